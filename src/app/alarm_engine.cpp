@@ -0,0 +1,104 @@
+#include "alarm_engine.hpp"
+
+#include <math.h>
+
+// Reconfigure the relative detector when the baseline moved by more than this fraction.
+static const float BASELINE_TOLERANCE = 0.05f;
+
+// lambda1 / lambda0 of the absolute detector. Its rates bracket the threshold so that the statistic
+// has zero drift exactly at the threshold: lambda0 = threshold * ln(k) / (k - 1) = 0.90 x threshold,
+// the false alarm interval holds for every rate up to there.
+static const float THRESHOLD_STEP = 1.22f;
+
+void CusumDetector::configure(float l0, float l1, float false_alarm_interval_s) {
+  lambda0 = l0;
+  lambda1 = l1;
+  if (!valid()) {
+    h = 0.0f;
+    return;
+  }
+  log_ratio = logf(lambda1 / lambda0);
+  // Siegmund's approximation of the in-control average run length:
+  //   ARL0 = (exp(h) - h - 1) / |drift0|,  drift0 = lambda0 * (k - 1 - ln k) per second, k = lambda1 / lambda0
+  // solve exp(h) - h - 1 = ARL0 * |drift0| for h by fixed point iteration.
+  float k = lambda1 / lambda0;
+  float x = false_alarm_interval_s * lambda0 * (k - 1.0f - log_ratio);
+  float hh = logf(x + 1.0f);
+  for (int i = 0; i < 8; i++)
+    hh = logf(x + hh + 1.0f);
+  h = (hh > 1.0f) ? hh : 1.0f;
+}
+
+float CusumDetector::update(uint32_t counts, float dt_s) {
+  if (!valid())
+    return 0.0f;
+  // log likelihood ratio of the batch: counts * ln(lambda1 / lambda0) - (lambda1 - lambda0) * dt
+  s += counts * log_ratio - (lambda1 - lambda0) * dt_s;
+  if (s < 0.0f)
+    s = 0.0f;
+  else if (s > 2.0f * h)
+    s = 2.0f * h;  // limit, so an alarm can clear again in reasonable time
+  return s;
+}
+
+float CusumDetector::expectedDetectionS() const {
+  if (!valid())
+    return 0.0f;
+  // ARL1 = (exp(-h) + h - 1) / drift1,  drift1 = lambda1 * ln k - (lambda1 - lambda0) per second
+  float drift1 = lambda1 * log_ratio - (lambda1 - lambda0);
+  return (expf(-h) + h - 1.0f) / drift1;
+}
+
+void AlarmEngine::configure(float f, float thr_cps, float false_alarm_interval_h) {
+  factor = (f > 1.0f) ? f : 1.0f;
+  threshold_cps = thr_cps;
+  false_alarm_interval_s = false_alarm_interval_h * 3600.0f;
+  if (threshold_cps > 0.0f) {
+    // independent of factor, which is about the baseline only
+    float lambda0 = threshold_cps * logf(THRESHOLD_STEP) / (THRESHOLD_STEP - 1.0f);
+    absolute.configure(lambda0, lambda0 * THRESHOLD_STEP, false_alarm_interval_s);
+  } else {
+    absolute.configure(0.0f, 0.0f, false_alarm_interval_s);
+  }
+  configured_baseline = 0.0f;
+  relative.configure(0.0f, 0.0f, false_alarm_interval_s);
+}
+
+AlarmEvent AlarmEngine::update(uint32_t counts, uint32_t dt_ms, float baseline_cps) {
+  if (baseline_cps > 0.0f && fabsf(baseline_cps - configured_baseline) > BASELINE_TOLERANCE * configured_baseline) {
+    // the baseline drifts slowly, so only redo the (log heavy) configuration now and then.
+    relative.configure(baseline_cps, baseline_cps * factor, false_alarm_interval_s);
+    configured_baseline = baseline_cps;
+  }
+
+  float dt_s = dt_ms / 1000.0f;
+  float s_rel = relative.update(counts, dt_s);
+  float s_abs = absolute.update(counts, dt_s);
+  bool rel_hit = relative.valid() && (s_rel >= relative.threshold());
+  bool abs_hit = absolute.valid() && (s_abs >= absolute.threshold());
+
+  if ((s_rel > 0.0f) || (s_abs > 0.0f))
+    since_zero_ms += dt_ms;
+  else
+    since_zero_ms = 0;
+
+  if (!alarm) {
+    if (rel_hit || abs_hit) {
+      alarm = true;
+      by_threshold = abs_hit;
+      detection_delay_ms = since_zero_ms;
+      return ALARM_RAISED;
+    }
+    return ALARM_NONE;
+  }
+
+  // hysteresis: stay in alarm until the detector(s) calmed down to half their threshold
+  bool rel_calm = !relative.valid() || (s_rel < relative.threshold() / 2.0f);
+  bool abs_calm = !absolute.valid() || (s_abs < absolute.threshold() / 2.0f);
+  if (rel_calm && abs_calm) {
+    alarm = false;
+    by_threshold = false;
+    return ALARM_CLEARED;
+  }
+  return ALARM_ACTIVE;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file alarm_engine.hpp
+ * @brief Local radiation alarm based on sequential change-point detection
+ *
+ * Instead of comparing rates when the display gets refreshed, AlarmEngine is fed
+ * with every pulse batch and runs Poisson CUSUM tests, which detect a rate step
+ * as fast as possible for a given false alarm rate:
+ *
+ * - relative: baseline rate -> factor x baseline rate
+ * - absolute: 0.9 x threshold -> 1.1 x threshold (threshold from the alarm dose rate), so its
+ *   statistic grows above the threshold and shrinks below it, independent of the factor
+ *
+ * The decision threshold h is derived from the configured mean time between false
+ * alarms, the expected detection latency follows from h and the step size.
+ * An alarm is cleared again (hysteresis) when the test statistic falls below h / 2.
+ *
+ * No Arduino dependencies, times are passed in [ms].
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include "config/config.hpp"  // LOCAL_ALARM_*, the host tools use the defaults below
+#endif
+
+#ifndef LOCAL_ALARM_FALSE_ALARM_INTERVAL
+#define LOCAL_ALARM_FALSE_ALARM_INTERVAL 8760  // h
+#endif
+
+enum AlarmEvent {
+  ALARM_NONE,     // no alarm
+  ALARM_RAISED,   // alarm just started
+  ALARM_ACTIVE,   // alarm still going on
+  ALARM_CLEARED   // alarm just ended
+};
+
+/**
+ * @class CusumDetector
+ * @brief One-sided Poisson CUSUM test for a rate step lambda0 -> lambda1
+ */
+class CusumDetector {
+public:
+  /** @brief Set rates [cps] and mean time between false alarms [s], recomputes h */
+  void configure(float lambda0, float lambda1, float false_alarm_interval_s);
+
+  /** @brief Add counts collected within dt_s, returns the test statistic */
+  float update(uint32_t counts, float dt_s);
+
+  /** @brief Expected time to detect a step to lambda1 [s] */
+  float expectedDetectionS() const;
+
+  void reset() { s = 0.0f; }
+  float statistic() const { return s; }
+  float threshold() const { return h; }
+  bool valid() const { return lambda1 > lambda0 && lambda0 > 0.0f; }
+
+private:
+  float lambda0 = 0.0f;
+  float lambda1 = 0.0f;
+  float log_ratio = 0.0f;  // ln(lambda1 / lambda0)
+  float h = 0.0f;
+  float s = 0.0f;
+};
+
+class AlarmEngine {
+public:
+  /**
+   * @param factor step factor to detect relative to the baseline (> 1)
+   * @param threshold_cps absolute alarm threshold (<= 0: disabled)
+   * @param false_alarm_interval_h wanted mean time between false alarms [h]
+   */
+  void configure(float factor, float threshold_cps, float false_alarm_interval_h);
+
+  /**
+   * @brief Feed one pulse batch
+   * @param counts counts collected within dt_ms
+   * @param dt_ms time span of the batch
+   * @param baseline_cps long term count rate to detect steps against (<= 0: not known yet)
+   */
+  AlarmEvent update(uint32_t counts, uint32_t dt_ms, float baseline_cps);
+
+  bool active() const { return alarm; }
+
+  /** @brief true if the absolute threshold detector raised the current alarm */
+  bool byThreshold() const { return by_threshold; }
+
+  /** @brief Expected detection latency of the relative detector at the current baseline [s] */
+  float expectedDetectionS() const { return relative.expectedDetectionS(); }
+
+  /** @brief Time since the step was most likely to have started, when the alarm got raised [ms] */
+  uint32_t detectionDelayMs() const { return detection_delay_ms; }
+
+private:
+  CusumDetector relative;
+  CusumDetector absolute;
+  float factor = 3.0f;
+  float threshold_cps = 0.0f;
+  float false_alarm_interval_s = 0.0f;
+  float configured_baseline = 0.0f;
+  bool alarm = false;
+  bool by_threshold = false;
+  uint32_t since_zero_ms = 0;  // time since the statistic of the raising detector left 0
+  uint32_t detection_delay_ms = 0;
+};
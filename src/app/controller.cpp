@@ -9,11 +9,22 @@ static const unsigned long AFTERSTART = 5000;
 // In which intervals the OLED display is updated. [msec]
 static const unsigned long DISPLAYREFRESH = 10000;
 
-// Minimum amount of GM pulses required to early-update the display.
-static const unsigned long MINCOUNTS = 100;
+// Period of the pulse interval histogram (serial statistics log, MQTT, web API). [msec]
+static const unsigned long HISTOGRAM_INTERVAL = 60000;
 
-// Target loop duration [ms]
-static const unsigned long LOOP_DURATION = 1000;
+// Stage periods of the scheduler. [msec]
+static const unsigned long TUBE_INTERVAL = 250;      // read pulses, update rates, check alarm
+static const unsigned long STATUS_INTERVAL = 1000;   // HV, WiFi, BLE status
+static const unsigned long WEB_INTERVAL = 100;       // web server / config portal, serves one request per poll
+static const unsigned long MQTT_INTERVAL = 1000;     // MQTT client keepalive
+static const unsigned long ONE_MINUTE_INTERVAL = 60000;
+static const unsigned long CPU_LOAD_INTERVAL = 10000;   // per task cpu load (10000 tick samples per core)
+
+// Stack of networkTask [bytes], MQTT over TLS and the web API need quite some.
+static const uint32_t NETWORK_TASK_STACK = 10240;
+
+// read_GMC() passes the pulse intervals to a plain function, this is where they go.
+static MeasurementPipeline *interval_target = nullptr;
 
 void MultiGeigerController::begin() {
   isLoraBoard = io.detectLoRa();
@@ -39,8 +50,102 @@ void MultiGeigerController::begin() {
   mqtt.begin(mqttCfg, ssid);
   ble.begin(ssid, sendToBle && switches_state.ble_on);
   setup_log_data(SERIAL_DEBUG);
+  interval_target = &pipeline;
+  sensors.onPulses(recordIntervals);
   sensors.beginTube();
-  log(DEBUG, "All Setup done");
+  MeasurementSources sources{
+    .millis = [](void *) -> uint32_t { return millis(); },
+    .utc_ms = [](void *) -> uint64_t { return clock_utc_us() / 1000; },
+    .read_pulses = [](unsigned long &counts, unsigned long &timestamp, void *c) {
+      PERF_SCOPE("tube.read");
+      unsigned int between;  // time between the last two pulses, not needed
+      static_cast<Sensors *>(c)->readTube(counts, timestamp, between);
+    },
+    .context = &sensors
+  };
+  pipeline.begin(sources, tubes[TUBE_TYPE].type, tubes[TUBE_TYPE].nbr, tubes[TUBE_TYPE].cps_to_uSvph);
+#if ARCHIVE_ENABLED
+  archive.begin();  // formats the partition on first boot, takes a few seconds then
+#endif
+  setupSinks();
+  setup_cpu_load();
+  setupStages();
+  LOG(DEBUG, "All Setup done");
+}
+
+static void networkTask(void *param) {
+  Scheduler *network = static_cast<Scheduler *>(param);
+  for (;;)
+    network->dispatch();
+}
+
+void MultiGeigerController::setupStages() {
+  // Counting on COUNTING_CPU: Arduino runs loop() there (ARDUINO_RUNNING_CORE == APP_CPU).
+  if (xPortGetCoreID() != COUNTING_CPU)
+    LOG(WARNING, "loop() runs on core %d, not on COUNTING_CPU %d", xPortGetCoreID(), COUNTING_CPU);
+  counting.begin();
+  counting.add("tube", TUBE_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageTube(); }, this);
+  counting.start();
+
+  // Everything else in networkTask on NETWORK_CPU, in order of importance: if several stages are due,
+  // they run in this order.
+  scheduler.add("status", STATUS_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageStatus(); }, this);
+  stage_display = scheduler.add("display", DISPLAYREFRESH, [](void *c) { static_cast<MultiGeigerController *>(c)->stageDisplay(); }, this, AFTERSTART);
+  scheduler.add("web", WEB_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageWeb(); }, this);
+  scheduler.add("mqtt", MQTT_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageMqtt(); }, this);
+  int thp = scheduler.add("thp", MEASUREMENT_INTERVAL * 1000, [](void *c) { static_cast<MultiGeigerController *>(c)->stageThp(); }, this);
+  scheduler.add("one_minute_log", ONE_MINUTE_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageOneMinuteLog(); }, this);
+  scheduler.add("statistics", HISTOGRAM_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageStatistics(); }, this);
+  scheduler.add("transmit", MEASUREMENT_INTERVAL * 1000, [](void *c) { static_cast<MultiGeigerController *>(c)->stageTransmit(); }, this);
+  scheduler.add("history", ONE_MINUTE_INTERVAL, [](void *c) { static_cast<MultiGeigerController *>(c)->stageHistory(); }, this);
+  stage_archive = scheduler.add("archive", 0, [](void *c) { static_cast<MultiGeigerController *>(c)->stageArchive(); }, this);
+  scheduler.add("cpu", CPU_LOAD_INTERVAL, [](void *) { update_cpu_load(); }, nullptr);
+#if PERF_PROFILING && (PERF_MQTT_INTERVAL_MS > 0)
+  scheduler.add("perf", PERF_MQTT_INTERVAL_MS, [](void *c) { static_cast<MultiGeigerController *>(c)->stagePerf(); }, this);
+#endif
+  // networkTask is only created now: dispatch() must not run while stages are still being added.
+  TaskHandle_t network_task;
+  xTaskCreatePinnedToCore(networkTask, "networkTask", NETWORK_TASK_STACK, &scheduler, 1, &network_task, NETWORK_CPU);
+  scheduler.begin(network_task);
+  scheduler.start();
+  scheduler.trigger(thp);  // have THP values for the display right away
+}
+
+void MultiGeigerController::setupSinks() {
+  // Live records (display cadence), in this order: BLE, display, MQTT, serial log.
+  live_sinks.add([](const MeasurementRecord &m, void *c) { static_cast<BleService *>(c)->update(m.cpm); }, &ble);
+  live_sinks.add([](const MeasurementRecord &m, void *c) {
+    MultiGeigerController *self = static_cast<MultiGeigerController *>(c);
+    self->display.showGmc(m, showDisplay && self->switches_state.display_on);
+  }, this);
+  live_sinks.add([](const MeasurementRecord &m, void *c) { static_cast<MqttPublisher *>(c)->publishLive(m); }, &mqtt);
+  live_sinks.add([](const MeasurementRecord &m, void *) {
+    if ((Serial_Print_Mode == Serial_Logging) && !(m.status & MEAS_NO_PULSES))
+      log_data(m);
+    else if (Serial_Print_Mode == Serial_Binary)
+      log_data_binary(m);
+  }, nullptr);
+
+  // Interval records (MEASUREMENT_INTERVAL): uplinks, MQTT, archive, binary serial output.
+  interval_sinks.add([](const MeasurementRecord &m, void *c) {
+    // HTTP and LoRa uplinks are done by the transmission task, this never blocks
+    if (!static_cast<WifiManager *>(c)->send(m))
+      LOG(WARNING, "Transmission queue full, measurement %u dropped", m.seq);
+  }, &wifi);
+  interval_sinks.add([](const MeasurementRecord &m, void *c) { static_cast<MqttPublisher *>(c)->publishMeasurement(m); }, &mqtt);
+  interval_sinks.add([](const MeasurementRecord &m, void *c) {
+    // a full block is written to flash by its own stage, after the other sinks are done
+    MultiGeigerController *self = static_cast<MultiGeigerController *>(c);
+    if (self->archive.add(m))
+      self->scheduler.trigger(self->stage_archive);
+  }, this);
+  interval_sinks.add([](const MeasurementRecord &m, void *) {
+    if (Serial_Print_Mode == Serial_Binary)
+      log_data_binary(m);
+  }, nullptr);
+
+  // Minute records: history (read by the web server, also in networkTask).
+  minute_sinks.add([](const MeasurementRecord &m, void *c) { static_cast<History *>(c)->add(history_sample(m)); }, &history);
 }
 
 void MultiGeigerController::setupNtp(int wifi_status) {
@@ -85,164 +190,173 @@ int MultiGeigerController::updateBleStatus() {  // currently no error detection
   return st;
 }
 
-void MultiGeigerController::publish(unsigned long current_ms, unsigned long current_counts, unsigned long gm_count_timestamp, unsigned long current_hv_pulses,
-                                    float temperature, float humidity, float pressure) {
-  static unsigned long last_timestamp = millis();
-  static unsigned long last_counts = 0;
-  static unsigned long last_hv_pulses = 0;
-  static unsigned long last_count_timestamp = 0;
-  static unsigned int accumulated_GMC_counts = 0;
-  static unsigned long accumulated_time = 0;
-  static float accumulated_Count_Rate = 0.0, accumulated_Dose_Rate = 0.0;
-
-  if (((current_counts - last_counts) >= MINCOUNTS) || ((current_ms - last_timestamp) >= DISPLAYREFRESH)) {
-    if ((gm_count_timestamp == 0) && (last_count_timestamp == 0)) {
-      return;
-    }
-    last_timestamp = current_ms;
-    int hv_pulses_delta = current_hv_pulses - last_hv_pulses;
-    last_hv_pulses = current_hv_pulses;
-    int counts = current_counts - last_counts;
-    last_counts = current_counts;
-    int dt = gm_count_timestamp - last_count_timestamp;
-    last_count_timestamp = gm_count_timestamp;
-
-    accumulated_time += dt;
-    accumulated_GMC_counts = current_counts;
-
-    float GMC_factor_uSvph = tubes[TUBE_TYPE].cps_to_uSvph;
-
-    float Count_Rate = (dt != 0) ? (float)counts * 1000.0 / (float)dt : 0.0;
-    float Dose_Rate = Count_Rate * GMC_factor_uSvph;
-
-    accumulated_Count_Rate = (accumulated_time != 0) ? (float)accumulated_GMC_counts * 1000.0 / (float)accumulated_time : 0.0;
-    accumulated_Dose_Rate = accumulated_Count_Rate * GMC_factor_uSvph;
-
-    ble.update((unsigned int)(Count_Rate * 60));
-    display.showGmc((unsigned int)(accumulated_time / 1000), (int)(accumulated_Dose_Rate * 1000), (int)(Count_Rate * 60),
-                    (showDisplay && switches_state.display_on));
-    mqtt.publishLive(Count_Rate, Dose_Rate, counts, dt, hv_pulses_delta,
-                     accumulated_GMC_counts, accumulated_time, accumulated_Count_Rate, accumulated_Dose_Rate,
-                     temperature, humidity, pressure);
-
-    if (soundLocalAlarm && GMC_factor_uSvph > 0) {
-      if (accumulated_Dose_Rate > localAlarmThreshold) {
-        log(WARNING, "Local alarm: Accumulated dose of %.3f µSv/h above threshold at %.3f µSv/h", accumulated_Dose_Rate, localAlarmThreshold);
-        io.triggerAlarm();
-      } else if (Dose_Rate > (accumulated_Dose_Rate * localAlarmFactor)) {
-        log(WARNING, "Local alarm: Current dose of %.3f > %d x accumulated dose of %.3f µSv/h", Dose_Rate, localAlarmFactor, accumulated_Dose_Rate);
-        io.triggerAlarm();
-      }
-    }
+void MultiGeigerController::publish() {
+  // runs every DISPLAYREFRESH ms (first time after AFTERSTART) and when stageTube() saw MINCOUNTS new pulses
+  if (pipeline.liveRecord(last_live))
+    live_sinks.publish(last_live);
+}
 
-    if (Serial_Print_Mode == Serial_Logging) {
-      log_data(counts, dt, Count_Rate, Dose_Rate, hv_pulses_delta,
-               accumulated_GMC_counts, accumulated_time, accumulated_Count_Rate, accumulated_Dose_Rate,
-               temperature, humidity, pressure);
-    }
-  } else {
-    static unsigned long boot_timestamp = millis();
-    static unsigned long afterStartTime = AFTERSTART;
-    if (afterStartTime && ((current_ms - boot_timestamp) >= afterStartTime)) {
-      afterStartTime = 0;
-      ble.update(0);
-      display.showGmc(0, 0, 0, (showDisplay && switches_state.display_on));
-    }
+void MultiGeigerController::logAlarm(AlarmEvent event) {
+  const AlarmEngine &alarm = pipeline.alarm();
+  switch (event) {
+  case ALARM_RAISED:
+    if (alarm.byThreshold())
+      LOG(WARNING, "Local alarm: Dose rate above threshold at %.3f µSv/h, detected after %.1f s",
+          localAlarmThreshold, alarm.detectionDelayMs() / 1000.0);
+    else
+      LOG(WARNING, "Local alarm: Current dose > %d x accumulated dose of %.3f µSv/h, detected after %.1f s (expected %.1f s)",
+          localAlarmFactor, pipeline.total().cps * pipeline.cpsToUSvph(), alarm.detectionDelayMs() / 1000.0, alarm.expectedDetectionS());
+    break;
+  case ALARM_CLEARED:
+    LOG(INFO, "Local alarm: cleared");
+    break;
+  default:
+    break;
   }
 }
 
-void MultiGeigerController::oneMinuteLog(unsigned long current_ms, unsigned long current_counts) {
-  static unsigned int last_counts = 0;
-  static unsigned long last_timestamp = millis();
-  int dt = current_ms - last_timestamp;
-  if (dt >= 60000) {
-    unsigned long counts = current_counts - last_counts;
-    unsigned int count_rate = (counts * 60000) / dt;
-    if (((((counts * 60000) % dt) * 2) / dt) >= 1) {
-      count_rate++;  // Rounding + 0.5
-    }
-    log_data_one_minute((current_ms / 1000), count_rate, counts);
-    last_timestamp = current_ms;
-    last_counts = current_counts;
-  }
+void MultiGeigerController::oneMinuteLog() {
+  // runs every ONE_MINUTE_INTERVAL ms, dt is the real time since the last run
+  uint32_t time_s, cpm, counts;
+  if (pipeline.oneMinute(time_s, cpm, counts))
+    log_data_one_minute(time_s, cpm, counts);
 }
 
-void MultiGeigerController::statisticsLog(unsigned long current_counts, unsigned int time_between) {
-  static unsigned long last_counts = 0;
-  if (current_counts != last_counts) {
-    log_data_statistics(time_between);
-    last_counts = current_counts;
-  }
+void MultiGeigerController::recordIntervals(const uint32_t *intervals_us, size_t count) {
+  // called by read_GMC with every batch of pulses, so no time between two impacts gets lost
+  interval_target->addIntervals(intervals_us, count);
+  if (SERIAL_BINARY_PULSES && (Serial_Print_Mode == Serial_Binary))
+    log_pulses_binary(intervals_us, count);
 }
 
-void MultiGeigerController::readThp(unsigned long current_ms) {
-  static unsigned long last_timestamp = 0;
-  if (!last_timestamp || (current_ms - last_timestamp) >= (MEASUREMENT_INTERVAL * 1000)) {
-    last_timestamp = current_ms;
-    have_thp = sensors.readThp(temperature, humidity, pressure);
-  }
+unsigned long MultiGeigerController::getHistogramPeriod() const {
+  return HISTOGRAM_INTERVAL;
 }
 
-void MultiGeigerController::transmit(unsigned long current_ms, unsigned long current_counts, unsigned long gm_count_timestamp, unsigned long current_hv_pulses,
-                                     bool have_thp_in, float temperature_in, float humidity_in, float pressure_in, int wifi_status) {
-  static unsigned long last_counts = 0;
-  static unsigned long last_hv_pulses = 0;
-  static unsigned long last_timestamp = millis();
-  static unsigned long last_count_timestamp = 0;
-  if ((current_ms - last_timestamp) >= (MEASUREMENT_INTERVAL * 1000)) {
-    if ((gm_count_timestamp == 0) && (last_count_timestamp == 0)) {
-      return;
+void MultiGeigerController::statisticsLog(unsigned long current_ms) {
+  // runs every HISTOGRAM_INTERVAL ms
+  pipeline.rotateHistogram();
+  const IntervalHistogram &intervals_last = pipeline.intervalsLast();
+
+  if (Serial_Print_Mode == Serial_Statistics_Log) {
+    for (size_t i = 0; i < IntervalHistogram::BUCKETS; i++) {
+      if (intervals_last.bucket(i))
+        log_data_statistics(current_ms / 1000, IntervalHistogram::bucketLow(i), IntervalHistogram::bucketHigh(i), intervals_last.bucket(i));
     }
-    last_timestamp = current_ms;
-    unsigned long counts = current_counts - last_counts;
-    last_counts = current_counts;
-    int dt = gm_count_timestamp - last_count_timestamp;
-    last_count_timestamp = gm_count_timestamp;
-    unsigned int current_cpm = (dt != 0) ? (int)(counts * 60000 / dt) : 0;
-
-    int hv_pulses_delta = current_hv_pulses - last_hv_pulses;
-    last_hv_pulses = current_hv_pulses;
-
-    log(DEBUG, "Measured GM: cpm= %d HV=%d", current_cpm, hv_pulses_delta);
-
-    wifi.send(tubes[TUBE_TYPE].type, tubes[TUBE_TYPE].nbr, dt, hv_pulses_delta, counts, current_cpm,
-              have_thp_in, temperature_in, humidity_in, pressure_in, wifi_status);
-    mqtt.publishMeasurement(tubes[TUBE_TYPE].type, tubes[TUBE_TYPE].nbr, dt, hv_pulses_delta, counts, current_cpm,
-                            have_thp_in, temperature_in, humidity_in, pressure_in, wifi_status);
   }
-}
 
-void MultiGeigerController::loopOnce() {
-  unsigned long current_ms = millis();
+  char json[IntervalHistogram::JSON_MAX_LEN];
+  intervals_last.toJson(json, sizeof(json));
+  mqtt.publishJson("interval_histogram_us", json);
+}
 
-  sensors.readTube(gm_counts, gm_count_timestamp, gm_count_time_between);
+void MultiGeigerController::transmit() {
+  // runs every MEASUREMENT_INTERVAL s
+  MeasurementRecord m;
+  if (!pipeline.intervalRecord(m))
+    return;
+  LOG(DEBUG, "Measured GM: cpm= %u HV=%u", m.cpm, m.hv_pulses);
+  interval_sinks.publish(m);
+
+  HvTelemetry hv;
+  sensors.readHvTelemetry(hv);
+  char json[HV_TELEMETRY_JSON_LEN];
+  format_hv_telemetry(&hv, millis(), json, sizeof(json));
+  mqtt.publishJson("hv", json);
+}
 
-  readThp(current_ms);
+void MultiGeigerController::stageTube() {
+  pipeline.configureAlarm(soundLocalAlarm, localAlarmFactor, localAlarmThreshold);
+  TubeResult result = pipeline.tube();
+  logAlarm(result.alarm);
+  if (result.sound_alarm)
+    io.triggerAlarm();
+  if (result.display_due)
+    scheduler.trigger(stage_display);
+}
 
+void MultiGeigerController::stageStatus() {
   sensors.readHv(hv_error, hv_pulses);
-  display.setStatus(STATUS_HV, hv_error ? ST_HV_ERROR : ST_HV_OK);
+  pipeline.setHv(hv_error, hv_pulses);
+  {
+    PERF_SCOPE("status.hv_display");  // only posts to displayTask (no I2C here any more)
+    display.setStatus(STATUS_HV, hv_error ? ST_HV_ERROR : ST_HV_OK);
+  }
+  {
+    PERF_SCOPE("status.wifi");
+    int wifi_status = updateWifiStatus();
+    pipeline.setWifiStatus(wifi_status, wifi_status == ST_WIFI_CONNECTED);
+    setupNtp(wifi_status);
+  }
+  {
+    PERF_SCOPE("status.ble");
+    updateBleStatus();
+  }
+}
 
-  int wifi_status = updateWifiStatus();
-  setupNtp(wifi_status);
+void MultiGeigerController::stageDisplay() {
+  publish();
+}
 
-  updateBleStatus();
+void MultiGeigerController::stageWeb() {
+  {
+    PERF_SCOPE("web.poll_tx");
+    wifi.pollTx();
+  }
+  {
+    PERF_SCOPE("web.poll_web");
+    wifi.pollWeb();
+  }
+}
 
-  wifi.pollTx();
-  wifi.pollWeb();
+void MultiGeigerController::stageMqtt() {
   mqtt.loop();
+}
 
-  publish(current_ms, gm_counts, gm_count_timestamp, hv_pulses, temperature, humidity, pressure);
+void MultiGeigerController::stageThp() {
+  have_thp = sensors.readThp(temperature, humidity, pressure);
+  pipeline.setThp(have_thp, temperature, humidity, pressure);
+}
 
+void MultiGeigerController::stageOneMinuteLog() {
   if (Serial_Print_Mode == Serial_One_Minute_Log)
-    oneMinuteLog(current_ms, gm_counts);
+    oneMinuteLog();
+}
+
+void MultiGeigerController::stageStatistics() {
+  statisticsLog(millis());
+}
+
+void MultiGeigerController::stageTransmit() {
+  transmit();
+}
+
+void MultiGeigerController::stageHistory() {
+  MeasurementRecord m;
+  if (pipeline.minuteRecord(m))
+    minute_sinks.publish(m);
+}
 
-  if (Serial_Print_Mode == Serial_Statistics_Log)
-    statisticsLog(gm_counts, gm_count_time_between);
+void MultiGeigerController::stageArchive() {
+  // only triggered (interval sink), a block every ARCHIVE_BLOCK_RECORDS interval records
+  archive.write();
+}
 
-  transmit(current_ms, gm_counts, gm_count_timestamp, hv_pulses, have_thp, temperature, humidity, pressure, wifi_status);
+void MultiGeigerController::stagePerf() {
+  // only configured with PERF_MQTT_INTERVAL_MS, /api/perf has the same data
+  static char json[PERF_JSON_LEN];
+  format_perf(json, sizeof(json));
+  mqtt.publishJson("perf", json);
+  static CpuLoad load;
+  static char cpu_json[CPU_LOAD_JSON_LEN];
+  read_cpu_load(&load);
+  format_cpu_load(&load, cpu_json, sizeof(cpu_json));
+  mqtt.publishJson("cpu", cpu_json);
+}
 
-  long loop_duration = millis() - current_ms;
-  iotWebConf.delay((loop_duration < LOOP_DURATION) ? (LOOP_DURATION - loop_duration) : 0);
+void MultiGeigerController::loopOnce() {
+  // the counting stages, everything else runs in networkTask (see setupStages())
+  counting.dispatch();
 }
 
 void MultiGeigerController::applyTickSettings(bool ledTick, bool speakerTick) {
@@ -13,14 +13,21 @@
 
 #include "config/config.hpp"
 #include "core/core.hpp"
+#include "core/cpu.hpp"
+#include "core/history.hpp"
+#include "core/measurement.hpp"
+#include "core/profiler.hpp"
 #include "drivers/clock/clock.hpp"
 #include "drivers/io/io.hpp"
 #include "drivers/sensors/sensors.hpp"
 #include "drivers/display/display.hpp"
+#include "drivers/storage/archive.hpp"
 #include "comm/ble/ble.hpp"
 #include "comm/wifi/wifi.hpp"
 #include "comm/lora/loraWan.hpp"
 #include "comm/mqtt/mqtt.hpp"
+#include "app/measurement_pipeline.hpp"
+#include "app/scheduler.hpp"
 
 /**
  * @class MultiGeigerController
@@ -34,7 +41,7 @@ public:
   /** @brief Initialize all subsystems (sensors, display, communication) */
   void begin();
 
-  /** @brief Execute one iteration of the main measurement loop */
+  /** @brief Wait for the next due counting stage(s) and run them (see Scheduler), on COUNTING_CPU */
   void loopOnce();
 
   /** @brief Update LED and speaker tick settings
@@ -49,7 +56,31 @@ public:
   void applyDisplaySetting(bool showDisplay);
 
   /** @brief Get current radiation counts */
-  unsigned long getCounts() const { return gm_counts; }
+  unsigned long getCounts() const { return pipeline.counts(); }
+
+  /** @brief The latest live record (what display, BLE, MQTT and serial log got), networkTask only */
+  const MeasurementRecord &getLastMeasurement() const { return last_live; }
+
+  /** @brief Count rate over one window (all rates shown / sent are taken from the same estimator) */
+  RateEstimate getRate(RateWindow window) const { return pipeline.rate(window); }
+
+  /** @brief Average count rate since boot */
+  RateEstimate getTotalRate() const { return pipeline.total(); }
+
+  /** @brief Histogram of the times between two pulses of the last complete histogram period */
+  const IntervalHistogram &getIntervalsLast() const { return pipeline.intervalsLast(); }
+
+  /** @brief Histogram of the times between two pulses since boot (without the running period) */
+  const IntervalHistogram &getIntervalsTotal() const { return pipeline.intervalsTotal(); }
+
+  /** @brief Duration of one histogram period [ms] */
+  unsigned long getHistogramPeriod() const;
+
+  /** @brief Per minute history with 10 min / 1 h rollups, networkTask only */
+  const History &getHistory() const { return history; }
+
+  /** @brief Compressed interval records on LittleFS (query() reads the flash), networkTask only */
+  Archive &getArchive() { return archive; }
 
   /** @brief Get current temperature (°C) */
   float getTemperature() const { return temperature; }
@@ -66,17 +97,39 @@ public:
   /** @brief Check for HV error */
   bool hasHvError() const { return hv_error; }
 
+  /** @brief Outbox of the MQTT uplink (any task) */
+  void readMqttOutboxStats(OutboxStats &stats) { mqtt.readOutboxStats(stats); }
+
+  /** @brief Stage scheduler of the counting task (run time statistics of the stages) */
+  const Scheduler &getCountingScheduler() const { return counting; }
+
+  /** @brief Stage scheduler of networkTask (run time statistics of the stages) */
+  const Scheduler &getScheduler() const { return scheduler; }
+
 private:
   void setupNtp(int wifiStatus);
   int updateWifiStatus();
   int updateBleStatus();
-  void readThp(unsigned long current_ms);
-  void publish(unsigned long current_ms, unsigned long current_counts, unsigned long gm_count_timestamp, unsigned long current_hv_pulses,
-               float temperature, float humidity, float pressure);
-  void oneMinuteLog(unsigned long current_ms, unsigned long current_counts);
-  void statisticsLog(unsigned long current_counts, unsigned int time_between);
-  void transmit(unsigned long current_ms, unsigned long current_counts, unsigned long gm_count_timestamp, unsigned long current_hv_pulses,
-                bool have_thp, float temperature, float humidity, float pressure, int wifi_status);
+  void setupStages();
+  void setupSinks();
+  void stageTube();
+  void stageStatus();
+  void stageDisplay();
+  void stageWeb();
+  void stageMqtt();
+  void stageThp();
+  void stageOneMinuteLog();
+  void stageStatistics();
+  void stageTransmit();
+  void stageHistory();
+  void stageArchive();
+  void stagePerf();
+  void publish();
+  void transmit();
+  void logAlarm(AlarmEvent event);
+  void oneMinuteLog();
+  void statisticsLog(unsigned long current_ms);
+  static void recordIntervals(const uint32_t *intervals_us, size_t count);
 
   IoModule io;
   Sensors sensors;
@@ -85,6 +138,17 @@ private:
   WifiManager wifi;
   MqttPublisher mqtt;
   ClockModule clock;
+  MeasurementPipeline pipeline;  // counters, rates, local alarm, records
+  Scheduler counting;   // loop(), COUNTING_CPU
+  Scheduler scheduler;  // networkTask, NETWORK_CPU
+  int stage_display = -1;
+  int stage_archive = -1;
+  MeasurementFanout live_sinks;      // display, BLE, MQTT, serial log
+  MeasurementFanout interval_sinks;  // uplinks, MQTT, archive
+  MeasurementFanout minute_sinks;    // history
+  History history;
+  Archive archive;
+  MeasurementRecord last_live{};
 
   bool isLoraBoard = false;
   bool hv_error = false;
@@ -94,7 +158,4 @@ private:
   float humidity = 0.0f;
   float pressure = 0.0f;
   unsigned long hv_pulses = 0;
-  unsigned long gm_counts = 0;
-  unsigned long gm_count_timestamp = 0;
-  unsigned int gm_count_time_between = 0;
 };
@@ -0,0 +1,248 @@
+#include "measurement_pipeline.hpp"
+
+#include <math.h>
+
+// Minimum amount of GM pulses required to early-update the display.
+static const unsigned long MINCOUNTS = 100;
+
+// Minimum time between two early display updates. [msec]
+static const uint32_t DISPLAY_MIN_INTERVAL = 1000;
+
+// While the local alarm is active, repeat the alarm sound in these intervals. [msec]
+static const uint32_t ALARM_REPEAT = 10000;
+
+void MeasurementPipeline::begin(const MeasurementSources &src, const char *type, int nbr, float factor_uSvph) {
+  sources = src;
+  tube_type = type;
+  tube_nbr = nbr;
+  cps_to_uSvph = factor_uSvph;
+  uint32_t now_ms = now();
+  rates.reset(now_ms);
+  previous_tube_ms = now_ms;
+  minute_ms = now_ms;
+}
+
+void MeasurementPipeline::configureAlarm(bool enabled, int factor, float threshold_uSvph) {
+  alarm_enabled = enabled && (cps_to_uSvph > 0);
+  if (!alarm_enabled)
+    return;
+  if ((alarm_threshold != threshold_uSvph) || (alarm_factor != factor)) {
+    // (re-)configure on start and whenever the settings were changed via web config
+    alarm_engine.configure(factor, threshold_uSvph / cps_to_uSvph, LOCAL_ALARM_FALSE_ALARM_INTERVAL);
+    alarm_threshold = threshold_uSvph;
+    alarm_factor = factor;
+  }
+}
+
+TubeResult MeasurementPipeline::tube() {
+  uint32_t now_ms = now();
+
+  // only this task writes the counters, so it may read them without lock
+  unsigned long counts = gm_counts;
+  unsigned long timestamp = gm_count_timestamp;
+  sources.read_pulses(counts, timestamp, sources.context);
+
+  TubeResult result = {};
+  result.new_counts = counts - gm_counts;
+  unsigned long shown_counts;
+  uint32_t shown_ms;
+  {
+    SpinLockGuard guard(lock);
+    gm_counts = counts;
+    gm_count_timestamp = timestamp;
+    rates.update(now_ms, result.new_counts);
+    shown_counts = display_counts;
+    shown_ms = display_ms;
+  }
+
+  result.alarm = checkAlarm(result.new_counts, now_ms - previous_tube_ms);
+  previous_tube_ms = now_ms;
+  if (result.alarm == ALARM_RAISED) {
+    result.sound_alarm = true;
+    last_alarm_sound_ms = now_ms;
+  } else if ((result.alarm == ALARM_ACTIVE) && ((now_ms - last_alarm_sound_ms) >= ALARM_REPEAT)) {
+    result.sound_alarm = true;
+    last_alarm_sound_ms = now_ms;
+  }
+
+  // early display update at high count rates
+  result.display_due = ((counts - shown_counts) >= MINCOUNTS) && ((now_ms - shown_ms) >= DISPLAY_MIN_INTERVAL);
+  return result;
+}
+
+AlarmEvent MeasurementPipeline::checkAlarm(uint32_t counts, uint32_t dt_ms) {
+  // called with every batch of pulses, independent of the display / publish cadence
+  if (!alarm_enabled)
+    return ALARM_NONE;
+
+  // the relative test needs a reasonably known baseline (counting task writes rates, no lock needed)
+  RateEstimate accumulated = rates.total();
+  float baseline_cps = (accumulated.counts >= MINCOUNTS) ? accumulated.cps : 0.0f;
+  return alarm_engine.update(counts, dt_ms, baseline_cps);
+}
+
+void MeasurementPipeline::addIntervals(const uint32_t *intervals_us, size_t count) {
+  // called with every batch of pulses, so no time between two impacts gets lost
+  SpinLockGuard guard(lock);
+  for (size_t i = 0; i < count; i++)
+    intervals_current.add(intervals_us[i]);
+}
+
+void MeasurementPipeline::setHv(bool error, unsigned long pulses) {
+  hv_error = error;
+  hv_pulses = pulses;
+}
+
+void MeasurementPipeline::setThp(bool valid, float t, float h, float p) {
+  have_thp = valid;
+  temperature = t;
+  humidity = h;
+  pressure = p;
+}
+
+void MeasurementPipeline::setWifiStatus(int status, bool connected) {
+  wifi_status = status;
+  wifi_connected = connected;
+}
+
+MeasurementRecord MeasurementPipeline::buildRecord(MeasurementKind kind, unsigned long current_counts, unsigned long timestamp, uint64_t utc_ms) {
+  unsigned long counts = current_counts - last_counts[kind];
+  unsigned long dt = timestamp - last_count_timestamp[kind];
+  unsigned long hv_pulses_delta = hv_pulses - last_hv_pulses[kind];
+  last_counts[kind] = current_counts;
+  last_count_timestamp[kind] = timestamp;
+  last_hv_pulses[kind] = hv_pulses;
+
+  // live: the smoothed 10 s rate like before, interval / minute: exactly what was counted in dt
+  RateEstimate current = {};
+  if (kind == RECORD_LIVE) {
+    current = rate(RATE_10S);
+  } else if (dt != 0) {
+    current.cps = counts * 1000.0f / dt;
+    current.cps_err = sqrtf(counts) * 1000.0f / dt;
+  }
+  RateEstimate accumulated = total();
+
+  time_t utc = utc_ms / 1000;
+  uint16_t status = 0;
+  if (timestamp == 0)
+    status |= MEAS_NO_PULSES;
+  if (hv_error)
+    status |= MEAS_HV_ERROR;
+  if (have_thp)
+    status |= MEAS_THP_VALID;
+  if (wifi_connected)
+    status |= MEAS_WIFI_CONNECTED;
+  if (utc > CLOCK_VALID_AFTER)
+    status |= MEAS_TIME_VALID;
+
+  return MeasurementRecord{
+    .seq = ++last_seq[kind],
+    .kind = kind,
+    .status = status,
+    .utc = utc,
+    .utc_ms = (uint16_t)(utc_ms % 1000),
+    .uptime_ms = now(),
+    .tube_type = tube_type,
+    .tube_nbr = tube_nbr,
+    .counts = (uint32_t)counts,
+    .dt_ms = (uint32_t)dt,
+    .hv_pulses = (uint32_t)hv_pulses_delta,
+    .cps = current.cps,
+    .cps_err = current.cps_err,
+    .cpm = (uint32_t)lroundf(current.cps * 60),
+    .dose_uSvph = current.cps * cps_to_uSvph,
+    .total_counts = accumulated.counts,
+    .total_ms = accumulated.span_ms,
+    .total_cps = accumulated.cps,
+    .total_dose_uSvph = accumulated.cps * cps_to_uSvph,
+    .temperature = temperature,
+    .humidity = humidity,
+    .pressure = pressure,
+    .wifi_status = wifi_status
+  };
+}
+
+bool MeasurementPipeline::liveRecord(MeasurementRecord &m) {
+  unsigned long counts, timestamp;
+  readCounts(counts, timestamp);
+  uint64_t utc_ms = utcMs();  // the capture time, not when the sinks send the record
+  if (timestamp == 0) {
+    // no pulse yet, only end the greeting screen
+    if (greeting_done)
+      return false;
+    greeting_done = true;
+  } else {
+    SpinLockGuard guard(lock);
+    display_counts = counts;
+    display_ms = now();
+  }
+  m = buildRecord(RECORD_LIVE, counts, timestamp, utc_ms);
+  return true;
+}
+
+bool MeasurementPipeline::countedRecord(MeasurementKind kind, MeasurementRecord &m) {
+  unsigned long counts, timestamp;
+  readCounts(counts, timestamp);
+  uint64_t utc_ms = utcMs();
+  if (timestamp == 0)
+    return false;
+  m = buildRecord(kind, counts, timestamp, utc_ms);
+  return true;
+}
+
+bool MeasurementPipeline::intervalRecord(MeasurementRecord &m) {
+  return countedRecord(RECORD_INTERVAL, m);
+}
+
+bool MeasurementPipeline::minuteRecord(MeasurementRecord &m) {
+  return countedRecord(RECORD_MINUTE, m);
+}
+
+bool MeasurementPipeline::oneMinute(uint32_t &time_s, uint32_t &cpm, uint32_t &count) {
+  // dt is the real time since the previous call
+  uint32_t now_ms = now();
+  uint32_t dt = now_ms - minute_ms;
+  if (dt == 0)
+    return false;
+  unsigned long current_counts = counts();
+  uint64_t counts_60s = (uint64_t)(current_counts - minute_counts) * 60000;
+  cpm = counts_60s / dt;
+  if ((((counts_60s % dt) * 2) / dt) >= 1)
+    cpm++;  // Rounding + 0.5
+  count = current_counts - minute_counts;
+  time_s = now_ms / 1000;
+  minute_ms = now_ms;
+  minute_counts = current_counts;
+  return true;
+}
+
+void MeasurementPipeline::rotateHistogram() {
+  {
+    SpinLockGuard guard(lock);
+    intervals_last = intervals_current;
+    intervals_current.reset();
+  }
+  intervals_total.merge(intervals_last);
+}
+
+unsigned long MeasurementPipeline::counts() const {
+  SpinLockGuard guard(lock);
+  return gm_counts;
+}
+
+void MeasurementPipeline::readCounts(unsigned long &counts, unsigned long &timestamp) const {
+  SpinLockGuard guard(lock);
+  counts = gm_counts;
+  timestamp = gm_count_timestamp;
+}
+
+RateEstimate MeasurementPipeline::rate(RateWindow window) const {
+  SpinLockGuard guard(lock);
+  return rates.rate(window);
+}
+
+RateEstimate MeasurementPipeline::total() const {
+  SpinLockGuard guard(lock);
+  return rates.total();
+}
@@ -0,0 +1,156 @@
+/**
+ * @file measurement_pipeline.hpp
+ * @brief Everything between the GM pulses and the measurement records, independent of the hardware
+ *
+ * MeasurementPipeline owns the cumulative counters, the RateEstimator, the local alarm
+ * (AlarmEngine), the pulse interval histograms and the state of the live / interval records
+ * and the one minute log. Time, wall clock and pulses come from injected sources, so the
+ * same code runs in the firmware (millis(), clock_utc_us(), read_GMC()) and in tools/replay (trace
+ * time, trace file) - with no hidden function-local state.
+ *
+ * In the firmware, tube() and addIntervals() run in the counting task, everything else in
+ * networkTask. State used by both is guarded by a SpinLock.
+ *
+ * No Arduino dependencies, times are [ms].
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "app/alarm_engine.hpp"
+#include "app/rate_estimator.hpp"
+#include "core/log2_histogram.hpp"
+#include "core/measurement.hpp"
+#include "core/spinlock.hpp"
+
+// Times between two GM pulses [us]: 1/4 octave buckets up to 2^28 us (~4.5 min)
+typedef Log2Histogram<2, 28> IntervalHistogram;
+
+/**
+ * @struct MeasurementSources
+ * @brief Where the pipeline gets time and pulses from
+ */
+struct MeasurementSources {
+  uint32_t (*millis)(void *context);  ///< monotonic time [ms]
+  uint64_t (*utc_ms)(void *context);  ///< wall clock [ms]
+  /**
+   * Add the pulses since the previous call to counts and set timestamp to the time of the
+   * latest pulse [ms]. The times between the pulses go to addIntervals() before it returns.
+   */
+  void (*read_pulses)(unsigned long &counts, unsigned long &timestamp, void *context);
+  void *context;
+};
+
+/**
+ * @struct TubeResult
+ * @brief What the controller has to do after a tube() step
+ */
+struct TubeResult {
+  uint32_t new_counts;  ///< pulses of this step
+  AlarmEvent alarm;     ///< local alarm state change
+  bool sound_alarm;     ///< alarm raised, or still active and ALARM_REPEAT passed since the last sound
+  bool display_due;     ///< MINCOUNTS new pulses since the last live record, update the display early
+};
+
+class MeasurementPipeline {
+public:
+  /** @brief Start counting now, tube_type must be a static string */
+  void begin(const MeasurementSources &sources, const char *tube_type, int tube_nbr, float cps_to_uSvph);
+
+  /** @brief Local alarm settings, cheap if unchanged (call before every tube()) */
+  void configureAlarm(bool enabled, int factor, float threshold_uSvph);
+
+  /** @brief Read the new pulses, update rates and check the local alarm (counting task) */
+  TubeResult tube();
+
+  /** @brief Times between consecutive pulses [us], from read_pulses */
+  void addIntervals(const uint32_t *intervals_us, size_t count);
+
+  /** @brief Status values for the records (networkTask) */
+  void setHv(bool error, unsigned long pulses);
+  void setThp(bool valid, float temperature, float humidity, float pressure);
+  void setWifiStatus(int status, bool connected);
+
+  /**
+   * @brief Build the next live record (display cadence)
+   * @return false if there is nothing to show: no pulse yet and the greeting was already ended
+   */
+  bool liveRecord(MeasurementRecord &m);
+
+  /** @brief Build the next interval record (uplink cadence), false if there was no pulse yet */
+  bool intervalRecord(MeasurementRecord &m);
+
+  /** @brief Build the next minute record (history cadence), false if there was no pulse yet */
+  bool minuteRecord(MeasurementRecord &m);
+
+  /** @brief Counts and rounded cpm since the previous call, false if no time passed */
+  bool oneMinute(uint32_t &time_s, uint32_t &cpm, uint32_t &counts);
+
+  /** @brief End the running histogram period: it becomes intervalsLast() and is added to intervalsTotal() */
+  void rotateHistogram();
+
+  unsigned long counts() const;
+  void readCounts(unsigned long &counts, unsigned long &timestamp) const;
+  RateEstimate rate(RateWindow window) const;
+  RateEstimate total() const;
+  const AlarmEngine &alarm() const { return alarm_engine; }
+  float cpsToUSvph() const { return cps_to_uSvph; }
+
+  /** @brief Histogram of the last complete period (networkTask) */
+  const IntervalHistogram &intervalsLast() const { return intervals_last; }
+
+  /** @brief Histogram since boot without the running period (networkTask) */
+  const IntervalHistogram &intervalsTotal() const { return intervals_total; }
+
+private:
+  uint32_t now() const { return sources.millis(sources.context); }
+  uint64_t utcMs() const { return sources.utc_ms(sources.context); }
+  MeasurementRecord buildRecord(MeasurementKind kind, unsigned long counts, unsigned long timestamp, uint64_t utc_ms);
+  bool countedRecord(MeasurementKind kind, MeasurementRecord &m);
+  AlarmEvent checkAlarm(uint32_t counts, uint32_t dt_ms);
+
+  MeasurementSources sources = {};
+  const char *tube_type = "";
+  int tube_nbr = 0;
+  float cps_to_uSvph = 0.0f;
+
+  mutable SpinLock lock;
+  // counting task writes, both read (lock)
+  unsigned long gm_counts = 0;
+  unsigned long gm_count_timestamp = 0;
+  RateEstimator rates;
+  IntervalHistogram intervals_current;
+  // counting task only
+  uint32_t previous_tube_ms = 0;
+  AlarmEngine alarm_engine;
+  bool alarm_enabled = false;
+  int alarm_factor = -1;
+  float alarm_threshold = -1.0f;
+  uint32_t last_alarm_sound_ms = 0;
+  // networkTask writes, counting task reads (lock)
+  unsigned long display_counts = 0;  // gm_counts of the latest live record
+  uint32_t display_ms = 0;           // time of the latest live record
+  // networkTask only
+  IntervalHistogram intervals_last;
+  IntervalHistogram intervals_total;
+  bool hv_error = false;
+  unsigned long hv_pulses = 0;
+  bool have_thp = false;
+  float temperature = 0.0f;
+  float humidity = 0.0f;
+  float pressure = 0.0f;
+  int wifi_status = 0;
+  bool wifi_connected = false;
+  bool greeting_done = false;
+  // values of the previous record per kind, the deltas are taken against them
+  unsigned long last_counts[RECORD_KINDS] = {};
+  unsigned long last_hv_pulses[RECORD_KINDS] = {};
+  unsigned long last_count_timestamp[RECORD_KINDS] = {};
+  uint32_t last_seq[RECORD_KINDS] = {};
+  // one minute log
+  unsigned long minute_counts = 0;
+  uint32_t minute_ms = 0;
+};
@@ -0,0 +1,91 @@
+#include "rate_estimator.hpp"
+
+#include <math.h>
+
+static const uint32_t WINDOW_MS[RATE_WINDOWS] = {1000, 10000, 60000, 600000, 3600000};
+static const char *WINDOW_NAMES[RATE_WINDOWS] = {"1s", "10s", "60s", "10min", "1h"};
+
+uint32_t RateEstimator::windowMs(RateWindow window) {
+  return WINDOW_MS[window];
+}
+
+const char *RateEstimator::windowName(RateWindow window) {
+  return WINDOW_NAMES[window];
+}
+
+void RateEstimator::reset(uint32_t now_ms) {
+  for (int i = 0; i < RATE_WINDOWS; i++) {
+    Window &w = windows[i];
+    w = {};
+    w.bucket_ms = WINDOW_MS[i] / BUCKETS;
+    w.bucket_start = now_ms;
+  }
+  start_ms = now_ms;
+  last_update_ms = now_ms;
+  total_counts = 0;
+}
+
+void RateEstimator::advance(Window &w, uint32_t now_ms) {
+  uint32_t elapsed = now_ms - w.bucket_start;
+  if (elapsed < w.bucket_ms)
+    return;
+  if (elapsed >= w.bucket_ms * BUCKETS) {
+    // no update for a whole window, everything in it is outdated
+    for (int i = 0; i < BUCKETS; i++) {
+      w.counts[i] = 0;
+      w.used[i] = false;
+    }
+    w.sum = 0;
+    w.bucket_start = now_ms - elapsed % w.bucket_ms;
+    return;
+  }
+  // at most BUCKETS - 1 steps
+  while ((now_ms - w.bucket_start) >= w.bucket_ms) {
+    w.current = (w.current + 1) % BUCKETS;
+    w.sum -= w.counts[w.current];
+    w.counts[w.current] = 0;
+    w.used[w.current] = false;
+    w.bucket_start += w.bucket_ms;
+  }
+}
+
+void RateEstimator::update(uint32_t now_ms, uint32_t counts) {
+  for (int i = 0; i < RATE_WINDOWS; i++) {
+    Window &w = windows[i];
+    advance(w, now_ms);
+    if (!w.used[w.current]) {
+      w.used[w.current] = true;
+      w.since[w.current] = last_update_ms;
+    }
+    w.counts[w.current] += counts;
+    w.sum += counts;
+  }
+  total_counts += counts;
+  last_update_ms = now_ms;
+}
+
+RateEstimate RateEstimator::estimate(uint32_t counts, uint32_t span_ms) {
+  RateEstimate r = {0.0f, 0.0f, counts, span_ms};
+  if (span_ms == 0)
+    return r;
+  float span_s = span_ms / 1000.0f;
+  r.cps = counts / span_s;
+  // with 0 counts, sqrt(N) would claim an exact 0 rate, use 1 count as uncertainty instead.
+  r.cps_err = sqrtf(counts ? (float)counts : 1.0f) / span_s;
+  return r;
+}
+
+RateEstimate RateEstimator::rate(RateWindow window) const {
+  const Window &w = windows[window];
+  // the oldest used bucket tells since when the window has collected counts
+  for (int i = 1; i <= BUCKETS; i++) {
+    int idx = (w.current + i) % BUCKETS;
+    if (w.used[idx])
+      return estimate(w.sum, last_update_ms - w.since[idx]);
+  }
+  return estimate(0, 0);
+}
+
+RateEstimate RateEstimator::total() const {
+  return estimate(total_counts, last_update_ms - start_ms);
+}
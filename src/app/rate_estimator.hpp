@@ -0,0 +1,82 @@
+/**
+ * @file rate_estimator.hpp
+ * @brief Multi-window count rate estimation
+ *
+ * RateEstimator is fed with the counts of every read_GMC() batch and keeps
+ * count rates over several sliding windows (1s .. 1h) plus the average since
+ * boot, each with its Poisson uncertainty. update() is O(1) (amortized), so
+ * all consumers (display, BLE, MQTT, web API, ...) read from one instance
+ * instead of computing their own rates.
+ *
+ * No Arduino dependencies, times are passed in [ms].
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+enum RateWindow {
+  RATE_1S,
+  RATE_10S,
+  RATE_60S,
+  RATE_10MIN,
+  RATE_1H,
+  RATE_WINDOWS  // amount of windows
+};
+
+/**
+ * @struct RateEstimate
+ * @brief Count rate over some time span
+ */
+struct RateEstimate {
+  float cps;         ///< count rate [counts/s]
+  float cps_err;     ///< 1 sigma Poisson uncertainty of cps [counts/s]
+  uint32_t counts;   ///< counts within the span
+  uint32_t span_ms;  ///< time span the counts were collected in (less than the window after boot)
+};
+
+class RateEstimator {
+public:
+  /** @brief Forget everything, start counting at now_ms */
+  void reset(uint32_t now_ms);
+
+  /** @brief Add the counts collected since the previous update */
+  void update(uint32_t now_ms, uint32_t counts);
+
+  /** @brief Count rate within the given sliding window */
+  RateEstimate rate(RateWindow window) const;
+
+  /** @brief Average count rate since reset */
+  RateEstimate total() const;
+
+  /** @brief Window length [ms] */
+  static uint32_t windowMs(RateWindow window);
+
+  /** @brief Short name of a window, e.g. "60s" */
+  static const char *windowName(RateWindow window);
+
+private:
+  static const int BUCKETS = 10;  // per window
+
+  // A window is a ring of BUCKETS buckets of window / BUCKETS length each.
+  // Every bucket also remembers since when its counts were collected (the time of the
+  // update before the first one that went into it), so a window knows exactly which
+  // time span its counts belong to, independent of the update cadence.
+  struct Window {
+    uint32_t bucket_ms;
+    uint32_t bucket_start;        // start time of the current bucket
+    uint32_t counts[BUCKETS];
+    uint32_t since[BUCKETS];      // counts[i] were collected after since[i]
+    bool used[BUCKETS];           // bucket got any update
+    uint32_t sum;                 // sum of counts[]
+    int current;
+  };
+
+  void advance(Window &w, uint32_t now_ms);
+  static RateEstimate estimate(uint32_t counts, uint32_t span_ms);
+
+  Window windows[RATE_WINDOWS] = {};
+  uint32_t start_ms = 0;
+  uint32_t last_update_ms = 0;
+  uint32_t total_counts = 0;
+};
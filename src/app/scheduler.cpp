@@ -0,0 +1,126 @@
+#include "scheduler.hpp"
+
+void Scheduler::begin(TaskHandle_t task) {
+  dispatcher = task ? task : xTaskGetCurrentTaskHandle();
+}
+
+int Scheduler::add(const char *name, uint32_t period_ms, StageFunction function, void *context, uint32_t first_ms) {
+  if (count >= SCHEDULER_MAX_STAGES || !function)
+    return -1;
+  Stage &stage = stage_list[count];
+  stage.owner = this;
+  stage.function = function;
+  stage.context = context;
+  stage.stats.name = name;
+  stage.stats.period_ms = period_ms;
+  stage.first_ms = first_ms ? first_ms : period_ms;
+  stage.first = (stage.first_ms != period_ms);
+#if PERF_PROFILING
+  stage.probe = perf_probe(name);
+#endif
+  if (period_ms) {
+    stage.timer = xTimerCreate(name, pdMS_TO_TICKS(stage.first_ms), pdTRUE, &stage, onTimer);
+    if (!stage.timer)
+      return -1;
+  }
+  return count++;
+}
+
+void Scheduler::start() {
+  for (int i = 0; i < count; i++) {
+    if (stage_list[i].timer)
+      xTimerStart(stage_list[i].timer, portMAX_DELAY);
+  }
+}
+
+void Scheduler::onTimer(TimerHandle_t timer) {
+  // runs in the FreeRTOS timer task
+  Stage &stage = *(Stage *)pvTimerGetTimerID(timer);
+  if (stage.first) {
+    // first run was done with first_ms, continue with the regular period
+    stage.first = false;
+    xTimerChangePeriod(timer, pdMS_TO_TICKS(stage.stats.period_ms), 0);
+  }
+  stage.owner->release(stage, true);
+  if (stage.owner->dispatcher)
+    xTaskNotifyGive(stage.owner->dispatcher);
+}
+
+void IRAM_ATTR Scheduler::release(Stage &stage, bool periodic) {
+  portENTER_CRITICAL_SAFE(&mux);
+  if (stage.pending) {
+    if (periodic)
+      stage.stats.skipped++;
+  } else {
+    stage.pending = true;
+    stage.released_ms = millis();
+  }
+  portEXIT_CRITICAL_SAFE(&mux);
+}
+
+void Scheduler::trigger(int stage) {
+  if (stage < 0 || stage >= count)
+    return;
+  release(stage_list[stage], false);
+  if (dispatcher)
+    xTaskNotifyGive(dispatcher);
+}
+
+void IRAM_ATTR Scheduler::triggerFromISR(int stage) {
+  if (stage < 0 || stage >= count)
+    return;
+  release(stage_list[stage], false);
+  if (dispatcher) {
+    BaseType_t hpw = pdFALSE;
+    vTaskNotifyGiveFromISR(dispatcher, &hpw);
+    if (hpw)
+      portYIELD_FROM_ISR();
+  }
+}
+
+void Scheduler::dispatch(uint32_t max_wait_ms) {
+  TickType_t wait = (max_wait_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(max_wait_ms);
+  ulTaskNotifyTake(pdTRUE, wait);
+  for (int i = 0; i < count; i++) {
+    Stage &stage = stage_list[i];
+    portENTER_CRITICAL(&mux);
+    bool run = stage.pending;
+    stage.pending = false;
+    uint32_t released_ms = stage.released_ms;
+    portEXIT_CRITICAL(&mux);
+    if (!run)
+      continue;
+
+    uint32_t start_ms = millis();
+#if PERF_PROFILING
+    uint32_t start_cycles = perf_now();
+#endif
+    stage.function(stage.context);
+#if PERF_PROFILING
+    perf_record(stage.probe, start_cycles);
+#endif
+    uint32_t end_ms = millis();
+
+    uint32_t run_ms = end_ms - start_ms;
+    uint32_t latency_ms = end_ms - released_ms;
+    portENTER_CRITICAL(&mux);
+    stage.stats.runs++;
+    if (stage.stats.period_ms && latency_ms > stage.stats.period_ms)
+      stage.stats.misses++;
+    if (run_ms > stage.stats.max_run_ms)
+      stage.stats.max_run_ms = run_ms;
+    if (latency_ms > stage.stats.max_latency_ms)
+      stage.stats.max_latency_ms = latency_ms;
+    portEXIT_CRITICAL(&mux);
+  }
+}
+
+StageStats Scheduler::stats(int stage) const {
+  StageStats result = {};
+  if (stage < 0 || stage >= count)
+    return result;
+  portENTER_CRITICAL(&mux);
+  result = stage_list[stage].stats;
+  portEXIT_CRITICAL(&mux);
+  return result;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file scheduler.hpp
+ * @brief Periodic / event triggered stages dispatched by one task
+ *
+ * Every stage (tube read, display, MQTT, ...) declares its own period and may
+ * additionally be triggered by events. A FreeRTOS software timer per periodic
+ * stage releases it, trigger() releases it on demand; both wake the dispatcher
+ * task with a task notification. dispatch() sleeps until something is released
+ * and then runs all released stages in the order they were added.
+ *
+ * Per stage, late completions (release -> end of run longer than the period)
+ * and releases that found the stage still pending (skipped runs) are counted.
+ * With PERF_PROFILING, every stage is also a profiler probe of the same name.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+
+#include "core/profiler.hpp"
+
+#define SCHEDULER_MAX_STAGES 16
+
+/**
+ * @struct StageStats
+ * @brief Run time statistics of one stage
+ */
+struct StageStats {
+  const char *name;
+  uint32_t period_ms;       ///< 0: event triggered only
+  uint32_t runs;            ///< amount of runs
+  uint32_t misses;          ///< runs which ended later than one period after their release
+  uint32_t skipped;         ///< periodic releases while the stage was still pending
+  uint32_t max_run_ms;      ///< longest run
+  uint32_t max_latency_ms;  ///< longest time from release to end of run
+};
+
+class Scheduler {
+public:
+  typedef void (*StageFunction)(void *context);
+
+  /** @brief Set the dispatcher task (the one calling dispatch()), nullptr: the calling task */
+  void begin(TaskHandle_t task = nullptr);
+
+  /**
+   * @brief Add a stage, call before start() and before the dispatcher task runs
+   * @param period_ms run every period_ms, 0: only run when triggered
+   * @param first_ms delay of the first periodic run, 0: one period
+   * @return stage id (for trigger()), -1 if there is no space left
+   */
+  int add(const char *name, uint32_t period_ms, StageFunction function, void *context, uint32_t first_ms = 0);
+
+  /** @brief Start the timers of all periodic stages */
+  void start();
+
+  /** @brief Release a stage now (task context), coalesces with a pending release */
+  void trigger(int stage);
+
+  /** @brief Same as trigger(), from an ISR */
+  void triggerFromISR(int stage);
+
+  /** @brief Wait for released stages (at most max_wait_ms) and run them */
+  void dispatch(uint32_t max_wait_ms = portMAX_DELAY);
+
+  int stages() const { return count; }
+  StageStats stats(int stage) const;
+
+private:
+  struct Stage {
+    Scheduler *owner;
+    StageFunction function;
+    void *context;
+    TimerHandle_t timer;
+    uint32_t first_ms;
+    bool first;
+    volatile bool pending;
+    volatile uint32_t released_ms;
+    StageStats stats;
+#if PERF_PROFILING
+    int probe;
+#endif
+  };
+
+  static void onTimer(TimerHandle_t timer);
+  void release(Stage &stage, bool periodic);
+
+  Stage stage_list[SCHEDULER_MAX_STAGES] = {};
+  int count = 0;
+  TaskHandle_t dispatcher = nullptr;
+  mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
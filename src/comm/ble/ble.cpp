@@ -18,12 +18,12 @@ class BleService::ServerCallbacks: public NimBLEServerCallbacks {
 public:
   explicit ServerCallbacks(BleService *svc): svc_(svc) {}
   void onConnect(NimBLEServer *pServer) {
-    log(INFO, "BLE device connected");
+    LOG(INFO, "BLE device connected");
     svc_->device_connected = true;
   }
   void onDisconnect(NimBLEServer *pServer) {
     svc_->device_connected = false;
-    log(INFO, "BLE device disconnected");
+    LOG(INFO, "BLE device disconnected");
   }
 private:
   BleService *svc_;
@@ -50,7 +50,7 @@ void BleService::update(unsigned int cpm) {
   cpm_update_counter++;
   cpm_update_counter = cpm_update_counter & 0xFFFF;
   if (status_HRCP > 0) {
-    log(DEBUG, "HR Control Point Value received: %d, resetting packet counter", status_HRCP);
+    LOG(DEBUG, "HR Control Point Value received: %d, resetting packet counter", status_HRCP);
     cpm_update_counter = 0;
     status_HRCP = 0;
   }
@@ -108,7 +108,7 @@ void BleService::begin(char *device_name, bool ble_on) {
   bleServer->getAdvertising()->start();
 
   set_status(STATUS_BLE, ST_BLE_CONNECTABLE);
-  log(INFO, "BLE service advertising started, device name: %s, MAC: %s", device_name, BLEDevice::getAddress().toString().c_str());
+  LOG(INFO, "BLE service advertising started, device name: %s, MAC: %s", device_name, BLEDevice::getAddress().toString().c_str());
 }
 
 void BleService::disable() {
@@ -73,30 +73,30 @@ void onEvent(ev_t ev) {
   switch (ev) {
   case EV_SCAN_TIMEOUT:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(INFO, "LoRa: Scan timeout - no gateway found");
-    log(DEBUG, "EV_SCAN_TIMEOUT");
+    LOG(INFO, "LoRa: Scan timeout - no gateway found");
+    LOG(DEBUG, "EV_SCAN_TIMEOUT");
     break;
   case EV_BEACON_FOUND:
     txStatus = TX_STATUS_UNKNOWN;
-    log(DEBUG, "EV_BEACON_FOUND");
+    LOG(DEBUG, "EV_BEACON_FOUND");
     break;
   case EV_BEACON_MISSED:
     txStatus = TX_STATUS_UNKNOWN;
-    log(DEBUG, "EV_BEACON_MISSED");
+    LOG(DEBUG, "EV_BEACON_MISSED");
     break;
   case EV_BEACON_TRACKED:
     txStatus = TX_STATUS_UNKNOWN;
-    log(DEBUG, "EV_BEACON_TRACKED");
+    LOG(DEBUG, "EV_BEACON_TRACKED");
     break;
   case EV_JOINING:
     txStatus = TX_STATUS_JOINING;
-    log(INFO, "LoRa: Joining TTN network (OTAA)...");
-    log(DEBUG, "EV_JOINING");
+    LOG(INFO, "LoRa: Joining TTN network (OTAA)...");
+    LOG(DEBUG, "EV_JOINING");
     break;
   case EV_JOINED:
     txStatus = TX_STATUS_JOINED;
-    log(INFO, "LoRa: Successfully joined TTN!");
-    log(DEBUG, "EV_JOINED");
+    LOG(INFO, "LoRa: Successfully joined TTN!");
+    LOG(DEBUG, "EV_JOINED");
     {
       u4_t netid = 0;
       devaddr_t devaddr = 0;
@@ -110,7 +110,7 @@ void onEvent(ev_t ev) {
       for (int i = 0; i < sizeof(nwkKey); ++i) {
         nk += String(nwkKey[i], 16);
       }
-      log(DEBUG, "netid: %d devaddr: %x artKey: %s nwkKey: %s", netid, devaddr, ak.c_str(), nk.c_str());
+      LOG(DEBUG, "netid: %d devaddr: %x artKey: %s nwkKey: %s", netid, devaddr, ak.c_str(), nk.c_str());
     }
     // Disable link check validation (automatically enabled
     // during join, but because slow data rates change max TX
@@ -120,28 +120,28 @@ void onEvent(ev_t ev) {
   // This event is defined but not used in the code.
   // No point in wasting codespace on it.
   // case EV_RFU1:
-  //   log(DEBUG, "EV_RFU1");
+  //   LOG(DEBUG, "EV_RFU1");
   //   break;
   case EV_JOIN_FAILED:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(INFO, "LoRa: Join FAILED - check credentials (DEVEUI, APPEUI, APPKEY)");
-    log(DEBUG, "EV_JOIN_FAILED");
+    LOG(INFO, "LoRa: Join FAILED - check credentials (DEVEUI, APPEUI, APPKEY)");
+    LOG(DEBUG, "EV_JOIN_FAILED");
     break;
   case EV_REJOIN_FAILED:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(INFO, "LoRa: Rejoin FAILED");
-    log(DEBUG, "EV_REJOIN_FAILED");
+    LOG(INFO, "LoRa: Rejoin FAILED");
+    LOG(DEBUG, "EV_REJOIN_FAILED");
     break;
   case EV_TXCOMPLETE:
-    log(INFO, "LoRa: Transmission complete");
-    log(DEBUG, "EV_TXCOMPLETE (includes waiting for RX windows)");
+    LOG(INFO, "LoRa: Transmission complete");
+    LOG(DEBUG, "EV_TXCOMPLETE (includes waiting for RX windows)");
     txStatus =   TX_STATUS_UPLINK_SUCCESS;
     if (LMIC.txrxFlags & TXRX_ACK) {
       txStatus = TX_STATUS_UPLINK_ACKED;
-      log(DEBUG, "Received ack");
+      LOG(DEBUG, "Received ack");
     }
     if (LMIC.dataLen) {
-      log(DEBUG, "Received %d bytes of payload", LMIC.dataLen);
+      LOG(DEBUG, "Received %d bytes of payload", LMIC.dataLen);
       if (__rxPort != NULL) *__rxPort = LMIC.frame[LMIC.dataBeg - 1];
       if (__rxSz != NULL) *__rxSz = LMIC.dataLen;
       if (__rxBuffer != NULL) memcpy(__rxBuffer, &LMIC.frame[LMIC.dataBeg], LMIC.dataLen);
@@ -150,46 +150,46 @@ void onEvent(ev_t ev) {
     break;
   case EV_LOST_TSYNC:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(DEBUG, "EV_LOST_TSYNC");
+    LOG(DEBUG, "EV_LOST_TSYNC");
     break;
   case EV_RESET:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(DEBUG, "EV_RESET");
+    LOG(DEBUG, "EV_RESET");
     break;
   case EV_RXCOMPLETE:
     // data received in ping slot
     txStatus = TX_STATUS_UNKNOWN;
-    log(DEBUG, "EV_RXCOMPLETE");
+    LOG(DEBUG, "EV_RXCOMPLETE");
     break;
   case EV_LINK_DEAD:
     txStatus = TX_STATUS_ENDING_ERROR;
-    log(DEBUG, "EV_LINK_DEAD");
+    LOG(DEBUG, "EV_LINK_DEAD");
     break;
   case EV_LINK_ALIVE:
     txStatus = TX_STATUS_UNKNOWN;
-    log(DEBUG, "EV_LINK_ALIVE");
+    LOG(DEBUG, "EV_LINK_ALIVE");
     break;
   // This event is defined but not used in the code.
   // No point in wasting codespace on it.
   // case EV_SCAN_FOUND:
-  //   log(DEBUG, "EV_SCAN_FOUND");
+  //   LOG(DEBUG, "EV_SCAN_FOUND");
   //   break;
   case EV_TXSTART:
     txStatus = TX_STATUS_UNKNOWN;
-    log(INFO, "LoRa: Starting transmission...");
-    log(DEBUG, "EV_TXSTART");
+    LOG(INFO, "LoRa: Starting transmission...");
+    LOG(DEBUG, "EV_TXSTART");
     break;
   default:
     txStatus = TX_STATUS_UNKNOWN;
-    log(INFO, "LoRa: Unknown event: %u", (unsigned int) ev);
-    log(DEBUG, "Unknown event: %u", (unsigned int) ev);
+    LOG(INFO, "LoRa: Unknown event: %u", (unsigned int) ev);
+    LOG(DEBUG, "Unknown event: %u", (unsigned int) ev);
     break;
   }
 }
 
 
 void setup_lorawan() {
-  log(INFO, "LoRa: Initializing LMIC stack (ABP mode)...");
+  LOG(INFO, "LoRa: Initializing LMIC stack (ABP mode)...");
   txStatus = TX_STATUS_UNKNOWN;
 
   // LMIC init
@@ -210,7 +210,7 @@ void setup_lorawan() {
   hex2data(nwkSKey, (const char *) nwkskey, 16);
   hex2data(appSKey, (const char *) appskey, 16);
 
-  log(INFO, "LoRa: Setting ABP session (DevAddr: 0x%08X)", devAddr);
+  LOG(INFO, "LoRa: Setting ABP session (DevAddr: 0x%08X)", devAddr);
 
   // Set ABP session keys (netid=0 for TTN)
   LMIC_setSession(0x1, devAddr, nwkSKey, appSKey);
@@ -231,7 +231,7 @@ void setup_lorawan() {
   // Disable ADR (Adaptive Data Rate) for single-channel gateway
   LMIC_setAdrMode(0);
 
-  log(INFO, "LoRa: ABP initialized (Single-Channel: 868.1 MHz, SF7)");
+  LOG(INFO, "LoRa: ABP initialized (Single-Channel: 868.1 MHz, SF7)");
   txStatus = TX_STATUS_JOINED;  // ABP is always "joined"
 }
 
@@ -249,22 +249,22 @@ void poll_lorawan() {
 // - rxBuffer : where the downlinked data will be stored
 // - rxSz : size of received data
 transmissionStatus_t lorawan_send(uint8_t txPort, uint8_t *txBuffer, uint8_t txSz, bool ack, uint8_t *rxPort, uint8_t *rxBuffer, uint8_t *rxSz) {
-  log(INFO, "LoRa: lorawan_send() called - port %d, %d bytes", txPort, txSz);
+  LOG(INFO, "LoRa: lorawan_send() called - port %d, %d bytes", txPort, txSz);
 
   // Check if there is not a current TX/RX job running
   if (LMIC.opmode & (OP_POLL | OP_TXDATA | OP_TXRXPEND)) {
-    log(INFO, "LoRa: LMIC busy (opmode=0x%02x), not sending", LMIC.opmode);
-    log(DEBUG, "OP_POLL | OP_TXDATA | OP_TXRXPEND, not sending");
+    LOG(INFO, "LoRa: LMIC busy (opmode=0x%02x), not sending", LMIC.opmode);
+    LOG(DEBUG, "OP_POLL | OP_TXDATA | OP_TXRXPEND, not sending");
     return TX_STATUS_ENDING_ERROR;
   } else {
-    log(INFO, "LoRa: Queuing data for transmission...");
+    LOG(INFO, "LoRa: Queuing data for transmission...");
     txStatus = TX_STATUS_UNKNOWN;
     __rxPort = rxPort;
     __rxBuffer = rxBuffer;
     __rxSz = rxSz;
     // Prepare upstream data transmission at the next possible time.
     LMIC_setTxData2(txPort, txBuffer, txSz, ((ack) ? 1 : 0));
-    log(INFO, "LoRa: Waiting for transmission to complete (timeout: %d ms)...", LORA_TIMEOUT_MS);
+    LOG(INFO, "LoRa: Waiting for transmission to complete (timeout: %ld ms)...", LORA_TIMEOUT_MS);
     // wait for completion
     uint64_t start = millis();
     while (true) {
@@ -284,7 +284,7 @@ transmissionStatus_t lorawan_send(uint8_t txPort, uint8_t *txBuffer, uint8_t txS
         break;
       }
       if (millis() - start > LORA_TIMEOUT_MS) {
-        log(INFO, "LoRa: TIMEOUT after %d ms - reinitializing LMIC", LORA_TIMEOUT_MS);
+        LOG(INFO, "LoRa: TIMEOUT after %ld ms - reinitializing LMIC", LORA_TIMEOUT_MS);
         setup_lorawan();
         return TX_STATUS_TIMEOUT;
       }
@@ -3,16 +3,16 @@
 #include "mqtt.hpp"
 
 static const unsigned long RECONNECT_INTERVAL_MS = 5000;
-static const size_t MQTT_BUFFER_SIZE = 512;
+static const size_t MQTT_BUFFER_SIZE = 2048;  // fits the histogram / HV telemetry / perf JSON payloads + topic
 
 void MqttPublisher::begin(const MqttConfig &cfg, const char *deviceName) {
   config = cfg;
   if (!config.enabled) {
-    log(DEBUG, "MQTT: disabled");
+    LOG(DEBUG, "MQTT: disabled");
     return;
   }
   if (config.host.isEmpty()) {
-    log(WARNING, "MQTT: disabled because host is empty");
+    LOG(WARNING, "MQTT: disabled because host is empty");
     return;
   }
   deviceBaseTopic = deviceName;
@@ -24,7 +24,8 @@ void MqttPublisher::begin(const MqttConfig &cfg, const char *deviceName) {
     baseTopic += "/";
 
   initialized = true;
-  log(INFO, "MQTT: init base topic %s broker=%s:%d tls=%s retain=%s",
+  outbox.begin("mqtt", 0);  // the records have their timestamp, no max. age
+  LOG(INFO, "MQTT: init base topic %s broker=%s:%d tls=%s retain=%s",
       baseTopic.c_str(), config.host.c_str(), config.port, config.useTls ? "on" : "off", config.retain ? "on" : "off");
 }
 
@@ -34,8 +35,10 @@ void MqttPublisher::loop() {
 
   if (!client.connected())
     ensureConnected();
-  if (client.connected())
+  if (client.connected()) {
     client.loop();
+    outbox.drain(publishBacklog, this);
+  }
 }
 
 void MqttPublisher::ensureConnected() {
@@ -43,7 +46,7 @@ void MqttPublisher::ensureConnected() {
     return;
 
   if (WiFi.status() != WL_CONNECTED) {
-    log(DEBUG, "MQTT: waiting for WiFi before connect");
+    LOG(DEBUG, "MQTT: waiting for WiFi before connect");
     return;
   }
 
@@ -62,9 +65,9 @@ void MqttPublisher::ensureConnected() {
     connected = client.connect(clientId.c_str());
 
   if (connected) {
-    log(INFO, "MQTT: connected to %s:%d as %s", config.host.c_str(), config.port, clientId.c_str());
+    LOG(INFO, "MQTT: connected to %s:%d as %s", config.host.c_str(), config.port, clientId.c_str());
   } else {
-    log(WARNING, "MQTT: connect failed rc=%d", client.state());
+    LOG(WARNING, "MQTT: connect failed rc=%d", client.state());
   }
 }
 
@@ -72,7 +75,7 @@ bool MqttPublisher::publish(const String &topicSuffix, const String &payload) {
   if (!config.enabled || !initialized)
     return false;
   if (!client.connected()) {
-    log(DEBUG, "MQTT: client not connected, retrying");
+    LOG(DEBUG, "MQTT: client not connected, retrying");
     ensureConnected();
     if (!client.connected()) {
       return false;
@@ -82,9 +85,9 @@ bool MqttPublisher::publish(const String &topicSuffix, const String &payload) {
   String topic = baseTopic + topicSuffix;
   bool ok = client.publish(topic.c_str(), payload.c_str(), config.retain);
   if (!ok) {
-    log(WARNING, "MQTT: publish failed for %s state=%d", topic.c_str(), client.state());
+    LOG(WARNING, "MQTT: publish failed for %s state=%d", topic.c_str(), client.state());
   } else {
-    log(DEBUG, "MQTT: publish %s -> %s", topic.c_str(), payload.c_str());
+    LOG(DEBUG, "MQTT: publish %s -> %s", topic.c_str(), payload.c_str());
     lastPublishMs = millis();
   }
   return ok;
@@ -94,8 +97,9 @@ bool MqttPublisher::publishValue(const String &topicSuffix, const String &value)
   return publish(topicSuffix, value);
 }
 
-void MqttPublisher::publishTimestamp(const String &topicSuffix) {
-  publishValue(topicSuffix, String(utctime()));
+void MqttPublisher::publishTimestamp(const String &topicSuffix, const MeasurementRecord &m) {
+  char buf[UTC_MS_LEN];
+  publishValue(topicSuffix, String(format_utc_ms(record_utc_ms(m), buf)));
 }
 
 void MqttPublisher::configureClient() {
@@ -107,75 +111,102 @@ void MqttPublisher::configureClient() {
   client.setServer(config.host.c_str(), config.port);
 }
 
-void MqttPublisher::publishLive(float countRate, float doseRate, int counts, int dt_ms, int hv_pulses_delta,
-                                int accumulated_counts, int accumulated_time_ms, float accumulated_rate, float accumulated_dose,
-                                float temperature, float humidity, float pressure) {
-  if (!config.enabled || !initialized)
+void MqttPublisher::publishLive(const MeasurementRecord &m) {
+  if (!config.enabled || !initialized || (m.status & MEAS_NO_PULSES))
     return;
 
   if (!client.connected()) {
-    log(INFO, "MQTT: skip live publish, not connected (will retry)");
+    LOG(INFO, "MQTT: skip live publish, not connected (will retry)");
   }
 
   // publish each value under live/<metric>
-  publishValue("live/count_rate_cps", String(countRate, 3));
-  publishValue("live/dose_rate_uSvph", String(doseRate, 3));
-  publishValue("live/counts", String(counts));
-  publishValue("live/dt_ms", String(dt_ms));
-  publishValue("live/hv_pulses", String(hv_pulses_delta));
-  publishValue("live/accum_counts", String(accumulated_counts));
-  publishValue("live/accum_time_ms", String(accumulated_time_ms));
-  publishValue("live/accum_rate_cps", String(accumulated_rate, 3));
-  publishValue("live/accum_dose_uSvph", String(accumulated_dose, 3));
-  publishValue("live/temperature", String(temperature, 2));
-  publishValue("live/humidity", String(humidity, 2));
-  publishValue("live/pressure", String(pressure, 2));
-  publishTimestamp("live/timestamp");
+  publishValue("live/count_rate_cps", String(m.cps, 3));
+  publishValue("live/dose_rate_uSvph", String(m.dose_uSvph, 3));
+  publishValue("live/counts", String(m.counts));
+  publishValue("live/dt_ms", String(m.dt_ms));
+  publishValue("live/hv_pulses", String(m.hv_pulses));
+  publishValue("live/accum_counts", String(m.total_counts));
+  publishValue("live/accum_time_ms", String(m.total_ms));
+  publishValue("live/accum_rate_cps", String(m.total_cps, 3));
+  publishValue("live/accum_dose_uSvph", String(m.total_dose_uSvph, 3));
+  publishValue("live/temperature", String(m.temperature, 2));
+  publishValue("live/humidity", String(m.humidity, 2));
+  publishValue("live/pressure", String(m.pressure, 2));
+  publishTimestamp("live/timestamp", m);
 }
 
-void MqttPublisher::publishMeasurement(const String &tubeType, int tubeNbr, unsigned int dt_ms, unsigned int hv_pulses,
-                                       unsigned int gm_counts, unsigned int cpm, bool have_thp, float temperature,
-                                       float humidity, float pressure, int wifi_status) {
+void MqttPublisher::publishJson(const char *name, const char *json) {
   if (!config.enabled || !initialized)
     return;
 
+  publish(String("live/") + name, String(json));
+}
+
+bool MqttPublisher::publishBacklog(const OutboxRecord &r, void *context) {
+  // one JSON message per replayed record, not to live/*: these are old values
+  MqttPublisher *self = static_cast<MqttPublisher *>(context);
+  char buf[320];
+  char utc[UTC_LEN];
+  int len = snprintf(buf, sizeof(buf),
+                     "{\"seq\":%u,\"timestamp\":\"%s\",\"time_valid\":%s,\"counts\":%u,\"cpm\":%u,\"hv_pulses\":%u,\"dt_ms\":%u,\"tube_id\":%u",
+                     r.seq, format_utc(r.utc, utc), (r.status & MEAS_TIME_VALID) ? "true" : "false",
+                     r.counts, r.cpm, r.hv_pulses, r.dt_ms, r.tube_nbr);
+  if (r.status & MEAS_THP_VALID)
+    snprintf(buf + len, sizeof(buf) - len, ",\"temperature\":%.2f,\"humidity\":%.2f,\"pressure\":%.2f}",
+             r.temperature, r.humidity, r.pressure);
+  else
+    snprintf(buf + len, sizeof(buf) - len, "}");
+  return self->publish("backlog/measurement", String(buf));
+}
+
+void MqttPublisher::publishMeasurement(const MeasurementRecord &m) {
+  if (!config.enabled || !initialized)
+    return;
+
+  if (!client.connected())
+    ensureConnected();
   if (!client.connected()) {
-    log(INFO, "MQTT: skip publish, not connected (will retry)");
+    LOG(INFO, "MQTT: not connected, measurement %u goes to the outbox", m.seq);
+    outbox.deliver(m, false, publishBacklog, this);
+    return;
   }
 
-  log(INFO, "MQTT: publish measurement counts=%u cpm=%u hv=%u dt=%u thp=%s wifi_status=%d",
-      gm_counts, cpm, hv_pulses, dt_ms, have_thp ? "yes" : "no", wifi_status);
+  bool have_thp = m.status & MEAS_THP_VALID;
+  LOG(INFO, "MQTT: publish measurement %u counts=%u cpm=%u hv=%u dt=%u thp=%s wifi_status=%d",
+      m.seq, m.counts, m.cpm, m.hv_pulses, m.dt_ms, have_thp ? "yes" : "no", m.wifi_status);
 
   // simple value topics under live/*
-  publishValue("live/counts", String(gm_counts));
-  publishValue("live/cpm", String(cpm));
-  publishValue("live/hv_pulses", String(hv_pulses));
-  publishValue("live/dt_ms", String(dt_ms));
-  publishValue("live/tube_type", tubeType);
-  publishValue("live/tube_id", String(tubeNbr));
-  publishTimestamp("live/timestamp");
+  publishValue("live/counts", String(m.counts));
+  publishValue("live/cpm", String(m.cpm));
+  publishValue("live/hv_pulses", String(m.hv_pulses));
+  publishValue("live/dt_ms", String(m.dt_ms));
+  publishValue("live/tube_type", String(m.tube_type));
+  publishValue("live/tube_id", String(m.tube_nbr));
+  publishTimestamp("live/timestamp", m);
 
   // thp (optional)
   if (have_thp) {
-    publishValue("live/temperature", String(temperature, 2));
-    publishValue("live/humidity", String(humidity, 2));
-    publishValue("live/pressure", String(pressure, 2));
+    publishValue("live/temperature", String(m.temperature, 2));
+    publishValue("live/humidity", String(m.humidity, 2));
+    publishValue("live/pressure", String(m.pressure, 2));
   } else {
-    log(INFO, "MQTT: no THP available, skipping THP publish");
+    LOG(INFO, "MQTT: no THP available, skipping THP publish");
   }
 
   // status JSON
   char buf[MQTT_BUFFER_SIZE];
+  char utc[UTC_MS_LEN];
   snprintf(buf, sizeof(buf),
-           "{\"wifi_status\":%d,\"mqtt_connected\":%s,\"last_publish_ms\":%lu,\"counts\":%u,\"cpm\":%u,\"hv_pulses\":%u,\"dt_ms\":%u,\"have_thp\":%s,\"timestamp\":\"%s\"}",
-           wifi_status,
+           "{\"seq\":%u,\"wifi_status\":%d,\"mqtt_connected\":%s,\"last_publish_ms\":%lu,\"counts\":%u,\"cpm\":%u,\"hv_pulses\":%u,\"dt_ms\":%u,\"have_thp\":%s,\"timestamp\":\"%s\"}",
+           m.seq,
+           m.wifi_status,
            client.connected() ? "true" : "false",
            lastPublishMs,
-           gm_counts,
-           cpm,
-           hv_pulses,
-           dt_ms,
+           m.counts,
+           m.cpm,
+           m.hv_pulses,
+           m.dt_ms,
            have_thp ? "true" : "false",
-           utctime());
+           format_utc_ms(record_utc_ms(m), utc));
   publish("status", String(buf));
 }
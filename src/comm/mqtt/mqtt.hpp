@@ -16,6 +16,7 @@
 
 #include "core/core.hpp"
 #include "config/config.hpp"
+#include "drivers/storage/outbox.hpp"
 
 /**
  * @struct MqttConfig
@@ -36,19 +37,21 @@ struct MqttConfig {
 class MqttPublisher {
 public:
   void begin(const MqttConfig &cfg, const char *deviceName);
+  /** @brief Keep the connection, replay the outbox (backlog/measurement) while connected */
   void loop();
-  void publishMeasurement(const String &tubeType, int tubeNbr, unsigned int dt_ms, unsigned int hv_pulses,
-                          unsigned int gm_counts, unsigned int cpm, bool have_thp, float temperature,
-                          float humidity, float pressure, int wifi_status);
-  void publishLive(float countRate, float doseRate, int counts, int dt_ms, int hv_pulses_delta,
-                   int accumulated_counts, int accumulated_time_ms, float accumulated_rate, float accumulated_dose,
-                   float temperature, float humidity, float pressure);
+  /** @brief Publish an interval record (MEASUREMENT_INTERVAL), into the outbox while not connected */
+  void publishMeasurement(const MeasurementRecord &m);
+  /** @brief Publish a live record (display cadence) */
+  void publishLive(const MeasurementRecord &m);
+  void publishJson(const char *name, const char *json);
+  void readOutboxStats(OutboxStats &stats) { outbox.readStats(stats); }
 
 private:
   void ensureConnected();
   bool publish(const String &topicSuffix, const String &payload);
   bool publishValue(const String &topicSuffix, const String &value);
-  void publishTimestamp(const String &topicSuffix);
+  void publishTimestamp(const String &topicSuffix, const MeasurementRecord &m);
+  static bool publishBacklog(const OutboxRecord &r, void *context);
 
   void configureClient();
 
@@ -62,4 +65,5 @@ private:
   unsigned long lastReconnectAttempt = 0;
   bool initialized = false;
   unsigned long lastPublishMs = 0;
+  Outbox outbox;  // interval records from while the broker was not reachable
 };
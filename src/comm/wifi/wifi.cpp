@@ -7,6 +7,8 @@
 #include <string.h>
 
 #include "app/controller.hpp"
+#include "core/cpu.hpp"
+#include "core/profiler.hpp"
 #include "web_assets.h"
 
 extern MultiGeigerController controller;
@@ -154,6 +156,78 @@ typedef struct https_client {
 
 static HttpsClient c_madavi, c_sensorc, c_customsrv;
 
+// Measurements wait here for transmitTask, which owns all uplinks (HTTP clients and LMIC),
+// so slow servers or the LoRa TX timeout never stall counting, display or web UI.
+static SpscQueue<MeasurementRecord, UPLINK_QUEUE_LEN> uplink_queue;
+static TaskHandle_t transmit_task = nullptr;
+static portMUX_TYPE mux_uplink = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t uplinks_sent = 0;        // protected by mux_uplink
+static uint32_t uplink_max_send_ms = 0;  // protected by mux_uplink
+
+// Interval records for Madavi / sensor.community from while WiFi or the server was down (transmitTask).
+static Outbox outbox_madavi, outbox_scomm;
+
+static bool send_madavi(const OutboxRecord &r, void *context);
+static bool send_scomm(const OutboxRecord &r, void *context);
+
+static void drain_outboxes() {
+  // a batch per uplink every OUTBOX_DRAIN_MS, oldest first
+  if (WiFi.status() != WL_CONNECTED)
+    return;
+  if (sendToMadavi)
+    outbox_madavi.drain(send_madavi, nullptr);
+  if (sendToCommunity)
+    outbox_scomm.drain(send_scomm, nullptr);
+}
+
+static void transmitTask(void * /*param*/) {
+  for (;;) {
+    MeasurementRecord m;
+    while (uplink_queue.pop(m)) {
+      unsigned long start = millis();
+      transmit_data(m);
+      uint32_t duration = millis() - start;
+      portENTER_CRITICAL(&mux_uplink);
+      uplinks_sent++;
+      if (duration > uplink_max_send_ms)
+        uplink_max_send_ms = duration;
+      portEXIT_CRITICAL(&mux_uplink);
+    }
+    drain_outboxes();
+    if (isLoraBoard) {
+      // The LMIC needs to be polled a lot; this is very low cost if the LMIC isn't active.
+      poll_lorawan();
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UPLINK_LMIC_POLL_MS));
+    } else {
+      bool backlog = outbox_madavi.depth() || outbox_scomm.depth();
+      ulTaskNotifyTake(pdTRUE, backlog ? pdMS_TO_TICKS(OUTBOX_DRAIN_MS) : portMAX_DELAY);
+    }
+  }
+}
+
+bool queue_transmission(const MeasurementRecord &m) {
+  // only called by one task (the controller's transmit stage)
+  bool queued = uplink_queue.push(m);
+  if (transmit_task)
+    xTaskNotifyGive(transmit_task);
+  return queued;
+}
+
+void read_uplink_stats(UplinkStats *stats) {
+  stats->queued = uplink_queue.size();
+  stats->dropped = uplink_queue.dropped();
+  stats->high_water = uplink_queue.highWater();
+  portENTER_CRITICAL(&mux_uplink);
+  stats->sent = uplinks_sent;
+  stats->max_send_ms = uplink_max_send_ms;
+  portEXIT_CRITICAL(&mux_uplink);
+}
+
+void read_outbox_stats(OutboxStats *madavi, OutboxStats *scomm) {
+  outbox_madavi.readStats(*madavi);
+  outbox_scomm.readStats(*scomm);
+}
+
 void setup_transmission(const char *version, char *ssid, bool loraHardware) {
   chipID = String(ssid);
   chipID.replace("ESP32", "esp32");
@@ -183,31 +257,32 @@ void setup_transmission(const char *version, char *ssid, bool loraHardware) {
   set_status(STATUS_SCOMM, sendToCommunity ? ST_SCOMM_INIT : ST_SCOMM_OFF);
   set_status(STATUS_MADAVI, sendToMadavi ? ST_MADAVI_INIT : ST_MADAVI_OFF);
   set_status(STATUS_TTN, sendToLora ? ST_TTN_INIT : ST_TTN_OFF);
+
+  if (sendToMadavi)
+    outbox_madavi.begin("madavi", OUTBOX_HTTP_MAX_AGE_S);
+  if (sendToCommunity)
+    outbox_scomm.begin("scomm", OUTBOX_HTTP_MAX_AGE_S);
+
+  xTaskCreatePinnedToCore(transmitTask, "transmitTask", UPLINK_TASK_STACK, NULL, 1, &transmit_task, NETWORK_CPU);
 }
 
 void poll_transmission() {
   // Check for scheduled restart
   if (restartScheduled && millis() >= restartTime) {
-    log(INFO, "Executing scheduled restart...");
-    delay(100);  // Small delay to ensure log is flushed
+    LOG(INFO, "Executing scheduled restart...");
+    flush_log(LOG_FLUSH_MS);  // logTask prints it, wait for that
     ESP.restart();
   }
 
   // Check if config page is active but no ping received for CONFIG_PING_TIMEOUT_MS
   // If timeout, user likely left the page without saving -> re-enable ticks
   if (configPageActive && (millis() - lastConfigPingTime) > CONFIG_PING_TIMEOUT_MS) {
-    log(INFO, "Config page heartbeat timeout - re-enabling ticks");
+    LOG(INFO, "Config page heartbeat timeout - re-enabling ticks");
     configPageActive = false;
     tick_enable(true);
   }
 
-  if (isLoraBoard) {
-    // The LMIC needs to be polled a lot; and this is very low cost if the LMIC isn't
-    // active. So we just act as a bridge. We need this routine so we can see
-    // `isLoraBoard`. Most C compilers will notice the tail call and optimize this
-    // to a jump.
-    poll_lorawan();
-  }
+  // the LMIC is polled by transmitTask, it must not be used by two tasks.
 }
 
 void prepare_http(HttpsClient *client, const char *host) {
@@ -222,17 +297,17 @@ void prepare_http(HttpsClient *client, const char *host) {
 
 int send_http(HttpsClient *client, String body) {
   if (DEBUG_SERVER_SEND)
-    log(DEBUG, "http request body: %s", body.c_str());
+    LOG(DEBUG, "http request body: %s", body.c_str());
 
   int httpResponseCode = client->hc->POST(body);
   if (httpResponseCode > 0) {
     String response = client->hc->getString();
     if (DEBUG_SERVER_SEND) {
-      log(DEBUG, "http code: %d", httpResponseCode);
-      log(DEBUG, "http response: %s", response.c_str());
+      LOG(DEBUG, "http code: %d", httpResponseCode);
+      LOG(DEBUG, "http response: %s", response.c_str());
     }
   } else {
-    log(ERROR, "Error on sending POST: %d", httpResponseCode);
+    LOG(ERROR, "Error on sending POST: %d", httpResponseCode);
   }
   client->hc->end();
   return httpResponseCode;
@@ -370,71 +445,82 @@ int send_ttn_thp(float temperature, float humidity, float pressure) {
   return lorawan_send(2, ttnData, 5, false, NULL, NULL, NULL);
 }
 
-void transmit_data(String tube_type, int tube_nbr, unsigned int dt, unsigned int hv_pulses, unsigned int gm_counts, unsigned int cpm,
-                   int have_thp, float temperature, float humidity, float pressure, int wifi_status) {
+static bool send_madavi(const OutboxRecord &r, void *) {
+  bool have_thp = r.status & MEAS_THP_VALID;
+  LOG(INFO, "Sending to Madavi ...");
+  set_status(STATUS_MADAVI, ST_MADAVI_SENDING);
+  display_status();
+  // Madavi needs the tube in the value types, records do not have it: all are from the configured tube,
+  // also those replayed from the outbox after a reboot.
+  int rc1 = send_http_geiger_2_madavi(&c_madavi, tubes[TUBE_TYPE].type, r.dt_ms, r.hv_pulses, r.counts, r.cpm);
+  int rc2 = have_thp ? send_http_thp_2_madavi(&c_madavi, r.temperature, r.humidity, r.pressure) : 200;
+  delay(300);
+  bool madavi_ok = (rc1 == 200) && (rc2 == 200);
+  LOG(INFO, "Sent to Madavi, status: %s, http: %d %d", madavi_ok ? "ok" : "error", rc1, rc2);
+  set_status(STATUS_MADAVI, madavi_ok ? ST_MADAVI_IDLE : ST_MADAVI_ERROR);
+  display_status();
+  return madavi_ok;
+}
+
+static bool send_scomm(const OutboxRecord &r, void *) {
+  bool have_thp = r.status & MEAS_THP_VALID;
+  LOG(INFO, "Sending to sensor.community ...");
+  set_status(STATUS_SCOMM, ST_SCOMM_SENDING);
+  display_status();
+  int rc1 = send_http_geiger(&c_sensorc, SENSORCOMMUNITY, r.dt_ms, r.hv_pulses, r.counts, r.cpm, XPIN_RADIATION);
+  int rc2 = have_thp ? send_http_thp(&c_sensorc, SENSORCOMMUNITY, r.temperature, r.humidity, r.pressure, XPIN_BME280) : 201;
+  delay(300);
+  bool scomm_ok = (rc1 == 201) && (rc2 == 201);
+  LOG(INFO, "Sent to sensor.community, status: %s, http: %d %d", scomm_ok ? "ok" : "error", rc1, rc2);
+  set_status(STATUS_SCOMM, scomm_ok ? ST_SCOMM_IDLE : ST_SCOMM_ERROR);
+  display_status();
+  return scomm_ok;
+}
+
+void transmit_data(const MeasurementRecord &m) {
   int rc1, rc2;
+  bool have_thp = m.status & MEAS_THP_VALID;
+  bool wifi_connected = m.status & MEAS_WIFI_CONNECTED;
 
   #if SEND2CUSTOMSRV
   bool customsrv_ok;
-  log(INFO, "Sending to CUSTOMSRV ...");
-  rc1 = send_http_geiger(&c_customsrv, CUSTOMSRV, dt, hv_pulses, gm_counts, cpm, XPIN_NO_XPIN);
-  rc2 = have_thp ? send_http_thp(&c_customsrv, CUSTOMSRV, temperature, humidity, pressure, XPIN_NO_XPIN) : 200;
+  LOG(INFO, "Sending to CUSTOMSRV ...");
+  rc1 = send_http_geiger(&c_customsrv, CUSTOMSRV, m.dt_ms, m.hv_pulses, m.counts, m.cpm, XPIN_NO_XPIN);
+  rc2 = have_thp ? send_http_thp(&c_customsrv, CUSTOMSRV, m.temperature, m.humidity, m.pressure, XPIN_NO_XPIN) : 200;
   customsrv_ok = (rc1 == 200) && (rc2 == 200);
-  log(INFO, "Sent to CUSTOMSRV, status: %s, http: %d %d", customsrv_ok ? "ok" : "error", rc1, rc2);
+  LOG(INFO, "Sent to CUSTOMSRV, status: %s, http: %d %d", customsrv_ok ? "ok" : "error", rc1, rc2);
   #endif
 
-  if(sendToMadavi && (wifi_status == ST_WIFI_CONNECTED)) {
-    bool madavi_ok;
-    log(INFO, "Sending to Madavi ...");
-    set_status(STATUS_MADAVI, ST_MADAVI_SENDING);
-    display_status();
-    rc1 = send_http_geiger_2_madavi(&c_madavi, tube_type, dt, hv_pulses, gm_counts, cpm);
-    rc2 = have_thp ? send_http_thp_2_madavi(&c_madavi, temperature, humidity, pressure) : 200;
-    delay(300);
-    madavi_ok = (rc1 == 200) && (rc2 == 200);
-    log(INFO, "Sent to Madavi, status: %s, http: %d %d", madavi_ok ? "ok" : "error", rc1, rc2);
-    set_status(STATUS_MADAVI, madavi_ok ? ST_MADAVI_IDLE : ST_MADAVI_ERROR);
-    display_status();
-  }
-
-  if(sendToCommunity  && (wifi_status == ST_WIFI_CONNECTED)) {
-    bool scomm_ok;
-    log(INFO, "Sending to sensor.community ...");
-    set_status(STATUS_SCOMM, ST_SCOMM_SENDING);
-    display_status();
-    rc1 = send_http_geiger(&c_sensorc, SENSORCOMMUNITY, dt, hv_pulses, gm_counts, cpm, XPIN_RADIATION);
-    rc2 = have_thp ? send_http_thp(&c_sensorc, SENSORCOMMUNITY, temperature, humidity, pressure, XPIN_BME280) : 201;
-    delay(300);
-    scomm_ok = (rc1 == 201) && (rc2 == 201);
-    log(INFO, "Sent to sensor.community, status: %s, http: %d %d", scomm_ok ? "ok" : "error", rc1, rc2);
-    set_status(STATUS_SCOMM, scomm_ok ? ST_SCOMM_IDLE : ST_SCOMM_ERROR);
-    display_status();
-  }
+  // sent now, or kept in the outbox (offline, server error, older records still waiting)
+  if (sendToMadavi && !outbox_madavi.deliver(m, wifi_connected, send_madavi, nullptr))
+    LOG(INFO, "Madavi: measurement %u not sent now, %u in the outbox", m.seq, outbox_madavi.depth());
+  if (sendToCommunity && !outbox_scomm.deliver(m, wifi_connected, send_scomm, nullptr))
+    LOG(INFO, "sensor.community: measurement %u not sent now, %u in the outbox", m.seq, outbox_scomm.depth());
 
   if(isLoraBoard && sendToLora && (strcmp(devaddr, "") != 0)) {    // send only, if we have ABP credentials
     bool ttn_ok;
-    log(INFO, "Sending to TTN ...");
-    log(INFO, "  - isLoraBoard: %d, sendToLora: %d, devaddr: %s", isLoraBoard, sendToLora, devaddr);
+    LOG(INFO, "Sending to TTN ...");
+    LOG(INFO, "  - isLoraBoard: %d, sendToLora: %d, devaddr: %s", isLoraBoard, sendToLora, devaddr);
     set_status(STATUS_TTN, ST_TTN_SENDING);
     display_status();
-    rc1 = send_ttn_geiger(tube_nbr, dt, gm_counts);
-    log(INFO, "TTN send_ttn_geiger result: %d", rc1);
-    rc2 = have_thp ? send_ttn_thp(temperature, humidity, pressure) : TX_STATUS_UPLINK_SUCCESS;
+    rc1 = send_ttn_geiger(m.tube_nbr, m.dt_ms, m.counts);
+    LOG(INFO, "TTN send_ttn_geiger result: %d", rc1);
+    rc2 = have_thp ? send_ttn_thp(m.temperature, m.humidity, m.pressure) : TX_STATUS_UPLINK_SUCCESS;
     if (have_thp) {
-      log(INFO, "TTN send_ttn_thp result: %d", rc2);
+      LOG(INFO, "TTN send_ttn_thp result: %d", rc2);
     }
     ttn_ok = (rc1 == TX_STATUS_UPLINK_SUCCESS) && (rc2 == TX_STATUS_UPLINK_SUCCESS);
-    log(INFO, "TTN transmission %s (rc1=%d, rc2=%d)", ttn_ok ? "SUCCESS" : "FAILED", rc1, rc2);
+    LOG(INFO, "TTN transmission %s (rc1=%d, rc2=%d)", ttn_ok ? "SUCCESS" : "FAILED", rc1, rc2);
     set_status(STATUS_TTN, ttn_ok ? ST_TTN_IDLE : ST_TTN_ERROR);
     display_status();
   } else {
     // Log why LoRa is not sending
     if (!isLoraBoard) {
-      log(INFO, "NOT sending to TTN: LoRa hardware not detected");
+      LOG(INFO, "NOT sending to TTN: LoRa hardware not detected");
     } else if (!sendToLora) {
-      log(INFO, "NOT sending to TTN: 'Send to LoRa' disabled in config");
+      LOG(INFO, "NOT sending to TTN: 'Send to LoRa' disabled in config");
     } else if (strcmp(devaddr, "") == 0) {
-      log(INFO, "NOT sending to TTN: DevAddr is empty (ABP not configured)");
+      LOG(INFO, "NOT sending to TTN: DevAddr is empty (ABP not configured)");
     }
   }
 }
@@ -561,8 +647,8 @@ unsigned long getESPchipID() {
   pid[0] = (uint8_t)pespid[5];
   pid[1] = (uint8_t)pespid[4];
   pid[2] = (uint8_t)pespid[3];
-  log(INFO, "ID: %08X", id);
-  log(INFO, "MAC: %04X%08X", (uint16_t)(espid >> 32), (uint32_t)espid);
+  LOG(INFO, "ID: %08X", id);
+  LOG(INFO, "MAC: %04X%08X", (uint16_t)(espid >> 32), (uint32_t)espid);
   return id;
 }
 
@@ -583,19 +669,100 @@ void handleApiStatus(void) {
   float press = controller.getPressure();
   bool thp = controller.hasThp();
   bool hvErr = controller.hasHvError();
-
-  // Calculate CPM and dose rate (simplified calculation)
-  unsigned long uptime_ms = millis();
-  unsigned long uptime_s = uptime_ms / 1000;
-  float cpm = (uptime_s > 0) ? (counts * 60.0 / uptime_s) : 0.0;
-  float dose_rate = cpm * tubes[TUBE_TYPE].cps_to_uSvph / 60.0;  // µSv/h
+  PulseRingStats ring;
+  read_pulse_ring_stats(&ring);
+  RechargeTimerStats hv_timer;
+  read_recharge_timer_stats(&hv_timer);
+  TickStats ticks;
+  read_tick_stats(&ticks);
+
+  // CPM and dose rate of the latest live record, the same numbers display / MQTT / BLE got
+  // (this handler runs in networkTask, which also builds the records)
+  const MeasurementRecord &m = controller.getLastMeasurement();
+  unsigned long uptime_s = millis() / 1000;
 
   String json = "{";
   json += "\"counts\":" + String(counts) + ",";
-  json += "\"cpm\":" + String(cpm, 1) + ",";
-  json += "\"dose_uSvh\":" + String(dose_rate, 3) + ",";
+  json += "\"measurement_seq\":" + String(m.seq) + ",";
+  json += "\"cpm\":" + String(m.cpm) + ",";
+  json += "\"cpm_err\":" + String(m.cps_err * 60.0, 1) + ",";
+  json += "\"dose_uSvh\":" + String(m.dose_uSvph, 3) + ",";
   json += "\"uptime_s\":" + String(uptime_s) + ",";
+  char utc[UTC_MS_LEN];
+  json += "\"utc\":\"" + String(format_utc_ms(clock_utc_us() / 1000, utc)) + "\",";
+  json += "\"measurement_utc\":\"" + String(format_utc_ms(record_utc_ms(m), utc)) + "\",";
+  json += "\"rates\":{";
+  for (int w = 0; w < RATE_WINDOWS; w++) {
+    RateEstimate r = controller.getRate((RateWindow)w);
+    json += String(w ? "," : "") + "\"" + RateEstimator::windowName((RateWindow)w) + "\":{";
+    json += "\"cps\":" + String(r.cps, 3) + ",";
+    json += "\"cps_err\":" + String(r.cps_err, 3) + ",";
+    json += "\"span_ms\":" + String(r.span_ms) + "}";
+  }
+  json += "},";
   json += "\"hv_error\":" + String(hvErr ? "true" : "false") + ",";
+  json += "\"pulses_dropped\":" + String(ring.dropped) + ",";
+  json += "\"pulse_ring_high_water\":" + String(ring.high_water) + ",";
+  json += "\"hv_isr_calls\":" + String(hv_timer.calls) + ",";
+  json += "\"hv_isr_cycles_avg\":" + String(hv_timer.calls ? (uint32_t)(hv_timer.cycles / hv_timer.calls) : 0) + ",";
+  json += "\"ticks_rendered\":" + String(ticks.rendered) + ",";
+  json += "\"ticks_coalesced\":" + String(ticks.coalesced) + ",";
+  json += "\"ticks_dropped\":" + String(ticks.dropped) + ",";
+  UplinkStats uplinks;
+  read_uplink_stats(&uplinks);
+  json += "\"uplinks_queued\":" + String(uplinks.queued) + ",";
+  json += "\"uplinks_dropped\":" + String(uplinks.dropped) + ",";
+  json += "\"uplinks_sent\":" + String(uplinks.sent) + ",";
+  json += "\"uplink_max_send_ms\":" + String(uplinks.max_send_ms) + ",";
+  OutboxStats outboxes[3];
+  const char *outbox_names[3] = {"madavi", "scomm", "mqtt"};
+  read_outbox_stats(&outboxes[0], &outboxes[1]);
+  controller.readMqttOutboxStats(outboxes[2]);
+  json += "\"outboxes\":{";
+  for (int i = 0; i < 3; i++) {
+    const OutboxStats &o = outboxes[i];
+    json += String(i ? "," : "") + "\"" + outbox_names[i] + "\":{";
+    json += "\"depth\":" + String(o.depth) + ",";
+    json += "\"high_water\":" + String(o.high_water) + ",";
+    json += "\"stored\":" + String(o.stored) + ",";
+    json += "\"replayed\":" + String(o.replayed) + ",";
+    json += "\"drain_per_min\":" + String(o.drain_per_min) + ",";
+    json += "\"dropped\":" + String(o.dropped) + ",";
+    json += "\"expired\":" + String(o.expired) + ",";
+    json += "\"lost\":" + String(o.lost) + "}";
+  }
+  json += "},";
+  LogStats logs;
+  read_log_stats(&logs);
+  json += "\"log\":{";
+  json += "\"written\":" + String(logs.written) + ",";
+  json += "\"dropped\":" + String(logs.dropped) + ",";
+  json += "\"truncated\":" + String(logs.truncated) + ",";
+  json += "\"queued\":" + String(logs.queued) + ",";
+  json += "\"high_water\":" + String(logs.high_water) + "},";
+  DisplayStats display;
+  read_display_stats(&display);
+  json += "\"display\":{";
+  json += "\"requests\":" + String(display.requests) + ",";
+  json += "\"frames\":" + String(display.frames) + ",";
+  json += "\"tiles\":" + String(display.tiles) + "},";
+  json += "\"stages\":[";
+  const Scheduler *schedulers[] = {&controller.getCountingScheduler(), &controller.getScheduler()};
+  bool first = true;
+  for (const Scheduler *scheduler : schedulers) {
+    for (int i = 0; i < scheduler->stages(); i++) {
+      StageStats st = scheduler->stats(i);
+      json += String(first ? "" : ",") + "{\"name\":\"" + st.name + "\",";
+      first = false;
+      json += "\"period_ms\":" + String(st.period_ms) + ",";
+      json += "\"runs\":" + String(st.runs) + ",";
+      json += "\"misses\":" + String(st.misses) + ",";
+      json += "\"skipped\":" + String(st.skipped) + ",";
+      json += "\"max_run_ms\":" + String(st.max_run_ms) + ",";
+      json += "\"max_latency_ms\":" + String(st.max_latency_ms) + "}";
+    }
+  }
+  json += "],";
 
   if (thp) {
     json += "\"temperature\":" + String(temp, 1) + ",";
@@ -609,6 +776,111 @@ void handleApiStatus(void) {
   server.send(200, "application/json", json);
 }
 
+/**
+ * @brief API endpoint for the histogram of times between two GM pulses (JSON)
+ */
+void handleApiHistogram(void) {
+  char buf[IntervalHistogram::JSON_MAX_LEN];
+  String json = "{\"interval_us\":{";
+  json += "\"period_ms\":" + String(controller.getHistogramPeriod()) + ",";
+  controller.getIntervalsLast().toJson(buf, sizeof(buf));
+  json += "\"last\":" + String(buf) + ",";
+  controller.getIntervalsTotal().toJson(buf, sizeof(buf));
+  json += "\"total\":" + String(buf);
+  json += "}}";
+
+  server.send(200, "application/json", json);
+}
+
+/**
+ * @brief API endpoint for the HV supply telemetry (JSON)
+ */
+void handleApiHv(void) {
+  HvTelemetry hv;
+  read_hv_telemetry(&hv);
+  char json[HV_TELEMETRY_JSON_LEN];
+  format_hv_telemetry(&hv, millis(), json, sizeof(json));
+
+  server.send(200, "application/json", json);
+}
+
+/**
+ * @brief API endpoint for the core layout and the cpu load per task (JSON)
+ */
+void handleApiCpu(void) {
+  static CpuLoad load;  // large, only used by the web server task
+  static char json[CPU_LOAD_JSON_LEN];
+  read_cpu_load(&load);
+  format_cpu_load(&load, json, sizeof(json));
+
+  server.send(200, "application/json", json);
+}
+
+static uint32_t historyTimeArg(const char *name, uint32_t now_s, uint32_t fallback) {
+  // absolute utc [s], or relative to now if negative (e.g. from=-86400: the last day)
+  if (!server.hasArg(name))
+    return fallback;
+  long value = strtol(server.arg(name).c_str(), nullptr, 10);
+  if (value < 0)
+    return (-value < (long)now_s) ? now_s + value : 0;
+  return value;
+}
+
+/**
+ * @brief API endpoint for the measurement history (JSON), see history_query()
+ *
+ * /api/history?from=&to=&res= (utc [s], negative: relative to now; resolution [s]).
+ * Streamed in CHUNK_WRITER_LEN pieces, the whole answer can be much larger than what
+ * should be built as one String.
+ */
+void handleApiHistory(void) {
+  uint32_t now_s = time(nullptr);
+  uint32_t from_s = historyTimeArg("from", now_s, (now_s > 86400) ? now_s - 86400 : 0);  // default: last day
+  uint32_t to_s = historyTimeArg("to", now_s, UINT32_MAX);
+  uint32_t res_s = server.hasArg("res") ? strtoul(server.arg("res").c_str(), nullptr, 10) : 0;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  history_query(controller.getHistory(), from_s, to_s, res_s, [](const char *data, size_t len, void *) {
+    server.sendContent(data, len);
+  }, nullptr);
+  server.sendContent("");  // end of the chunked response
+}
+
+/**
+ * @brief API endpoint for the long-term archive (JSON), see Archive::query()
+ *
+ * /api/archive?from=&to= (utc [s], negative: relative to now), default: the last day.
+ * Reads and decodes the blocks from flash, at most ARCHIVE_QUERY_BLOCKS per request so networkTask
+ * is not held up for long, a longer range is continued with from=<next> of the response.
+ */
+void handleApiArchive(void) {
+  uint32_t now_s = time(nullptr);
+  uint32_t from_s = historyTimeArg("from", now_s, (now_s > 86400) ? now_s - 86400 : 0);
+  uint32_t to_s = historyTimeArg("to", now_s, UINT32_MAX);
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  controller.getArchive().query(from_s, to_s, [](const char *data, size_t len, void *) {
+    server.sendContent(data, len);
+  }, nullptr);
+  server.sendContent("");
+}
+
+void handleApiPerf(void) {
+  // stage / probe run times and the per task cpu load, large, only used by the web server task
+  static char perf[PERF_JSON_LEN];
+  static CpuLoad load;
+  static char cpu[CPU_LOAD_JSON_LEN];
+  static char json[PERF_JSON_LEN + CPU_LOAD_JSON_LEN + 32];
+  format_perf(perf, sizeof(perf));
+  read_cpu_load(&load);
+  format_cpu_load(&load, cpu, sizeof(cpu));
+  snprintf(json, sizeof(json), "{\"perf\":%s,\"cpu\":%s}", perf, cpu);
+
+  server.send(200, "application/json", json);
+}
+
 void handleRoot(void) {  // Handle web requests to "/" path.
   // -- Let IotWebConf test and handle captive portal requests.
   if (iotWebConf.handleCaptivePortal()) {
@@ -655,14 +927,14 @@ static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info) {
     return;
 
   int reason = info.wifi_sta_disconnected.reason;
-  log(INFO, "WiFi disconnect event (reason=%d)", reason);
+  LOG(INFO, "WiFi disconnect event (reason=%d)", reason);
 
   if (!hasConfiguredWifi()) {
-    log(INFO, "WiFi reconnect skipped: no client SSID configured");
+    LOG(INFO, "WiFi reconnect skipped: no client SSID configured");
     return;
   }
 
-  log(INFO, "WiFi reconnecting to configured network via IotWebConf");
+  LOG(INFO, "WiFi reconnecting to configured network via IotWebConf");
   // The regular doLoop will push us back to Connecting state.
 }
 
@@ -670,7 +942,7 @@ static void onApClientConnectEvent(arduino_event_id_t event, arduino_event_info_
   if (event != ARDUINO_EVENT_WIFI_AP_STACONNECTED)
     return;
 
-  log(INFO, "AP client connected, keeping AP open indefinitely");
+  LOG(INFO, "AP client connected, keeping AP open indefinitely");
   // Disable AP timeout when client connects - keep AP open
   iotWebConf.setApTimeoutMs(0);  // 0 = no timeout, AP stays open
 }
@@ -679,11 +951,11 @@ static void onApClientDisconnectEvent(arduino_event_id_t event, arduino_event_in
   if (event != ARDUINO_EVENT_WIFI_AP_STADISCONNECTED)
     return;
 
-  log(INFO, "AP client disconnected");
+  LOG(INFO, "AP client disconnected");
 
   // If WiFi STA is configured, switch to STA mode
   if (hasConfiguredWifi() && iotWebConf.getState() == iotwebconf::ApMode) {
-    log(INFO, "WiFi STA configured, switching to STA mode");
+    LOG(INFO, "WiFi STA configured, switching to STA mode");
     iotWebConf.forceApMode(false);  // will change state to Connecting if allowed
   }
 }
@@ -691,7 +963,8 @@ static void onApClientDisconnectEvent(arduino_event_id_t event, arduino_event_in
 void loadConfigVariables(void) {
   // check if WiFi SSID has changed. If so, restart cpu. Otherwise, the program will not use the new SSID
   if ((strcmp(lastWiFiSSID, "") != 0) && (strcmp(lastWiFiSSID, iotWebConf.getWifiSsidParameter()->valueBuffer) != 0)) {
-    log(INFO, "Doing restart...");
+    LOG(INFO, "Doing restart...");
+    flush_log(LOG_FLUSH_MS);
     ESP.restart();
   }
   strcpy(lastWiFiSSID, iotWebConf.getWifiSsidParameter()->valueBuffer);
@@ -722,7 +995,7 @@ void loadConfigVariables(void) {
 }
 
 void configSaved(void) {
-  log(INFO, "Config saved. ");
+  LOG(INFO, "Config saved. ");
   loadConfigVariables();
   configPageActive = false;  // Config saved, no longer on config page
   tick_enable(true);
@@ -787,7 +1060,7 @@ void handlePostConfig(void) {
   }
 
   String body = server.arg("plain");
-  log(INFO, "Received config update");
+  LOG(INFO, "Received config update");
 
   // Parse JSON manually (simple approach - ESP32 can use ArduinoJson if needed)
   // For now, we'll use a simpler approach - just update the IotWebConf parameters
@@ -985,7 +1258,7 @@ void handlePostConfig(void) {
   // This prevents crashes due to incomplete HTTP response transmission
   restartScheduled = true;
   restartTime = millis() + 2000;  // Restart in 2 seconds
-  log(INFO, "Restart scheduled in 2 seconds...");
+  LOG(INFO, "Restart scheduled in 2 seconds...");
 }
 
 void setup_webconf(bool loraHardware) {
@@ -1063,7 +1336,7 @@ void setup_webconf(bool loraHardware) {
   (void)apDisconnectEventId;
 
   auto redirectToCaptivePortal = []() {
-    log(INFO, "Captive portal probe detected, redirecting to /config");
+    LOG(INFO, "Captive portal probe detected, redirecting to /config");
     server.sendHeader("Location", "/config");
     server.send(302, "text/plain", "");
   };
@@ -1071,6 +1344,12 @@ void setup_webconf(bool loraHardware) {
   // -- Set up required URL handlers on the web server.
   server.on("/", handleRoot);
   server.on("/api/status", handleApiStatus);
+  server.on("/api/histogram", handleApiHistogram);
+  server.on("/api/hv", handleApiHv);
+  server.on("/api/cpu", handleApiCpu);
+  server.on("/api/perf", handleApiPerf);
+  server.on("/api/history", handleApiHistory);
+  server.on("/api/archive", handleApiArchive);
 
   // Serve dashboard assets
   server.on("/style.css", []() {
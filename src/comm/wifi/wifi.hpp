@@ -17,6 +17,8 @@
 #include "drivers/io/io.hpp"
 #include "comm/lora/loraWan.hpp"
 #include "config/config.hpp"
+#include "core/spsc_queue.hpp"
+#include "drivers/storage/outbox.hpp"
 
 extern bool speakerTick;
 extern bool playSound;
@@ -59,11 +61,46 @@ void setup_webconf(bool loraHardware);
 #define XPIN_RADIATION 19
 #define XPIN_BME280 11
 
+// Measurements waiting for the transmission task (one per MEASUREMENT_INTERVAL, so 8 are > 20 min).
+#ifndef UPLINK_QUEUE_LEN
+#define UPLINK_QUEUE_LEN 8
+#endif
+
+// Stack of the transmission task [bytes], TLS needs a lot.
+#ifndef UPLINK_TASK_STACK
+#define UPLINK_TASK_STACK 8192
+#endif
+
+// While idle, the transmission task polls the LMIC (LoRa boards only) in these intervals [ms].
+#ifndef UPLINK_LMIC_POLL_MS
+#define UPLINK_LMIC_POLL_MS 10
+#endif
+
+// Madavi and sensor.community take no timestamp, a replayed record is stored with the time it
+// arrives: older records are dropped from the outbox unsent. 0: replay all. [s]
+#ifndef OUTBOX_HTTP_MAX_AGE_S
+#define OUTBOX_HTTP_MAX_AGE_S 3600
+#endif
+
+typedef struct {
+  uint32_t queued;       // measurements waiting now
+  uint32_t high_water;   // most measurements ever waiting
+  uint32_t dropped;      // measurements dropped because the queue was full
+  uint32_t sent;         // measurements handled by the transmission task
+  uint32_t max_send_ms;  // longest time needed to send one measurement to all uplinks
+} UplinkStats;
+
 void setup_transmission(const char *version, char *ssid, bool lora);
-void transmit_data(String tube_type, int tube_nbr, unsigned int dt, unsigned int hv_pulses, unsigned int gm_counts, unsigned int cpm,
-                   int have_thp, float temperature, float humidity, float pressure, int wifi_status);
+void transmit_data(const MeasurementRecord &m);
+
+// Hand an interval record to the transmission task, returns false if the queue was full. Never blocks.
+bool queue_transmission(const MeasurementRecord &m);
+void read_uplink_stats(UplinkStats *stats);
+
+// Outboxes of the HTTP uplinks (records from while WiFi or the server was down), any task.
+void read_outbox_stats(OutboxStats *madavi, OutboxStats *scomm);
 
-// The Arduino LMIC wants to be polled from loop(). This takes care of that on LoRa boards.
+// Scheduled restart / config page heartbeat, call regularly from the main loop.
 void poll_transmission(void);
 
 // Thin OO wrapper for WiFi/web configuration and transmissions.
@@ -73,8 +110,7 @@ public:
   void beginTx(const char *version, char *chipSsid, bool loraHardware) { setup_transmission(version, chipSsid, loraHardware); }
   void pollTx() { poll_transmission(); }
   void pollWeb() { iotWebConf.doLoop(); }
-  void send(const String &tube_type, int tube_nbr, unsigned int dt, unsigned int hv_pulses, unsigned int gm_counts, unsigned int cpm,
-            int have_thp, float temperature, float humidity, float pressure, int wifi_status) {
-    transmit_data(tube_type, tube_nbr, dt, hv_pulses, gm_counts, cpm, have_thp, temperature, humidity, pressure, wifi_status);
-  }
+  bool send(const MeasurementRecord &m) { return queue_transmission(m); }
+  void readUplinkStats(UplinkStats &stats) { read_uplink_stats(&stats); }
+  void readOutboxStats(OutboxStats &madavi, OutboxStats &scomm) { read_outbox_stats(&madavi, &scomm); }
 };
@@ -18,11 +18,20 @@
 // your log level:
 #define DEFAULT_LOG_LEVEL INFO
 
+// LOG() calls below this level are not even compiled in (saves flash and cpu time).
+// Keep DEBUG to be able to switch the log level at run time.
+#define LOG_MIN_LEVEL DEBUG
+
 // SERIAL_DEBUG values (DO NOT CHANGE)
 // (values declared in core.hpp)
 // your serial logging style:
 #define SERIAL_DEBUG Serial_Logging
 
+// Serial_Binary only: baud rate of the binary stream (decode it with tools/serial_decode)
+// and whether every single pulse time is sent, not only the measurement records.
+#define SERIAL_BINARY_BAUD 921600
+#define SERIAL_BINARY_PULSES false
+
 // Server transmission debugging:
 // if set to true, print debug info on serial (USB) interface while sending to servers (madavi or sensor.community)
 #define DEBUG_SERVER_SEND true
@@ -33,6 +42,10 @@
 // White LED on uC board flashing with every pulse?
 #define LED_TICK true
 
+// Above this count rate [cps], the speaker plays a continuous tone (pitch rising with the rate)
+// and the LED stays on, instead of ticking with every pulse.
+#define TICK_TONE_CPS 80
+
 // Enable display?
 #define SHOW_DISPLAY true
 
@@ -75,13 +88,16 @@
 #define SEND2BLE false
 
 // Play an alarm sound when radiation level is too high?
-// Activates when either accumulated dose rate reaches the set threshold (see below)
+// Activates when either the dose rate reaches the set threshold (see below)
 // or when the current dose rate is higher than the accumulated dose rate by the set factor (see below).
+// Both conditions are checked with every batch of GM pulses using a sequential (CUSUM) test,
+// so a real rise is detected within seconds while the false alarm rate stays bounded (see below).
 // ! Requires a valid tube type to be set in order to calculate dose rate.
 #define LOCAL_ALARM_SOUND false
 
-// Accumulated dose rate threshold to trigger the local alarm
-// The accumulated dose rate is the overall average since the last start of MultiGeiger.
+// Dose rate threshold to trigger the local alarm
+// A dose rate above it is detected the faster the higher it is, up to 90% of it the false alarm
+// interval (see below) holds. Independent of LOCAL_ALARM_FACTOR.
 // Default value: 0.500 µSv/h
 // ! Requires a valid tube type to be set in order to calculate dose rate.
 #define LOCAL_ALARM_THRESHOLD 0.500  // µSv/h
@@ -93,6 +109,13 @@
 // ! Requires a valid tube type to be set in order to calculate dose rate.
 #define LOCAL_ALARM_FACTOR 3  // current / accumulated dose rate
 
+// Mean time between false local alarms at a constant dose rate.
+// Larger values need more counts (i.e. more time) to detect a rise, smaller values detect faster
+// but alarm without a reason more often. Detection time of a rise to LOCAL_ALARM_FACTOR x the
+// accumulated dose rate is logged when the alarm triggers.
+// Default value: 8760 h (1 year)
+#define LOCAL_ALARM_FALSE_ALARM_INTERVAL 8760  // h
+
 // LoRa timeout
 #define LORA_TIMEOUT_MS 30000L
 
@@ -119,7 +142,44 @@
 #define PIN_GMC_COUNT_INPUT 2
 #define GMC_DEAD_TIME 190
 #define MAX_CHARGE_PULSES 3333
-#define TUBE_PERIOD_DURATION_US 100
+// How to count GM pulses (values declared in sensors.hpp):
+// GMC_BACKEND_ISR: interrupt per pulse, gives per-pulse timestamps and speaker / LED ticks.
+// GMC_BACKEND_PCNT: hardware pulse counter, almost no cpu load at high count rates,
+//                   but no per-pulse timestamps and ticks only come in batches (once per second).
+// GMC_BACKEND_RMT: RMT receiver, per-pulse timestamps with 0.5us resolution without a per-pulse
+//                  interrupt, for count rates up to a few hundred cps.
+#define GMC_COUNT_BACKEND GMC_BACKEND_ISR
+#define PULSE_RING_SIZE 1024  // buffered GM pulse timestamps (power of 2), 4 bytes each
+
+// Core affinity: interrupts, counting and audio on COUNTING_CPU, networking / TLS / web / display on
+// NETWORK_CPU (where ESP-IDF runs the WiFi and BT stacks), see src/core/cpu.hpp. Per task cpu load: /api/cpu.
+#define COUNTING_CPU 1  // APP_CPU
+#define NETWORK_CPU 0   // PRO_CPU
+
+// Run time profiling of the scheduler stages and some of their parts (cycle counter, min / max / mean /
+// p50 / p99), JSON at /api/perf together with the per task cpu load. 0 compiles all probes out.
+// PERF_MQTT_INTERVAL_MS > 0 also publishes both via MQTT (live/perf, live/cpu) in these intervals.
+#define PERF_PROFILING 1
+#define PERF_MQTT_INTERVAL_MS 0
+
+// Measurement history in RAM (/api/history), blocks of 256 bytes per resolution, ~25 samples each.
+#define HISTORY_MINUTE_BLOCKS 48  // ~22 h of 1 min samples
+#define HISTORY_10MIN_BLOCKS 32   // ~5 days of 10 min samples
+#define HISTORY_HOUR_BLOCKS 16    // ~2 weeks of 1 h samples
+
+// Long-term archive of the interval records on the LittleFS partition ("spiffs" in the partition table,
+// /api/archive), compressed blocks of ARCHIVE_BLOCK_RECORDS records, written when a block is full.
+#define ARCHIVE_ENABLED 1
+#define ARCHIVE_BLOCK_RECORDS 96      // ~2.4 h, lost on reset until written
+#define ARCHIVE_MAX_BYTES 1048576     // 2 - 6 months, the oldest 64 KB file is deleted then
+#define ARCHIVE_QUERY_BLOCKS 16       // per /api/archive request (~38 h), continue with from=<next>
+
+// Outbox per uplink (Madavi, sensor.community, MQTT) on the LittleFS partition: interval records from while
+// the uplink was offline, replayed oldest first, OUTBOX_BATCH records every OUTBOX_DRAIN_MS per uplink.
+#define OUTBOX_SLOTS 480              // 12 h, 23 KB per uplink, the oldest record is overwritten then
+#define OUTBOX_BATCH 5
+#define OUTBOX_DRAIN_MS 30000
+#define OUTBOX_HTTP_MAX_AGE_S 3600    // Madavi / sensor.community stamp records on arrival, don't replay older ones
 
 // IO pins
 #define HWTESTPIN 26
@@ -0,0 +1,312 @@
+#include "archive_codec.hpp"
+
+#include <string.h>
+
+enum ColumnCoding : uint8_t {
+  CODING_DOD,    // delta of delta
+  CODING_DELTA,
+  CODING_XOR     // float bits
+};
+
+static const ColumnCoding column_coding[ARCHIVE_COLUMNS] = {
+  CODING_DOD,    // t
+  CODING_DOD,    // dt_ms
+  CODING_DELTA,  // counts
+  CODING_DELTA,  // hv_pulses
+  CODING_DELTA,  // status
+  CODING_XOR,    // temperature
+  CODING_XOR,    // humidity
+  CODING_XOR     // pressure
+};
+
+static uint32_t float_bits(float f) {
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+static float bits_float(uint32_t u) {
+  float f;
+  memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+static uint32_t get_column(const ArchiveRecord &r, int column) {
+  switch (column) {
+  case 0: return r.t;
+  case 1: return r.dt_ms;
+  case 2: return r.counts;
+  case 3: return r.hv_pulses;
+  case 4: return r.status;
+  case 5: return float_bits(r.temperature);
+  case 6: return float_bits(r.humidity);
+  default: return float_bits(r.pressure);
+  }
+}
+
+static void set_column(ArchiveRecord &r, int column, uint32_t v) {
+  switch (column) {
+  case 0: r.t = v; break;
+  case 1: r.dt_ms = v; break;
+  case 2: r.counts = v; break;
+  case 3: r.hv_pulses = v; break;
+  case 4: r.status = v; break;
+  case 5: r.temperature = bits_float(v); break;
+  case 6: r.humidity = bits_float(v); break;
+  default: r.pressure = bits_float(v); break;
+  }
+}
+
+ArchiveRecord archive_record(const MeasurementRecord &m) {
+  ArchiveRecord r = {};
+  r.t = (uint32_t)m.utc;
+  r.dt_ms = m.dt_ms;
+  r.counts = m.counts;
+  r.hv_pulses = m.hv_pulses;
+  r.status = m.status;
+  if (m.status & MEAS_THP_VALID) {
+    r.temperature = m.temperature;
+    r.humidity = m.humidity;
+    r.pressure = m.pressure;
+  }
+  return r;
+}
+
+// --- bit streams ---
+
+namespace {
+
+class BitWriter {
+public:
+  BitWriter(uint8_t *data, size_t len) : data(data), len(len) {}
+
+  void write(uint32_t value, int bits) {  // 1..32 bits, MSB first
+    while (bits > 0) {
+      size_t byte = pos / 8;
+      if (byte >= len) {
+        overflow = true;
+        return;
+      }
+      if ((pos % 8) == 0)
+        data[byte] = 0;
+      int free_bits = 8 - (pos % 8);
+      int n = (bits < free_bits) ? bits : free_bits;
+      uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+      data[byte] |= chunk << (free_bits - n);
+      pos += n;
+      bits -= n;
+    }
+  }
+
+  size_t bytes() const { return (pos + 7) / 8; }
+  bool overflow = false;
+
+private:
+  uint8_t *data;
+  size_t len;
+  size_t pos = 0;  // bits
+};
+
+}  // namespace
+
+uint32_t ArchiveBitReader::read(int bits) {
+  uint32_t value = 0;
+  while (bits > 0) {
+    size_t byte = pos / 8;
+    if (byte >= len) {
+      pos = len * 8 + 1;  // overrun
+      return 0;
+    }
+    int avail = 8 - (pos % 8);
+    int n = (bits < avail) ? bits : avail;
+    uint8_t chunk = (data[byte] >> (avail - n)) & ((1u << n) - 1);
+    value = (value << n) | chunk;
+    pos += n;
+    bits -= n;
+  }
+  return value;
+}
+
+// --- integers: Gorilla buckets ---
+
+static void write_int(BitWriter &out, int32_t v) {
+  if (v == 0) {
+    out.write(0, 1);
+  } else if ((v >= -63) && (v <= 64)) {
+    out.write(0x2, 2);
+    out.write((uint32_t)v & 0x7f, 7);
+  } else if ((v >= -255) && (v <= 256)) {
+    out.write(0x6, 3);
+    out.write((uint32_t)v & 0x1ff, 9);
+  } else if ((v >= -2047) && (v <= 2048)) {
+    out.write(0xe, 4);
+    out.write((uint32_t)v & 0xfff, 12);
+  } else {
+    out.write(0xf, 4);
+    out.write((uint32_t)v, 32);
+  }
+}
+
+static int32_t sign_extend(uint32_t v, int bits) {
+  // the bucket covers -(2^(bits-1) - 1) .. 2^(bits-1)
+  return (v > (1u << (bits - 1))) ? (int32_t)v - (int32_t)(1u << bits) : (int32_t)v;
+}
+
+static int32_t read_int(ArchiveBitReader &in) {
+  if (!in.read(1))
+    return 0;
+  if (!in.read(1))
+    return sign_extend(in.read(7), 7);
+  if (!in.read(1))
+    return sign_extend(in.read(9), 9);
+  if (!in.read(1))
+    return sign_extend(in.read(12), 12);
+  return (int32_t)in.read(32);
+}
+
+// --- floats: XOR ---
+
+static int leading_zeros(uint32_t x) {
+  return __builtin_clz(x);
+}
+
+static int trailing_zeros(uint32_t x) {
+  return __builtin_ctz(x);
+}
+
+static void write_xor(BitWriter &out, uint32_t x, int &leading, int &trailing) {
+  if (x == 0) {
+    out.write(0, 1);
+    return;
+  }
+  int lz = leading_zeros(x);
+  int tz = trailing_zeros(x);
+  if ((leading >= 0) && (lz >= leading) && (tz >= trailing)) {
+    out.write(0x2, 2);
+    out.write(x >> trailing, 32 - leading - trailing);
+    return;
+  }
+  int length = 32 - lz - tz;
+  out.write(0x3, 2);
+  out.write(lz, 5);
+  out.write(length - 1, 5);
+  out.write(x >> tz, length);
+  leading = lz;
+  trailing = tz;
+}
+
+static uint32_t read_xor(ArchiveBitReader &in, int &leading, int &trailing) {
+  if (!in.read(1))
+    return 0;
+  if (!in.read(1)) {
+    if (leading < 0)
+      return 0;  // corrupt: no window yet
+    return in.read(32 - leading - trailing) << trailing;
+  }
+  leading = in.read(5);
+  int length = in.read(5) + 1;
+  trailing = 32 - leading - length;
+  if (trailing < 0) {
+    trailing = 0;
+    return 0;  // corrupt
+  }
+  return in.read(length) << trailing;
+}
+
+// --- blocks ---
+
+static void put_u16(uint8_t *out, uint16_t v) {
+  out[0] = v & 0xff;
+  out[1] = v >> 8;
+}
+
+static uint16_t get_u16(const uint8_t *in) {
+  return in[0] | (in[1] << 8);
+}
+
+size_t archive_encode(const ArchiveRecord *records, size_t count, uint8_t *out, size_t len) {
+  if ((count > 0xffff) || (len < 2))
+    return 0;
+  put_u16(out, count);
+  size_t pos = 2;
+  for (int c = 0; c < ARCHIVE_COLUMNS; c++) {
+    if (pos + 2 > len)
+      return 0;
+    BitWriter column(out + pos + 2, len - pos - 2);
+    uint32_t previous = 0;
+    int32_t previous_delta = 0;
+    int leading = -1, trailing = 0;
+    for (size_t i = 0; i < count; i++) {
+      uint32_t v = get_column(records[i], c);
+      int32_t delta = (int32_t)(v - previous);
+      switch (column_coding[c]) {
+      case CODING_DOD:
+        write_int(column, (int32_t)((uint32_t)delta - (uint32_t)previous_delta));
+        previous_delta = delta;
+        break;
+      case CODING_DELTA:
+        write_int(column, delta);
+        break;
+      case CODING_XOR:
+        write_xor(column, v ^ previous, leading, trailing);
+        break;
+      }
+      previous = v;
+    }
+    if (column.overflow || (column.bytes() > 0xffff))
+      return 0;
+    put_u16(out + pos, column.bytes());
+    pos += 2 + column.bytes();
+  }
+  return pos;
+}
+
+bool ArchiveDecoder::begin(const uint8_t *block, size_t len) {
+  total = decoded = 0;
+  if (len < 2)
+    return false;
+  size_t count = get_u16(block);
+  size_t pos = 2;
+  for (int c = 0; c < ARCHIVE_COLUMNS; c++) {
+    if (pos + 2 > len)
+      return false;
+    size_t bytes = get_u16(block + pos);
+    if (pos + 2 + bytes > len)
+      return false;
+    columns[c].begin(block + pos + 2, bytes);
+    value[c] = 0;
+    delta[c] = 0;
+    leading[c] = -1;
+    trailing[c] = 0;
+    pos += 2 + bytes;
+  }
+  total = count;
+  return true;
+}
+
+bool ArchiveDecoder::next(ArchiveRecord &r) {
+  if (decoded >= total)
+    return false;
+  for (int c = 0; c < ARCHIVE_COLUMNS; c++) {
+    ArchiveBitReader &in = columns[c];
+    switch (column_coding[c]) {
+    case CODING_DOD:
+      delta[c] = (int32_t)((uint32_t)delta[c] + (uint32_t)read_int(in));
+      value[c] += delta[c];
+      break;
+    case CODING_DELTA:
+      value[c] += read_int(in);
+      break;
+    case CODING_XOR:
+      value[c] ^= read_xor(in, leading[c], trailing[c]);
+      break;
+    }
+    if (in.overrun()) {
+      total = decoded;  // corrupt block, stop here
+      return false;
+    }
+    set_column(r, c, value[c]);
+  }
+  decoded++;
+  return true;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file archive_codec.hpp
+ * @brief Columnar, Gorilla style compression of interval records for the flash archive
+ *
+ * A block holds up to a few hundred records, column by column: the values of one field of
+ * all records follow each other, so every column is compressed on its own:
+ *
+ * - t, dt_ms: delta of delta (regular spacing: 1 bit per value)
+ * - counts, hv_pulses, status: delta
+ * - temperature, humidity, pressure: XOR with the previous float
+ *
+ * Integers use the variable length buckets of Gorilla (Pelkonen et al., VLDB 2015):
+ *   '0' = 0, '10' + 7 bits, '110' + 9 bits, '1110' + 12 bits, '1111' + 32 bits.
+ * Floats: '0' = same as before, '10' + the meaningful bits within the previous leading /
+ * trailing zeros window, '11' + 5 bits leading zeros + 5 bits length - 1 + meaningful bits.
+ *
+ * Block layout: uint16 record count, then per column uint16 byte length + bit stream
+ * (uint16 little endian, bits MSB first, every column starts at a byte boundary).
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/measurement.hpp"
+
+#define ARCHIVE_COLUMNS 8
+
+// Max. encoded size of a block of n records [bytes].
+#define ARCHIVE_BLOCK_BOUND(n) (2 + ARCHIVE_COLUMNS * 3 + (n) * 40)
+
+/**
+ * @struct ArchiveRecord
+ * @brief What the archive keeps of an interval record, rates / dose can be computed from it
+ */
+struct ArchiveRecord {
+  uint32_t t;          ///< utc [s] when the record was built
+  uint32_t dt_ms;
+  uint32_t counts;
+  uint32_t hv_pulses;
+  uint32_t status;     ///< MEAS_* bits
+  float temperature;
+  float humidity;
+  float pressure;
+};
+
+ArchiveRecord archive_record(const MeasurementRecord &m);
+
+/**
+ * Encode count records into out.
+ * @return the block size [bytes], 0 if it does not fit into len bytes
+ */
+size_t archive_encode(const ArchiveRecord *records, size_t count, uint8_t *out, size_t len);
+
+class ArchiveBitReader {
+public:
+  void begin(const uint8_t *data, size_t len) {
+    this->data = data;
+    this->len = len;
+    pos = 0;
+  }
+  uint32_t read(int bits);  // 1..32 bits, MSB first
+  bool overrun() const { return pos > len * 8; }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t len = 0;
+  size_t pos = 0;  // bits
+};
+
+/**
+ * @class ArchiveDecoder
+ * @brief Decodes one block record by record (all columns in parallel, no record buffer)
+ */
+class ArchiveDecoder {
+public:
+  /** @brief Start decoding a block, false if it is malformed */
+  bool begin(const uint8_t *block, size_t len);
+
+  size_t count() const { return total; }
+
+  /** @brief The next record, false at the end of the block or if the block is corrupt */
+  bool next(ArchiveRecord &r);
+
+private:
+  ArchiveBitReader columns[ARCHIVE_COLUMNS];
+  uint32_t value[ARCHIVE_COLUMNS] = {};
+  int32_t delta[ARCHIVE_COLUMNS] = {};
+  int leading[ARCHIVE_COLUMNS] = {};
+  int trailing[ARCHIVE_COLUMNS] = {};
+  size_t total = 0;
+  size_t decoded = 0;
+};
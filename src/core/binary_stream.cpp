@@ -0,0 +1,257 @@
+#include "binary_stream.hpp"
+
+#include <string.h>
+
+#include "core/crc32.hpp"
+
+// --- little endian fields ---
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static inline void put_f32(uint8_t *p, float f) {
+  uint32_t v;
+  memcpy(&v, &f, sizeof(v));
+  put_u32(p, v);
+}
+
+static inline uint16_t get_u16(const uint8_t *p) {
+  return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline float get_f32(const uint8_t *p) {
+  uint32_t v = get_u32(p);
+  float f;
+  memcpy(&f, &v, sizeof(f));
+  return f;
+}
+
+// --- COBS ---
+
+struct CobsWriter {
+  uint8_t *out;
+  size_t pos = 1;       // next byte to write
+  size_t code_pos = 0;  // where the code byte of the current block goes
+  uint8_t code = 1;
+
+  explicit CobsWriter(uint8_t *out) : out(out) {}
+
+  void put(uint8_t b) {
+    if (b) {
+      out[pos++] = b;
+      if (++code != 0xff)
+        return;
+    }
+    out[code_pos] = code;
+    code_pos = pos++;
+    code = 1;
+  }
+
+  void put(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++)
+      put(data[i]);
+  }
+
+  size_t finish() {
+    out[code_pos] = code;
+    out[pos++] = 0;
+    return pos;
+  }
+};
+
+// in may be out (decoding never writes ahead of reading), returns the decoded length, -1 if corrupt
+static long cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0, o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (!code || (i + code - 1 > len))
+      return -1;
+    memmove(out + o, in + i, code - 1);
+    o += code - 1;
+    i += code - 1;
+    if ((code < 0xff) && (i < len))
+      out[o++] = 0;
+  }
+  return o;
+}
+
+size_t bin_frame(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len, uint8_t *out, size_t out_len) {
+  if ((len > BIN_MAX_PAYLOAD) || (out_len < BIN_FRAME_LEN(len)))
+    return 0;
+  uint8_t head[2] = {type, seq};
+  uint8_t crc[4];
+  put_u32(crc, crc32_update(crc32(head, sizeof(head)), payload, len));
+  CobsWriter w(out);
+  w.put(head, sizeof(head));
+  w.put(payload, len);
+  w.put(crc, sizeof(crc));
+  return w.finish();
+}
+
+// --- payloads ---
+
+size_t bin_measurement(const MeasurementRecord &m, uint8_t *out) {
+  put_u32(out + 0, m.seq);
+  out[4] = m.kind;
+  out[5] = m.tube_nbr;
+  put_u16(out + 6, m.status);
+  put_u32(out + 8, (uint32_t)m.utc);
+  put_u32(out + 12, m.uptime_ms);
+  put_u32(out + 16, m.counts);
+  put_u32(out + 20, m.dt_ms);
+  put_u32(out + 24, m.hv_pulses);
+  put_u32(out + 28, m.cpm);
+  put_f32(out + 32, m.cps);
+  put_f32(out + 36, m.cps_err);
+  put_f32(out + 40, m.dose_uSvph);
+  put_u32(out + 44, m.total_counts);
+  put_u32(out + 48, m.total_ms);
+  put_f32(out + 52, m.temperature);
+  put_f32(out + 56, m.humidity);
+  put_f32(out + 60, m.pressure);
+  return BIN_MEASUREMENT_LEN;
+}
+
+bool bin_parse_measurement(const uint8_t *p, size_t len, BinMeasurement &m) {
+  if (len < BIN_MEASUREMENT_LEN)
+    return false;
+  m.seq = get_u32(p + 0);
+  m.kind = p[4];
+  m.tube_nbr = p[5];
+  m.status = get_u16(p + 6);
+  m.utc = get_u32(p + 8);
+  m.uptime_ms = get_u32(p + 12);
+  m.counts = get_u32(p + 16);
+  m.dt_ms = get_u32(p + 20);
+  m.hv_pulses = get_u32(p + 24);
+  m.cpm = get_u32(p + 28);
+  m.cps = get_f32(p + 32);
+  m.cps_err = get_f32(p + 36);
+  m.dose_uSvph = get_f32(p + 40);
+  m.total_counts = get_u32(p + 44);
+  m.total_ms = get_u32(p + 48);
+  m.temperature = get_f32(p + 52);
+  m.humidity = get_f32(p + 56);
+  m.pressure = get_f32(p + 60);
+  return true;
+}
+
+size_t bin_pulses(uint32_t first, const uint32_t *intervals_us, size_t count, uint8_t *out, size_t out_len) {
+  if (out_len < 4)
+    return 0;
+  put_u32(out, first);
+  size_t pos = 4;
+  for (size_t i = 0; (i < count) && (pos + 5 <= out_len); i++) {
+    uint32_t v = intervals_us[i];
+    while (v >= 0x80) {
+      out[pos++] = (v & 0x7f) | 0x80;
+      v >>= 7;
+    }
+    out[pos++] = v;
+  }
+  return pos;
+}
+
+int bin_parse_pulses(const uint8_t *p, size_t len, uint32_t &first, uint32_t *out, size_t max) {
+  if (len < 4)
+    return -1;
+  first = get_u32(p);
+  size_t n = 0;
+  uint32_t v = 0;
+  int shift = 0;
+  for (size_t i = 4; i < len; i++) {
+    v |= (uint32_t)(p[i] & 0x7f) << shift;
+    if (p[i] & 0x80) {
+      shift += 7;
+      if (shift > 28)
+        return -1;
+      continue;
+    }
+    if (n == max)
+      return -1;
+    out[n++] = v;
+    v = 0;
+    shift = 0;
+  }
+  return shift ? -1 : (int)n;
+}
+
+size_t bin_info(uint8_t flags, const char *version, uint8_t *out, size_t out_len) {
+  size_t version_len = strlen(version) + 1;
+  if (out_len < 2 + version_len)
+    return 0;
+  out[0] = BIN_FORMAT_VERSION;
+  out[1] = flags;
+  memcpy(out + 2, version, version_len);
+  return 2 + version_len;
+}
+
+// --- decoder ---
+
+#ifdef ARDUINO
+#define frame_crc32 crc32
+#else
+#define frame_crc32 crc32_fast  // the decoder is for the host tools
+#endif
+
+void BinFrameDecoder::frame(const uint8_t *in, size_t len) {
+  // in: a whole frame without the 0x00, may be buf (decoded in place)
+  if (len > sizeof(buf)) {
+    stats_.oversized++;
+    return;
+  }
+  uint8_t *data = buf;
+  long n = cobs_decode(in, len, data);
+  if ((n < 6) || (frame_crc32(data, n - 4) != get_u32(data + n - 4))) {
+    stats_.crc_errors++;
+    return;
+  }
+  uint8_t type = data[0], seq = data[1];
+  if (have_seq && !((type == BIN_INFO) && (seq == 0)))  // a restart begins with INFO, seq 0
+    stats_.seq_gaps += (uint8_t)(seq - last_seq - 1);
+  have_seq = true;
+  last_seq = seq;
+  stats_.frames++;
+  handler(type, seq, data + 2, n - 6, context);
+}
+
+void BinFrameDecoder::feed(const uint8_t *data, size_t len) {
+  stats_.bytes += len;
+  while (len) {
+    const uint8_t *end = static_cast<const uint8_t *>(memchr(data, 0, len));
+    size_t n = end ? end - data : len;
+    if (end && !used && !skip) {
+      if (n)
+        frame(data, n);  // the usual case: the whole frame is in data, no copy
+    } else if (!skip) {
+      if (used + n > sizeof(buf)) {
+        stats_.oversized++;
+        skip = true;
+      } else {
+        memcpy(buf + used, data, n);
+        used += n;
+      }
+    }
+    if (!end)
+      return;
+    if (!skip && used)
+      frame(buf, used);
+    used = 0;
+    skip = false;
+    data = end + 1;
+    len -= n + 1;
+  }
+}
@@ -0,0 +1,125 @@
+/**
+ * @file binary_stream.hpp
+ * @brief Framed binary records for the Serial_Binary print mode, encoder and decoder
+ *
+ * Every frame is COBS encoded and ends with a 0x00 byte, so a reader can start anywhere
+ * in a capture and finds the next frame boundary at the next 0x00. Before COBS, a frame is
+ *
+ *   type (1 byte) | seq (1 byte) | payload | CRC-32 of type, seq, payload (4 bytes, little endian)
+ *
+ * seq counts frames (mod 256), a gap means frames were lost on the line or in the log ring.
+ * All payload fields are little endian.
+ *
+ * - BIN_INFO: format version, flags, firmware version (string with \0); first frame, seq 0,
+ *   preceded by an extra 0x00 which ends the text output before it
+ * - BIN_MEASUREMENT: a live or interval MeasurementRecord (BIN_MEASUREMENT_LEN bytes)
+ * - BIN_PULSES: index of the first interval since boot (uint32), then the times between
+ *   consecutive pulses [us] as LEB128 varints
+ * - BIN_LOG: log level, then the log message text (no \0)
+ *
+ * Pulses the firmware counted but could not timestamp (full pulse ring) are merged into the
+ * following interval, the measurement records count them.
+ *
+ * No Arduino dependencies, the host decoder (tools/serial_decode) uses the same code.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/measurement.hpp"
+
+#define BIN_FORMAT_VERSION 1
+
+enum BinFrameType : uint8_t {
+  BIN_INFO = 1,
+  BIN_MEASUREMENT = 2,
+  BIN_PULSES = 3,
+  BIN_LOG = 4
+};
+
+#define BIN_INFO_PULSES 0x01  // BIN_INFO flags: BIN_PULSES frames follow
+
+#define BIN_MEASUREMENT_LEN 64
+#define BIN_MAX_PAYLOAD 600
+// type + seq + payload + CRC, COBS adds 1 byte per 254 plus 1, then the 0x00.
+#define BIN_FRAME_LEN(payload) ((payload) + 6 + ((payload) + 6) / 254 + 2)
+
+/** @brief Encode a frame into out (BIN_FRAME_LEN(len) bytes), returns its length incl. the 0x00, 0 if out is too small */
+size_t bin_frame(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len, uint8_t *out, size_t out_len);
+
+/** @brief Payload of a BIN_MEASUREMENT frame (BIN_MEASUREMENT_LEN bytes) */
+size_t bin_measurement(const MeasurementRecord &m, uint8_t *out);
+
+/** @brief Payload of a BIN_PULSES frame (max. 4 + 5 * count bytes), returns its length */
+size_t bin_pulses(uint32_t first, const uint32_t *intervals_us, size_t count, uint8_t *out, size_t out_len);
+
+/** @brief Payload of the BIN_INFO frame */
+size_t bin_info(uint8_t flags, const char *version, uint8_t *out, size_t out_len);
+
+/**
+ * @struct BinMeasurement
+ * @brief A decoded BIN_MEASUREMENT payload
+ */
+struct BinMeasurement {
+  uint32_t seq;
+  uint8_t kind;        ///< MeasurementKind
+  uint8_t tube_nbr;
+  uint16_t status;     ///< MEAS_* bits
+  uint32_t utc;
+  uint32_t uptime_ms;
+  uint32_t counts;
+  uint32_t dt_ms;
+  uint32_t hv_pulses;
+  uint32_t cpm;
+  float cps;
+  float cps_err;
+  float dose_uSvph;
+  uint32_t total_counts;
+  uint32_t total_ms;
+  float temperature;
+  float humidity;
+  float pressure;
+};
+
+bool bin_parse_measurement(const uint8_t *payload, size_t len, BinMeasurement &m);
+
+/** @brief Decode a BIN_PULSES payload: first index, up to max intervals into out, returns their amount (-1: corrupt) */
+int bin_parse_pulses(const uint8_t *payload, size_t len, uint32_t &first, uint32_t *out, size_t max);
+
+typedef struct {
+  uint64_t bytes;       // fed into the decoder
+  uint64_t frames;      // valid frames
+  uint64_t crc_errors;  // frames with a bad CRC / COBS code
+  uint64_t oversized;   // frames longer than BIN_FRAME_LEN(BIN_MAX_PAYLOAD), dropped
+  uint64_t seq_gaps;    // frames missing according to seq
+} BinDecoderStats;
+
+// Called for every valid frame, payload is valid during the call only.
+typedef void (*BinFrameHandler)(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len, void *context);
+
+/**
+ * @class BinFrameDecoder
+ * @brief Finds, checks and decodes frames in a byte stream fed in pieces of any size
+ */
+class BinFrameDecoder {
+public:
+  BinFrameDecoder(BinFrameHandler handler, void *context) : handler(handler), context(context) {}
+
+  void feed(const uint8_t *data, size_t len);
+
+  const BinDecoderStats &stats() const { return stats_; }
+
+private:
+  void frame(const uint8_t *in, size_t len);
+
+  BinFrameHandler handler;
+  void *context;
+  uint8_t buf[BIN_FRAME_LEN(BIN_MAX_PAYLOAD)];
+  size_t used = 0;
+  bool skip = false;  // dropping the rest of an oversized frame
+  bool have_seq = false;
+  uint8_t last_seq = 0;
+  BinDecoderStats stats_{};
+};
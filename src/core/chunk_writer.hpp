@@ -0,0 +1,54 @@
+/**
+ * @file chunk_writer.hpp
+ * @brief printf into a small buffer which is handed on piece by piece
+ *
+ * For answers which are too large to build in one buffer / String (e.g. the web API
+ * streaming /api/history): the output gets pieces of up to CHUNK_WRITER_LEN bytes.
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Size of the pieces, one printf() must be shorter than CHUNK_WRITER_LINE.
+#define CHUNK_WRITER_LEN 512
+#define CHUNK_WRITER_LINE 128
+
+// Gets the output piece by piece.
+typedef void (*ChunkOutput)(const char *data, size_t len, void *context);
+
+class ChunkWriter {
+public:
+  ChunkWriter(ChunkOutput output, void *context) : output(output), context(context) {}
+  ~ChunkWriter() { flush(); }
+  ChunkWriter(const ChunkWriter &) = delete;
+  ChunkWriter &operator=(const ChunkWriter &) = delete;
+
+  void printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    // flush early so the next line always fits
+    if (len > sizeof(buf) - CHUNK_WRITER_LINE)
+      flush();
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf + len, sizeof(buf) - len, format, args);
+    va_end(args);
+    if (n > 0)
+      len += ((size_t)n < sizeof(buf) - len) ? n : sizeof(buf) - len - 1;
+  }
+
+  void flush() {
+    if (len)
+      output(buf, len, context);
+    len = 0;
+  }
+
+private:
+  ChunkOutput output;
+  void *context;
+  char buf[CHUNK_WRITER_LEN];
+  size_t len = 0;
+};
@@ -1,13 +1,32 @@
 #include "core.hpp"
 
+#include <atomic>
+#include "core/binary_stream.hpp"
+#include "core/cpu.hpp"
+#include "core/log_format.hpp"
+
 // Logging
 
 // the GEIGER: prefix is is to easily differentiate our output from other esp32 output (e.g. wifi messages)
 #define LOG_PREFIX_FORMAT "GEIGER: %s "
-#define LOG_PREFIX_LEN (7+1+19+1)  // chars, without the terminating \0
+#define LOG_PREFIX_LEN (7+1+23+1)  // chars, without the terminating \0
+#define LOG_LINE_LEN 512           // longer messages are cut by logTask
+
+#define LOG_IDLE_MS 10  // logTask polls the ring this often when it is empty
 
 static int log_level = NOLOG;  // messages at level >= log_level will be output
 
+// Callers (any task on any core) pack their message into a slot, logTask formats and prints it.
+static LogRing log_ring;
+static std::atomic<uint32_t> log_written{0};
+static std::atomic<uint32_t> log_truncated{0};
+static TaskHandle_t log_task = NULL;
+
+// time stamp of a log record: monotonic [ms], logTask converts it to utc when it prints it
+static inline uint32_t log_time_ms() {
+  return clock_mono_us() / 1000;
+}
+
 int Serial_Print_Mode;
 
 static const char *Serial_Logging_Name = "Simple Multi-Geiger";
@@ -17,10 +36,61 @@ static const char *Serial_Logging_Header = "     %10s %15s %10s %9s %9s %8s %9s
 static const char *Serial_Logging_Body = "DATA %10d %15d %10f %9f %9d %8d %9d %9f %9f %5.1f %5.1f %6.0f";
 static const char *Serial_One_Minute_Log_Header = "     %4s %10s %29s";
 static const char *Serial_One_Minute_Log_Body = "DATA %4d %10d %29d";
+static const char *Serial_Statistics_Log_Header = "     %10s %10s %10s %10s";
+static const char *Serial_Statistics_Log_Body = "DATA %10d %10u %10u %10u";
+
+// Serial_Binary: frame a record, in logTask (the only task writing to Serial, so frames never mix).
+static size_t write_frame(uint8_t type, const uint8_t *payload, size_t len) {
+  static uint8_t frame[BIN_FRAME_LEN(LOG_LINE_LEN + 1)];
+  static uint8_t seq = 0;
+  if (type == BIN_INFO) {
+    seq = 0;  // tells the decoder about the (re)start
+    Serial.write((uint8_t)0);  // ends any text before, so the INFO frame is not merged with it
+  }
+  size_t n = bin_frame(type, seq++, payload, len, frame, sizeof(frame));
+  Serial.write(frame, n);
+  return n;
+}
+
+static void logTask(void * /*parameter*/) {
+  char line[LOG_PREFIX_LEN + LOG_LINE_LEN + 2];
+  for (;;) {
+    LogMessage m;
+    if (!log_ring.read(m, line + LOG_PREFIX_LEN, LOG_LINE_LEN)) {  // frees the slots before we wait for the UART
+      vTaskDelay(pdMS_TO_TICKS(LOG_IDLE_MS));
+      continue;
+    }
+    if (m.truncated)
+      log_truncated.fetch_add(1, std::memory_order_relaxed);
+    if (m.raw || (Serial_Print_Mode == Serial_Binary)) {
+      if (m.raw) {
+        write_frame(m.level, (const uint8_t *)line + LOG_PREFIX_LEN, m.len);
+      } else {
+        line[LOG_PREFIX_LEN - 1] = m.level;  // BIN_LOG: level, text
+        write_frame(BIN_LOG, (const uint8_t *)line + LOG_PREFIX_LEN - 1, m.len + 1);
+      }
+      log_written.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    // time_ms: low 32 bits of the monotonic time, go back from now and convert that to utc
+    uint64_t now_us = clock_mono_us();
+    uint32_t age_ms = (uint32_t)(now_us / 1000) - m.time_ms;
+    char utc[UTC_MS_LEN], prefix[LOG_PREFIX_LEN + 1];
+    snprintf(prefix, sizeof(prefix), LOG_PREFIX_FORMAT, format_utc_ms(clock_utc_us_at(now_us - age_ms * 1000ULL) / 1000, utc));
+    memcpy(line, prefix, LOG_PREFIX_LEN);
+    size_t n = LOG_PREFIX_LEN + m.len;
+    line[n++] = '\r';  // like Serial.println()
+    line[n++] = '\n';
+    Serial.write((const uint8_t *)line, n);
+    log_written.fetch_add(1, std::memory_order_relaxed);
+  }
+}
 
 void CoreServices::setupLogger(int level) {
   Serial.begin(115200);
   while (!Serial) {};
+  if (!log_task)
+    xTaskCreatePinnedToCore(logTask, "logTask", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, &log_task, NETWORK_CPU);
   CoreServices::logMessage(NOLOG, "Logging initialized at level %d.", level);  // this will always be output
   log_level = level;
 }
@@ -36,22 +106,34 @@ void CoreServices::logMessageVa(int level, const char *format, va_list args) {
   if (level < log_level)
     return;
 
-  va_list args_copy;
-  va_copy(args_copy, args);
-  int needed = vsnprintf(NULL, 0, format, args_copy);
-  va_end(args_copy);
+  // ring full (logTask starved or Serial too slow): counted as dropped
+  log_ring.write(log_time_ms(), level, format, args);
+}
 
-  char buf[needed + 1 + LOG_PREFIX_LEN];
-  sprintf(buf, LOG_PREFIX_FORMAT, utctime());
+void CoreServices::flushLog(uint32_t timeout_ms) {
+  uint32_t start = millis();
+  while (log_task && log_ring.size() && (millis() - start < timeout_ms))
+    vTaskDelay(1);
+  Serial.flush();
+}
 
-  va_list args_copy2;
-  va_copy(args_copy2, args);
-  vsprintf(buf + LOG_PREFIX_LEN, format, args_copy2);
-  va_end(args_copy2);
-  Serial.println(buf);
+void CoreServices::readLogStats(LogStats &stats) {
+  stats.written = log_written.load(std::memory_order_relaxed);
+  stats.truncated = log_truncated.load(std::memory_order_relaxed);
+  log_ring.readStats(stats.queued, stats.dropped, stats.high_water);
 }
 
 void CoreServices::setupDataLogging(int mode) {
+  if (mode == Serial_Binary) {
+    CoreServices::logMessage(NOLOG, "Serial output: binary frames at %d baud from now on.", SERIAL_BINARY_BAUD);
+    CoreServices::flushLog(LOG_FLUSH_MS);
+    Serial.updateBaudRate(SERIAL_BINARY_BAUD);
+    Serial_Print_Mode = mode;
+    uint8_t info[2 + sizeof(VERSION_STR)];
+    size_t n = bin_info(SERIAL_BINARY_PULSES ? BIN_INFO_PULSES : 0, VERSION_STR, info, sizeof(info));
+    log_ring.writeRaw(log_time_ms(), BIN_INFO, info, n);
+    return;
+  }
   Serial_Print_Mode = mode;
 
   bool data_log_enabled = (Serial_Print_Mode == Serial_Logging) || (Serial_Print_Mode == Serial_One_Minute_Log) || (Serial_Print_Mode == Serial_Statistics_Log);
@@ -62,9 +144,7 @@ void CoreServices::setupDataLogging(int mode) {
   }
 }
 
-void CoreServices::logData(int GMC_counts, int time_difference, float Count_Rate, float Dose_Rate, int HV_pulse_count,
-                           int accumulated_GMC_counts, int accumulated_time, float accumulated_Count_Rate, float accumulated_Dose_Rate,
-                           float t, float h, float p) {
+void CoreServices::logData(const MeasurementRecord &m) {
   static int counter = 0;
   if (counter++ % 20 == 0) {
     CoreServices::logMessage(INFO, Serial_Logging_Header,
@@ -74,9 +154,9 @@ void CoreServices::logData(int GMC_counts, int time_difference, float Count_Rate
     CoreServices::logMessage(INFO, dashes);
   }
   CoreServices::logMessage(INFO, Serial_Logging_Body,
-                           GMC_counts, time_difference, Count_Rate, Dose_Rate, HV_pulse_count,
-                           accumulated_GMC_counts, accumulated_time, accumulated_Count_Rate, accumulated_Dose_Rate,
-                           t, h, p);
+                           m.counts, m.dt_ms, m.cps, m.dose_uSvph, m.hv_pulses,
+                           m.total_counts, m.total_ms, m.total_cps, m.total_dose_uSvph,
+                           m.temperature, m.humidity, m.pressure);
 }
 
 void CoreServices::logDataOneMinute(int time_s, int cpm, int counts) {
@@ -92,14 +172,38 @@ void CoreServices::logDataOneMinute(int time_s, int cpm, int counts) {
                            time_s, cpm, counts);
 }
 
-void CoreServices::logDataStatistics(int count_time_between) {
-  static int counter = 0;
-  if (counter++ % 20 == 0) {
-    CoreServices::logMessage(INFO, "Time between two impacts");
-    CoreServices::logMessage(INFO, "[usec]");
+void CoreServices::logDataStatistics(int time_s, unsigned int from_us, unsigned int to_us, unsigned int counts) {
+  // one line per histogram bucket, a new header starts every histogram
+  static int last_time_s = -1;
+  if (time_s != last_time_s) {
+    last_time_s = time_s;
+    CoreServices::logMessage(INFO, "Histogram of times between two impacts");
+    CoreServices::logMessage(INFO, Serial_Statistics_Log_Header,
+                             "Time", "From", "To", "Counts");
+    CoreServices::logMessage(INFO, Serial_Statistics_Log_Header,
+                             "[s]",  "[usec]", "[usec]", "[-]");
     CoreServices::logMessage(INFO, dashes);
   }
-  CoreServices::logMessage(INFO, "%d", count_time_between);
+  CoreServices::logMessage(INFO, Serial_Statistics_Log_Body,
+                           time_s, from_us, to_us, counts);
+}
+
+void CoreServices::logDataBinary(const MeasurementRecord &m) {
+  uint8_t payload[BIN_MEASUREMENT_LEN];
+  log_ring.writeRaw(log_time_ms(), BIN_MEASUREMENT, payload, bin_measurement(m, payload));
+}
+
+void CoreServices::logPulsesBinary(const uint32_t *intervals_us, size_t count) {
+  static uint32_t index = 0;  // of the first interval, a gap in the stream shows frames lost in the ring
+  const size_t max = 64;
+  uint8_t payload[4 + 5 * max];
+  while (count) {
+    size_t n = (count < max) ? count : max;
+    log_ring.writeRaw(log_time_ms(), BIN_PULSES, payload, bin_pulses(index, intervals_us, n, payload, sizeof(payload)));
+    index += n;
+    intervals_us += n;
+    count -= n;
+  }
 }
 
 int CoreServices::hex2data(unsigned char *data, const char *hexstring, unsigned int len) {
@@ -141,24 +245,36 @@ void setup_log(int level) {
   CoreServices::setupLogger(level);
 }
 
+void flush_log(uint32_t timeout_ms) {
+  CoreServices::flushLog(timeout_ms);
+}
+
+void read_log_stats(LogStats *stats) {
+  CoreServices::readLogStats(*stats);
+}
+
 void setup_log_data(int mode) {
   CoreServices::setupDataLogging(mode);
 }
 
-void log_data(int GMC_counts, int time_difference, float Count_Rate, float Dose_Rate, int HV_pulse_count,
-              int accumulated_GMC_counts, int accumulated_time, float accumulated_Count_Rate, float accumulated_Dose_Rate,
-              float t, float h, float p) {
-  CoreServices::logData(GMC_counts, time_difference, Count_Rate, Dose_Rate, HV_pulse_count,
-                        accumulated_GMC_counts, accumulated_time, accumulated_Count_Rate, accumulated_Dose_Rate,
-                        t, h, p);
+void log_data(const MeasurementRecord &m) {
+  CoreServices::logData(m);
 }
 
 void log_data_one_minute(int time_s, int cpm, int counts) {
   CoreServices::logDataOneMinute(time_s, cpm, counts);
 }
 
-void log_data_statistics(int count_time_between) {
-  CoreServices::logDataStatistics(count_time_between);
+void log_data_statistics(int time_s, unsigned int from_us, unsigned int to_us, unsigned int counts) {
+  CoreServices::logDataStatistics(time_s, from_us, to_us, counts);
+}
+
+void log_data_binary(const MeasurementRecord &m) {
+  CoreServices::logDataBinary(m);
+}
+
+void log_pulses_binary(const uint32_t *intervals_us, size_t count) {
+  CoreServices::logPulsesBinary(intervals_us, count);
 }
 
 int hex2data(unsigned char *data, const char *hexstring, unsigned int len) {
@@ -3,7 +3,9 @@
  * @brief Core utilities for the MultiGeiger firmware
  *
  * Provides:
- * - Logging system with configurable log levels
+ * - Logging system with configurable log levels: LOG() packs the message into a lock-free
+ *   ring (see log_format.hpp, LOG_RING_SLOTS), logTask formats it and writes it to Serial, so the caller
+ *   never waits for the UART. LOG() calls below LOG_MIN_LEVEL are compiled out.
  * - Data logging for measurements (table, one-minute, statistics formats)
  * - Utility functions (hex conversion, byte array manipulation)
  * - Firmware version information
@@ -14,7 +16,9 @@
 #include <Arduino.h>
 #include <sys/time.h>
 #include <stdarg.h>
+#include "config/config.hpp"  // LOG_MIN_LEVEL
 #include "drivers/clock/clock.hpp"
+#include "core/measurement.hpp"
 
 // log levels
 #define DEBUG 0
@@ -24,41 +28,84 @@
 #define CRITICAL 4
 #define NOLOG 999  // only to set log_level, so log() never creates output
 
+// LOG() calls below this level are removed at compile time, incl. the evaluation of their
+// arguments; the level given to setup_log() filters the remaining ones at run time.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
+
+#define LOG(level, ...) do { if ((level) >= LOG_MIN_LEVEL) log((level), __VA_ARGS__); } while (0)
+
+// Stack / priority of logTask, on NETWORK_CPU. Priority 0: it only runs when nothing else wants the core.
+#ifndef LOG_TASK_STACK
+#define LOG_TASK_STACK 4096
+#endif
+#ifndef LOG_TASK_PRIORITY
+#define LOG_TASK_PRIORITY 0
+#endif
+
+// Max. wait for the ring to be printed before a restart (a full ring at 115200 baud: ~0.6 s). [ms]
+#define LOG_FLUSH_MS 1000
+
+typedef struct {
+  uint32_t written;     // messages written to Serial
+  uint32_t dropped;     // messages lost because the ring was full
+  uint32_t truncated;   // messages cut because their arguments did not fit into a slot
+  uint32_t queued;      // ring slots in use now (LOG_RING_SLOTS, a long message takes several)
+  uint32_t high_water;  // most ring slots ever in use
+} LogStats;
+
 // Values for Serial_Print_Mode to configure Serial (USB) output mode.
 #define Serial_None 0            // No Serial output
 #define Serial_Debug 1           // Only debug and error messages
 #define Serial_Logging 2         // Log measurements as a table
 #define Serial_One_Minute_Log 3  // One Minute logging
-#define Serial_Statistics_Log 4  // Logs time [us] between two events
+#define Serial_Statistics_Log 4  // Logs a histogram of the time [us] between two events
+#define Serial_Binary 5          // COBS framed, CRC checked binary records (binary_stream.hpp), also the log
+
+// Serial_Binary: baud rate (the log is at 115200 until the switch), send every pulse time too?
+#ifndef SERIAL_BINARY_BAUD
+#define SERIAL_BINARY_BAUD 921600
+#endif
+#ifndef SERIAL_BINARY_PULSES
+#define SERIAL_BINARY_PULSES false
+#endif
 
 extern int Serial_Print_Mode;
 
 class CoreServices {
 public:
   static void setupLogger(int level);
-  static void logMessage(int level, const char *format, ...);
+  static void logMessage(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
   static void logMessageVa(int level, const char *format, va_list args);
+  static void flushLog(uint32_t timeout_ms);
+  static void readLogStats(LogStats &stats);
 
   static void setupDataLogging(int mode);
-  static void logData(int GMC_counts, int time_difference, float Count_Rate, float Dose_Rate, int HV_pulse_count,
-                      int accumulated_GMC_counts, int accumulated_time, float accumulated_Count_Rate, float accumulated_Dose_Rate,
-                      float t, float h, float p);
+  static void logData(const MeasurementRecord &m);
   static void logDataOneMinute(int time_s, int cpm, int counts);
-  static void logDataStatistics(int count_time_between);
+  static void logDataStatistics(int time_s, unsigned int from_us, unsigned int to_us, unsigned int counts);
+  static void logDataBinary(const MeasurementRecord &m);
+  static void logPulsesBinary(const uint32_t *intervals_us, size_t count);
 
   static int hex2data(unsigned char *data, const char *hexstring, unsigned int len);
   static void reverseByteArray(unsigned char *data, int len);
 };
 
-// Keep legacy free-function API for existing call sites.
-void log(int level, const char *format, ...);
+// Keep legacy free-function API for existing call sites (use LOG() for compile time elision).
+// format must be a string literal (or otherwise live forever), it is formatted later by logTask.
+void log(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
 void setup_log(int level);
+// Wait (max. timeout_ms) until logTask wrote everything logged so far, e.g. before a restart.
+void flush_log(uint32_t timeout_ms);
+void read_log_stats(LogStats *stats);
 void setup_log_data(int mode);
-void log_data(int GMC_counts, int time_difference, float Count_Rate, float Dose_Rate, int HV_pulse_count,
-              int accumulated_GMC_counts, int accumulated_time, float accumulated_Count_Rate, float accumulated_Dose_Rate,
-              float t, float h, float p);
+void log_data(const MeasurementRecord &m);
 void log_data_one_minute(int time_s, int cpm, int counts);
-void log_data_statistics(int count_time_between);
+void log_data_statistics(int time_s, unsigned int from_us, unsigned int to_us, unsigned int counts);
+void log_data_binary(const MeasurementRecord &m);
+// Times between pulses [us] as handed to the pulse handler of read_GMC (one task only).
+void log_pulses_binary(const uint32_t *intervals_us, size_t count);
 int hex2data(unsigned char *data, const char *hexstring, unsigned int len);
 void reverseByteArray(unsigned char *data, int len);
 
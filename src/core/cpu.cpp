@@ -0,0 +1,140 @@
+#include "cpu.hpp"
+
+#include <esp_freertos_hooks.h>
+
+typedef struct {
+  void (*fn)(void);
+  TaskHandle_t caller;
+} CoreCall;
+
+static void coreCallTask(void *param) {
+  CoreCall *call = (CoreCall *)param;
+  call->fn();
+  xTaskNotifyGive(call->caller);
+  vTaskDelete(NULL);
+}
+
+void run_on_core(int core, void (*fn)(void)) {
+  if (xPortGetCoreID() == core) {
+    fn();
+    return;
+  }
+  CoreCall call = {fn, xTaskGetCurrentTaskHandle()};
+  xTaskCreatePinnedToCore(coreCallTask, "runOnCore", 4096, &call, uxTaskPriorityGet(NULL), NULL, core);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+static portMUX_TYPE mux_cpu = portMUX_INITIALIZER_UNLOCKED;
+static CpuLoad cpu_load = {};  // protected by mux_cpu
+
+// Tick samples since the previous update, per core: which task the tick interrupted how often.
+// Written by the tick hook of that core, read and cleared by update_cpu_load().
+typedef struct {
+  TaskHandle_t task;
+  uint32_t samples;
+} TaskSamples;
+
+static DRAM_ATTR TaskSamples tick_samples[portNUM_PROCESSORS][CPU_LOAD_MAX_TASKS];
+static DRAM_ATTR uint32_t tick_total[portNUM_PROCESSORS];
+static portMUX_TYPE mux_samples = portMUX_INITIALIZER_UNLOCKED;
+static bool sampling = false;
+
+static void IRAM_ATTR cpu_load_tick_hook(void) {
+  int core = xPortGetCoreID();
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  TaskSamples *s = tick_samples[core];
+  portENTER_CRITICAL_ISR(&mux_samples);
+  tick_total[core]++;
+  for (int i = 0; i < CPU_LOAD_MAX_TASKS; i++) {
+    if ((s[i].task == task) || !s[i].task) {
+      s[i].task = task;
+      s[i].samples++;
+      break;
+    }
+  }  // table full: only counted in the total
+  portEXIT_CRITICAL_ISR(&mux_samples);
+}
+
+void setup_cpu_load(void) {
+  for (int core = 0; core < portNUM_PROCESSORS; core++)
+    esp_register_freertos_tick_hook_for_cpu(cpu_load_tick_hook, core);
+  sampling = true;
+}
+
+// share of one core [permille] of a task, from the samples of all cores
+static uint16_t task_permille(TaskSamples samples[][CPU_LOAD_MAX_TASKS], const uint32_t *total, TaskHandle_t task) {
+  uint32_t permille = 0;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    for (int i = 0; (i < CPU_LOAD_MAX_TASKS) && samples[core][i].task && total[core]; i++) {
+      if (samples[core][i].task == task)
+        permille += (uint64_t)samples[core][i].samples * 1000 / total[core];
+    }
+  }
+  return permille;
+}
+
+static TaskSamples samples[portNUM_PROCESSORS][CPU_LOAD_MAX_TASKS];
+#if CPU_LOAD_TASK_LIST
+static TaskStatus_t task_status[CPU_LOAD_MAX_TASKS];
+#endif
+static uint32_t previous_ms = 0;
+
+void update_cpu_load(void) {
+  uint32_t total[portNUM_PROCESSORS];
+  portENTER_CRITICAL(&mux_samples);
+  memcpy(samples, tick_samples, sizeof(samples));
+  memcpy(total, tick_total, sizeof(total));
+  memset(tick_samples, 0, sizeof(tick_samples));
+  memset(tick_total, 0, sizeof(tick_total));
+  portEXIT_CRITICAL(&mux_samples);
+  uint32_t now_ms = millis();
+
+  CpuLoad load = {};
+  load.supported = sampling && previous_ms;
+  load.period_ms = now_ms - previous_ms;
+  load.samples = total[0];
+  for (int core = 0; (core < portNUM_PROCESSORS) && load.supported; core++) {
+    uint16_t idle = task_permille(samples, total, xTaskGetIdleTaskHandleForCPU(core));
+    load.core_load_permille[core] = (idle < 1000) ? 1000 - idle : 0;
+  }
+#if CPU_LOAD_TASK_LIST
+  int n = load.supported ? uxTaskGetSystemState(task_status, CPU_LOAD_MAX_TASKS, NULL) : 0;
+  for (int i = 0; i < n; i++) {
+    TaskStatus_t &st = task_status[i];
+    TaskLoad &t = load.task[load.tasks++];
+    strncpy(t.name, st.pcTaskName, sizeof(t.name) - 1);
+    BaseType_t affinity = xTaskGetAffinity(st.xHandle);
+    t.core = (affinity == tskNO_AFFINITY) ? -1 : affinity;
+    t.load_permille = task_permille(samples, total, st.xHandle);
+    t.stack_free = st.usStackHighWaterMark;
+  }
+#endif
+  previous_ms = now_ms;
+
+  portENTER_CRITICAL(&mux_cpu);
+  cpu_load = load;
+  portEXIT_CRITICAL(&mux_cpu);
+}
+
+void read_cpu_load(CpuLoad *load) {
+  portENTER_CRITICAL(&mux_cpu);
+  *load = cpu_load;
+  portEXIT_CRITICAL(&mux_cpu);
+}
+
+int format_cpu_load(const CpuLoad *load, char *buf, size_t len) {
+  size_t n = snprintf(buf, len, "{\"supported\":%s,\"counting_cpu\":%d,\"network_cpu\":%d,\"period_ms\":%u,\"samples\":%u,\"core_load_permille\":[",
+                      load->supported ? "true" : "false", COUNTING_CPU, NETWORK_CPU, load->period_ms, load->samples);
+  for (int core = 0; (core < portNUM_PROCESSORS) && (n < len); core++)
+    n += snprintf(buf + n, len - n, "%s%u", core ? "," : "", load->core_load_permille[core]);
+  if (n < len)
+    n += snprintf(buf + n, len - n, "],\"tasks\":[");
+  for (int i = 0; (i < load->tasks) && (n < len); i++) {
+    const TaskLoad &t = load->task[i];
+    n += snprintf(buf + n, len - n, "%s{\"name\":\"%s\",\"core\":%d,\"load_permille\":%u,\"stack_free\":%u}",
+                  i ? "," : "", t.name, t.core, t.load_permille, t.stack_free);
+  }
+  if (n < len)
+    n += snprintf(buf + n, len - n, "]}");
+  return (n < len) ? n : len - 1;
+}
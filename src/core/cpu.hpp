@@ -0,0 +1,73 @@
+/**
+ * @file cpu.hpp
+ * @brief Core affinity layout and cpu load statistics
+ *
+ * The ESP32 has two cores. Counting must not get jitter from networking, so:
+ * - COUNTING_CPU (APP_CPU): GM / cap-full / HV timer interrupts, the counting task
+ *   (Arduino loop: tube read, rates, local alarm), audioTask, rmtTask.
+ * - NETWORK_CPU (PRO_CPU): WiFi / BT / lwIP stacks (ESP-IDF puts them there), networkTask
+ *   (web server, MQTT, display, BLE, logs), transmitTask (HTTP / TLS, LoRa), esp_timer task.
+ *
+ * Interrupts are served by the core that allocated them, so all interrupt setup has to
+ * run on COUNTING_CPU (see run_on_core()).
+ *
+ * The cpu load is sampled: a FreeRTOS tick hook on every core counts which task it interrupted
+ * (1000 samples per second and core). The run time stats of FreeRTOS would be exact, but the
+ * prebuilt ESP-IDF of the Arduino framework has configGENERATE_RUN_TIME_STATS off.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "config/config.hpp"  // COUNTING_CPU / NETWORK_CPU, same in every file
+
+#ifndef COUNTING_CPU
+#define COUNTING_CPU 1  // APP_CPU
+#endif
+
+#ifndef NETWORK_CPU
+#define NETWORK_CPU 0   // PRO_CPU
+#endif
+
+// Max. amount of tasks in the cpu load statistics.
+#ifndef CPU_LOAD_MAX_TASKS
+#define CPU_LOAD_MAX_TASKS 32
+#endif
+
+// Names, cores and stacks of the tasks need uxTaskGetSystemState(), without it only the core loads are there.
+#if (configUSE_TRACE_FACILITY == 1)
+#define CPU_LOAD_TASK_LIST 1
+#else
+#define CPU_LOAD_TASK_LIST 0
+#endif
+
+typedef struct {
+  char name[configMAX_TASK_NAME_LEN];
+  int core;                // pinned to this core, -1: runs on both
+  uint16_t load_permille;  // share of one core's time since the previous update
+  uint32_t stack_free;     // stack high water mark [bytes] (never used so far)
+} TaskLoad;
+
+typedef struct {
+  bool supported;               // false: setup_cpu_load() was not called (yet)
+  uint32_t period_ms;           // time span of the load values
+  uint32_t samples;             // tick samples per core within period_ms
+  uint16_t core_load_permille[portNUM_PROCESSORS];  // 1000 - idle task share
+  int tasks;
+  TaskLoad task[CPU_LOAD_MAX_TASKS];
+} CpuLoad;
+
+// Run fn in a temporary task pinned to core and wait for it (fn runs directly if we are on that core).
+void run_on_core(int core, void (*fn)(void));
+
+// Start sampling the cpu load on all cores.
+void setup_cpu_load(void);
+// Compute the load since the previous call, call it regularly (e.g. every 10 s).
+void update_cpu_load(void);
+void read_cpu_load(CpuLoad *load);
+int format_cpu_load(const CpuLoad *load, char *buf, size_t len);
+
+#define CPU_LOAD_JSON_LEN (64 + CPU_LOAD_MAX_TASKS * 96)
@@ -0,0 +1,63 @@
+/**
+ * @file crc32.hpp
+ * @brief CRC-32 (IEEE 802.3, same as zlib / PNG), nibble table, no Arduino dependencies
+ *
+ * crc32(data, len) of "123456789" is 0xCBF43926. Longer data can be done in pieces:
+ * crc = crc32_update(crc32_update(0, a, a_len), b, b_len).
+ *
+ * Host tools have crc32_fast(): same result, slicing-by-8 (8 KB table), ~10x faster.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+static inline uint32_t crc32_update(uint32_t crc, const void *data, size_t len) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+  };
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc = table[(crc ^ p[i]) & 0x0f] ^ (crc >> 4);
+    crc = table[(crc ^ (p[i] >> 4)) & 0x0f] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+static inline uint32_t crc32(const void *data, size_t len) {
+  return crc32_update(0, data, len);
+}
+
+#ifndef ARDUINO
+static inline uint32_t crc32_fast(const void *data, size_t len) {
+  static const struct Tables {
+    uint32_t t[8][256];
+    Tables() {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+          c = (c >> 1) ^ ((c & 1) ? 0xedb88320 : 0);
+        t[0][i] = c;
+      }
+      for (uint32_t i = 0; i < 256; i++)
+        for (int s = 1; s < 8; s++)
+          t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xff];
+    }
+  } tables;
+  const uint32_t (*t)[256] = tables.t;
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  uint32_t crc = 0xffffffff;
+  for (; len >= 8; p += 8, len -= 8) {
+    uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+    uint32_t hi = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+  for (; len; p++, len--)
+    crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+#endif
@@ -0,0 +1,306 @@
+#include "history.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include "core/chunk_writer.hpp"
+
+// --- encoding ---
+
+static size_t put_varint(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+static size_t put_delta(uint8_t *out, uint32_t value, uint32_t previous) {
+  int32_t delta = (int32_t)(value - previous);
+  return put_varint(out, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));  // zigzag
+}
+
+static bool get_varint(const uint8_t *in, size_t len, size_t &pos, uint32_t &value) {
+  value = 0;
+  for (int shift = 0; (shift < 35) && (pos < len); shift += 7) {
+    uint8_t b = in[pos++];
+    value |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static bool get_delta(const uint8_t *in, size_t len, size_t &pos, uint32_t previous, uint32_t &value) {
+  uint32_t zigzag;
+  if (!get_varint(in, len, pos, zigzag))
+    return false;
+  value = previous + ((zigzag >> 1) ^ -(zigzag & 1));
+  return true;
+}
+
+// base: the previous sample, THP from the previous sample with valid THP
+static size_t encode_sample(const HistorySample &base, const HistorySample &s, uint8_t *out) {
+  size_t n = put_varint(out, s.flags);
+  n += put_delta(out + n, s.t, base.t);
+  n += put_delta(out + n, s.counts, base.counts);
+  n += put_delta(out + n, s.dt_ms, base.dt_ms);
+  n += put_delta(out + n, s.hv_pulses, base.hv_pulses);
+  if (s.flags & HIST_THP_VALID) {
+    n += put_delta(out + n, (uint32_t)s.temperature, (uint32_t)base.temperature);
+    n += put_delta(out + n, s.humidity, base.humidity);
+    n += put_delta(out + n, s.pressure, base.pressure);
+  }
+  return n;
+}
+
+static void advance_base(HistorySample &base, const HistorySample &s) {
+  base.t = s.t;
+  base.counts = s.counts;
+  base.dt_ms = s.dt_ms;
+  base.hv_pulses = s.hv_pulses;
+  base.flags = s.flags;
+  if (s.flags & HIST_THP_VALID) {
+    base.temperature = s.temperature;
+    base.humidity = s.humidity;
+    base.pressure = s.pressure;
+  }
+}
+
+HistorySample history_sample(const MeasurementRecord &m) {
+  HistorySample s = {};
+  s.t = (uint32_t)m.utc;
+  s.counts = m.counts;
+  s.dt_ms = m.dt_ms;
+  s.hv_pulses = m.hv_pulses;
+  if (m.status & MEAS_HV_ERROR)
+    s.flags |= HIST_HV_ERROR;
+  if (m.status & MEAS_TIME_VALID)
+    s.flags |= HIST_TIME_VALID;
+  if (m.status & MEAS_THP_VALID) {
+    s.flags |= HIST_THP_VALID;
+    s.temperature = (int16_t)lroundf(m.temperature * 10);
+    s.humidity = (uint16_t)lroundf(m.humidity * 10);
+    s.pressure = (uint16_t)lroundf(m.pressure * 10);
+  }
+  return s;
+}
+
+// --- rollup ---
+
+void HistoryRollup::add(const HistorySample &s) {
+  sum.t = s.t;
+  sum.counts += s.counts;
+  sum.dt_ms += s.dt_ms;
+  sum.hv_pulses += s.hv_pulses;
+  sum.flags |= s.flags & HIST_HV_ERROR;
+  if (samples == 0)
+    sum.flags |= s.flags & HIST_TIME_VALID;
+  else if (!(s.flags & HIST_TIME_VALID))
+    sum.flags &= ~HIST_TIME_VALID;
+  if (s.flags & HIST_THP_VALID) {
+    temperature += s.temperature;
+    humidity += s.humidity;
+    pressure += s.pressure;
+    thp_samples++;
+  }
+  samples++;
+}
+
+HistorySample HistoryRollup::result() const {
+  HistorySample s = sum;
+  if (thp_samples) {
+    s.flags |= HIST_THP_VALID;
+    s.temperature = (int16_t)lroundf((float)temperature / thp_samples);
+    s.humidity = (uint16_t)((humidity + thp_samples / 2) / thp_samples);
+    s.pressure = (uint16_t)((pressure + thp_samples / 2) / thp_samples);
+  }
+  return s;
+}
+
+void HistoryRollup::reset() {
+  *this = HistoryRollup();
+}
+
+// --- tier ---
+
+void HistoryTier::append(const HistorySample &s) {
+  uint8_t encoded[HISTORY_MAX_SAMPLE_BYTES];
+  if (used_blocks) {
+    int current = physical(used_blocks - 1);
+    size_t n = encode_sample(base, s, encoded);
+    if (used[current] + n <= HISTORY_BLOCK_SIZE) {
+      memcpy(data + current * HISTORY_BLOCK_SIZE + used[current], encoded, n);
+      used[current] += n;
+      block_samples[current]++;
+      sample_count++;
+      advance_base(base, s);
+      return;
+    }
+  }
+
+  // next block, it starts with a complete sample
+  if (used_blocks == blocks) {
+    sample_count -= block_samples[oldest_block];
+    oldest_block = (oldest_block + 1) % blocks;
+    used_blocks--;
+  }
+  int current = physical(used_blocks++);
+  base = {};
+  size_t n = encode_sample(base, s, encoded);
+  memcpy(data + current * HISTORY_BLOCK_SIZE, encoded, n);
+  used[current] = n;
+  block_samples[current] = 1;
+  first_t[current] = s.t;
+  sample_count++;
+  advance_base(base, s);
+}
+
+size_t HistoryTier::bytesUsed() const {
+  size_t bytes = 0;
+  for (int i = 0; i < used_blocks; i++)
+    bytes += used[physical(i)];
+  return bytes;
+}
+
+HistoryReader HistoryTier::read(uint32_t from_s) const {
+  // all samples of a block are older than the first one of the next block
+  int block = 0;
+  while ((block + 1 < used_blocks) && (first_t[physical(block + 1)] <= from_s))
+    block++;
+  return HistoryReader(*this, block);
+}
+
+bool HistoryReader::next(HistorySample &s) {
+  while (block < tier->used_blocks) {
+    int b = tier->physical(block);
+    const uint8_t *in = tier->data + b * HISTORY_BLOCK_SIZE;
+    size_t len = tier->used[b];
+    if (pos < len) {
+      if (pos == 0)
+        base = {};
+      uint32_t flags, temperature, humidity, pressure;
+      if (!get_varint(in, len, pos, flags) ||
+          !get_delta(in, len, pos, base.t, s.t) ||
+          !get_delta(in, len, pos, base.counts, s.counts) ||
+          !get_delta(in, len, pos, base.dt_ms, s.dt_ms) ||
+          !get_delta(in, len, pos, base.hv_pulses, s.hv_pulses))
+        return false;
+      s.flags = flags;
+      s.temperature = 0;
+      s.humidity = 0;
+      s.pressure = 0;
+      if (flags & HIST_THP_VALID) {
+        if (!get_delta(in, len, pos, (uint32_t)base.temperature, temperature) ||
+            !get_delta(in, len, pos, base.humidity, humidity) ||
+            !get_delta(in, len, pos, base.pressure, pressure))
+          return false;
+        s.temperature = (int16_t)temperature;
+        s.humidity = (uint16_t)humidity;
+        s.pressure = (uint16_t)pressure;
+      }
+      advance_base(base, s);
+      return true;
+    }
+    block++;
+    pos = 0;
+  }
+  return false;
+}
+
+// --- history ---
+
+History::History() : minutes(60), ten_minutes(600), hours(3600), tiers{&minutes, &ten_minutes, &hours} {}
+
+void History::add(const HistorySample &minute) {
+  HistorySample s = minute;
+  tiers[0]->append(s);
+  for (int i = 1; i < HISTORY_TIERS; i++) {
+    // a period of tiers[i] ends when the first sample of the next one arrives
+    HistoryRollup &rollup = rollups[i - 1];
+    uint32_t res = tiers[i]->resolution();
+    bool period_done = !rollup.empty() && ((rollup.lastTime() / res) != (s.t / res));
+    HistorySample done;
+    if (period_done) {
+      done = rollup.result();
+      rollup.reset();
+    }
+    rollup.add(s);
+    if (!period_done)
+      return;
+    tiers[i]->append(done);
+    s = done;
+  }
+}
+
+const HistoryTier &History::select(uint32_t from_s, uint32_t res_s) const {
+  const HistoryTier *finest_covering = nullptr;
+  const HistoryTier *coarsest_fitting = nullptr;
+  for (int i = 0; i < HISTORY_TIERS; i++) {
+    const HistoryTier *t = tiers[i];
+    bool covering = !t->empty() && (t->oldest() <= from_s + t->resolution());
+    if (!covering)
+      continue;
+    if (!finest_covering)
+      finest_covering = t;
+    if (t->resolution() <= res_s)
+      coarsest_fitting = t;
+  }
+  if (coarsest_fitting)
+    return *coarsest_fitting;
+  if (finest_covering)
+    return *finest_covering;
+  // nothing reaches back that far: the tier reaching back furthest
+  for (int i = HISTORY_TIERS - 1; i > 0; i--) {
+    if (!tiers[i]->empty())
+      return *tiers[i];
+  }
+  return *tiers[0];
+}
+
+// --- query ---
+
+static void print_sample(ChunkWriter &out, const HistorySample &s, bool first) {
+  out.printf("%s[%u,%u,%u,%u,", first ? "" : ",", s.t, s.counts, s.dt_ms, s.hv_pulses);
+  if (s.flags & HIST_THP_VALID)
+    out.printf("%.1f,%.1f,%.1f,", s.temperature / 10.0, s.humidity / 10.0, s.pressure / 10.0);
+  else
+    out.printf("null,null,null,");
+  out.printf("%u]", s.flags);
+}
+
+void history_query(const History &history, uint32_t from_s, uint32_t to_s, uint32_t res_s, ChunkOutput output, void *context) {
+  const HistoryTier &tier = history.select(from_s, res_s);
+  if (res_s < tier.resolution())
+    res_s = tier.resolution();
+
+  ChunkWriter out(output, context);
+  out.printf("{\"res\":%u,\"tier\":%u,\"samples\":[", res_s, tier.resolution());
+  HistoryReader reader = tier.read(from_s);
+  HistoryRollup bucket;
+  HistorySample s;
+  bool first = true;
+  while (reader.next(s)) {
+    if (s.t < from_s)
+      continue;
+    if (s.t > to_s)
+      break;
+    if (res_s == tier.resolution()) {
+      print_sample(out, s, first);
+      first = false;
+      continue;
+    }
+    // downsample: sum up the samples of one res_s period
+    if (!bucket.empty() && ((bucket.lastTime() / res_s) != (s.t / res_s))) {
+      print_sample(out, bucket.result(), first);
+      first = false;
+      bucket.reset();
+    }
+    bucket.add(s);
+  }
+  if (!bucket.empty())
+    print_sample(out, bucket.result(), first);
+  out.printf("]}");
+}
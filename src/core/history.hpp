@@ -0,0 +1,201 @@
+/**
+ * @file history.hpp
+ * @brief RAM time series of the measurements: one minute samples rolled up to 10 min and 1 h
+ *
+ * Every minute one HistorySample (counts, dt, HV pulses, THP) is added. Each resolution
+ * (tier) is a ring of fixed size blocks, a block starts with a complete sample and every
+ * further sample is stored as zigzag varint deltas to the one before (typically 9 - 11 bytes
+ * per sample). When a tier is full, its oldest block is dropped.
+ *
+ * Samples of a tier are summed up (counts, dt, HV pulses; THP averaged) into one sample of
+ * the next coarser tier whenever a new period of that tier starts, so the coarser tiers lag
+ * behind by up to their resolution.
+ *
+ * Not thread safe: add samples and read them in the same task (networkTask).
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/chunk_writer.hpp"
+#include "core/measurement.hpp"
+
+#ifdef ARDUINO
+#include "config/config.hpp"  // HISTORY_* sizes the members of History, same in every file
+#endif
+
+// Bytes per block, a block is dropped as a whole when a tier is full.
+#ifndef HISTORY_BLOCK_SIZE
+#define HISTORY_BLOCK_SIZE 256
+#endif
+
+// Blocks per tier, HISTORY_BLOCK_SIZE bytes each.
+#ifndef HISTORY_MINUTE_BLOCKS
+#define HISTORY_MINUTE_BLOCKS 48  // 12 KB, ~22 h
+#endif
+#ifndef HISTORY_10MIN_BLOCKS
+#define HISTORY_10MIN_BLOCKS 32   // 8 KB, ~5 days
+#endif
+#ifndef HISTORY_HOUR_BLOCKS
+#define HISTORY_HOUR_BLOCKS 16    // 4 KB, ~2 weeks
+#endif
+
+#define HISTORY_TIERS 3
+
+// HistorySample flags
+#define HIST_HV_ERROR 0x01    // HV charger error during the period
+#define HIST_THP_VALID 0x02   // temperature / humidity / pressure are measured values
+#define HIST_TIME_VALID 0x04  // t is a real wall clock time (else: no NTP sync yet)
+
+// Max. bytes of one encoded sample.
+#define HISTORY_MAX_SAMPLE_BYTES 32
+
+/**
+ * @struct HistorySample
+ * @brief One period of a tier
+ */
+struct HistorySample {
+  uint32_t t;            ///< end of the period, utc [s]
+  uint32_t counts;
+  uint32_t dt_ms;        ///< time the counts were counted in
+  uint32_t hv_pulses;
+  int16_t temperature;   ///< [0.1 °C], see HIST_THP_VALID
+  uint16_t humidity;     ///< [0.1 %]
+  uint16_t pressure;     ///< [0.1 hPa]
+  uint8_t flags;         ///< HIST_* bits
+};
+
+// One minute sample from a measurement record.
+HistorySample history_sample(const MeasurementRecord &m);
+
+/**
+ * @class HistoryRollup
+ * @brief Sums up samples into one sample of a coarser resolution
+ */
+class HistoryRollup {
+public:
+  void add(const HistorySample &s);
+  bool empty() const { return samples == 0; }
+  uint32_t lastTime() const { return sum.t; }
+  HistorySample result() const;
+  void reset();
+
+private:
+  HistorySample sum = {};
+  int32_t temperature = 0;
+  uint32_t humidity = 0;
+  uint32_t pressure = 0;
+  uint32_t thp_samples = 0;
+  uint32_t samples = 0;
+};
+
+class HistoryReader;
+
+/**
+ * @class HistoryTier
+ * @brief Delta / varint encoded ring of samples of one resolution, see HistoryTierStorage
+ */
+class HistoryTier {
+public:
+  void append(const HistorySample &s);
+
+  uint32_t resolution() const { return resolution_s; }
+  size_t samples() const { return sample_count; }
+  size_t bytesUsed() const;
+  size_t capacity() const { return (size_t)blocks * HISTORY_BLOCK_SIZE; }
+  bool empty() const { return used_blocks == 0; }
+
+  /** @brief Time of the oldest sample, 0 if empty */
+  uint32_t oldest() const { return used_blocks ? first_t[oldest_block] : 0; }
+
+  /** @brief Read the samples from the first block which may contain samples at or after from_s */
+  HistoryReader read(uint32_t from_s) const;
+
+  HistoryTier(const HistoryTier &) = delete;
+  HistoryTier &operator=(const HistoryTier &) = delete;
+
+protected:
+  HistoryTier(uint8_t *data, uint16_t *used, uint16_t *block_samples, uint32_t *first_t, int blocks, uint32_t resolution_s)
+    : data(data), used(used), block_samples(block_samples), first_t(first_t), blocks(blocks), resolution_s(resolution_s) {}
+
+private:
+  friend class HistoryReader;
+  int physical(int block) const { return (oldest_block + block) % blocks; }
+
+  uint8_t *data;             // blocks * HISTORY_BLOCK_SIZE
+  uint16_t *used;            // bytes used per block
+  uint16_t *block_samples;   // samples per block
+  uint32_t *first_t;         // time of the first sample per block
+  int blocks;
+  uint32_t resolution_s;
+  int oldest_block = 0;
+  int used_blocks = 0;
+  size_t sample_count = 0;
+  HistorySample base = {};   // what the next sample is encoded against
+};
+
+template <int BLOCKS>
+class HistoryTierStorage : public HistoryTier {
+public:
+  explicit HistoryTierStorage(uint32_t resolution_s)
+    : HistoryTier(&storage[0][0], used, block_samples, first_t, BLOCKS, resolution_s) {}
+
+private:
+  uint8_t storage[BLOCKS][HISTORY_BLOCK_SIZE] = {};
+  uint16_t used[BLOCKS] = {};
+  uint16_t block_samples[BLOCKS] = {};
+  uint32_t first_t[BLOCKS] = {};
+};
+
+/**
+ * @class HistoryReader
+ * @brief Decodes the samples of a tier, oldest first
+ */
+class HistoryReader {
+public:
+  explicit HistoryReader(const HistoryTier &tier, int block = 0) : tier(&tier), block(block) {}
+  bool next(HistorySample &s);
+
+private:
+  const HistoryTier *tier;
+  int block;
+  size_t pos = 0;
+  HistorySample base = {};
+};
+
+class History {
+public:
+  History();
+
+  /** @brief Add a one minute sample (and roll it up) */
+  void add(const HistorySample &minute);
+
+  const HistoryTier &tier(int i) const { return *tiers[i]; }
+
+  /**
+   * @brief Tier to answer a query from from_s with a resolution of res_s
+   *
+   * The coarsest tier with a resolution <= res_s reaching back to from_s, or if the
+   * requested resolution is finer than all tiers which do, the finest which does.
+   */
+  const HistoryTier &select(uint32_t from_s, uint32_t res_s) const;
+
+private:
+  HistoryTierStorage<HISTORY_MINUTE_BLOCKS> minutes;
+  HistoryTierStorage<HISTORY_10MIN_BLOCKS> ten_minutes;
+  HistoryTierStorage<HISTORY_HOUR_BLOCKS> hours;
+  HistoryTier *tiers[HISTORY_TIERS];
+  HistoryRollup rollups[HISTORY_TIERS - 1];  // into tiers[1], tiers[2]
+};
+
+/**
+ * Write the samples from from_s to to_s as JSON, summed up to res_s (at least the
+ * resolution of the selected tier), in pieces of up to CHUNK_WRITER_LEN bytes:
+ *   {"res":600,"tier":600,"samples":[[t,counts,dt_ms,hv_pulses,temperature,humidity,pressure,flags],...]}
+ * THP values are null if not valid.
+ */
+void history_query(const History &history, uint32_t from_s, uint32_t to_s, uint32_t res_s, ChunkOutput output, void *context);
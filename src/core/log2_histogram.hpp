@@ -0,0 +1,141 @@
+/**
+ * @file log2_histogram.hpp
+ * @brief Fixed memory log2 / linear bucket histogram
+ *
+ * Values below 2^SUB_BITS get a bucket of their own (linear part), above that every
+ * power of 2 is split into 2^SUB_BITS equally sized buckets (log2 part), so the
+ * relative bucket width is at most 2^-SUB_BITS over the whole range. Values of
+ * 2^MAX_BITS and above are counted in the last bucket.
+ *
+ * Bucket i has the lower bound
+ *   i                                                  for i < 2^SUB_BITS
+ *   (2^SUB_BITS + i % 2^SUB_BITS) << (i / 2^SUB_BITS - 1)  otherwise
+ *
+ * add() is O(1), does not allocate and is forced inline, so it can be used from an
+ * IRAM_ATTR ISR. Not thread safe, fill and read it from the same task (or use a lock).
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LOG2_HISTOGRAM_INLINE inline __attribute__((always_inline))
+
+template <unsigned SUB_BITS, unsigned MAX_BITS>
+class Log2Histogram {
+  static_assert(SUB_BITS < MAX_BITS && MAX_BITS <= 32, "Log2Histogram: need SUB_BITS < MAX_BITS <= 32");
+
+public:
+  static constexpr size_t BUCKETS = (size_t)(MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+  /** @brief Buffer size toJson() needs in the worst case */
+  static constexpr size_t JSON_MAX_LEN = 128 + BUCKETS * 11;
+
+  void reset() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT32_MAX;
+    max_ = 0;
+  }
+
+  Log2Histogram() { reset(); }
+
+  LOG2_HISTOGRAM_INLINE void add(uint32_t value) {
+    counts_[index(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_)
+      min_ = value;
+    if (value > max_)
+      max_ = value;
+  }
+
+  /** @brief Add all counts of another histogram (same layout) */
+  void merge(const Log2Histogram &other) {
+    for (size_t i = 0; i < BUCKETS; i++)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.min_ < min_)
+      min_ = other.min_;
+    if (other.max_ > max_)
+      max_ = other.max_;
+  }
+
+  static LOG2_HISTOGRAM_INLINE size_t index(uint32_t value) {
+    if (value < (1u << SUB_BITS))
+      return value;
+    unsigned msb = 31 - __builtin_clz(value);
+    if (msb >= MAX_BITS)
+      return BUCKETS - 1;
+    unsigned shift = msb - SUB_BITS;
+    return ((size_t)(shift + 1) << SUB_BITS) | ((value >> shift) & ((1u << SUB_BITS) - 1));
+  }
+
+  /** @brief Smallest value counted in bucket i */
+  static uint32_t bucketLow(size_t i) {
+    if (i < (1u << SUB_BITS))
+      return i;
+    unsigned shift = (i >> SUB_BITS) - 1;
+    return (uint32_t)((1u << SUB_BITS) | (i & ((1u << SUB_BITS) - 1))) << shift;
+  }
+
+  /** @brief Largest value counted in bucket i */
+  static uint32_t bucketHigh(size_t i) {
+    return (i + 1 < BUCKETS) ? bucketLow(i + 1) - 1 : UINT32_MAX;
+  }
+
+  uint32_t bucket(size_t i) const { return counts_[i]; }
+  uint32_t count() const { return count_; }
+  uint32_t min() const { return count_ ? min_ : 0; }
+  uint32_t max() const { return max_; }
+  uint32_t mean() const { return count_ ? (uint32_t)(sum_ / count_) : 0; }
+
+  /** @brief Value below which the given fraction (0..1) of all values is, resolution is one bucket */
+  uint32_t percentile(float fraction) const {
+    uint32_t target = (uint32_t)(fraction * count_);
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      seen += counts_[i];
+      if (seen > target)
+        return bucketHigh(i);
+    }
+    return max_;
+  }
+
+  /**
+   * @brief Write the histogram as JSON object into buf
+   *
+   * Format: {"sub_bits":S,"count":N,"min":..,"max":..,"mean":..,"first":F,"counts":[..]},
+   * counts starts at bucket F and ends at the last non-empty bucket.
+   * @return length written (like snprintf, >= len means truncated, never happens with JSON_MAX_LEN)
+   */
+  int toJson(char *buf, size_t len) const {
+    size_t first = 0, last = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+      if (counts_[i]) {
+        if (!last)
+          first = i;
+        last = i + 1;
+      }
+    }
+    int n = snprintf(buf, len, "{\"sub_bits\":%u,\"count\":%u,\"min\":%u,\"max\":%u,\"mean\":%u,\"first\":%u,\"counts\":[",
+                     SUB_BITS, (unsigned)count_, (unsigned)min(), (unsigned)max_, (unsigned)mean(), (unsigned)first);
+    for (size_t i = first; i < last; i++)
+      n += snprintf(buf + ((size_t)n < len ? n : len), (size_t)n < len ? len - n : 0, i > first ? ",%u" : "%u", (unsigned)counts_[i]);
+    n += snprintf(buf + ((size_t)n < len ? n : len), (size_t)n < len ? len - n : 0, "]}");
+    return n;
+  }
+
+private:
+  uint32_t counts_[BUCKETS];
+  uint32_t count_;
+  uint64_t sum_;
+  uint32_t min_;
+  uint32_t max_;
+};
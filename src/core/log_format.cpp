@@ -0,0 +1,338 @@
+#include "log_format.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+enum ArgType : uint8_t {
+  ARG_INT,       // also char, short (promoted)
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_SIZE,      // %z, %t
+  ARG_DOUBLE,    // also float (promoted)
+  ARG_LDOUBLE,
+  ARG_STRING,
+  ARG_POINTER
+};
+
+struct Spec {
+  const char *end;  // after the conversion character
+  int stars;        // '*' width / precision: int arguments before the value
+  ArgType type;
+};
+
+static bool parse_spec(const char *p, Spec &spec) {
+  // p: after the '%'
+  while (*p && strchr("-+ #0", *p))
+    p++;
+  spec.stars = 0;
+  if (*p == '*') {
+    spec.stars++;
+    p++;
+  }
+  while ((*p >= '0') && (*p <= '9'))
+    p++;
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      spec.stars++;
+      p++;
+    }
+    while ((*p >= '0') && (*p <= '9'))
+      p++;
+  }
+  char length = 0;
+  while (*p && strchr("hljztL", *p)) {
+    length = ((length == 'l') && (*p == 'l')) ? 'q' : *p;  // q: ll
+    p++;
+  }
+  switch (*p) {
+  case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+    spec.type = (length == 'l') ? ARG_LONG : ((length == 'q') || (length == 'j')) ? ARG_LLONG :
+                ((length == 'z') || (length == 't')) ? ARG_SIZE : ARG_INT;
+    break;
+  case 'c':
+    spec.type = ARG_INT;
+    break;
+  case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+    spec.type = (length == 'L') ? ARG_LDOUBLE : ARG_DOUBLE;
+    break;
+  case 's':
+    spec.type = ARG_STRING;
+    break;
+  case 'p':
+    spec.type = ARG_POINTER;
+    break;
+  default:
+    return false;  // unknown / %n: not a conversion we take arguments for
+  }
+  spec.end = p + 1;
+  return true;
+}
+
+static size_t arg_size(ArgType type) {
+  switch (type) {
+  case ARG_LONG: return sizeof(long);
+  case ARG_LLONG: return sizeof(long long);
+  case ARG_SIZE: return sizeof(size_t);
+  case ARG_DOUBLE: return sizeof(double);
+  case ARG_LDOUBLE: return sizeof(long double);
+  case ARG_POINTER: return sizeof(void *);
+  default: return sizeof(int);
+  }
+}
+
+size_t log_pack(uint8_t *buf, size_t size, const char *format, va_list args, uint16_t *stop) {
+  *stop = LOG_COMPLETE;
+  size_t pos = 0;
+  for (const char *p = format; *p; p++) {
+    if (*p != '%')
+      continue;
+    if (p[1] == '%') {
+      p++;
+      continue;
+    }
+    Spec spec;
+    if (!parse_spec(p + 1, spec))
+      continue;
+    if (pos + spec.stars * sizeof(int) + ((spec.type == ARG_STRING) ? 1 : arg_size(spec.type)) > size) {
+      *stop = p - format;  // no room for this one
+      return pos;
+    }
+    for (int i = 0; i < spec.stars; i++) {
+      int star = va_arg(args, int);
+      memcpy(buf + pos, &star, sizeof(star));
+      pos += sizeof(star);
+    }
+    p = spec.end - 1;
+    switch (spec.type) {
+    case ARG_INT: {
+      int v = va_arg(args, int);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_LONG: {
+      long v = va_arg(args, long);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_LLONG: {
+      long long v = va_arg(args, long long);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_SIZE: {
+      size_t v = va_arg(args, size_t);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_DOUBLE: {
+      double v = va_arg(args, double);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_LDOUBLE: {
+      long double v = va_arg(args, long double);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_POINTER: {
+      void *v = va_arg(args, void *);
+      memcpy(buf + pos, &v, sizeof(v));
+      break;
+    }
+    case ARG_STRING: {
+      const char *s = va_arg(args, const char *);
+      if (!s)
+        s = "(null)";
+      size_t room = size - pos - 1;
+      size_t n = strlen(s);
+      if (n > room) {
+        memcpy(buf + pos, s, room);
+        buf[pos + room] = 0;
+        *stop = spec.end - format;  // the cut string is the last thing shown
+        return size;
+      }
+      memcpy(buf + pos, s, n + 1);
+      pos += n + 1;
+      continue;
+    }
+    }
+    pos += arg_size(spec.type);
+  }
+  return pos;
+}
+
+template <class T>
+static int print(char *out, size_t len, const char *fmt, int stars, const int *star, T v) {
+  switch (stars) {
+  case 0: return snprintf(out, len, fmt, v);
+  case 1: return snprintf(out, len, fmt, star[0], v);
+  default: return snprintf(out, len, fmt, star[0], star[1], v);
+  }
+}
+
+size_t log_render(const char *format, uint16_t stop, const uint8_t *args, char *out, size_t len) {
+  if (!len)
+    return 0;
+  const char *end = (stop == LOG_COMPLETE) ? format + strlen(format) : format + stop;
+  size_t pos = 0, arg = 0;
+  for (const char *p = format; (p < end) && (pos + 1 < len);) {
+    Spec spec;
+    char fmt[24];
+    if ((*p != '%') || (p[1] == '%') || !parse_spec(p + 1, spec) || ((size_t)(spec.end - p) >= sizeof(fmt))) {
+      out[pos++] = *p;
+      p += ((*p == '%') && (p[1] == '%')) ? 2 : 1;
+      continue;
+    }
+    memcpy(fmt, p, spec.end - p);
+    fmt[spec.end - p] = 0;
+    int star[2] = {0, 0};
+    for (int i = 0; i < spec.stars; i++) {
+      memcpy(&star[i], args + arg, sizeof(int));
+      arg += sizeof(int);
+    }
+    int n = 0;
+    size_t used = arg_size(spec.type);
+    switch (spec.type) {
+    case ARG_INT: {
+      int v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_LONG: {
+      long v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_LLONG: {
+      long long v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_SIZE: {
+      size_t v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_DOUBLE: {
+      double v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_LDOUBLE: {
+      long double v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_POINTER: {
+      void *v;
+      memcpy(&v, args + arg, sizeof(v));
+      n = print(out + pos, len - pos, fmt, spec.stars, star, v);
+      break;
+    }
+    case ARG_STRING: {
+      const char *s = reinterpret_cast<const char *>(args + arg);
+      n = print(out + pos, len - pos, fmt, spec.stars, star, s);
+      used = strlen(s) + 1;
+      break;
+    }
+    }
+    arg += used;
+    pos += (n > 0) ? n : 0;
+    if (pos >= len)
+      pos = len - 1;
+    p = spec.end;
+  }
+  if ((stop != LOG_COMPLETE) && (pos + 4 <= len)) {
+    memcpy(out + pos, "...", 3);
+    pos += 3;
+  }
+  out[pos] = 0;
+  return pos;
+}
+
+// Continuation slots carry LogRecord-sized pieces of the packed arguments.
+static size_t log_parts(size_t packed) {
+  if (packed <= LOG_SLOT_ARGS)
+    return 1;
+  return 1 + (packed - LOG_SLOT_ARGS + sizeof(LogRecord) - 1) / sizeof(LogRecord);
+}
+
+bool LogRing::write(uint32_t time_ms, int level, const char *format, va_list args) {
+  uint8_t packed[LOG_ARGS_MAX];
+  uint16_t stop;
+  size_t n = log_pack(packed, sizeof(packed), format, args, &stop);
+  return put(format, time_ms, level, stop, packed, n);
+}
+
+bool LogRing::writeRaw(uint32_t time_ms, uint8_t type, const uint8_t *data, size_t len) {
+  if (len > LOG_ARGS_MAX)
+    return false;
+  return put(nullptr, time_ms, type, len, data, len);
+}
+
+bool LogRing::put(const char *format, uint32_t time_ms, int level, uint16_t stop, const uint8_t *packed, size_t n) {
+  uint32_t parts = log_parts(n);
+  uint32_t pos;
+  LogRecord *r = ring.claim(pos, parts);
+  if (!r)
+    return false;
+  r->format = format;
+  r->time_ms = time_ms;
+  r->level = (level > 255) ? 255 : level;
+  r->parts = parts;
+  r->stop = stop;
+  memcpy(r->args, packed, (n < LOG_SLOT_ARGS) ? n : LOG_SLOT_ARGS);
+  for (uint32_t i = 1; i < parts; i++) {
+    size_t from = LOG_SLOT_ARGS + (i - 1) * sizeof(LogRecord);
+    size_t len = (n - from < sizeof(LogRecord)) ? n - from : sizeof(LogRecord);
+    memcpy(reinterpret_cast<uint8_t *>(ring.at(pos + i)), packed + from, len);
+    ring.publish(pos + i);
+  }
+  ring.publish(pos);  // the first slot last: the consumer takes the message when it sees that one
+  return true;
+}
+
+bool LogRing::read(LogMessage &m, char *out, size_t len) {
+  const LogRecord *r = ring.peek();
+  if (!r)
+    return false;
+  m.time_ms = r->time_ms;
+  m.level = r->level;
+  m.raw = !r->format;
+  m.truncated = !m.raw && (r->stop != LOG_COMPLETE);
+  if (m.raw) {
+    m.len = (r->stop <= len) ? r->stop : 0;
+    for (size_t from = 0, i = 0; from < m.len; i++) {
+      const uint8_t *src = i ? reinterpret_cast<const uint8_t *>(ring.peek(i)) : r->args;
+      size_t n = i ? sizeof(LogRecord) : LOG_SLOT_ARGS;
+      memcpy(out + from, src, (m.len - from < n) ? m.len - from : n);
+      from += n;
+    }
+  } else if (r->parts <= 1) {
+    m.len = log_render(r->format, r->stop, r->args, out, len);
+  } else {
+    uint8_t packed[LOG_ARGS_MAX];
+    memcpy(packed, r->args, LOG_SLOT_ARGS);
+    for (uint32_t i = 1; i < r->parts; i++) {
+      size_t from = LOG_SLOT_ARGS + (i - 1) * sizeof(LogRecord);
+      size_t n = (sizeof(packed) - from < sizeof(LogRecord)) ? sizeof(packed) - from : sizeof(LogRecord);
+      memcpy(packed + from, ring.peek(i), n);  // published before the first slot
+    }
+    m.len = log_render(r->format, r->stop, packed, out, len);
+  }
+  ring.release(r->parts);
+  return true;
+}
+
+void LogRing::readStats(uint32_t &queued, uint32_t &dropped, uint32_t &high_water) {
+  queued = ring.size();
+  dropped = ring.dropped();
+  high_water = ring.highWater();
+}
@@ -0,0 +1,94 @@
+/**
+ * @file log_format.hpp
+ * @brief Deferred printf: pack a format's arguments, render the message later
+ *
+ * log_pack() walks the format once and copies the arguments (by their conversion: int,
+ * long, long long, size_t, double, pointer) into a buffer; %s strings are copied too,
+ * so the caller's buffers may go away. The format itself is only referenced, it has to
+ * be a string literal. log_render() formats the packed arguments with snprintf() per
+ * conversion.
+ *
+ * LogRing keeps such messages in an MpscRing: a message takes one slot, or some more
+ * consecutive ones if its arguments do not fit (long %s strings, e.g. HTTP bodies). If the
+ * arguments do not fit into LOG_ARGS_MAX bytes at all, the last string is cut and the rest
+ * of the message is replaced by "...". %n is not supported.
+ *
+ * A raw record (writeRaw(), format nullptr) carries bytes which the consumer writes as they
+ * are, e.g. binary frames: that way there is only one task writing to the UART.
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/mpsc_ring.hpp"
+
+// Room for the packed arguments of one message (incl. copied strings). [bytes]
+#ifndef LOG_ARGS_MAX
+#define LOG_ARGS_MAX 480
+#endif
+
+// Messages waiting for the consumer, in slots of 128 bytes (power of 2).
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 64
+#endif
+
+#define LOG_SLOT_ARGS 116     // LogRecord.args: the slot is 128 bytes on the ESP32
+#define LOG_COMPLETE 0xffff   // LogRecord.stop: all arguments were packed
+
+/**
+ * @struct LogRecord
+ * @brief First slot of a message in the log ring (further slots: raw packed arguments)
+ */
+struct LogRecord {
+  const char *format;  ///< nullptr: a raw record
+  uint32_t time_ms;    ///< monotonic time [ms] when it was logged (low 32 bits, see logTask)
+  uint8_t level;       ///< raw record: its type
+  uint8_t parts;       ///< slots of this message (incl. this one)
+  uint16_t stop;       ///< render the format up to this offset, then "...", or LOG_COMPLETE; raw: length
+  uint8_t args[LOG_SLOT_ARGS];
+};
+
+/**
+ * @struct LogMessage
+ * @brief What LogRing::read() tells about the message it rendered
+ */
+struct LogMessage {
+  uint32_t time_ms;
+  uint8_t level;       ///< raw: the type given to writeRaw()
+  bool raw;            ///< out has the bytes given to writeRaw(), not text
+  bool truncated;      ///< arguments were cut (more than LOG_ARGS_MAX bytes)
+  size_t len;          ///< of the rendered text / raw bytes
+};
+
+/** @brief Copy the arguments of format into buf, returns the bytes used; stop: see LogRecord */
+size_t log_pack(uint8_t *buf, size_t size, const char *format, va_list args, uint16_t *stop);
+
+/** @brief Format packed arguments into out (always terminated), returns its length */
+size_t log_render(const char *format, uint16_t stop, const uint8_t *args, char *out, size_t len);
+
+class LogRing {
+public:
+  /** @brief Any task: queue a message, false if the ring is full (counted as dropped) */
+  bool write(uint32_t time_ms, int level, const char *format, va_list args);
+
+  /** @brief Any task: queue len (max. LOG_ARGS_MAX) bytes for the consumer, false if the ring is full */
+  bool writeRaw(uint32_t time_ms, uint8_t type, const uint8_t *data, size_t len);
+
+  /** @brief The consumer task: render the oldest message into out and free its slots, false if there is none */
+  bool read(LogMessage &m, char *out, size_t len);
+
+  void readStats(uint32_t &queued, uint32_t &dropped, uint32_t &high_water);
+
+  /** @brief Slots in use (any task) */
+  uint32_t size() const { return ring.size(); }
+
+private:
+  bool put(const char *format, uint32_t time_ms, int level, uint16_t stop, const uint8_t *packed, size_t n);
+
+  MpscRing<LogRecord, LOG_RING_SLOTS> ring;
+};
@@ -0,0 +1,114 @@
+/**
+ * @file measurement.hpp
+ * @brief Immutable snapshot of one measurement interval and its fan-out to the outputs
+ *
+ * The controller builds one MeasurementRecord per interval: a live record whenever the
+ * display is updated, an interval record every MEASUREMENT_INTERVAL for the uplinks and
+ * a minute record every minute for the history.
+ * All derived values (deltas, rates, cpm, dose) are computed once while building it, the
+ * outputs (display, BLE, MQTT, serial log, uplinks, web API) only format what is in the
+ * record, so they all report the same numbers.
+ *
+ * A sink is a function plus context pointer (like the scheduler stages), it gets the record
+ * by const reference, so adding a sink costs one call and neither a copy nor any computation.
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Max. amount of sinks per MeasurementFanout.
+#ifndef MEASUREMENT_MAX_SINKS
+#define MEASUREMENT_MAX_SINKS 8
+#endif
+
+enum MeasurementKind : uint8_t {
+  RECORD_LIVE,      // display cadence (DISPLAYREFRESH, earlier at high count rates)
+  RECORD_INTERVAL,  // uplink cadence (MEASUREMENT_INTERVAL)
+  RECORD_MINUTE,    // history cadence (one minute)
+  RECORD_KINDS
+};
+
+// MeasurementRecord status bits
+#define MEAS_NO_PULSES 0x01       // no pulse since boot, all count values are 0
+#define MEAS_HV_ERROR 0x02        // HV charger error
+#define MEAS_THP_VALID 0x04       // temperature / humidity / pressure are measured values
+#define MEAS_WIFI_CONNECTED 0x08  // WiFi was online when the record was built
+#define MEAS_TIME_VALID 0x10      // utc is a real wall clock time (NTP)
+
+// Wall clock times before this are not set yet (no NTP sync since boot). [s]
+#define CLOCK_VALID_AFTER 1577836800  // 2020-01-01T00:00:00
+
+/**
+ * @struct MeasurementRecord
+ * @brief Everything the outputs report about one interval, never modified after it was built
+ */
+struct MeasurementRecord {
+  uint32_t seq;              ///< 1, 2, ... per kind since boot, gaps mean a record was lost
+  MeasurementKind kind;
+  uint16_t status;           ///< MEAS_* bits
+  time_t utc;                ///< wall clock when the counts were read [s], see MEAS_TIME_VALID
+  uint16_t utc_ms;           ///< ... and its milliseconds
+  uint32_t uptime_ms;        ///< millis() when the record was built
+  const char *tube_type;     ///< static string (tubes[])
+  int tube_nbr;
+  // this interval: from the last pulse of the previous record to the last pulse of this one
+  uint32_t counts;
+  uint32_t dt_ms;
+  uint32_t hv_pulses;        ///< HV charge pulses
+  float cps;                 ///< live: 10 s rate estimate, interval / minute: counts / dt
+  float cps_err;             ///< 1 sigma
+  uint32_t cpm;              ///< cps * 60, rounded
+  float dose_uSvph;          ///< cps * tube factor
+  // since boot
+  uint32_t total_counts;
+  uint32_t total_ms;
+  float total_cps;
+  float total_dose_uSvph;
+  // THP, see MEAS_THP_VALID
+  float temperature;
+  float humidity;
+  float pressure;
+  int wifi_status;           ///< ST_WIFI_*
+};
+
+/** @brief Capture time of a record, utc [ms] */
+inline uint64_t record_utc_ms(const MeasurementRecord &m) {
+  return (uint64_t)m.utc * 1000 + m.utc_ms;
+}
+
+// Output of records. Called in the task building the record, must not keep the reference.
+typedef void (*MeasurementSink)(const MeasurementRecord &m, void *context);
+
+class MeasurementFanout {
+public:
+  /** @brief Add a sink, returns false if there is no space left (call during setup) */
+  bool add(MeasurementSink sink, void *context) {
+    if (count >= MEASUREMENT_MAX_SINKS)
+      return false;
+    sinks[count].sink = sink;
+    sinks[count].context = context;
+    count++;
+    return true;
+  }
+
+  /** @brief Hand the record to all sinks, in the order they were added */
+  void publish(const MeasurementRecord &m) const {
+    for (int i = 0; i < count; i++)
+      sinks[i].sink(m, sinks[i].context);
+  }
+
+  int size() const { return count; }
+
+private:
+  struct Entry {
+    MeasurementSink sink;
+    void *context;
+  };
+  Entry sinks[MEASUREMENT_MAX_SINKS] = {};
+  int count = 0;
+};
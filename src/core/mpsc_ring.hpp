@@ -0,0 +1,111 @@
+/**
+ * @file mpsc_ring.hpp
+ * @brief Bounded lock-free multi-producer / single-consumer ring of fixed size slots
+ *
+ * Every slot has a sequence number (D. Vyukov's bounded queue): a producer claims the
+ * next free position(s) with one compare-and-swap, fills the slot(s) in place and publishes
+ * them by storing the sequence number (release). Several consecutive slots may be claimed
+ * at once for one item; the consumer releases slots in order, so if the last one of them
+ * is free, all of them are. The consumer sees a slot as ready when
+ * its sequence number says so (acquire) and hands it back to the producers after use.
+ * Producers never wait for each other or for the consumer: when the ring is full,
+ * claim() fails and counts a drop. Not for interrupt handlers (a producer preempted
+ * between claim() and publish() only delays the consumer, but an ISR would spin).
+ *
+ * No Arduino dependencies, the same code runs in the host tools.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+template <class T, uint32_t N>
+class MpscRing {
+  static_assert((N >= 2) && ((N & (N - 1)) == 0), "MpscRing size must be a power of 2");
+
+public:
+  MpscRing() {
+    for (uint32_t i = 0; i < N; i++)
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  /** @brief Producer side: reserve n consecutive slots from pos on, nullptr (and a counted drop) if they are not free */
+  T *claim(uint32_t &pos, uint32_t n = 1) {
+    if ((n == 0) || (n > N)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      uint32_t last = pos + n - 1;
+      Slot &slot = slots_[last & (N - 1)];
+      int32_t diff = (int32_t)(slot.seq.load(std::memory_order_acquire) - last);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+    uint32_t used = pos + n - tail_.load(std::memory_order_relaxed);
+    uint32_t high = high_water_.load(std::memory_order_relaxed);
+    while ((used > high) && !high_water_.compare_exchange_weak(high, used, std::memory_order_relaxed))
+      ;
+    return &slots_[pos & (N - 1)].item;
+  }
+
+  /** @brief Producer side: a slot claimed by this producer (pos .. pos + n - 1) */
+  T *at(uint32_t pos) { return &slots_[pos & (N - 1)].item; }
+
+  /** @brief Producer side: hand a filled slot to the consumer */
+  void publish(uint32_t pos) {
+    slots_[pos & (N - 1)].seq.store(pos + 1, std::memory_order_release);
+  }
+
+  /** @brief Consumer side: the published slot offset places after the oldest one, nullptr if it is not ready */
+  const T *peek(uint32_t offset = 0) {
+    uint32_t pos = tail_.load(std::memory_order_relaxed) + offset;
+    Slot &slot = slots_[pos & (N - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+      return nullptr;
+    return &slot.item;
+  }
+
+  /** @brief Consumer side: done with the n oldest slots */
+  void release(uint32_t n = 1) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; i++)
+      slots_[(tail + i) & (N - 1)].seq.store(tail + i + N, std::memory_order_release);
+    tail_.store(tail + n, std::memory_order_release);
+  }
+
+  /** @brief Amount of claimed, not yet released slots (a snapshot, any side) */
+  uint32_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+  /** @brief Total amount of slots claimed (wraps at 2^32) */
+  uint32_t accepted() const { return head_.load(std::memory_order_relaxed); }
+
+  /** @brief Total amount of claims rejected because the ring was full (wraps at 2^32) */
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /** @brief Highest fill level seen by the producers */
+  uint32_t highWater() const { return high_water_.load(std::memory_order_relaxed); }
+
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    T item;
+  };
+
+  std::atomic<uint32_t> head_{0};  // next position to claim, producers
+  std::atomic<uint32_t> tail_{0};  // next position to read, consumer owned
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<uint32_t> high_water_{0};
+  Slot slots_[N];
+};
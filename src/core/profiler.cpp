@@ -0,0 +1,90 @@
+#include "profiler.hpp"
+
+#if PERF_PROFILING
+
+typedef struct {
+  const char *name;
+  PerfHistogram run_us;
+} Probe;
+
+static portMUX_TYPE mux_perf = portMUX_INITIALIZER_UNLOCKED;
+static Probe probes[PERF_MAX_PROBES];  // protected by mux_perf
+static int probe_count = 0;            // only grows, protected by mux_perf
+static uint32_t cycles_per_us = 240;
+
+int perf_probe(const char *name) {
+  cycles_per_us = getCpuFrequencyMhz();
+  int probe = -1;
+  portENTER_CRITICAL(&mux_perf);
+  for (int i = 0; i < probe_count; i++) {
+    if (!strcmp(probes[i].name, name)) {
+      probe = i;
+      break;
+    }
+  }
+  if ((probe < 0) && (probe_count < PERF_MAX_PROBES)) {
+    probe = probe_count++;
+    probes[probe].name = name;
+  }
+  portEXIT_CRITICAL(&mux_perf);
+  return probe;
+}
+
+void perf_record(int probe, uint32_t start_cycles) {
+  uint32_t us = (perf_now() - start_cycles) / cycles_per_us;
+  if (probe < 0)
+    return;
+  portENTER_CRITICAL(&mux_perf);
+  probes[probe].run_us.add(us);
+  portEXIT_CRITICAL(&mux_perf);
+}
+
+int perf_probes(void) {
+  portENTER_CRITICAL(&mux_perf);
+  int n = probe_count;
+  portEXIT_CRITICAL(&mux_perf);
+  return n;
+}
+
+bool read_perf(int probe, PerfSummary *summary) {
+  if ((probe < 0) || (probe >= perf_probes()))
+    return false;
+  // percentile() walks all buckets, so copy the probe instead of holding the lock for it
+  static Probe copy;  // too large for the stack of some callers, only read by the web / MQTT task
+  portENTER_CRITICAL(&mux_perf);
+  copy = probes[probe];
+  portEXIT_CRITICAL(&mux_perf);
+  summary->name = copy.name;
+  summary->count = copy.run_us.count();
+  summary->min_us = copy.run_us.min();
+  summary->max_us = copy.run_us.max();
+  summary->mean_us = copy.run_us.mean();
+  // upper bucket bounds, but never above the largest run seen
+  summary->p50_us = min(copy.run_us.percentile(0.5), summary->max_us);
+  summary->p99_us = min(copy.run_us.percentile(0.99), summary->max_us);
+  return true;
+}
+
+#else
+
+int perf_probes(void) {
+  return 0;
+}
+
+bool read_perf(int /*probe*/, PerfSummary * /*summary*/) {
+  return false;
+}
+
+#endif
+
+int format_perf(char *buf, size_t len) {
+  size_t n = snprintf(buf, len, "{\"enabled\":%s,\"probes\":[", PERF_PROFILING ? "true" : "false");
+  PerfSummary s;
+  for (int i = 0; (n < len) && read_perf(i, &s); i++) {
+    n += snprintf(buf + n, len - n, "%s{\"name\":\"%s\",\"count\":%u,\"min_us\":%u,\"max_us\":%u,\"mean_us\":%u,\"p50_us\":%u,\"p99_us\":%u}",
+                  i ? "," : "", s.name, s.count, s.min_us, s.max_us, s.mean_us, s.p50_us, s.p99_us);
+  }
+  if (n < len)
+    n += snprintf(buf + n, len - n, "]}");
+  return (n < len) ? n : len - 1;
+}
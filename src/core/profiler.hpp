@@ -0,0 +1,96 @@
+/**
+ * @file profiler.hpp
+ * @brief Lightweight run time probes based on the cpu cycle counter
+ *
+ * A probe is a named code section (a scheduler stage or a part of one). Every run is
+ * measured with the cycle counter and added to the probe's min / max / mean and a
+ * log2 histogram (p50 / p99), all in microseconds.
+ *
+ * Usage:
+ *   {
+ *     PERF_SCOPE("web.poll_tx");  // measures until the end of the block
+ *     wifi.pollTx();
+ *   }
+ *
+ * With PERF_PROFILING 0, PERF_SCOPE() expands to nothing and no probe state exists.
+ *
+ * The cycle counter is per core, so only use probes in tasks pinned to one core. It wraps
+ * after 2^32 cycles (~17.9 s at 240 MHz), longer runs are counted too short.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <hal/cpu_hal.h>
+
+#include "config/config.hpp"  // PERF_* changes the layout of Scheduler / the probes, same in every file
+#include "core/log2_histogram.hpp"
+
+#ifndef PERF_PROFILING
+#define PERF_PROFILING 1
+#endif
+
+#ifndef PERF_MAX_PROBES
+#define PERF_MAX_PROBES 16
+#endif
+
+// Publish the profile via MQTT (live/perf, live/cpu) in these intervals [ms], 0: only /api/perf.
+#ifndef PERF_MQTT_INTERVAL_MS
+#define PERF_MQTT_INTERVAL_MS 0
+#endif
+
+// Run times [us]: 1/4 octave buckets up to 2^24 us (~17 s)
+typedef Log2Histogram<2, 24> PerfHistogram;
+
+typedef struct {
+  const char *name;
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t mean_us;
+  uint32_t p50_us;
+  uint32_t p99_us;
+} PerfSummary;
+
+#if PERF_PROFILING
+
+// Register a probe (or find the one with this name), -1 if all PERF_MAX_PROBES are used.
+int perf_probe(const char *name);
+
+static inline uint32_t perf_now(void) {
+  return cpu_hal_get_cycle_count();
+}
+
+// Add one run of probe, which started at start_cycles (perf_now()).
+void perf_record(int probe, uint32_t start_cycles);
+
+class PerfScope {
+public:
+  explicit PerfScope(int probe) : probe(probe), start(perf_now()) {}
+  ~PerfScope() { perf_record(probe, start); }
+
+private:
+  int probe;
+  uint32_t start;
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(name) \
+  static const int PERF_CONCAT(perf_probe_, __LINE__) = perf_probe(name); \
+  PerfScope PERF_CONCAT(perf_scope_, __LINE__)(PERF_CONCAT(perf_probe_, __LINE__))
+
+#else
+
+#define PERF_SCOPE(name) do { } while (0)
+
+#endif
+
+// Amount of registered probes (0 without PERF_PROFILING).
+int perf_probes(void);
+bool read_perf(int probe, PerfSummary *summary);
+
+// {"enabled":..,"probes":[{"name":..,"count":..,"min_us":..,"max_us":..,"mean_us":..,"p50_us":..,"p99_us":..},..]}
+int format_perf(char *buf, size_t len);
+
+#define PERF_JSON_LEN (32 + PERF_MAX_PROBES * 128)
@@ -0,0 +1,52 @@
+/**
+ * @file spinlock.hpp
+ * @brief Short critical sections between tasks, which also build on the host
+ *
+ * On the ESP32 this is a portMUX spinlock (critical section, works across both cores),
+ * on the host (tools) a std::atomic_flag spin. Only hold it for a few copies / updates,
+ * never across calls which may block or call FreeRTOS.
+ */
+
+#pragma once
+
+#ifdef ARDUINO
+
+#include <freertos/FreeRTOS.h>
+
+class SpinLock {
+public:
+  void lock() { portENTER_CRITICAL(&mux); }
+  void unlock() { portEXIT_CRITICAL(&mux); }
+
+private:
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#else
+
+#include <atomic>
+
+class SpinLock {
+public:
+  void lock() {
+    while (flag.test_and_set(std::memory_order_acquire))
+      ;
+  }
+  void unlock() { flag.clear(std::memory_order_release); }
+
+private:
+  std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
+
+#endif
+
+class SpinLockGuard {
+public:
+  explicit SpinLockGuard(SpinLock &lock) : lock(lock) { lock.lock(); }
+  ~SpinLockGuard() { lock.unlock(); }
+  SpinLockGuard(const SpinLockGuard &) = delete;
+  SpinLockGuard &operator=(const SpinLockGuard &) = delete;
+
+private:
+  SpinLock &lock;
+};
@@ -0,0 +1,70 @@
+/**
+ * @file spsc_queue.hpp
+ * @brief Bounded lock-free single-producer / single-consumer queue of small structs
+ *
+ * Same scheme as PulseRing: head is only written by the producer, tail only by
+ * the consumer, acquire/release ordering on them publishes the slot contents.
+ * When the queue is full, push() rejects the new element and counts it, so the
+ * producer never waits for the consumer.
+ *
+ * No Arduino dependencies, the same code runs in the host tools.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+template <class T, uint32_t N>
+class SpscQueue {
+  static_assert((N >= 2) && ((N & (N - 1)) == 0), "SpscQueue size must be a power of 2");
+
+public:
+  /** @brief Producer side: copy item into the queue, returns false (and counts a drop) if it was full */
+  bool push(const T &item) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if ((head - tail) >= N) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    uint32_t used = head + 1 - tail;
+    if (used > high_water_.load(std::memory_order_relaxed))
+      high_water_.store(used, std::memory_order_relaxed);
+    return true;
+  }
+
+  /** @brief Consumer side: move the oldest item to out, returns false if the queue was empty */
+  bool pop(T &out) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail)
+      return false;
+    out = buf_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Amount of queued items (a snapshot, either side) */
+  uint32_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+
+  /** @brief Total amount of items accepted (wraps at 2^32) */
+  uint32_t accepted() const { return head_.load(std::memory_order_relaxed); }
+
+  /** @brief Total amount of items rejected because the queue was full (wraps at 2^32) */
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /** @brief Highest fill level seen by the producer */
+  uint32_t highWater() const { return high_water_.load(std::memory_order_relaxed); }
+
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  std::atomic<uint32_t> head_{0};        // next slot to write, producer owned
+  std::atomic<uint32_t> tail_{0};        // next slot to read, consumer owned
+  std::atomic<uint32_t> dropped_{0};     // producer owned
+  std::atomic<uint32_t> high_water_{0};  // producer owned
+  T buf_[N] = {};
+};
@@ -0,0 +1,66 @@
+#include "tile_canvas.hpp"
+
+#include <string.h>
+
+void TileCanvas::begin(uint8_t cols, uint8_t rows) {
+  cols_ = (cols < TILE_COLS_MAX) ? cols : TILE_COLS_MAX;
+  rows_ = (rows < TILE_ROWS_MAX) ? rows : TILE_ROWS_MAX;
+  memset(frame, 0, sizeof(frame));
+  memset(panel, 0, sizeof(panel));
+  panel_valid = true;
+}
+
+void TileCanvas::clear() {
+  memset(frame, 0, sizeof(frame));
+}
+
+void TileCanvas::clearRow(uint8_t row) {
+  if (row < rows_)
+    memset(frame[row], 0, sizeof(frame[row]));
+}
+
+void TileCanvas::drawGlyph(uint8_t x, uint8_t y, uint8_t c) {
+  uint8_t first = font_[0], last = font_[1], tw = font_[2], th = font_[3];
+  const uint8_t *glyph = ((c >= first) && (c <= last)) ? font_ + 4 + (size_t)(c - first) * tw * th * 8 : nullptr;
+  for (uint8_t ty = 0; ty < th; ty++) {
+    for (uint8_t tx = 0; tx < tw; tx++) {
+      if ((x + tx >= cols_) || (y + ty >= rows_))
+        continue;
+      uint8_t *tile = frame[y + ty][x + tx];
+      if (glyph)
+        memcpy(tile, glyph + (ty * tw + tx) * 8, 8);
+      else
+        memset(tile, 0, 8);
+    }
+  }
+}
+
+void TileCanvas::drawString(uint8_t x, uint8_t y, const char *s) {
+  if (!font_)
+    return;
+  uint8_t tw = font_[2];
+  for (; *s && (x < cols_); s++, x += tw)
+    drawGlyph(x, y, (uint8_t)*s);
+}
+
+uint32_t TileCanvas::flush(TileWriter write, void *context) {
+  uint32_t sent = 0;
+  for (uint8_t y = 0; y < rows_; y++) {
+    uint8_t x = 0;
+    while (x < cols_) {
+      if (panel_valid && !memcmp(frame[y][x], panel[y][x], 8)) {
+        x++;
+        continue;
+      }
+      uint8_t start = x;  // a run of changed tiles: one transfer
+      while ((x < cols_) && (!panel_valid || memcmp(frame[y][x], panel[y][x], 8)))
+        x++;
+      uint8_t count = x - start;
+      memcpy(panel[y][start], frame[y][start], count * 8);
+      write(start, y, count, frame[y][start], context);
+      sent += count;
+    }
+  }
+  panel_valid = true;
+  return sent;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file tile_canvas.hpp
+ * @brief Shadow buffer for a U8x8 tile display, only changed tiles go to the panel
+ *
+ * The OLED is driven as a grid of 8x8 pixel tiles (16x8 on the 128x64 panel, 8x4 on the
+ * 64x32 panel of the LoRa boards). TileCanvas draws a whole screen into a frame buffer with
+ * the U8x8 fonts (same layout as U8X8::drawString(), incl. the fonts with 2x2, 1x2, 3x6
+ * tiles per glyph) and flush() compares it with a copy of what the panel shows: only tiles
+ * which differ are sent, consecutive ones in a row as one transfer. A screen which did not
+ * change costs no I2C traffic at all, a new cpm value only the tiles of its digits.
+ *
+ * U8x8 font format: first char, last char, tiles wide, tiles high, then per char the tiles
+ * (row by row) of 8 bytes each. Chars outside first..last are blank.
+ *
+ * No Arduino dependencies, tools/display_bench runs it against a mock panel.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TILE_COLS_MAX 16
+#define TILE_ROWS_MAX 8
+
+// Send count tiles (8 bytes each) to the panel, starting at column x, row y.
+typedef void (*TileWriter)(uint8_t x, uint8_t y, uint8_t count, const uint8_t *tiles, void *context);
+
+class TileCanvas {
+public:
+  /** @brief Grid size, the panel is assumed to be blank (like after U8X8::begin()) */
+  void begin(uint8_t cols, uint8_t rows);
+
+  uint8_t cols() const { return cols_; }
+  uint8_t rows() const { return rows_; }
+
+  /** @brief Blank the frame (not the panel, see flush()) */
+  void clear();
+  void clearRow(uint8_t row);
+
+  /** @brief Font for drawString(), a U8x8 font */
+  void setFont(const uint8_t *font) { font_ = font; }
+
+  /** @brief Like U8X8::drawString(): x, y in tiles, clipped at the border */
+  void drawString(uint8_t x, uint8_t y, const char *s);
+
+  /** @brief Send the tiles which differ from the panel, returns their amount */
+  uint32_t flush(TileWriter write, void *context);
+
+  /** @brief The panel content is unknown (e.g. it was cleared directly), flush() sends every tile */
+  void invalidate() { panel_valid = false; }
+
+private:
+  void drawGlyph(uint8_t x, uint8_t y, uint8_t c);
+
+  uint8_t cols_ = TILE_COLS_MAX;
+  uint8_t rows_ = TILE_ROWS_MAX;
+  const uint8_t *font_ = nullptr;
+  bool panel_valid = true;
+  uint8_t frame[TILE_ROWS_MAX][TILE_COLS_MAX][8] = {};
+  uint8_t panel[TILE_ROWS_MAX][TILE_COLS_MAX][8] = {};
+};
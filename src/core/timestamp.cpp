@@ -0,0 +1,128 @@
+#include "timestamp.hpp"
+
+#include <string.h>
+
+// --- formatting ---
+
+static inline void put2(char *p, unsigned v) {
+  p[0] = '0' + v / 10;
+  p[1] = '0' + v % 10;
+}
+
+// days since 1970-01-01 -> civil date (proleptic Gregorian, H. Hinnant's algorithm)
+static void civil_from_days(int64_t z, int &y, unsigned &m, unsigned &d) {
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  unsigned doe = (unsigned)(z - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int)(yoe + era * 400) + (m <= 2);
+}
+
+static void build_utc(int64_t t, char *out) {
+  int64_t days = t / 86400;
+  unsigned s = t % 86400;
+  int y;
+  unsigned mo, d;
+  civil_from_days(days, y, mo, d);
+  put2(out, y / 100);
+  put2(out + 2, y % 100);
+  out[4] = '-';
+  put2(out + 5, mo);
+  out[7] = '-';
+  put2(out + 8, d);
+  out[10] = 'T';
+  put2(out + 11, s / 3600);
+  out[13] = ':';
+  put2(out + 14, s / 60 % 60);
+  out[16] = ':';
+  put2(out + 17, s % 60);
+  out[19] = '\0';
+}
+
+// the latest formatted second, shared by all callers
+static SpinLock cache_lock;
+static int64_t cache_second = -1;
+static char cache_text[UTC_LEN];
+
+char *format_utc(time_t t, char *buffer) {
+  // timestamp string like 2019-12-31T23:59:59
+  int64_t second = (t > 0) ? t : 0;
+  SpinLockGuard guard(cache_lock);
+  if (second != cache_second) {
+    if ((cache_second >= 0) && (second / 60 == cache_second / 60))
+      put2(cache_text + 17, second % 60);  // same minute: only the seconds change
+    else
+      build_utc(second, cache_text);
+    cache_second = second;
+  }
+  memcpy(buffer, cache_text, UTC_LEN);
+  return buffer;
+}
+
+char *format_utc_ms(uint64_t utc_ms, char *buffer) {
+  // timestamp string like 2019-12-31T23:59:59.123
+  format_utc((time_t)(utc_ms / 1000), buffer);
+  unsigned ms = utc_ms % 1000;
+  buffer[19] = '.';
+  buffer[20] = '0' + ms / 100;
+  put2(buffer + 21, ms % 100);
+  buffer[23] = '\0';
+  return buffer;
+}
+
+// --- clock ---
+
+static inline int64_t clamp(int64_t v, int64_t limit) {
+  return (v > limit) ? limit : ((v < -limit) ? -limit : v);
+}
+
+uint64_t TimestampClock::estimate(uint64_t mono_us) const {
+  int64_t dt = (int64_t)(mono_us - base_mono);  // negative for times before the latest sync
+  int64_t slewed = clamp(slew_us, (dt > 0 ? dt : 0) * TIMESTAMP_SLEW_PPM / 1000000);
+  return base_utc + dt + dt * drift_ppb / 1000000000 + slewed;
+}
+
+uint64_t TimestampClock::utc(uint64_t mono_us) const {
+  SpinLockGuard guard(lock);
+  if (!syncs)
+    return mono_us;
+  return estimate(mono_us);
+}
+
+void TimestampClock::sync(uint64_t mono_us, uint64_t utc_us) {
+  SpinLockGuard guard(lock);
+  if (!syncs) {
+    base_mono = mono_us;
+    base_utc = utc_us;
+    syncs = 1;
+    return;
+  }
+  int64_t elapsed = (int64_t)(mono_us - base_mono);
+  int64_t error = (int64_t)(utc_us - estimate(mono_us));
+  // was the previous correction applied completely? then error is the rate error since then
+  bool settled = (slew_us >= 0 ? slew_us : -slew_us) <= elapsed * TIMESTAMP_SLEW_PPM / 1000000;
+  // continue from where the clock is now, so it does not jump
+  base_utc = estimate(mono_us);
+  base_mono = mono_us;
+  if ((error > TIMESTAMP_STEP_US) || (error < -TIMESTAMP_STEP_US)) {
+    base_utc = utc_us;  // too far off (or set by hand): step
+    slew_us = 0;
+  } else {
+    slew_us = error;
+    if (settled && (elapsed >= 60 * 1000000LL))  // correct the rate by a quarter of the measured error
+      drift_ppb = clamp(drift_ppb + error * 1000000000 / elapsed / 4, TIMESTAMP_MAX_DRIFT_PPM * 1000LL);
+  }
+  last_error = error;
+  syncs++;
+}
+
+void TimestampClock::readStats(int32_t &drift, int64_t &last_error_us, uint32_t &sync_count) const {
+  SpinLockGuard guard(lock);
+  drift = (int32_t)drift_ppb;
+  last_error_us = last_error;
+  sync_count = syncs;
+}
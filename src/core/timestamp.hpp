@@ -0,0 +1,73 @@
+/**
+ * @file timestamp.hpp
+ * @brief Wall clock from a monotonic microsecond clock disciplined to NTP, cached ISO-8601 strings
+ *
+ * TimestampClock maps a monotonic 64-bit time [us] (esp_timer on the ESP32, it never steps)
+ * to utc [us]. sync() hands it a wall clock reading (NTP): the first one and errors above
+ * TIMESTAMP_STEP_US step the clock, smaller ones are slewed in at TIMESTAMP_SLEW_PPM and
+ * correct the rate estimate, so a routine NTP update never makes utc jump or run backwards.
+ * Before the first sync, utc is the monotonic time (1970 + uptime, like time() before NTP).
+ *
+ * format_utc() / format_utc_ms() write into the caller's buffer (reentrant, any task). The
+ * date and time of the latest second are cached: within a minute only the seconds digits are
+ * rewritten, a new minute is computed without gmtime() / strftime().
+ *
+ * No Arduino dependencies.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "core/spinlock.hpp"
+
+#define UTC_LEN 20     // "2019-12-31T23:59:59" + \0
+#define UTC_MS_LEN 24  // "2019-12-31T23:59:59.123" + \0
+
+// Errors larger than this step the clock, smaller ones are slewed. [us]
+#ifndef TIMESTAMP_STEP_US
+#define TIMESTAMP_STEP_US 1000000
+#endif
+
+// Max. rate a correction is slewed in with. [ppm]
+#ifndef TIMESTAMP_SLEW_PPM
+#define TIMESTAMP_SLEW_PPM 500
+#endif
+
+// Limit of the rate correction (crystal tolerance). [ppm]
+#ifndef TIMESTAMP_MAX_DRIFT_PPM
+#define TIMESTAMP_MAX_DRIFT_PPM 200
+#endif
+
+/** @brief "2019-12-31T23:59:59" for utc t [s] into buffer (UTC_LEN chars), returns buffer */
+char *format_utc(time_t t, char *buffer);
+
+/** @brief "2019-12-31T23:59:59.123" for utc [ms] into buffer (UTC_MS_LEN chars), returns buffer */
+char *format_utc_ms(uint64_t utc_ms, char *buffer);
+
+class TimestampClock {
+public:
+  /** @brief A wall clock reading utc_us, taken at the monotonic time mono_us (any task) */
+  void sync(uint64_t mono_us, uint64_t utc_us);
+
+  /** @brief utc [us] at the monotonic time mono_us (any task) */
+  uint64_t utc(uint64_t mono_us) const;
+
+  bool synced() const { return syncs != 0; }
+
+  /** @brief Current rate correction [ppb] and the error of the latest sync [us] */
+  void readStats(int32_t &drift, int64_t &last_error_us, uint32_t &sync_count) const;
+
+private:
+  uint64_t estimate(uint64_t mono_us) const;
+
+  mutable SpinLock lock;
+  uint64_t base_mono = 0;  // utc = base_utc + (mono - base_mono) * (1 + drift) + slewed part of slew
+  uint64_t base_utc = 0;
+  int64_t drift_ppb = 0;
+  int64_t slew_us = 0;     // correction still to be applied, from base_mono on
+  int64_t last_error = 0;
+  uint32_t syncs = 0;
+};
@@ -1,29 +1,51 @@
 #include "clock.hpp"
 
+#include <esp_sntp.h>
+#include <esp_timer.h>
+
+static TimestampClock timestamp_clock;
+
+
+static void time_synced(struct timeval *tv) {
+  // SNTP (lwIP task) got the time: discipline our clock to it
+  timestamp_clock.sync(esp_timer_get_time(), (uint64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+}
+
 
 void config_time(time_t timestamp) {
   if (timestamp > 0) {
     // a specific timestamp was given, e.g. for testing purposes, set time:
     struct timeval tv = {timestamp, 0};
     settimeofday(&tv, nullptr);
+    timestamp_clock.sync(esp_timer_get_time(), (uint64_t)timestamp * 1000000);
   } else {
     // timestamp == 0 means we shall use NTP to get the time:
+    sntp_set_time_sync_notification_cb(time_synced);
     configTime(TZ_OFFSET, DST_OFFSET, NTP_SRV_1, NTP_SRV_2);
     // please note that this just sets up NTP. the actual time sync might take some minutes...
   }
 }
 
 
+uint64_t clock_mono_us(void) {
+  return esp_timer_get_time();
+}
+
+
+uint64_t clock_utc_us(void) {
+  return timestamp_clock.utc(esp_timer_get_time());
+}
+
+
+uint64_t clock_utc_us_at(uint64_t mono_us) {
+  return timestamp_clock.utc(mono_us);
+}
+
+
 char *utctime(void) {
   // return a pointer to a timestamp string like 2019-12-31T23:59:59
-  time_t t;
-  struct tm *ti;
-  static char buffer[20];
-
-  time(&t);
-  ti = gmtime(&t);
-  strftime(buffer, 20, "%Y-%m-%dT%H:%M:%S", ti);
-  return buffer;
+  static char buffer[UTC_LEN];
+  return format_utc(clock_utc_us() / 1000000, buffer);
 }
 
 
@@ -3,6 +3,8 @@
 #include <Arduino.h>
 #include <time.h>
 
+#include "core/timestamp.hpp"  // format_utc(), format_utc_ms(), UTC_LEN, UTC_MS_LEN
+
 #define NTP_SRV_1 "pool.ntp.org"
 #define NTP_SRV_2 "time.nist.gov"
 
@@ -12,7 +14,16 @@
 // timestamp == 0 -> NTP wanted, otherwise just set the clock.
 void setup_clock(time_t timestamp);
 
-// return a iso-8601-like utc timestamp
+// monotonic time since boot [us] (esp_timer), never steps
+uint64_t clock_mono_us(void);
+
+// wall clock [us]: the monotonic clock, disciplined to NTP (see TimestampClock), any task
+uint64_t clock_utc_us(void);
+
+// wall clock [us] at a monotonic time taken earlier with clock_mono_us()
+uint64_t clock_utc_us_at(uint64_t mono_us);
+
+// return a iso-8601-like utc timestamp (static buffer: use format_utc() / format_utc_ms() from other tasks)
 char *utctime(void);
 
 // Thin OO wrapper for clock handling.
@@ -20,4 +31,5 @@ class ClockModule {
 public:
   void begin(time_t timestamp = 0) { setup_clock(timestamp); }
   char *utc() { return utctime(); }
+  uint64_t utcUs() { return clock_utc_us(); }
 };
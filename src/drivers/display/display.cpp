@@ -8,36 +8,58 @@
 #define PIN_OLED_SCL 15
 #define PIN_OLED_SDA 4
 
+// The panel is only used by displayTask. The main loop, networkTask and the transmission task
+// post what to show (status word, measurement slot) and wake it up, they never wait for I2C.
+
+uint32_t DisplayModule::flush() {
+  return canvas.flush([](uint8_t x, uint8_t y, uint8_t count, const uint8_t *tiles, void *c) {
+    static_cast<U8X8 *>(c)->drawTile(x, y, count, const_cast<uint8_t *>(tiles));
+  }, pu8x8);
+}
+
 void DisplayModule::startScreen() {
   char line[20];
 
-  pu8x8->clear();
-
   if (isLoraBoard) {
-    pu8x8->setFont(u8x8_font_amstrad_cpc_extended_f);
-    pu8x8->drawString(0, 2, " Multi-");
-    pu8x8->drawString(0, 3, " Geiger");
-    pu8x8->setFont(u8x8_font_victoriamedium8_r);
+    canvas.setFont(u8x8_font_amstrad_cpc_extended_f);
+    canvas.drawString(0, 2, " Multi-");
+    canvas.drawString(0, 3, " Geiger");
+    canvas.setFont(u8x8_font_victoriamedium8_r);
     snprintf(line, 9, "%s", VERSION_STR);  // 8 chars + \0 termination
-    pu8x8->drawString(0, 4, line);
+    canvas.drawString(0, 4, line);
   } else {
-    pu8x8->setFont(u8x8_font_amstrad_cpc_extended_f);
-    pu8x8->drawString(0, 0, "  Multi-Geiger");
-    pu8x8->setFont(u8x8_font_victoriamedium8_r);
-    pu8x8->drawString(0, 1, "________________");
-    pu8x8->drawString(0, 3, "Info:boehri.de");
+    canvas.setFont(u8x8_font_amstrad_cpc_extended_f);
+    canvas.drawString(0, 0, "  Multi-Geiger");
+    canvas.setFont(u8x8_font_victoriamedium8_r);
+    canvas.drawString(0, 1, "________________");
+    canvas.drawString(0, 3, "Info:boehri.de");
     snprintf(line, 15, "%s", VERSION_STR);  // 14 chars + \0 termination
-    pu8x8->drawString(0, 5, line);
+    canvas.drawString(0, 5, line);
   }
-  displayIsClear = false;
 }
 
 // Legacy free-function API forwarding to a chosen instance.
 static DisplayModule gDisplay;
 static DisplayModule *gActiveDisplay = &gDisplay;
 
+void DisplayModule::task(void *param) {
+  DisplayModule *self = static_cast<DisplayModule *>(param);
+  self->pu8x8->begin();
+  // all 8 controller pages: the 64x32 panel of the LoRa boards shows pages 2..5, which we use
+  self->canvas.begin(self->isLoraBoard ? 8 : 16, 8);
+  self->canvas.invalidate();  // begin() does not clear the pages outside of the panel, send every tile once
+  for (;;) {
+    self->render();
+    // Updates posted from now on are collected for a frame and shown with one redraw.
+    vTaskDelay(pdMS_TO_TICKS(DISPLAY_FRAME_MS));
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
 void DisplayModule::begin(bool loraHardware) {
   gActiveDisplay = this;  // use this instance for legacy wrappers
+  if (task_handle)
+    return;
   isLoraBoard = loraHardware;
   if (isLoraBoard) {
     pu8x8 = &u8x8_lora;
@@ -48,69 +70,94 @@ void DisplayModule::begin(bool loraHardware) {
   } else {
     pu8x8 = &u8x8;
   }
-  pu8x8->begin();
-  startScreen();
+  xTaskCreatePinnedToCore(task, "displayTask", DISPLAY_TASK_STACK, this, DISPLAY_TASK_PRIORITY, &task_handle, NETWORK_CPU);
 }
 
-void DisplayModule::clearLine(int line) {
-  const char *blanks;
-  blanks = isLoraBoard ? "        " : "                ";  // 8 / 16
-  pu8x8->drawString(0, line, blanks);
+void DisplayModule::post() {
+  requests.fetch_add(1, std::memory_order_relaxed);
+  if (task_handle)
+    xTaskNotifyGive(task_handle);
 }
 
-void DisplayModule::showStatusLine(const String &txt) {
-  if (txt.length() == 0)
-    return;
-  int line = isLoraBoard ? 5 : 7;
-  pu8x8->setFont(u8x8_font_victoriamedium8_r);
-  clearLine(line);
-  pu8x8->drawString(0, line, txt.c_str());
+void DisplayModule::render() {
+  GmcValues g;
+  bool show_gmc, show;
+  {
+    SpinLockGuard guard(slot_lock);
+    g = gmc;
+    show_gmc = have_gmc;
+    show = use_display;
+  }
+  // the whole screen is drawn again, flush() sends the tiles which differ
+  canvas.clear();
+  if (show) {
+    if (show_gmc)
+      drawGmc(g);
+    else
+      startScreen();
+    drawStatusLine(status_word.load(std::memory_order_relaxed));
+  }
+  tiles.fetch_add(flush(), std::memory_order_relaxed);
+  frames.fetch_add(1, std::memory_order_relaxed);
 }
 
 void DisplayModule::setStatus(int index, int value) {
-  if ((index >= 0) && (index < STATUS_MAX)) {
-    if (status[index] != value) {
-      status[index] = value;
-      renderStatus();
-    }
-  } else
-    log(ERROR, "invalid parameters: set_status(%d, %d)", index, value);
+  if ((index < 0) || (index >= STATUS_MAX) || (value < 0) || (value > 15)) {
+    LOG(ERROR, "invalid parameters: set_status(%d, %d)", index, value);
+    return;
+  }
+  uint32_t mask = 0xfu << (4 * index);
+  uint32_t bits = (uint32_t)value << (4 * index);
+  uint32_t old = status_word.load(std::memory_order_relaxed);
+  do {
+    if ((old & mask) == bits)
+      return;  // unchanged, e.g. the WiFi / BLE status of every status stage
+  } while (!status_word.compare_exchange_weak(old, (old & ~mask) | bits, std::memory_order_relaxed));
+  post();
 }
 
 int DisplayModule::getStatus(int index) const {
-  return status[index];
+  return (status_word.load(std::memory_order_relaxed) >> (4 * index)) & 0xf;
 }
 
-char DisplayModule::getStatusChar(int index) const {
-  if ((index >= 0) && (index < STATUS_MAX)) {
-    int idx = status[index];
-    if (idx < (int)strlen(status_chars[index]))
-      return status_chars[index][idx];
-    else
-      log(ERROR, "string status_chars[%d] is too short, no char at index %d", index, idx);
-  } else
-    log(ERROR, "invalid parameters: get_status_char(%d)", index);
+char DisplayModule::getStatusChar(uint32_t status, int index) const {
+  int idx = (status >> (4 * index)) & 0xf;
+  if (idx < (int)strlen(status_chars[index]))
+    return status_chars[index][idx];
+  LOG(ERROR, "string status_chars[%d] is too short, no char at index %d", index, idx);
   return '?';  // some error happened
 }
 
-void DisplayModule::renderStatus(void) {
+void DisplayModule::drawStatusLine(uint32_t status) {
   char output[17];  // max. 16 chars wide display + \0 terminator
   const char *format = isLoraBoard ? "%c%c%c%c%c%c%c%c" : "%c %c %c %c %c %c %c %c";  // 8 or 16 chars wide
   snprintf(output, 17, format,
-           getStatusChar(0), getStatusChar(1), getStatusChar(2), getStatusChar(3),
-           getStatusChar(4), getStatusChar(5), getStatusChar(6), getStatusChar(7)
+           getStatusChar(status, 0), getStatusChar(status, 1), getStatusChar(status, 2), getStatusChar(status, 3),
+           getStatusChar(status, 4), getStatusChar(status, 5), getStatusChar(status, 6), getStatusChar(status, 7)
           );
-  showStatusLine(output);
+  int line = isLoraBoard ? 5 : 7;
+  canvas.setFont(u8x8_font_victoriamedium8_r);
+  canvas.clearRow(line);
+  canvas.drawString(0, line, output);
+}
+
+void DisplayModule::renderStatus(void) {
+  post();
+}
+
+void DisplayModule::readStats(DisplayStats &stats) const {
+  stats.requests = requests.load(std::memory_order_relaxed);
+  stats.frames = frames.load(std::memory_order_relaxed);
+  stats.tiles = tiles.load(std::memory_order_relaxed);
 }
 
 // Legacy free-function API forwarding to the active instance
 void setup_display(bool loraHardware) { gActiveDisplay->begin(loraHardware); }
 void display_GMC(unsigned int TimeSec, int RadNSvph, int CPM, bool use_display) { gActiveDisplay->showGmc(TimeSec, RadNSvph, CPM, use_display); }
-void clear_displayline(int line) { gActiveDisplay->clearLine(line); }
-void display_statusline(String txt) { gActiveDisplay->showStatusLine(txt); }
 void set_status(int index, int value) { gActiveDisplay->setStatus(index, value); }
 int get_status(int index) { return gActiveDisplay->getStatus(index); }
 void display_status(void) { gActiveDisplay->renderStatus(); }
+void read_display_stats(DisplayStats *stats) { gActiveDisplay->readStats(*stats); }
 char *format_time(unsigned int secs) {
   static char result[4];
   unsigned int mins = secs / 60;
@@ -129,51 +176,46 @@ char *format_time(unsigned int secs) {
   return result;
 }
 
-void DisplayModule::showGmc(unsigned int TimeSec, int RadNSvph, int CPM, bool use_display) {
-  if (!use_display) {
-    if (!displayIsClear) {
-      pu8x8->clear();
-      clearLine(4);
-      clearLine(5);
-      displayIsClear = true;
-    }
-    return;
-  }
-
-  pu8x8->clear();
-
+void DisplayModule::drawGmc(const GmcValues &g) {
   char output[40];
   if (!isLoraBoard) {
-    pu8x8->setFont(u8x8_font_7x14_1x2_f);
-    sprintf(output, "%3s%7d nSv/h", format_time(TimeSec), RadNSvph);
-    pu8x8->drawString(0, 0, output);
-    pu8x8->setFont(u8x8_font_inb33_3x6_n);
-    sprintf(output, "%5d", CPM);
-    pu8x8->drawString(0, 2, output);
+    canvas.setFont(u8x8_font_7x14_1x2_f);
+    sprintf(output, "%3s%7d nSv/h", format_time(g.time_s), g.nsvph);
+    canvas.drawString(0, 0, output);
+    canvas.setFont(u8x8_font_inb33_3x6_n);
+    sprintf(output, "%5d", g.cpm);
+    canvas.drawString(0, 2, output);
   } else {
-    pu8x8->setFont(u8x8_font_amstrad_cpc_extended_f);
-    sprintf(output, " %7d", RadNSvph);
-    pu8x8->drawString(0, 2, output);
-    pu8x8->setFont(u8x8_font_px437wyse700b_2x2_f);
-    sprintf(output, "%4d", CPM);
-    pu8x8->drawString(0, 3, output);
+    canvas.setFont(u8x8_font_amstrad_cpc_extended_f);
+    sprintf(output, " %7d", g.nsvph);
+    canvas.drawString(0, 2, output);
+    canvas.setFont(u8x8_font_px437wyse700b_2x2_f);
+    sprintf(output, "%4d", g.cpm);
+    canvas.drawString(0, 3, output);
   }
-  renderStatus();
-  displayIsClear = false;
 }
 
-void DisplayModule::applyDisplaySetting(bool use_display) {
-  // Immediately apply display on/off setting
-  if (!use_display) {
-    // Turn off display
-    if (!displayIsClear) {
-      pu8x8->clear();
-      clearLine(4);
-      clearLine(5);
-      displayIsClear = true;
+void DisplayModule::showGmc(unsigned int TimeSec, int RadNSvph, int CPM, bool use_display) {
+  {
+    SpinLockGuard guard(slot_lock);
+    if (use_display) {
+      gmc = GmcValues{TimeSec, RadNSvph, CPM};
+      have_gmc = true;  // ends the start screen
     }
-  } else {
-    // Turn on display - reset clear flag so next showGmc will refresh
-    displayIsClear = false;
+    this->use_display = use_display;
+  }
+  post();
+}
+
+void DisplayModule::showGmc(const MeasurementRecord &m, bool use_display) {
+  showGmc(m.total_ms / 1000, (int)(m.total_dose_uSvph * 1000), m.cpm, use_display);
+}
+
+void DisplayModule::applyDisplaySetting(bool use_display) {
+  // Immediately apply display on/off setting (on: the latest values again)
+  {
+    SpinLockGuard guard(slot_lock);
+    this->use_display = use_display;
   }
+  post();
 }
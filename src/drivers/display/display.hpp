@@ -6,14 +6,25 @@
  * - Radiation measurements (CPM, dose rate)
  * - Subsystem status indicators (WiFi, BLE, LoRa, MQTT, sensors)
  * - Device information and diagnostics
+ *
+ * displayTask owns the panel: the other tasks only post the state to show (status chars in
+ * one atomic word, the latest measurement in a slot) and wake it up. It redraws at most once
+ * per DISPLAY_FRAME_MS, so a burst of status changes (e.g. one transmission) becomes one
+ * redraw, and nobody but displayTask waits for the I2C bus. Screens are drawn into a
+ * TileCanvas (core/tile_canvas.hpp), the panel only gets the 8x8 tiles which changed.
  */
 
 #pragma once
 
 #include <Arduino.h>
 #include <U8x8lib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
 
 #include "core/core.hpp"
+#include "core/spinlock.hpp"
+#include "core/tile_canvas.hpp"
 #include "config/config.hpp"
 
 // supported status indexes and values:
@@ -67,35 +78,81 @@
 #define ST_HV_OK 1
 #define ST_HV_ERROR 2
 
-#define STATUS_MAX 8
+#define STATUS_MAX 8  // 4 bits each in DisplayModule's status word
+
+// Stack / priority of displayTask, on NETWORK_CPU.
+#ifndef DISPLAY_TASK_STACK
+#define DISPLAY_TASK_STACK 4096
+#endif
+#ifndef DISPLAY_TASK_PRIORITY
+#define DISPLAY_TASK_PRIORITY 1
+#endif
+
+// Min. time between two redraws, updates in between are shown together. [ms]
+#ifndef DISPLAY_FRAME_MS
+#define DISPLAY_FRAME_MS 100
+#endif
+
+typedef struct {
+  uint32_t requests;  // updates posted by other tasks
+  uint32_t frames;    // redraws by displayTask
+  uint32_t tiles;     // 8x8 tiles sent to the panel
+} DisplayStats;
 
 void set_status(int index, int value);
 int get_status(int index);
 void display_status(void);
+void read_display_stats(DisplayStats *stats);
 
-// Thin OO wrapper for display operations.
+// Thin OO wrapper for display operations. All public methods only post, from any task.
 class DisplayModule {
 public:
+  /** @brief Start displayTask, which initializes the panel and shows the start screen */
   void begin(bool loraHardware);
   void showGmc(unsigned int timeSec, int radNSvph, int cpm, bool useDisplay);
+  /** @brief Show a live record: time / dose since boot and current cpm */
+  void showGmc(const MeasurementRecord &m, bool useDisplay);
   void applyDisplaySetting(bool useDisplay);
-  void clearLine(int line);
-  void showStatusLine(const String &txt);
   void setStatus(int index, int value);
   int getStatus(int index) const;
+  /** @brief Redraw soon (the status chars are always up to date) */
   void renderStatus();
+  void readStats(DisplayStats &stats) const;
 
 private:
+  struct GmcValues {
+    unsigned int time_s;
+    int nsvph;
+    int cpm;
+  };
+
+  static void task(void *param);
+  void post();
+  void render();
   void startScreen();
-  char getStatusChar(int index) const;
+  void drawGmc(const GmcValues &g);
+  void drawStatusLine(uint32_t status);
+  char getStatusChar(uint32_t status, int index) const;
+  uint32_t flush();
 
+  // displayTask only
   U8X8_SSD1306_128X64_NONAME_HW_I2C u8x8{PIN_OLED_RST, PIN_OLED_SCL, PIN_OLED_SDA};
   U8X8_SSD1306_64X32_NONAME_HW_I2C u8x8_lora{PIN_OLED_RST, PIN_OLED_SCL, PIN_OLED_SDA};
   U8X8 *pu8x8 = nullptr;
-  bool displayIsClear = false;
+  TileCanvas canvas;  // what the panel shows / should show
   bool isLoraBoard = false;
-  int status[STATUS_MAX] = {ST_NODISPLAY, ST_NODISPLAY, ST_NODISPLAY, ST_NODISPLAY,
-                            ST_NODISPLAY, ST_NODISPLAY, ST_NODISPLAY, ST_NODISPLAY};
+  TaskHandle_t task_handle = nullptr;
+
+  // posted by any task
+  std::atomic<uint32_t> status_word{0};  // status[i] in bits 4 * i .. 4 * i + 3, all ST_NODISPLAY
+  mutable SpinLock slot_lock;            // guards the slot
+  GmcValues gmc = {};                    // slot: the latest measurement
+  bool have_gmc = false;                 // slot: the start screen was ended
+  bool use_display = true;               // slot
+  std::atomic<uint32_t> requests{0};
+  std::atomic<uint32_t> frames{0};
+  std::atomic<uint32_t> tiles{0};
+
   const char *status_chars[STATUS_MAX] = {
     ".W0wA",  // WiFi
     ".s1S?",  // sensor.community
@@ -111,8 +168,7 @@ private:
 // Legacy free functions (forward to singleton)
 void setup_display(bool loraHardware);
 void display_GMC(unsigned int TimeSec, int RadNSvph, int CPM, bool use_display);
-void clear_displayline(int line);
-void display_statusline(String txt);
 void set_status(int index, int value);
 int get_status(int index);
 void display_status(void);
+void read_display_stats(DisplayStats *stats);
@@ -0,0 +1,125 @@
+/**
+ * @file audio_sequencer.hpp
+ * @brief Note scheduling for alarm and melody sequences
+ *
+ * A sequence is an array of notes {frequency_mHz, volume, led, duration_ms}:
+ * - frequency_mHz > 0: speaker on with this frequency, == 0: speaker off, < 0: unchanged
+ * - volume: >= 1 high volume, 0 low volume
+ * - led: 1 on, 0 off, -1 unchanged
+ * - duration_ms: time until the next note, 0: next note follows immediately
+ * After the last note, speaker and LED are switched off.
+ *
+ * AudioSequencer does not wait for anything: advance() applies all notes that are due
+ * and tells the caller what to output and when to call it again, so it can be driven by
+ * a one-shot timer. Priorities: alarm beats melody, melody beats ticks. A sequence
+ * pre-empts a running one of the same or lower priority, a lower priority one waits.
+ *
+ * No Arduino / ESP-IDF dependencies, not thread safe (the caller serializes access).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum AudioPriority {
+  AUDIO_PRIO_TICK,    // no sequence playing, ticks may use the speaker
+  AUDIO_PRIO_MELODY,
+  AUDIO_PRIO_ALARM,
+  AUDIO_PRIOS
+};
+
+typedef const int (*AudioSequence)[4];
+
+/**
+ * @struct AudioStep
+ * @brief Output of AudioSequencer::advance()
+ */
+struct AudioStep {
+  int frequency_mHz;  ///< > 0: speaker on, 0: speaker off, < 0: unchanged
+  int volume;         ///< volume for frequency_mHz > 0
+  int led;            ///< 1 on, 0 off, -1 unchanged
+  uint32_t delay_ms;  ///< call advance() again after this time, 0: nothing scheduled
+};
+
+class AudioSequencer {
+public:
+  /**
+   * @brief Queue a sequence (replaces a queued one of the same priority)
+   * @return true if it starts right away, i.e. advance() should be called now
+   */
+  bool request(AudioSequence sequence, size_t length, AudioPriority priority) {
+    if (priority <= AUDIO_PRIO_TICK || priority >= AUDIO_PRIOS || !sequence || !length)
+      return false;
+    pending_[priority].sequence = sequence;
+    pending_[priority].length = length;
+    return priority >= current_;
+  }
+
+  AudioStep advance(uint32_t now_ms) {
+    AudioStep step = {-1, 0, -1, 0};
+    for (int p = AUDIO_PRIOS - 1; p > AUDIO_PRIO_TICK; p--) {
+      if (pending_[p].sequence && p >= current_) {
+        if (current_ != AUDIO_PRIO_TICK)
+          preempted_++;
+        current_ = (AudioPriority)p;
+        sequence_ = pending_[p];
+        pending_[p].sequence = nullptr;
+        position_ = 0;
+        next_ms_ = now_ms;
+        break;
+      }
+    }
+    if (current_ == AUDIO_PRIO_TICK)
+      return step;
+
+    int32_t early = (int32_t)(next_ms_ - now_ms);
+    if (early > 0) {
+      step.delay_ms = early;  // woken up before the current note ended
+      return step;
+    }
+    while (position_ < sequence_.length) {
+      const int *note = sequence_.sequence[position_++];
+      if (note[0] >= 0) {
+        step.frequency_mHz = note[0];
+        step.volume = note[1];
+      }
+      if (note[2] >= 0)
+        step.led = note[2];
+      if (note[3] > 0) {
+        next_ms_ = now_ms + note[3];
+        step.delay_ms = note[3];
+        return step;
+      }
+    }
+    // end of sequence
+    step.frequency_mHz = 0;
+    step.led = 0;
+    current_ = AUDIO_PRIO_TICK;
+    for (int p = AUDIO_PRIO_TICK + 1; p < AUDIO_PRIOS; p++) {
+      if (pending_[p].sequence)
+        step.delay_ms = 1;  // a lower priority sequence waited for this one
+    }
+    return step;
+  }
+
+  /** @brief A sequence owns the speaker (ticks must not use it) */
+  bool busy() const { return current_ != AUDIO_PRIO_TICK; }
+
+  AudioPriority current() const { return current_; }
+
+  /** @brief Amount of sequences cut short by another one */
+  uint32_t preempted() const { return preempted_; }
+
+private:
+  struct Slot {
+    AudioSequence sequence;
+    size_t length;
+  };
+  Slot pending_[AUDIO_PRIOS] = {};
+  Slot sequence_ = {};
+  size_t position_ = 0;
+  uint32_t next_ms_ = 0;
+  AudioPriority current_ = AUDIO_PRIO_TICK;
+  uint32_t preempted_ = 0;
+};
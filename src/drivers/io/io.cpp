@@ -1,6 +1,12 @@
 #include "io.hpp"
 
 #include <driver/gpio.h>
+#include <driver/timer.h>
+#include <hal/cpu_hal.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
+
+#include "core/cpu.hpp"
 
 // Hardware detection pin comes from config.hpp
 
@@ -36,7 +42,7 @@ void setup_switches(bool isLoraBoard) {
   pinMode(PIN_SWI_3, INPUT);
 
   Switches s = read_switches();
-  log(DEBUG, "Switches: SW0 speaker_on %d,  SW1 display_on %d,  SW2 led_on: %d,  SW3 ble_on: %d",
+  LOG(DEBUG, "Switches: SW0 speaker_on %d,  SW1 display_on %d,  SW2 led_on: %d,  SW3 ble_on: %d",
       s.speaker_on, s.display_on, s.led_on, s.ble_on);
 }
 
@@ -63,6 +69,27 @@ static bool speaker_tick_wanted, led_tick_wanted;  // state wanted by user
 // MUX (mutexes used for mutual exclusive access to isr variables)
 portMUX_TYPE mux_audio = portMUX_INITIALIZER_UNLOCKED;
 
+// Tick rendering, see tick_engine.hpp
+#define TICK_SLOT_MS 10      // max. 100 clicks/s
+#define TICK_CLICK_MS 4      // duration of one click
+#define TICK_BACKLOG 100     // clicks that may wait for a slot (1s worth, so batches from PCNT / RMT get spread)
+
+static const TickConfig tick_config = {
+  TICK_SLOT_MS,
+  TICK_BACKLOG,
+  (float)TICK_TONE_CPS,        // tone_on_cps
+  (float)TICK_TONE_CPS / 2,    // tone_off_cps
+  500000,                      // tone_base_mHz: 500 Hz ...
+  20000,                       // tone_mHz_per_cps: ... + 20 Hz per cps ...
+  5000000,                     // tone_max_mHz: ... up to 5 kHz
+  1000                         // rate_tau_ms
+};
+
+static TickCounter tick_counter;       // producers: tick(), consumer: audioTask
+static TickRenderer tick_renderer(tick_config);  // only used by audioTask
+static TickStats tick_stats = {};      // snapshot of tick_renderer.stats(), protected by mux_audio
+static TaskHandle_t audio_task = nullptr;
+
 // Keep sequences in DRAM so the ISR never dereferences flash when cache is off.
 static DRAM_ATTR int alarm_sequence[][4] = {
   {3000000, 1, -1, 400},  // high pitch
@@ -93,15 +120,13 @@ static DRAM_ATTR int melody_sequence[][4] = {
   {0, 0, -1, 0},                    // speaker off, end
 };
 
-enum class AudioCommandType { TickHigh, TickLow, PlaySequence };
+// Alarm / melody sequences, see audio_sequencer.hpp. sequencerService runs on an esp_timer, which gets
+// reprogrammed to the next note, so a new sequence starts within the esp_timer task latency.
+static AudioSequencer sequencer;             // protected by speaker_mutex
+static esp_timer_handle_t sequencer_timer = nullptr;
 
-struct AudioCommand {
-  AudioCommandType type;
-  const int (*sequence)[4];
-  size_t length;
-};
-
-static QueueHandle_t audio_command_queue = nullptr;
+// speaker / LED hardware access of sequencerService and audioTask (ticks)
+static SemaphoreHandle_t speaker_mutex = nullptr;
 
 static void speakerOn(int frequency_mHz, int volume) {
   if (frequency_mHz <= 0)
@@ -125,76 +150,124 @@ static void speakerOff() {
   mcpwm_set_signal_low(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_B);
 }
 
+static void scheduleSequencer(uint64_t delay_us) {
+  // call with speaker_mutex taken, so a request and sequencerService do not race for the timer
+  esp_timer_stop(sequencer_timer);  // fails harmlessly if not running
+  esp_timer_start_once(sequencer_timer, delay_us);
+}
+
+static void sequencerService(void * /*arg*/) {
+  // esp_timer callback: apply the notes which are due, then sleep until the next one.
+  xSemaphoreTake(speaker_mutex, portMAX_DELAY);
+  AudioStep step = sequencer.advance(millis());
+  if (step.frequency_mHz > 0)
+    speakerOn(step.frequency_mHz, step.volume);
+  else if (step.frequency_mHz == 0)
+    speakerOff();
+  if (step.led >= 0)
+    digitalWrite(LED_BUILTIN, step.led ? HIGH : LOW);
+  if (step.delay_ms)
+    scheduleSequencer(step.delay_ms * 1000ULL);
+  xSemaphoreGive(speaker_mutex);
+}
+
+static void play_sequence(AudioSequence sequence, size_t len, AudioPriority priority) {
+  // called from normal code (not ISR), never blocks for longer than a speaker access.
+  if (!speaker_mutex)
+    return;
+  xSemaphoreTake(speaker_mutex, portMAX_DELAY);
+  if (sequencer.request(sequence, len, priority))
+    scheduleSequencer(0);  // pre-empt whatever plays now
+  xSemaphoreGive(speaker_mutex);
+}
+
+static void renderTone(uint32_t tone_mHz) {
+  if (tone_mHz && speaker_tick)
+    speakerOn(tone_mHz, 0);  // low volume, it is continuous
+  else
+    speakerOff();
+  digitalWrite(LED_BUILTIN, (tone_mHz && led_tick) ? HIGH : LOW);
+}
+
 static void audioTask(void * /*param*/) {
-  AudioCommand cmd;
+  // renders the ticks, lowest audio priority: whenever a sequence plays, clicks are dropped.
+  uint32_t tone_mHz = 0;
+  TickType_t last_slot = xTaskGetTickCount();
   for (;;) {
-    if (xQueueReceive(audio_command_queue, &cmd, portMAX_DELAY) != pdTRUE)
-      continue;
-
-    switch (cmd.type) {
-    case AudioCommandType::TickHigh:
-      if (speaker_tick)
-        speakerOn(5000000, 1);  // 5 kHz
-      if (led_tick)
-        digitalWrite(LED_BUILTIN, HIGH);
-      vTaskDelay(pdMS_TO_TICKS(4));
-      speakerOff();
-      if (led_tick)
-        digitalWrite(LED_BUILTIN, LOW);
-      break;
-    case AudioCommandType::TickLow:
-      if (speaker_tick)
-        speakerOn(1000000, 1);  // 1 kHz
-      if (led_tick)
-        digitalWrite(LED_BUILTIN, LOW);
-      vTaskDelay(pdMS_TO_TICKS(4));
-      speakerOff();
-      break;
-    case AudioCommandType::PlaySequence:
-      if (cmd.sequence && cmd.length > 0) {
-        for (size_t i = 0; i < cmd.length; i++) {
-          int frequency_mHz = cmd.sequence[i][0];
-          int volume = cmd.sequence[i][1];
-          int led = cmd.sequence[i][2];
-          int duration_ms = cmd.sequence[i][3];
-          if (frequency_mHz > 0)
-            speakerOn(frequency_mHz, volume);
-          else if (frequency_mHz == 0)
-            speakerOff();
-          if (led >= 0)
-            digitalWrite(LED_BUILTIN, led ? HIGH : LOW);
-          if (duration_ms > 0)
-            vTaskDelay(pdMS_TO_TICKS(duration_ms));
-        }
+    TickType_t slot = xTaskGetTickCount();
+    uint32_t clicks = tick_counter.take();
+    bool click = false;
+
+    xSemaphoreTake(speaker_mutex, portMAX_DELAY);
+    bool sequence_playing = sequencer.busy();
+    if (sequence_playing) {
+      tick_renderer.interrupt();
+      tick_renderer.drop(clicks);
+      tone_mHz = 0;
+    } else {
+      TickAction action = tick_renderer.render(clicks, pdTICKS_TO_MS(slot - last_slot));
+      if (action.tone_mHz != tone_mHz) {
+        tone_mHz = action.tone_mHz;
+        renderTone(tone_mHz);
+      }
+      click = action.click;
+      if (click) {
+        if (speaker_tick)
+          speakerOn(5000000, 1);  // 5 kHz
+        if (led_tick)
+          digitalWrite(LED_BUILTIN, HIGH);
+      }
+    }
+    xSemaphoreGive(speaker_mutex);
+    last_slot = slot;
+
+    if (click) {
+      vTaskDelay(pdMS_TO_TICKS(TICK_CLICK_MS));
+      xSemaphoreTake(speaker_mutex, portMAX_DELAY);
+      if (!sequencer.busy()) {  // else a sequence took over the speaker meanwhile
         speakerOff();
         digitalWrite(LED_BUILTIN, LOW);
       }
-      break;
+      xSemaphoreGive(speaker_mutex);
     }
+
+    portENTER_CRITICAL(&mux_audio);
+    tick_stats = tick_renderer.stats();
+    portEXIT_CRITICAL(&mux_audio);
+
+    if (!sequence_playing && tick_renderer.idle())
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);  // sleep until tick() wakes us
+    else
+      vTaskDelayUntil(&slot, pdMS_TO_TICKS(TICK_SLOT_MS));
   }
 }
 
-
 // Audio timer is unused; keep stub ISR to avoid flash access
 void IRAM_ATTR isr_audio() {
   // nothing: all audio handled in FreeRTOS task
 }
 
-void IRAM_ATTR tick(bool high) {
-  // high true: "tick" -> high frequency tick and LED blink
-  // high false: "tock" -> lower frequency tock, no LED
-  // called from ISR!
-  portENTER_CRITICAL_ISR(&mux_audio);
-  if (speaker_tick || led_tick) {
-    AudioCommand cmd;
-    cmd.type = high ? AudioCommandType::TickHigh : AudioCommandType::TickLow;
-    cmd.sequence = nullptr;
-    cmd.length = 0;
-    BaseType_t hpw = pdFALSE;
-    if (audio_command_queue)
-      xQueueSendFromISR(audio_command_queue, &cmd, &hpw);
+void IRAM_ATTR tick(uint32_t clicks) {
+  // called from ISR (or task) with every (batch of) pulse(s), audioTask renders them.
+  // no queue, no lock: just count, and wake audioTask if it might be sleeping.
+  if (!(speaker_tick || led_tick) || !audio_task)
+    return;
+  if (tick_counter.add(clicks)) {
+    if (xPortInIsrContext()) {
+      BaseType_t hpw = pdFALSE;
+      vTaskNotifyGiveFromISR(audio_task, &hpw);
+      if (hpw)
+        portYIELD_FROM_ISR();
+    } else {
+      xTaskNotifyGive(audio_task);
+    }
   }
-  portEXIT_CRITICAL_ISR(&mux_audio);
+}
+
+void read_tick_stats(TickStats *stats) {
+  portENTER_CRITICAL(&mux_audio);
+  *stats = tick_stats;
+  portEXIT_CRITICAL(&mux_audio);
 }
 
 void tick_enable(bool enable) {
@@ -210,28 +283,8 @@ void tick_enable(bool enable) {
 }
 
 void alarm() {
-  // play alarm sound, called from normal code (not ISR)
-  if (audio_command_queue) {
-    AudioCommand cmd;
-    cmd.type = AudioCommandType::PlaySequence;
-    cmd.sequence = alarm_sequence;
-    cmd.length = sizeof(alarm_sequence) / sizeof(alarm_sequence[0]);
-    xQueueSend(audio_command_queue, &cmd, 0);
-  }
-}
-
-static void play(int *sequence) {
-  // legacy wrapper, unused
-}
-
-static void play_sequence(const int (*sequence)[4], size_t len) {
-  if (audio_command_queue) {
-    AudioCommand cmd;
-    cmd.type = AudioCommandType::PlaySequence;
-    cmd.sequence = sequence;
-    cmd.length = len;
-    xQueueSend(audio_command_queue, &cmd, 0);
-  }
+  // play alarm sound, pre-empts everything else. called from normal code (not ISR)
+  play_sequence(alarm_sequence, sizeof(alarm_sequence) / sizeof(alarm_sequence[0]), AUDIO_PRIO_ALARM);
 }
 
 void setup_speaker(bool playSound, bool _led_tick, bool _speaker_tick) {
@@ -251,15 +304,20 @@ void setup_speaker(bool playSound, bool _led_tick, bool _speaker_tick) {
 
   tick_enable(false);  // no ticking while we play melody / init sound
 
-  if (!audio_command_queue) {
-    audio_command_queue = xQueueCreate(8, sizeof(AudioCommand));
-    xTaskCreate(audioTask, "audioTask", 4096, NULL, 1, NULL);
+  if (!speaker_mutex) {
+    speaker_mutex = xSemaphoreCreateMutex();
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = sequencerService;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "audioSequencer";
+    esp_timer_create(&timer_args, &sequencer_timer);
+    xTaskCreatePinnedToCore(audioTask, "audioTask", 4096, NULL, 1, &audio_task, COUNTING_CPU);
   }
 
-  play_sequence(init_sequence, sizeof(init_sequence) / sizeof(init_sequence[0]));
+  play_sequence(init_sequence, sizeof(init_sequence) / sizeof(init_sequence[0]), AUDIO_PRIO_MELODY);
 
   if (playSound)
-    play_sequence(melody_sequence, sizeof(melody_sequence) / sizeof(melody_sequence[0]));
+    play_sequence(melody_sequence, sizeof(melody_sequence) / sizeof(melody_sequence[0]), AUDIO_PRIO_MELODY);
 
   led_tick_wanted = _led_tick;
   speaker_tick_wanted = _speaker_tick;
@@ -275,19 +333,49 @@ void update_tick_settings(bool _led_tick, bool _speaker_tick) {
 
 // Timer helpers
 
-#define RECHARGE_TIMER 0
-
-hw_timer_t *recharge_timer = NULL;
+#define RECHARGE_TIMER_GROUP TIMER_GROUP_0
+#define RECHARGE_TIMER_IDX TIMER_0
+#define RECHARGE_TIMER_DIVIDER 80  // 80MHz / 80 == 1MHz, so timer ticks are us
+
+static DRAM_ATTR RechargeIsr recharge_isr = NULL;
+static DRAM_ATTR RechargeTimerStats recharge_stats = {};
+portMUX_TYPE mux_recharge_stats = portMUX_INITIALIZER_UNLOCKED;
+
+static bool IRAM_ATTR recharge_timer_callback(void * /*arg*/) {
+  // The timer reloads to 0 when the alarm fires, so the alarm value is the delay until the next call.
+  // Unlike the arduino timerAlarmWrite, timer_group_set_alarm_value_in_isr is in IRAM, so we can
+  // reprogram the alarm from here without risking "Cache disabled but cached memory region accessed".
+  // The driver re-enables the alarm after we return.
+  uint32_t start = cpu_hal_get_cycle_count();
+  uint32_t delay_us = recharge_isr();
+  timer_group_set_alarm_value_in_isr(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX, delay_us);
+  uint32_t cycles = cpu_hal_get_cycle_count() - start;
+  portENTER_CRITICAL_ISR(&mux_recharge_stats);
+  recharge_stats.calls++;
+  recharge_stats.cycles += cycles;
+  portEXIT_CRITICAL_ISR(&mux_recharge_stats);
+  return false;  // no task woken
+}
 
-hw_timer_t *setup_timer(int timer_no, void (*isr)(), int period_us) {
-  hw_timer_t *timer = timerBegin(timer_no, 80, true);  // prescaler: 80MHz / 80 == 1MHz
-  timerAttachInterrupt(timer, isr, true);  // set ISR
-  timerAlarmWrite(timer, period_us, true);  // set alarm after period, do repeat
-  timerWrite(timer, 0);
-  timerAlarmEnable(timer);
-  return timer;
+void setup_recharge_timer(RechargeIsr isr_recharge, uint32_t first_delay_us) {
+  recharge_isr = isr_recharge;
+  timer_config_t cfg = {};
+  cfg.alarm_en = TIMER_ALARM_EN;
+  cfg.counter_en = TIMER_PAUSE;
+  cfg.intr_type = TIMER_INTR_LEVEL;
+  cfg.counter_dir = TIMER_COUNT_UP;
+  cfg.auto_reload = TIMER_AUTORELOAD_EN;
+  cfg.divider = RECHARGE_TIMER_DIVIDER;
+  timer_init(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX, &cfg);
+  timer_set_counter_value(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX, 0);
+  timer_set_alarm_value(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX, first_delay_us);
+  timer_enable_intr(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX);
+  timer_isr_callback_add(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX, recharge_timer_callback, NULL, ESP_INTR_FLAG_IRAM);
+  timer_start(RECHARGE_TIMER_GROUP, RECHARGE_TIMER_IDX);
 }
 
-void setup_recharge_timer(void (*isr_recharge)(), int period_us) {
-  recharge_timer = setup_timer(RECHARGE_TIMER, isr_recharge, period_us);
+void read_recharge_timer_stats(RechargeTimerStats *stats) {
+  portENTER_CRITICAL(&mux_recharge_stats);
+  *stats = recharge_stats;
+  portEXIT_CRITICAL(&mux_recharge_stats);
 }
@@ -5,11 +5,17 @@
 #include <Arduino.h>
 #include <driver/mcpwm.h>
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
 #include <freertos/task.h>
 
 #include "core/core.hpp"
 #include "config/config.hpp"
+#include "drivers/io/tick_engine.hpp"
+#include "drivers/io/audio_sequencer.hpp"
+
+// Above this click rate [cps], the speaker plays a continuous tone instead of ticks.
+#ifndef TICK_TONE_CPS
+#define TICK_TONE_CPS 80
+#endif
 
 // DIP switch related code
 typedef struct switches {
@@ -27,10 +33,20 @@ Switches read_switches(void);
 void setup_speaker(bool playSound, bool led_tick, bool speaker_tick);
 void update_tick_settings(bool led_tick, bool speaker_tick);
 void tick_enable(bool enable);
-void tick(bool high);
+void tick(uint32_t clicks);
+void read_tick_stats(TickStats *stats);
 void alarm();
 
-void setup_recharge_timer(void (*isr_recharge)(), int period_us);
+// One-shot HV recharge timer: the ISR returns the time [us] until it wants to run again.
+typedef uint32_t (*RechargeIsr)(void);
+void setup_recharge_timer(RechargeIsr isr_recharge, uint32_t first_delay_us);
+
+// Load of the recharge timer ISR since boot.
+typedef struct {
+  uint32_t calls;   // amount of ISR invocations
+  uint64_t cycles;  // cpu cycles spent in the ISR callback (without the ESP-IDF interrupt dispatch)
+} RechargeTimerStats;
+void read_recharge_timer_stats(RechargeTimerStats *stats);
 void setup_audio_timer(void (*isr_audio)(), int period_us);
 
 // Thin OO wrapper for IO-related helpers.
@@ -43,9 +59,11 @@ public:
   void setupSpeaker(bool playSound, bool ledTick, bool speakerTick) { setup_speaker(playSound, ledTick, speakerTick); }
   void updateTickSettings(bool ledTick, bool speakerTick) { update_tick_settings(ledTick, speakerTick); }
   void enableTick(bool enable) { tick_enable(enable); }
-  void doTick(bool high) { tick(high); }
+  void doTick(uint32_t clicks) { tick(clicks); }
+  void readTickStats(TickStats &stats) { read_tick_stats(&stats); }
   void triggerAlarm() { alarm(); }
 
-  void setupRechargeTimer(void (*isr)(), int period_us) { setup_recharge_timer(isr, period_us); }
+  void setupRechargeTimer(RechargeIsr isr, uint32_t first_delay_us) { setup_recharge_timer(isr, first_delay_us); }
+  void readRechargeTimerStats(RechargeTimerStats &stats) { read_recharge_timer_stats(&stats); }
   void setupAudioTimer(void (*isr)(), int period_us) { /* no-op: audio handled in task */ }
 };
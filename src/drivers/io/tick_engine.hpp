@@ -0,0 +1,134 @@
+/**
+ * @file tick_engine.hpp
+ * @brief Coalescing speaker / LED tick rendering
+ *
+ * Pulse sources (GM ISR, RMT task, PCNT reader) only add to an atomic counter of
+ * pending clicks (TickCounter). The audio task takes them in render slots of
+ * slot_ms and asks TickRenderer what to do:
+ *
+ * - low rates: one click per slot, pending clicks beyond that wait in a small
+ *   backlog (so a batch of clicks gets spread out) or, if it is full, are coalesced
+ * - high rates: a continuous tone with a frequency proportional to the click rate,
+ *   switched on above tone_on_cps, off again below tone_off_cps (hysteresis)
+ *
+ * Clicks that can not be rendered at all (ticking disabled, sequence playing) are
+ * counted as dropped. No Arduino / ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#define TICK_ENGINE_INLINE inline __attribute__((always_inline))
+
+/**
+ * @class TickCounter
+ * @brief Pending clicks, multiple producers (also ISRs), one consumer
+ */
+class TickCounter {
+public:
+  /** @brief Add clicks, returns true if there were none pending before (consumer might sleep) */
+  TICK_ENGINE_INLINE bool add(uint32_t clicks) {
+    return pending_.fetch_add(clicks, std::memory_order_relaxed) == 0;
+  }
+
+  /** @brief Take all pending clicks */
+  uint32_t take() { return pending_.exchange(0, std::memory_order_relaxed); }
+
+private:
+  std::atomic<uint32_t> pending_{0};
+};
+
+struct TickConfig {
+  uint32_t slot_ms;        ///< render slot, at most one click per slot
+  uint32_t backlog_max;    ///< clicks that may wait for a slot, more get coalesced
+  float tone_on_cps;       ///< switch to continuous tone above this click rate
+  float tone_off_cps;      ///< and back to clicks below this one
+  uint32_t tone_base_mHz;  ///< tone frequency at 0 cps
+  uint32_t tone_mHz_per_cps;
+  uint32_t tone_max_mHz;
+  uint32_t rate_tau_ms;    ///< time constant of the click rate average
+};
+
+/**
+ * @struct TickAction
+ * @brief What the audio task shall do in the current slot
+ */
+struct TickAction {
+  bool click;         ///< render one click
+  uint32_t tone_mHz;  ///< > 0: continuous tone at this frequency, 0: no tone
+};
+
+/**
+ * @struct TickStats
+ * @brief Click accounting since boot
+ */
+struct TickStats {
+  uint32_t rendered;   ///< clicks rendered as a click
+  uint32_t coalesced;  ///< clicks merged into other clicks or into the tone
+  uint32_t dropped;    ///< clicks that could not be rendered at all
+  bool tone;           ///< continuous tone active
+  float cps;           ///< averaged click rate
+};
+
+class TickRenderer {
+public:
+  explicit TickRenderer(const TickConfig &cfg): cfg_(cfg) {}
+
+  /** @brief Render slot: clicks taken since the last call, dt_ms since the last call */
+  TickAction render(uint32_t clicks, uint32_t dt_ms) {
+    float dt = (dt_ms > 0) ? dt_ms : 1;
+    cps_ += (clicks * 1000.0f / dt - cps_) * dt / (cfg_.rate_tau_ms + dt);
+    if (!stats_.tone && cps_ > cfg_.tone_on_cps) {
+      stats_.tone = true;
+      stats_.coalesced += backlog_;  // the tone takes over the waiting clicks, too
+      backlog_ = 0;
+    } else if (stats_.tone && cps_ < cfg_.tone_off_cps) {
+      stats_.tone = false;
+    }
+
+    if (stats_.tone) {
+      stats_.coalesced += clicks;
+      uint32_t f = cfg_.tone_base_mHz + (uint32_t)(cps_ * cfg_.tone_mHz_per_cps);
+      return {false, (f < cfg_.tone_max_mHz) ? f : cfg_.tone_max_mHz};
+    }
+
+    backlog_ += clicks;
+    if (backlog_ > cfg_.backlog_max) {
+      stats_.coalesced += backlog_ - cfg_.backlog_max;
+      backlog_ = cfg_.backlog_max;
+    }
+    if (!backlog_)
+      return {false, 0};
+    backlog_--;
+    stats_.rendered++;
+    return {true, 0};
+  }
+
+  /** @brief Count clicks which can not be rendered */
+  void drop(uint32_t clicks) { stats_.dropped += clicks; }
+
+  /** @brief Forget waiting clicks and the tone (e.g. a sequence takes over the speaker) */
+  void interrupt() {
+    stats_.dropped += backlog_;
+    backlog_ = 0;
+    stats_.tone = false;
+    cps_ = 0;
+  }
+
+  /** @brief Nothing to render: no waiting clicks and no tone, the caller may sleep until new clicks come in */
+  bool idle() const { return !backlog_ && !stats_.tone; }
+
+  TickStats stats() const {
+    TickStats s = stats_;
+    s.cps = cps_;
+    return s;
+  }
+
+private:
+  TickConfig cfg_;
+  TickStats stats_ = {};
+  uint32_t backlog_ = 0;
+  float cps_ = 0;
+};
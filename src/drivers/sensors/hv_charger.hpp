@@ -0,0 +1,134 @@
+/**
+ * @file hv_charger.hpp
+ * @brief HV capacitor recharge state machine
+ *
+ * The GM tube high voltage is kept in a capacitor, which loses charge through leak
+ * currents and every GM pulse. HvCharger recharges it with FET pulses until the
+ * capacitor signals "full", and adapts the time between recharges so that a recharge
+ * takes about 2 charge pulses (see HvAdaptiveLaw).
+ *
+ * step() executes the next state and returns the time [us] until it wants to run
+ * again, so the caller owns the time base: in the firmware that is a one-shot timer
+ * ISR, in a simulation just a variable. All hardware access goes through HvChargerHal.
+ *
+ * No Arduino / ESP-IDF dependencies. All methods used by step() are forced inline,
+ * so an IRAM_ATTR caller keeps the whole state machine in IRAM.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define HV_CHARGER_INLINE inline __attribute__((always_inline))
+
+/**
+ * @struct HvChargerHal
+ * @brief Hardware access needed by HvCharger (must be ISR / IRAM safe in the firmware)
+ */
+struct HvChargerHal {
+  void (*set_fet)(bool on);               ///< switch the HV FET on / off
+  bool (*cap_full)(void);                 ///< capacitor signalled "full" since clear_cap_full()
+  void (*clear_cap_full)(void);           ///< reset the "full" signal
+  void (*charged)(int pulses, bool ok, uint32_t interval_us);  ///< end of a recharge: charge pulses used,
+  ///< capacitor full?, time until the next recharge
+};
+
+/**
+ * @struct HvTiming
+ * @brief Timing of the recharge state machine [us]
+ */
+struct HvTiming {
+  uint32_t pulse_high_us;  ///< FET on (5000us gives 1.3 times more charge, 500us gives 1/20th of charge)
+  uint32_t pulse_low_us;   ///< FET off, then check whether the capacitor is full
+  uint32_t interval_us;    ///< initial time between recharges, also used after a failure
+  uint32_t min_us;         ///< limits for the time between recharges
+  uint32_t max_us;
+  uint32_t retry_us;       ///< time to wait after a failed recharge
+  int max_pulses;          ///< charge pulses until a recharge is considered failed
+};
+
+/**
+ * @struct HvAdaptiveLaw
+ * @brief Default control law for the time between recharges
+ *
+ * Depending on a lot of circumstances (e.g. level of radiation, humidity, leak currents
+ * (diode leak current depends on temperature), tube type, ...), we might need to charge
+ * the HV capacitor more or less often.
+ * We target charging with 2 pulses here because if we only needed 1 charge pulse, this
+ * does not imply the HV capacitor actually needed charging. If we needed 2 pulses, we
+ * are sure the HV capacitor needed a little charge.
+ */
+struct HvAdaptiveLaw {
+  static HV_CHARGER_INLINE uint32_t next(uint32_t interval_us, int charge_pulses) {
+    if (charge_pulses <= 1)
+      return interval_us * 5 / 4;  // one charge pulse was enough, so maybe we charge too often
+    // 2 charge pulses: no change
+    // > 2: the more charge pulses we needed, the more frequently we want to recharge
+    return interval_us * 2 / charge_pulses;
+  }
+};
+
+template <class Law = HvAdaptiveLaw>
+class HvCharger {
+public:
+  HvCharger(const HvChargerHal &hal, const HvTiming &timing): hal_(hal), timing_(timing), next_charge_(timing.interval_us) {}
+
+  /** @brief Run the state machine, returns the time [us] until the next call */
+  HV_CHARGER_INLINE uint32_t step() {
+    if (state_ == init) {
+      charge_pulses_ = 0;
+      hal_.clear_cap_full();
+      state_ = pulse_h;
+      // fall through
+    }
+    while (state_ < is_full) {
+      if (state_ == pulse_h) {
+        hal_.set_fet(true);
+        state_ = pulse_l;
+        return timing_.pulse_high_us;
+      }
+      if (state_ == pulse_l) {
+        hal_.set_fet(false);
+        state_ = check_full;
+        return timing_.pulse_low_us;
+      }
+      if (state_ == check_full) {
+        charge_pulses_++;
+        if (hal_.cap_full())
+          state_ = is_full;
+        else if (charge_pulses_ < timing_.max_pulses)
+          state_ = pulse_h;
+        else
+          state_ = charge_fail;
+        // fall through
+      }
+    }
+    if (state_ == is_full) {
+      state_ = init;
+      next_charge_ = Law::next(next_charge_, charge_pulses_);
+      if (next_charge_ < timing_.min_us)
+        next_charge_ = timing_.min_us;
+      else if (next_charge_ > timing_.max_us)
+        next_charge_ = timing_.max_us;
+      hal_.charged(charge_pulses_, true, next_charge_);
+      return next_charge_;
+    }
+    // state_ == charge_fail: capacitor does not charge! let's retry charging later, with the default interval.
+    state_ = init;
+    next_charge_ = timing_.interval_us;
+    hal_.charged(charge_pulses_, false, timing_.retry_us);
+    return timing_.retry_us;
+  }
+
+  /** @brief Current time between recharges [us] */
+  uint32_t interval() const { return next_charge_; }
+
+private:
+  enum State {init, pulse_h, pulse_l, check_full, is_full, charge_fail};
+
+  HvChargerHal hal_;
+  HvTiming timing_;
+  State state_ = init;
+  int charge_pulses_ = 0;
+  uint32_t next_charge_;
+};
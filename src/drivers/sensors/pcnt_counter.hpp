@@ -0,0 +1,86 @@
+/**
+ * @file pcnt_counter.hpp
+ * @brief Hardware pulse counter backend for the GM tube input
+ *
+ * The ESP32 pulse counter (PCNT) counts GM pulses without any cpu involvement.
+ * Its counter is only 16 bits wide and wraps to 0 when it reaches the high limit,
+ * which raises the only interrupt of this backend. PcntCounter widens the hardware
+ * counter to 32 bits using these overflow events.
+ *
+ * All hardware access goes through PcntHal, so this code has no Arduino / ESP-IDF
+ * dependencies and can be used with a stub HAL on a host.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @struct PcntHal
+ * @brief Hardware access needed by PcntCounter
+ */
+struct PcntHal {
+  int16_t (*read)(void);  ///< current value of the hardware counter
+  void (*clear)(void);    ///< reset the hardware counter to 0
+};
+
+class PcntCounter {
+public:
+  /**
+   * @param hal hardware access functions
+   * @param limit value at which the hardware counter wraps to 0 (and signals an overflow)
+   */
+  PcntCounter(const PcntHal &hal, int16_t limit): hal_(hal), limit_(limit) {}
+
+  /** @brief Reset hardware and overflow counters */
+  void begin() {
+    hal_.clear();
+    overflows_.store(0, std::memory_order_relaxed);
+    seen_overflows_ = 0;
+    seen_raw_ = 0;
+  }
+
+  /** @brief Overflow interrupt: the hardware counter just wrapped from limit to 0 */
+  inline __attribute__((always_inline)) void onOverflow() {
+    // only the overflow interrupt writes this
+    overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * @brief Total amount of pulses counted since begin() (wraps at 2^32)
+   *
+   * Reader side, call it from one task only. It never goes backwards: the hardware counter wraps
+   * before the overflow interrupt runs (on the other core it may not even have been served yet),
+   * so a read can see the wrapped counter with the old overflow count. A counter below the
+   * previous read with no new overflow is such a wrap and counted as one.
+   */
+  uint32_t total() {
+    uint32_t overflows, after;
+    int16_t raw;
+    do {
+      // if an overflow happens while we read, the raw value might belong to either
+      // side of it, so just read again.
+      overflows = overflows_.load(std::memory_order_acquire);
+      raw = hal_.read();
+      after = overflows_.load(std::memory_order_acquire);
+    } while (overflows != after);
+    if ((int32_t)(overflows - seen_overflows_) < 0)
+      overflows = seen_overflows_;  // the interrupt of a wrap we already counted is still pending
+    if ((overflows == seen_overflows_) && (raw < seen_raw_))
+      overflows++;  // wrapped, the interrupt is pending
+    seen_overflows_ = overflows;
+    seen_raw_ = raw;
+    return overflows * (uint32_t)limit_ + (uint32_t)raw;
+  }
+
+  /** @brief Amount of overflow interrupts since begin() */
+  uint32_t overflows() const { return overflows_.load(std::memory_order_relaxed); }
+
+private:
+  PcntHal hal_;
+  int16_t limit_;
+  std::atomic<uint32_t> overflows_{0};
+  uint32_t seen_overflows_ = 0;  // overflows at the previous total(), incl. a pending one
+  int16_t seen_raw_ = 0;         // hardware counter at the previous total()
+};
@@ -0,0 +1,141 @@
+/**
+ * @file pulse_ring.hpp
+ * @brief Lock-free single-producer / single-consumer ring for GM pulse timestamps
+ *
+ * The GM tube ISR is the only producer, read_GMC() (task context) is the only
+ * consumer, so no critical section is needed: head is only written by the
+ * producer, tail only by the consumer, and acquire/release ordering on these
+ * two indexes publishes the slot contents.
+ *
+ * When the ring is full, the timestamp is dropped but still counted, so the
+ * total number of pulses (accepted() + dropped()) is always exact.
+ *
+ * PulseIntervals turns the drained timestamps into intervals between pulses.
+ *
+ * This file has no Arduino dependencies, so the very same code can be built
+ * and stress-tested on a host.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PULSE_RING_INLINE inline __attribute__((always_inline))
+
+template <uint32_t N>
+class PulseRing {
+  static_assert((N >= 2) && ((N & (N - 1)) == 0), "PulseRing size must be a power of 2");
+
+public:
+  /** @brief Producer side (ISR): store a timestamp, returns false if the ring was full */
+  PULSE_RING_INLINE bool push(uint32_t timestamp) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    uint32_t tail = tail_.load(std::memory_order_acquire);
+    if ((head - tail) >= N) {
+      // only the producer writes dropped_, so load + store is fine here
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    buf_[head & (N - 1)] = timestamp;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** @brief Consumer side: move up to max timestamps (oldest first) to out, returns the amount moved */
+  size_t pop(uint32_t *out, size_t max) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    uint32_t head = head_.load(std::memory_order_acquire);
+    uint32_t avail = head - tail;
+    if (avail > high_water_)
+      high_water_ = avail;
+    if (avail > max)
+      avail = max;
+    for (uint32_t i = 0; i < avail; i++)
+      out[i] = buf_[(tail + i) & (N - 1)];
+    tail_.store(tail + avail, std::memory_order_release);
+    return avail;
+  }
+
+  /** @brief Total amount of timestamps accepted into the ring (wraps at 2^32) */
+  uint32_t accepted() const { return head_.load(std::memory_order_relaxed); }
+
+  /** @brief Total amount of timestamps dropped because the ring was full (wraps at 2^32) */
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /** @brief Highest fill level the consumer has seen so far (consumer side only) */
+  uint32_t highWater() const { return high_water_; }
+
+  static constexpr uint32_t capacity() { return N; }
+
+private:
+  std::atomic<uint32_t> head_{0};     // next slot to write, producer owned
+  std::atomic<uint32_t> tail_{0};     // next slot to read, consumer owned
+  std::atomic<uint32_t> dropped_{0};  // producer owned
+  uint32_t high_water_ = 0;           // consumer owned
+  uint32_t buf_[N] = {};
+};
+
+/**
+ * Consumer side: intervals between drained pulse timestamps of a 32 bit tick counter.
+ *
+ * The tick counter wraps (cpu cycles: every ~17.9 s at 240 MHz), so the difference of two
+ * timestamps is only their interval if the pulses were less than one wrap period apart.
+ * The system time [ms] of every pulse is derived from its age at drain time, intervals whose
+ * system time difference comes close to the wrap period are dropped instead of being reported
+ * modulo 2^32. Same if the drain itself was late by a wrap period (ages are ambiguous then).
+ */
+class PulseIntervals {
+public:
+  // Intervals this close to the wrap period are dropped: margin for the ms resolution and the
+  // latency between reading the tick counter and the system time. [ms]
+  static constexpr uint32_t WRAP_MARGIN_MS = 1000;
+
+  void begin(uint32_t ticks_per_us, uint32_t now_ms) {
+    ticks_per_us_ = ticks_per_us;
+    wrap_ms_ = 0xFFFFFFFFUL / ticks_per_us / 1000;
+    last_drain_ms_ = now_ms;
+    have_last_ = false;
+  }
+
+  /** @brief Start a drain, the tick counter reads now_ticks at the system time now_ms */
+  void startDrain(uint32_t now_ticks, uint32_t now_ms) {
+    stale_ = (now_ms - last_drain_ms_) >= wrap_ms_;
+    last_drain_ms_ = now_ms;
+    now_ticks_ = now_ticks;
+    now_ms_ = now_ms;
+  }
+
+  /** @brief Next drained timestamp (oldest first), true if *interval_us to the previous pulse is valid */
+  bool add(uint32_t ticks, uint32_t *interval_us) {
+    // a pulse which came in while we drain is up to ~1 s "ahead" of now_ticks, it happened now
+    bool ahead = (ticks - now_ticks_) < ticks_per_us_ * 1000000;
+    uint32_t pulse_ms = now_ms_ - (ahead ? 0 : (now_ticks_ - ticks) / ticks_per_us_ / 1000);
+    bool valid = have_last_ && !stale_ && ((pulse_ms - last_ms_) + WRAP_MARGIN_MS < wrap_ms_);
+    if (valid)
+      *interval_us = (ticks - last_ticks_) / ticks_per_us_;
+    last_ticks_ = ticks;
+    last_ms_ = pulse_ms;
+    have_last_ = true;
+    stale_ = false;  // the following pulses are relative to this one
+    return valid;
+  }
+
+  /** @brief System time [ms] of the latest drained pulse */
+  uint32_t lastPulseMs() const { return last_ms_; }
+
+  /** @brief Wrap period of the tick counter [ms] */
+  uint32_t wrapMs() const { return wrap_ms_; }
+
+private:
+  uint32_t ticks_per_us_ = 1;
+  uint32_t wrap_ms_ = 0xFFFFFFFFUL / 1000;
+  uint32_t last_drain_ms_ = 0;
+  uint32_t now_ticks_ = 0;
+  uint32_t now_ms_ = 0;
+  uint32_t last_ticks_ = 0;  // timestamp of the latest drained pulse
+  uint32_t last_ms_ = 0;     // its system time
+  bool have_last_ = false;
+  bool stale_ = false;
+};
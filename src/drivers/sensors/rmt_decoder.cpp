@@ -0,0 +1,51 @@
+#include "rmt_decoder.hpp"
+
+// segment <half> (0 or 1) of an RMT item
+#define RMT_DURATION(item, half) (((item) >> ((half) * 16)) & 0x7FFF)
+#define RMT_LEVEL(item, half) (((item) >> ((half) * 16 + 15)) & 1)
+
+uint64_t rmt_frame_ticks(const uint32_t *items, size_t n_items) {
+  uint64_t ticks = 0;
+  for (size_t i = 0; i < n_items; i++) {
+    for (int half = 0; half < 2; half++) {
+      uint32_t duration = RMT_DURATION(items[i], half);
+      if (duration == 0)
+        return ticks;
+      ticks += duration;
+    }
+  }
+  return ticks;
+}
+
+RmtDecodeResult rmt_decode_pulses(const uint32_t *items, size_t n_items, uint64_t frame_start_ticks,
+                                  int active_level, uint32_t dead_time_ticks, RmtDecoderState *state,
+                                  uint64_t *timestamps, size_t max_timestamps) {
+  RmtDecodeResult result = {0, 0};
+  // the frame start is usually estimated by the caller, make sure time never runs backwards. An estimate
+  // before the end of the previous frame is wrong, don't let it put the first pulse into the dead time
+  // of the previous frame's last one either (frames usually are the idle threshold apart).
+  uint64_t t = frame_start_ticks;
+  if (t <= state->frame_end_ticks)
+    t = state->have_last_pulse ? state->frame_end_ticks + dead_time_ticks + 1 : state->frame_end_ticks;
+  for (size_t i = 0; i < n_items; i++) {
+    for (int half = 0; half < 2; half++) {
+      uint32_t duration = RMT_DURATION(items[i], half);
+      if (duration == 0)
+        goto done;  // end of frame
+      if ((int)RMT_LEVEL(items[i], half) == active_level) {
+        // this segment starts with an edge into the active level: a pulse.
+        if (!state->have_last_pulse || ((t - state->last_pulse_ticks) > dead_time_ticks)) {
+          state->last_pulse_ticks = t;
+          state->have_last_pulse = true;
+          if (result.timestamps < max_timestamps)
+            timestamps[result.timestamps++] = t;
+          result.counts++;
+        }
+      }
+      t += duration;
+    }
+  }
+done:
+  state->frame_end_ticks = t;
+  return result;
+}
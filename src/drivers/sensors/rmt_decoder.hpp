@@ -0,0 +1,58 @@
+/**
+ * @file rmt_decoder.hpp
+ * @brief Decoder for GM pulse edges captured by the RMT receiver
+ *
+ * The RMT receiver records a frame of input level durations, starting with the
+ * first edge after the input was idle and ending after it was idle again for the
+ * configured idle threshold. Each 32bit item holds two segments:
+ * {duration0:15, level0:1, duration1:15, level1:1}, a 0 duration ends the frame.
+ *
+ * rmt_decode_pulses turns such a frame into absolute pulse timestamps and does
+ * the dead time filtering for the whole frame at once. It is a pure function
+ * (all state is passed in), so it can be tested and benchmarked on a host with
+ * recorded symbol streams.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @struct RmtDecoderState
+ * @brief Decoder state carried from one frame to the next
+ */
+struct RmtDecoderState {
+  uint64_t last_pulse_ticks;  ///< timestamp of the last accepted pulse
+  uint64_t frame_end_ticks;   ///< timestamp of the last edge of the previous frame
+  bool have_last_pulse;       ///< false until the first pulse was accepted
+};
+
+/**
+ * @struct RmtDecodeResult
+ * @brief Result of decoding one frame
+ */
+struct RmtDecodeResult {
+  uint32_t counts;    ///< pulses accepted in this frame
+  size_t timestamps;  ///< pulse timestamps written to the output (<= counts)
+};
+
+/**
+ * @brief Sum of all segment durations of a frame, i.e. time from first to last edge [ticks]
+ */
+uint64_t rmt_frame_ticks(const uint32_t *items, size_t n_items);
+
+/**
+ * @brief Decode the pulses of one RMT frame
+ * @param items RMT items of the frame
+ * @param n_items amount of items
+ * @param frame_start_ticks absolute time of the first edge of the frame [ticks]
+ * @param active_level input level while a GM pulse is active, each edge into it is a pulse
+ * @param dead_time_ticks pulses less than this after the last accepted pulse are ignored
+ * @param state decoder state, updated
+ * @param timestamps output: absolute timestamps of the accepted pulses [ticks]
+ * @param max_timestamps size of the timestamps output
+ */
+RmtDecodeResult rmt_decode_pulses(const uint32_t *items, size_t n_items, uint64_t frame_start_ticks,
+                                  int active_level, uint32_t dead_time_ticks, RmtDecoderState *state,
+                                  uint64_t *timestamps, size_t max_timestamps);
@@ -1,6 +1,12 @@
 #include "sensors.hpp"
 
 #include <driver/gpio.h>
+#include <hal/cpu_hal.h>
+#include <driver/pcnt.h>
+#include <driver/rmt.h>
+#include <esp_timer.h>
+
+#include "core/cpu.hpp"
 
 // THP sensor handling
 
@@ -32,13 +38,13 @@ bool setup_thp_sensor(void) {
     bme680.setPressureOversampling(BME680_OS_4X);
     bme680.setIIRFilterSize(BME680_FILTER_SIZE_3);
     bme680.setGasHeater(300, 150); // 300*C for 150 ms
-    log(INFO, "BME_Status: ok,  ID: BME680");
+    LOG(INFO, "BME_Status: ok,  ID: BME680");
     break;
   case 280:
-    log(INFO, "BME_Status: ok,  ID: BME280");
+    LOG(INFO, "BME_Status: ok,  ID: BME280");
     break;
   default:
-    log(INFO, "BME_Status: not found");
+    LOG(INFO, "BME_Status: not found");
     break;
   }
   return (type_thp > 0);
@@ -51,7 +57,7 @@ bool read_thp_sensor(float *temperature, float *humidity, float *pressure) {
     *pressure = bme280.readPressure();
   } else if (type_thp == 680) {
     if (!bme680.performReading()) {
-      log(INFO, "BME680: Failed to perform reading");
+      LOG(INFO, "BME680: Failed to perform reading");
       return false;
     }
     *temperature = bme680.temperature;
@@ -89,113 +95,67 @@ volatile bool isr_GMC_cap_full;
 
 volatile unsigned long isr_hv_pulses;
 volatile bool isr_hv_charge_error;
+static HvTelemetry hv_telemetry = {};  // protected by mux_hv
 
-volatile unsigned int isr_GMC_counts;
-volatile unsigned long isr_count_timestamp;
-volatile unsigned long isr_count_time_between;
-
-// MUX (mutexes used for mutual exclusive access to isr variables)
 portMUX_TYPE mux_cap_full = portMUX_INITIALIZER_UNLOCKED;
-portMUX_TYPE mux_GMC_count = portMUX_INITIALIZER_UNLOCKED;
 portMUX_TYPE mux_hv = portMUX_INITIALIZER_UNLOCKED;
 
-// Maximum amount of HV capacitor charge pulses to generate in one charge cycle.
-#define PERIODS(us) ((us) / TUBE_PERIOD_DURATION_US)
-
-void IRAM_ATTR isr_recharge() {
-  // this code is periodically called by a timer hw interrupt, always same period.
-  // we need to decide internally whether we actually want to do something.
-  //
-  // note: this is implemented like it is because dynamically reprogramming the hw timer
-  // to a different period would require us to call library functions like timerAlarmWrite
-  // which are **not** in IRAM (but in flash) and doing that can lead to spurious fatal
-  // exceptions like "Cache disabled but cached memory region accessed".
-  static unsigned int current = 0;  // current period counter
-  static unsigned int next_state = 0;  // periods to next state machine execution
-  static unsigned int next_charge = PERIODS(1000000);  // periods between recharges, initially 1s
-  if (++current < next_state)
-    return;  // nothing to do yet
-
-  // we reached "next_state", so we execute the state machine:
-  current = 0;
-
-  enum State {init, pulse_h, pulse_l, check_full, is_full, charge_fail};
-  static State state = init;
-  static int charge_pulses;
-  if (state == init) {
-    charge_pulses = 0;
-    portENTER_CRITICAL_ISR(&mux_cap_full);
-    isr_GMC_cap_full = 0;
-    portEXIT_CRITICAL_ISR(&mux_cap_full);
-    state = pulse_h;
-    // fall through
-  }
-  while (state < is_full) {
-    if (state == pulse_h) {
-      // use gpio_set_level (IRAM safe) to avoid lock acquisition in ISR
-      gpio_set_level((gpio_num_t)PIN_HV_FET_OUTPUT, 1);  // turn the HV FET on
-      state = pulse_l;
-      next_state = PERIODS(1500);  // 1500us (5000us gives 1.3 times more charge, 500us gives 1/20th of charge)
-      return;
-    }
-    if (state == pulse_l) {
-      gpio_set_level((gpio_num_t)PIN_HV_FET_OUTPUT, 0);   // turn the HV FET off
-      state = check_full;
-      next_state = PERIODS(1000);  // 1000us
-      return;
-    }
-    if (state == check_full) {
-      charge_pulses++;
-      if (isr_GMC_cap_full)
-        state = is_full;
-      else if (charge_pulses < MAX_CHARGE_PULSES)
-        state = pulse_h;
-      else
-        state = charge_fail;
-      // fall through
-    }
-  }
-  if (state == is_full) {
-    // capacitor full
-    portENTER_CRITICAL_ISR(&mux_hv);
-    isr_hv_charge_error = false;
-    isr_hv_pulses += charge_pulses;
-    portEXIT_CRITICAL_ISR(&mux_hv);
-    state = init;
-    // depending on a lot of circumstances (e.g. level of radiation, humidity,
-    // leak currents (diode leak current depends on temperature), tube type, ...),
-    // we might need to charge the HV capacitor more or less often.
-    // we target charging with 2 pulses here because if we only needed 1 charge
-    // pulse, this does not imply the HV capacitor actually needed charging. if
-    // we needed 2 pulses, we are sure the HV capacitor needed a little charge.
-    if (charge_pulses <= 1) {
-      // one charge pulse was enough, so maybe we charge too often
-      next_charge = next_charge * 5 / 4;
-    } else {
-      // 2 charge pulses: no change
-      // > 2: the more charge pulses we needed, the more frequently we want to recharge
-      next_charge = next_charge * 2 / charge_pulses;
-    }
-    // never go below 1ms or above 10s
-    if (next_charge < PERIODS(1000))
-      next_charge = PERIODS(1000);
-    else if (next_charge > PERIODS(10000000))
-      next_charge = PERIODS(10000000);
-    next_state = next_charge;
-    return;
-  }
-  if (state == charge_fail) {
-    // capacitor does not charge!
-    portENTER_CRITICAL_ISR(&mux_hv);
-    isr_hv_charge_error = true;
-    isr_hv_pulses += charge_pulses;
-    portEXIT_CRITICAL_ISR(&mux_hv);
-    // let's retry charging later
-    state = init;
-    next_charge = PERIODS(1000000);  // reset to default 1s charge interval
-    next_state = PERIODS(10 * 60 * 1000000);  // wait for 10 minutes before retrying
-    return;
+// HV recharge state machine, see hv_charger.hpp. The HAL functions get called from the recharge timer ISR.
+
+static void IRAM_ATTR hv_set_fet(bool on) {
+  // use gpio_set_level (IRAM safe) to avoid lock acquisition in ISR
+  gpio_set_level((gpio_num_t)PIN_HV_FET_OUTPUT, on ? 1 : 0);
+}
+
+static bool IRAM_ATTR hv_cap_full(void) {
+  return isr_GMC_cap_full;
+}
+
+static void IRAM_ATTR hv_clear_cap_full(void) {
+  portENTER_CRITICAL_ISR(&mux_cap_full);
+  isr_GMC_cap_full = 0;
+  portEXIT_CRITICAL_ISR(&mux_cap_full);
+}
+
+static void IRAM_ATTR hv_charged(int pulses, bool ok, uint32_t interval_us) {
+  uint32_t now_ms = esp_timer_get_time() / 1000;  // millis() is not guaranteed to be in IRAM
+  portENTER_CRITICAL_ISR(&mux_hv);
+  isr_hv_charge_error = !ok;
+  isr_hv_pulses += pulses;
+  HvTelemetry *t = &hv_telemetry;
+  if (ok) {
+    t->interval_us = interval_us;
+    if (!t->recharges || interval_us < t->interval_min_us)
+      t->interval_min_us = interval_us;
+    if (interval_us > t->interval_max_us)
+      t->interval_max_us = interval_us;
+    t->interval_sum_us += interval_us;
+    t->recharges++;
+    t->pulses.add(pulses);
+  } else {
+    t->failures++;
+    for (int i = HV_FAIL_HISTORY - 1; i > 0; i--)
+      t->fail_ms[i] = t->fail_ms[i - 1];
+    t->fail_ms[0] = now_ms;
   }
+  portEXIT_CRITICAL_ISR(&mux_hv);
+}
+
+static const HvChargerHal hv_hal = {hv_set_fet, hv_cap_full, hv_clear_cap_full, hv_charged};
+static const HvTiming hv_timing = {
+  1500,                 // pulse_high_us
+  1000,                 // pulse_low_us
+  1000000,              // interval_us: 1s
+  1000,                 // min_us: never recharge more often than every 1ms ...
+  10000000,             // max_us: ... or less often than every 10s
+  10 * 60 * 1000000,    // retry_us: wait for 10 minutes before retrying after a failure
+  MAX_CHARGE_PULSES     // max_pulses
+};
+static HvCharger<> hv_charger(hv_hal, hv_timing);
+
+uint32_t IRAM_ATTR isr_recharge() {
+  // called by a one-shot timer hw interrupt, which gets reprogrammed to the time we return here.
+  return hv_charger.step();
 }
 
 void IRAM_ATTR isr_GMC_capacitor_full() {
@@ -211,39 +171,282 @@ void read_hv(bool *hv_error, unsigned long *pulses) {
   portEXIT_CRITICAL(&mux_hv);
 }
 
+void read_hv_telemetry(HvTelemetry *telemetry) {
+  portENTER_CRITICAL(&mux_hv);
+  *telemetry = hv_telemetry;
+  portEXIT_CRITICAL(&mux_hv);
+}
+
+int format_hv_telemetry(const HvTelemetry *t, uint32_t now_ms, char *buf, size_t len) {
+  // JSON object, failure times as seconds ago (uptime based, so they are right before NTP sync, too)
+  int n = snprintf(buf, len,
+                   "{\"interval_us\":%u,\"interval_min_us\":%u,\"interval_max_us\":%u,\"interval_mean_us\":%u,"
+                   "\"recharges\":%u,\"failures\":%u,\"fail_age_s\":[",
+                   t->interval_us, t->interval_min_us, t->interval_max_us,
+                   t->recharges ? (uint32_t)(t->interval_sum_us / t->recharges) : 0,
+                   t->recharges, t->failures);
+  size_t used;
+  for (int i = 0; (i < HV_FAIL_HISTORY) && (i < (int)t->failures); i++) {
+    used = ((size_t)n < len) ? n : len;
+    n += snprintf(buf + used, len - used, i ? ",%u" : "%u", (now_ms - t->fail_ms[i]) / 1000);
+  }
+  used = ((size_t)n < len) ? n : len;
+  n += snprintf(buf + used, len - used, "],\"pulses\":");
+  used = ((size_t)n < len) ? n : len;
+  n += t->pulses.toJson(buf + used, len - used);
+  used = ((size_t)n < len) ? n : len;
+  n += snprintf(buf + used, len - used, "}");
+  return n;
+}
+
+#if (GMC_COUNT_BACKEND == GMC_BACKEND_ISR) || (GMC_COUNT_BACKEND == GMC_BACKEND_RMT)
+
+// Both backends timestamp every valid pulse and hand the timestamps to read_GMC through the pulse ring.
+// The time base of the timestamps ("ticks") depends on the backend, see pulse_ticks_now().
+
+// Valid GM pulses, as tick timestamps. The backend is the producer, read_GMC the consumer.
+static DRAM_ATTR PulseRing<PULSE_RING_SIZE> pulse_ring;
+
+static uint32_t pulse_ticks_now(void);
+
+// consumer side state of the pulse ring, only used by read_GMC
+static PulseIntervals pulse_intervals;
+static uint32_t consumed_pulses;       // accepted + dropped pulses seen so far
+static unsigned int last_between_us;   // time between the last two drained pulses
+static PulseBatchHandler pulse_handler = nullptr;
+
+void set_pulse_handler(PulseBatchHandler handler) {
+  pulse_handler = handler;
+}
+
+void read_GMC(unsigned long *counts, unsigned long *timestamp, unsigned int *between) {
+  uint32_t batch[PULSE_BATCH_SIZE];
+  uint32_t intervals[PULSE_BATCH_SIZE];
+  pulse_intervals.startDrain(pulse_ticks_now(), millis());
+
+  size_t n;
+  while ((n = pulse_ring.pop(batch, PULSE_BATCH_SIZE)) > 0) {
+    size_t n_intervals = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (pulse_intervals.add(batch[i], &intervals[n_intervals]))
+        n_intervals++;
+    }
+    if (n_intervals) {
+      last_between_us = intervals[n_intervals - 1];
+      if (pulse_handler)
+        pulse_handler(intervals, n_intervals);
+    }
+  }
+
+  // counting does not depend on timestamps, so pulses dropped due to a full ring are not lost.
+  uint32_t total = pulse_ring.accepted() + pulse_ring.dropped();
+  *counts += total - consumed_pulses;
+  consumed_pulses = total;
+  *timestamp = pulse_intervals.lastPulseMs();
+  *between = last_between_us;
+}
+
+void read_pulse_ring_stats(PulseRingStats *stats) {
+  stats->accepted = pulse_ring.accepted();
+  stats->dropped = pulse_ring.dropped();
+  stats->high_water = pulse_ring.highWater();
+  stats->capacity = pulse_ring.capacity();
+}
+
+#endif
+
+#if GMC_COUNT_BACKEND == GMC_BACKEND_ISR
+
+// GPIO interrupt on every edge of PIN_GMC_COUNT_INPUT, dead time and timestamps done in software.
+// Ticks are cpu cycles. The cycle counter is per cpu core, so read_GMC has to run on the core
+// the ISR was attached from.
+
+// GMC_DEAD_TIME converted to cpu cycles, computed in setup_GMC_count
+static DRAM_ATTR uint32_t gmc_dead_time_cycles;
+
+static uint32_t pulse_ticks_now(void) {
+  return cpu_hal_get_cycle_count();
+}
+
 void IRAM_ATTR isr_GMC_count() {
-  unsigned long now;
-  static unsigned long last;
-  portENTER_CRITICAL_ISR(&mux_GMC_count);
+  // no critical section here: the pulse ring is lock-free, all other state is ISR-local.
+  static uint32_t last;  // timestamp of last **valid** pulse [cpu cycles]
 #if PIN_TEST_OUTPUT >= 0
   digitalWrite(PIN_TEST_OUTPUT, HIGH);
 #endif
-  now = micros();  // unsigned long == uint32_t == 32bit -> overflows after ~72 minutes.
-  // safely compute dt, even if <now> has overflowed and <last> not [yet]:
-  unsigned long dt = (now >= last) ? (now - last) : ((now + (1 << 30)) - (last + (1 << 30)));
-  if (dt > GMC_DEAD_TIME) {
+  uint32_t now = cpu_hal_get_cycle_count();  // overflows after ~18s at 240MHz, unsigned math keeps dt correct
+  if ((now - last) > gmc_dead_time_cycles) {
     // We only consider a pulse valid if it happens more than GMC_DEAD_TIME after the last valid pulse.
     // Reason: Pulses occurring short after a valid pulse are false pulses generated by the rising edge on the PIN_GMC_COUNT_INPUT.
     //         This happens because we don't have a Schmitt trigger on this controller pin.
-    isr_count_timestamp = millis();        // remember (system) time of the pulse
-    isr_count_time_between = dt;           // save for statistics debuging
-    isr_GMC_counts++;                      // count the pulse
-    last = now;                            // remember timestamp of last **valid** pulse
+    pulse_ring.push(now);  // if the ring is full, the pulse is still counted (as dropped)
+    last = now;
+    tick(1);
   }
 #if PIN_TEST_OUTPUT >= 0
   digitalWrite(PIN_TEST_OUTPUT, LOW);
 #endif
-  portEXIT_CRITICAL_ISR(&mux_GMC_count);
-  tick(true);  // tick
+}
+
+static void setup_GMC_count(void) {
+  uint32_t ticks_per_us = getCpuFrequencyMhz();
+  gmc_dead_time_cycles = GMC_DEAD_TIME * ticks_per_us;
+  pulse_intervals.begin(ticks_per_us, millis());
+  attachInterrupt(PIN_GMC_COUNT_INPUT, isr_GMC_count, CHANGE);
+}
+
+#elif GMC_COUNT_BACKEND == GMC_BACKEND_RMT
+
+// The RMT receiver records the durations between edges of PIN_GMC_COUNT_INPUT in hardware, rmtTask
+// decodes whole frames of them at once (incl. dead time filtering) into pulse timestamps.
+// No per-pulse interrupt and a timestamp resolution of 0.5us. Ticks are 0.5us on the esp_timer time base.
+// The exact times are only known within a frame, the start of a frame is estimated from the time we
+// receive it, so inter-arrival times across frames have some us of jitter.
+// A frame only ends after GMC_RMT_IDLE_US without pulses and holds max. ~256 pulses, so this backend
+// is not suited for count rates above a few hundred cps, use GMC_BACKEND_PCNT there.
+
+#define GMC_RMT_CHANNEL RMT_CHANNEL_4
+#define GMC_RMT_MEM_BLOCKS 4       // channels 4..7 memory: 256 items
+#define GMC_RMT_CLK_DIV 40         // 80MHz APB / 40 -> 0.5us ticks
+#define GMC_RMT_TICKS_PER_US 2
+#define GMC_RMT_IDLE_US 15000      // end of frame, must fit into 15 bits of ticks
+#define GMC_RMT_FILTER 255         // ignore spikes shorter than 255 APB cycles (3.2us)
+#define GMC_RMT_ACTIVE_LEVEL 0     // a GM pulse starts with a falling edge
+#define GMC_RMT_RINGBUF_SIZE 4096  // bytes
+
+static uint32_t pulse_ticks_now(void) {
+  return (uint32_t)(esp_timer_get_time() * GMC_RMT_TICKS_PER_US);
+}
+
+static void rmtTask(void *param) {
+  RingbufHandle_t rb = (RingbufHandle_t)param;
+  RmtDecoderState state = {};
+  static uint64_t timestamps[GMC_RMT_MEM_BLOCKS * 64 * 2];  // max. 2 segments per item
+  for (;;) {
+    size_t size = 0;
+    uint32_t *items = (uint32_t *)xRingbufferReceive(rb, &size, portMAX_DELAY);
+    if (!items)
+      continue;
+    // we get the frame GMC_RMT_IDLE_US after its last edge (plus some latency).
+    uint64_t now_ticks = esp_timer_get_time() * GMC_RMT_TICKS_PER_US;
+    size_t n_items = size / sizeof(uint32_t);
+    uint64_t frame_start = now_ticks - GMC_RMT_IDLE_US * GMC_RMT_TICKS_PER_US - rmt_frame_ticks(items, n_items);
+    RmtDecodeResult result = rmt_decode_pulses(items, n_items, frame_start, GMC_RMT_ACTIVE_LEVEL,
+                             GMC_DEAD_TIME * GMC_RMT_TICKS_PER_US, &state,
+                             timestamps, sizeof(timestamps) / sizeof(timestamps[0]));
+    vRingbufferReturnItem(rb, items);
+    for (size_t i = 0; i < result.timestamps; i++)
+      pulse_ring.push((uint32_t)timestamps[i]);
+    // no per-pulse interrupt, the tick engine spreads the clicks of a frame
+    if (result.counts)
+      tick(result.counts);
+  }
+}
+
+static void setup_GMC_count(void) {
+  pulse_intervals.begin(GMC_RMT_TICKS_PER_US, millis());
+
+  rmt_config_t cfg = RMT_DEFAULT_CONFIG_RX((gpio_num_t)PIN_GMC_COUNT_INPUT, GMC_RMT_CHANNEL);
+  cfg.mem_block_num = GMC_RMT_MEM_BLOCKS;
+  cfg.clk_div = GMC_RMT_CLK_DIV;
+  cfg.rx_config.filter_en = true;
+  cfg.rx_config.filter_ticks_thresh = GMC_RMT_FILTER;
+  cfg.rx_config.idle_threshold = GMC_RMT_IDLE_US * GMC_RMT_TICKS_PER_US;
+  rmt_config(&cfg);
+  rmt_driver_install(GMC_RMT_CHANNEL, GMC_RMT_RINGBUF_SIZE, 0);
+
+  RingbufHandle_t rb = nullptr;
+  rmt_get_ringbuf_handle(GMC_RMT_CHANNEL, &rb);
+  xTaskCreatePinnedToCore(rmtTask, "rmtTask", 4096, rb, 2, NULL, COUNTING_CPU);
+  rmt_rx_start(GMC_RMT_CHANNEL, true);
+}
+
+#elif GMC_COUNT_BACKEND == GMC_BACKEND_PCNT
+
+// The PCNT hardware counts the pulses, the cpu only gets interrupted when the 16bit counter overflows.
+// We only count falling edges: the rising edge is what generated the false pulses the software dead time
+// check was needed for. The PCNT glitch filter (max. 1023 APB cycles == 12.8us) suppresses short spikes,
+// it can not cover the full GMC_DEAD_TIME though.
+
+#define GMC_PCNT_UNIT PCNT_UNIT_0
+#define GMC_PCNT_LIMIT 32767
+#define GMC_PCNT_FILTER 1023  // [APB cycles]
+
+static int16_t pcnt_hal_read(void) {
+  int16_t value = 0;
+  pcnt_get_counter_value(GMC_PCNT_UNIT, &value);
+  return value;
+}
+
+static void pcnt_hal_clear(void) {
+  pcnt_counter_clear(GMC_PCNT_UNIT);
+}
+
+static const PcntHal pcnt_hal = {pcnt_hal_read, pcnt_hal_clear};
+static PcntCounter pcnt_counter(pcnt_hal, GMC_PCNT_LIMIT);
+
+static uint32_t consumed_pulses;
+static unsigned long last_pulse_ms;
+
+static void IRAM_ATTR isr_GMC_overflow(void * /*arg*/) {
+  pcnt_counter.onOverflow();
+}
+
+void set_pulse_handler(PulseBatchHandler /*handler*/) {
+  // no per-pulse timestamps with the hardware counter
 }
 
 void read_GMC(unsigned long *counts, unsigned long *timestamp, unsigned int *between) {
-  portENTER_CRITICAL(&mux_GMC_count);
-  *counts += isr_GMC_counts;
-  isr_GMC_counts = 0;
-  *timestamp = isr_count_timestamp;
-  *between = isr_count_time_between;
-  portEXIT_CRITICAL(&mux_GMC_count);
+  uint32_t total = pcnt_counter.total();
+  if (total != consumed_pulses) {
+    // best we can do without per-pulse timestamps: the time we noticed the pulse(s)
+    last_pulse_ms = millis();
+    tick(total - consumed_pulses);  // the tick engine spreads them (or plays a tone at high rates)
+    *counts += total - consumed_pulses;
+    consumed_pulses = total;
+  }
+  *timestamp = last_pulse_ms;
+  *between = 0;
+}
+
+void read_pulse_ring_stats(PulseRingStats *stats) {
+  *stats = {};
+}
+
+static void setup_GMC_count(void) {
+  pcnt_config_t cfg = {};
+  cfg.pulse_gpio_num = PIN_GMC_COUNT_INPUT;
+  cfg.ctrl_gpio_num = PCNT_PIN_NOT_USED;
+  cfg.channel = PCNT_CHANNEL_0;
+  cfg.unit = GMC_PCNT_UNIT;
+  cfg.pos_mode = PCNT_COUNT_DIS;  // rising edge: ignore
+  cfg.neg_mode = PCNT_COUNT_INC;  // falling edge: count
+  cfg.lctrl_mode = PCNT_MODE_KEEP;
+  cfg.hctrl_mode = PCNT_MODE_KEEP;
+  cfg.counter_h_lim = GMC_PCNT_LIMIT;
+  cfg.counter_l_lim = 0;
+  pcnt_unit_config(&cfg);
+
+  pcnt_set_filter_value(GMC_PCNT_UNIT, GMC_PCNT_FILTER);
+  pcnt_filter_enable(GMC_PCNT_UNIT);
+
+  pcnt_counter_pause(GMC_PCNT_UNIT);
+  pcnt_counter.begin();
+  pcnt_event_enable(GMC_PCNT_UNIT, PCNT_EVT_H_LIM);
+  pcnt_isr_service_install(0);
+  pcnt_isr_handler_add(GMC_PCNT_UNIT, isr_GMC_overflow, NULL);
+  pcnt_counter_resume(GMC_PCNT_UNIT);
+}
+
+#else
+#error "unsupported GMC_COUNT_BACKEND"
+#endif
+
+static void setup_tube_interrupts(void) {
+  // interrupts are served by the core which allocates them: this runs on COUNTING_CPU
+  setup_GMC_count();
+  attachInterrupt(PIN_HV_CAP_FULL_INPUT, isr_GMC_capacitor_full, CHANGE);
+  setup_recharge_timer(isr_recharge, 1000);  // start charging right away
 }
 
 void setup_tube(void) {
@@ -251,7 +454,5 @@ void setup_tube(void) {
   pinMode(PIN_HV_CAP_FULL_INPUT, INPUT);  // !! has to be capable of "interrupt on change"
   pinMode(PIN_GMC_COUNT_INPUT, INPUT);    // !! has to be capable of "interrupt on change"
 
-  attachInterrupt(PIN_GMC_COUNT_INPUT, isr_GMC_count, CHANGE);
-  attachInterrupt(PIN_HV_CAP_FULL_INPUT, isr_GMC_capacitor_full, CHANGE);
-  setup_recharge_timer(isr_recharge, TUBE_PERIOD_DURATION_US);
+  run_on_core(COUNTING_CPU, setup_tube_interrupts);
 }
@@ -18,6 +18,28 @@
 #include "core/core.hpp"
 #include "drivers/io/io.hpp"
 #include "config/config.hpp"
+#include "drivers/sensors/pulse_ring.hpp"
+#include "drivers/sensors/pcnt_counter.hpp"
+#include "drivers/sensors/rmt_decoder.hpp"
+#include "drivers/sensors/hv_charger.hpp"
+#include "core/log2_histogram.hpp"
+
+// GMC_COUNT_BACKEND values: how GM pulses get counted
+#define GMC_BACKEND_ISR 0   // GPIO interrupt per edge, software dead time, per-pulse timestamps
+#define GMC_BACKEND_PCNT 1  // PCNT hardware counter, no per-pulse timestamps, ticks per read_GMC batch
+#define GMC_BACKEND_RMT 2   // RMT receiver captures edges, decoded in batches, sub-us timestamps
+
+#ifndef GMC_COUNT_BACKEND
+#define GMC_COUNT_BACKEND GMC_BACKEND_ISR
+#endif
+
+// Amount of pulse timestamps buffered between isr_GMC_count and read_GMC (power of 2).
+#ifndef PULSE_RING_SIZE
+#define PULSE_RING_SIZE 1024
+#endif
+
+// Amount of pulses read_GMC moves out of the ring and hands to the pulse handler at once.
+#define PULSE_BATCH_SIZE 64
 
 /**
  * @struct TUBETYPE
@@ -31,9 +53,51 @@ typedef struct {
 
 extern TUBETYPE tubes[];
 
+/**
+ * @struct PulseRingStats
+ * @brief Fill and overflow counters of the pulse timestamp ring
+ */
+typedef struct {
+  uint32_t accepted;    ///< pulses stored into the ring since boot
+  uint32_t dropped;     ///< pulses counted, but not timestamped, because the ring was full
+  uint32_t high_water;  ///< highest fill level seen by read_GMC
+  uint32_t capacity;    ///< ring size
+} PulseRingStats;
+
+// Charge pulses needed per HV recharge: exact up to 3, then 1/4 octave buckets up to 4095 (MAX_CHARGE_PULSES)
+typedef Log2Histogram<2, 12> HvPulseHistogram;
+
+// Amount of HV charge failure times kept
+#define HV_FAIL_HISTORY 4
+
+/**
+ * @struct HvTelemetry
+ * @brief State and history of the HV supply since boot, updated by the recharge ISR
+ */
+typedef struct {
+  uint32_t interval_us;               ///< current time between recharges
+  uint32_t interval_min_us;           ///< shortest / longest time between recharges the controller chose
+  uint32_t interval_max_us;
+  uint64_t interval_sum_us;           ///< sum of all chosen times between recharges (mean = sum / recharges)
+  uint32_t recharges;                 ///< successful recharges
+  HvPulseHistogram pulses;            ///< charge pulses per successful recharge
+  uint32_t failures;                  ///< failed recharges (capacitor did not get full)
+  uint32_t fail_ms[HV_FAIL_HISTORY];  ///< uptime [ms] of the latest failures, newest first
+} HvTelemetry;
+
+// Called by read_GMC with a batch of times between consecutive valid pulses [us], oldest first.
+typedef void (*PulseBatchHandler)(const uint32_t *intervals_us, size_t count);
+
 void setup_tube(void);
 void read_GMC(unsigned long *counts, unsigned long *timestamp, unsigned int *between);
+void set_pulse_handler(PulseBatchHandler handler);
+void read_pulse_ring_stats(PulseRingStats *stats);
 void read_hv(bool *hv_error, unsigned long *pulses);
+void read_hv_telemetry(HvTelemetry *telemetry);
+int format_hv_telemetry(const HvTelemetry *telemetry, uint32_t now_ms, char *buf, size_t len);
+
+// Buffer size format_hv_telemetry needs in the worst case
+#define HV_TELEMETRY_JSON_LEN (HvPulseHistogram::JSON_MAX_LEN + 256)
 
 bool setup_thp_sensor(void);
 bool read_thp_sensor(float *temperature, float *humidity, float *pressure);
@@ -46,5 +110,8 @@ public:
 
   void beginTube() { setup_tube(); }
   void readTube(unsigned long &counts, unsigned long &timestamp, unsigned int &between) { read_GMC(&counts, &timestamp, &between); }
+  void onPulses(PulseBatchHandler handler) { set_pulse_handler(handler); }
+  void readPulseRingStats(PulseRingStats &stats) { read_pulse_ring_stats(&stats); }
   void readHv(bool &hvError, unsigned long &pulses) { read_hv(&hvError, &pulses); }
+  void readHvTelemetry(HvTelemetry &telemetry) { read_hv_telemetry(&telemetry); }
 };
@@ -0,0 +1,251 @@
+#include "archive.hpp"
+
+#include "core/core.hpp"
+
+#define ARCHIVE_DIR "/archive"
+
+void Archive::path(char *buf, uint32_t n, const char *suffix) {
+  snprintf(buf, 32, ARCHIVE_DIR "/%08lx.%s", (unsigned long)n, suffix);
+}
+
+bool Archive::begin() {
+  if (!mount_storage())
+    return false;
+  if (!LittleFS.exists(ARCHIVE_DIR))
+    LittleFS.mkdir(ARCHIVE_DIR);
+
+  // find the index files, sorted by number
+  File dir = LittleFS.open(ARCHIVE_DIR);
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    unsigned long n;
+    char suffix[4];
+    const char *name = strrchr(f.name(), '/') ? strrchr(f.name(), '/') + 1 : f.name();
+    if ((sscanf(name, "%8lx.%3s", &n, suffix) != 2) || strcmp(suffix, "idx"))
+      continue;
+    if (file_count == ARCHIVE_MAX_FILES) {
+      LOG(WARNING, "Archive: more than %d files, ignoring %s", ARCHIVE_MAX_FILES, name);
+      continue;
+    }
+    int i = file_count++;
+    while ((i > 0) && (files[i - 1].n > n)) {
+      files[i] = files[i - 1];
+      i--;
+    }
+    files[i].n = n;
+  }
+  dir.close();
+
+  // time of the first block and size of each data file, drop pairs without a block
+  char name[32];
+  for (int i = 0; i < file_count;) {
+    ArchiveIndexEntry entry;
+    path(name, files[i].n, "idx");
+    File index = LittleFS.open(name, "r");
+    bool ok = index && readEntry(index, 0, entry);
+    index.close();
+    path(name, files[i].n, "dat");
+    File data = LittleFS.open(name, "r");
+    files[i].bytes = data ? data.size() : 0;
+    data.close();
+    if (ok) {
+      files[i].first_t = entry.first_t;
+      i++;
+      continue;
+    }
+    LittleFS.remove(name);
+    path(name, files[i].n, "idx");
+    LittleFS.remove(name);
+    for (int j = i; j < file_count - 1; j++)
+      files[j] = files[j + 1];
+    file_count--;
+  }
+  ready = true;
+  LOG(INFO, "Archive: %d files, %u bytes", file_count, bytes());
+  return true;
+}
+
+uint32_t Archive::bytes() const {
+  uint32_t sum = 0;
+  for (int i = 0; i < file_count; i++)
+    sum += files[i].bytes;
+  return sum;
+}
+
+bool Archive::add(const MeasurementRecord &m) {
+  // only a copy, the flash write is done by write() in its own stage
+  if (!ready)
+    return false;
+  if (pending_count == ARCHIVE_BLOCK_RECORDS)
+    write();  // the stage did not run yet
+  pending[pending_count++] = archive_record(m);
+  return pending_count == ARCHIVE_BLOCK_RECORDS;
+}
+
+void Archive::write() {
+  if (!ready || !pending_count)
+    return;
+  size_t len = archive_encode(pending, pending_count, block, sizeof(block));
+  ArchiveIndexEntry entry = {
+    .first_t = pending[0].t,
+    .last_t = pending[pending_count - 1].t,
+    .offset = 0,
+    .length = (uint16_t)len,
+    .count = (uint16_t)pending_count
+  };
+  pending_count = 0;
+  if (!len) {
+    write_errors++;
+    LOG(ERROR, "Archive: block does not fit into %u bytes, %u records lost", (unsigned)sizeof(block), entry.count);
+    return;
+  }
+  if (!file_count || (files[file_count - 1].bytes + len > ARCHIVE_FILE_BYTES))
+    newFile(entry.first_t);
+  while ((file_count > 1) && (bytes() + len > ARCHIVE_MAX_BYTES))
+    dropOldest();
+  if (!append(block, len, entry) && (file_count > 1)) {
+    // flash full (e.g. other files on the partition): make space and try once more
+    dropOldest();
+    if (!append(block, len, entry))
+      write_errors++;
+  }
+}
+
+void Archive::newFile(uint32_t first_t) {
+  if (file_count == ARCHIVE_MAX_FILES)
+    dropOldest();
+  DataFile &f = files[file_count];
+  f.n = file_count ? files[file_count - 1].n + 1 : 0;
+  f.first_t = first_t;
+  f.bytes = 0;
+  file_count++;
+}
+
+void Archive::dropOldest() {
+  char name[32];
+  path(name, files[0].n, "dat");
+  LittleFS.remove(name);
+  path(name, files[0].n, "idx");
+  LittleFS.remove(name);
+  LOG(INFO, "Archive: dropped file %u (records since %u)", files[0].n, files[0].first_t);
+  for (int i = 0; i < file_count - 1; i++)
+    files[i] = files[i + 1];
+  file_count--;
+}
+
+bool Archive::append(const uint8_t *data, size_t len, const ArchiveIndexEntry &entry) {
+  // data first: if the index entry is missing after a reset, the block is just not found
+  DataFile &f = files[file_count - 1];
+  char name[32];
+  path(name, f.n, "dat");
+  File dat = LittleFS.open(name, "a");
+  if (!dat) {
+    LOG(ERROR, "Archive: can't open %s", name);
+    return false;
+  }
+  ArchiveIndexEntry e = entry;
+  e.offset = dat.size();
+  size_t written = dat.write(data, len);
+  dat.close();
+  if (written != len) {
+    LOG(ERROR, "Archive: writing %s failed (%u of %u bytes)", name, (unsigned)written, (unsigned)len);
+    return false;
+  }
+  f.bytes = e.offset + len;
+
+  path(name, f.n, "idx");
+  File idx = LittleFS.open(name, "a");
+  written = idx ? idx.write(reinterpret_cast<const uint8_t *>(&e), sizeof(e)) : 0;
+  idx.close();
+  if (written != sizeof(e)) {
+    LOG(ERROR, "Archive: writing %s failed", name);
+    return false;
+  }
+  blocks_written++;
+  LOG(DEBUG, "Archive: %u records, %u bytes -> file %u", e.count, (unsigned)len, f.n);
+  return true;
+}
+
+bool Archive::readEntry(File &index, size_t i, ArchiveIndexEntry &entry) {
+  return index.seek(i * sizeof(entry)) &&
+         (index.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry)) == sizeof(entry));
+}
+
+static void print_record(ChunkWriter &out, const ArchiveRecord &r, bool &first) {
+  out.printf("%s[%u,%u,%u,%u,%u,", first ? "" : ",", r.t, r.dt_ms, r.counts, r.hv_pulses, r.status);
+  if (r.status & MEAS_THP_VALID)
+    out.printf("%.2f,%.1f,%.1f]", r.temperature, r.humidity, r.pressure);
+  else
+    out.printf("null,null,null]");
+  first = false;
+}
+
+void Archive::query(uint32_t from_s, uint32_t to_s, ChunkOutput output, void *context) {
+  ChunkWriter out(output, context);
+  out.printf("{\"files\":%d,\"bytes\":%u,\"records\":[", file_count, bytes());
+  bool first = true;
+
+  // the first file which may hold from_s: the last one starting at or before it
+  int start = 0;
+  while ((start + 1 < file_count) && (files[start + 1].first_t <= from_s))
+    start++;
+  char name[32];
+  bool done = false;
+  int blocks = 0;
+  uint32_t next = 0;  // first_t of the block the query stopped at, 0: complete
+  for (int i = start; (i < file_count) && !done && (files[i].first_t <= to_s); i++) {
+    path(name, files[i].n, "idx");
+    File idx = LittleFS.open(name, "r");
+    path(name, files[i].n, "dat");
+    File dat = LittleFS.open(name, "r");
+    if (!idx || !dat)
+      continue;
+
+    // binary search: the first block ending at or after from_s
+    ArchiveIndexEntry entry;
+    size_t lo = 0, hi = idx.size() / sizeof(entry);
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (!readEntry(idx, mid, entry))
+        break;
+      if (entry.last_t < from_s)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    for (size_t b = lo; readEntry(idx, b, entry); b++) {
+      if (entry.first_t > to_s) {
+        done = true;
+        break;
+      }
+      if (blocks == ARCHIVE_QUERY_BLOCKS) {
+        next = entry.first_t;  // the client continues from here with another request
+        done = true;
+        break;
+      }
+      blocks++;
+      ArchiveDecoder decoder;
+      if ((entry.length > sizeof(block)) || !dat.seek(entry.offset) ||
+          (dat.read(block, entry.length) != entry.length) || !decoder.begin(block, entry.length)) {
+        LOG(WARNING, "Archive: block %u of file %u is unreadable", (unsigned)b, files[i].n);
+        continue;
+      }
+      ArchiveRecord r;
+      while (decoder.next(r)) {
+        if ((r.t >= from_s) && (r.t <= to_s))
+          print_record(out, r, first);
+      }
+    }
+    idx.close();
+    dat.close();
+  }
+
+  // and what is not written yet
+  for (size_t i = 0; !next && (i < pending_count); i++) {
+    if ((pending[i].t >= from_s) && (pending[i].t <= to_s))
+      print_record(out, pending[i], first);
+  }
+  if (next)
+    out.printf("],\"next\":%u}", next);
+  else
+    out.printf("],\"next\":null}");
+}
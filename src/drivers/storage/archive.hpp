@@ -0,0 +1,113 @@
+/**
+ * @file archive.hpp
+ * @brief Long-term archive of the interval records on the LittleFS partition
+ *
+ * Interval records are collected in RAM until ARCHIVE_BLOCK_RECORDS are there (~2.4 h),
+ * then compressed into one block (core/archive_codec.hpp, typically 6 - 15 bytes per record)
+ * and appended to the current data file, so there is one flash write per block instead of
+ * one per record. Data files are rotated at ARCHIVE_FILE_BYTES, the oldest file is deleted
+ * when the archive would exceed ARCHIVE_MAX_BYTES (default 1 MB: 2 - 6 months).
+ *
+ * Next to every data file (/archive/<n>.dat) an index file (<n>.idx) has a fixed size
+ * ArchiveIndexEntry per block, time ordered, so a range query finds its first file in RAM,
+ * its first block by binary search in the index and then seeks to it directly.
+ *
+ * Records still in RAM are lost on power loss / reset. All methods run in networkTask
+ * (the interval sinks, the archive stage and the web server), never in the counting task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "config/config.hpp"
+#include "drivers/storage/storage.hpp"
+#include "core/archive_codec.hpp"
+#include "core/chunk_writer.hpp"
+#include "core/measurement.hpp"
+
+#ifndef ARCHIVE_ENABLED
+#define ARCHIVE_ENABLED 1
+#endif
+
+// Records per block (interval records: every 90 s).
+#ifndef ARCHIVE_BLOCK_RECORDS
+#define ARCHIVE_BLOCK_RECORDS 96
+#endif
+
+// Start a new data file when the current one would get larger. [bytes]
+#ifndef ARCHIVE_FILE_BYTES
+#define ARCHIVE_FILE_BYTES 65536
+#endif
+
+// Delete the oldest data files when the archive would get larger. [bytes]
+#ifndef ARCHIVE_MAX_BYTES
+#define ARCHIVE_MAX_BYTES 1048576
+#endif
+
+// Max. blocks one query decodes (~38 h), larger ranges take several requests. It runs in networkTask.
+#ifndef ARCHIVE_QUERY_BLOCKS
+#define ARCHIVE_QUERY_BLOCKS 16
+#endif
+
+#define ARCHIVE_MAX_FILES (ARCHIVE_MAX_BYTES / ARCHIVE_FILE_BYTES + 2)
+
+/**
+ * @struct ArchiveIndexEntry
+ * @brief Where a block is and which time span it covers (16 bytes in the index file)
+ */
+struct ArchiveIndexEntry {
+  uint32_t first_t;  ///< utc [s] of the first record
+  uint32_t last_t;   ///< utc [s] of the last record
+  uint32_t offset;   ///< in the data file [bytes]
+  uint16_t length;   ///< [bytes]
+  uint16_t count;    ///< records
+};
+
+class Archive {
+public:
+  /** @brief Mount LittleFS (see mount_storage()) and find the archive files */
+  bool begin();
+
+  /** @brief Collect an interval record, true if the block is full and write() should run */
+  bool add(const MeasurementRecord &m);
+
+  /** @brief Compress the collected records and append them to the archive */
+  void write();
+
+  /**
+   * @brief Write the records from from_s to to_s (incl. the ones still in RAM) as JSON:
+   *   {"files":2,"bytes":81234,"records":[[t,dt_ms,counts,hv_pulses,status,temperature,humidity,pressure],...],"next":null}
+   *
+   * At most ARCHIVE_QUERY_BLOCKS blocks are decoded, if the range has more, "next" is the time
+   * to continue from (as from_s of the next query), otherwise null.
+   */
+  void query(uint32_t from_s, uint32_t to_s, ChunkOutput output, void *context);
+
+  bool mounted() const { return ready; }
+  uint32_t bytes() const;
+  uint32_t blocksWritten() const { return blocks_written; }
+  uint32_t writeErrors() const { return write_errors; }
+
+private:
+  struct DataFile {
+    uint32_t n;        // file number, the names are /archive/<n as %08x>.dat / .idx
+    uint32_t first_t;  // of the first block
+    uint32_t bytes;    // size of the data file
+  };
+
+  void newFile(uint32_t first_t);
+  void dropOldest();
+  bool append(const uint8_t *block, size_t len, const ArchiveIndexEntry &entry);
+  bool readEntry(File &index, size_t i, ArchiveIndexEntry &entry);
+  static void path(char *buf, uint32_t n, const char *suffix);
+
+  bool ready = false;
+  DataFile files[ARCHIVE_MAX_FILES] = {};
+  int file_count = 0;
+  ArchiveRecord pending[ARCHIVE_BLOCK_RECORDS];
+  size_t pending_count = 0;
+  uint8_t block[ARCHIVE_BLOCK_BOUND(ARCHIVE_BLOCK_RECORDS)];  // write() and query()
+  uint32_t blocks_written = 0;
+  uint32_t write_errors = 0;
+};
@@ -0,0 +1,180 @@
+#include "outbox.hpp"
+
+#include "core/core.hpp"
+#include "core/crc32.hpp"
+
+#define OUTBOX_DIR "/outbox"
+
+static const size_t RECORD_CRC_LEN = offsetof(OutboxRecord, crc);
+
+OutboxRecord outbox_record(const MeasurementRecord &m) {
+  OutboxRecord r = {};
+  r.utc = (uint32_t)m.utc;
+  r.dt_ms = m.dt_ms;
+  r.counts = m.counts;
+  r.hv_pulses = m.hv_pulses;
+  r.cpm = m.cpm;
+  r.temperature = m.temperature;
+  r.humidity = m.humidity;
+  r.pressure = m.pressure;
+  r.status = m.status;
+  r.tube_nbr = m.tube_nbr;
+  return r;
+}
+
+static bool valid(const OutboxRecord &r) {
+  return r.seq && (r.crc == crc32(&r, RECORD_CRC_LEN));
+}
+
+bool Outbox::begin(const char *uplink, uint32_t max_age) {
+  max_age_s = max_age;
+  if (!mount_storage())
+    return false;
+  if (!LittleFS.exists(OUTBOX_DIR))
+    LittleFS.mkdir(OUTBOX_DIR);
+  snprintf(name, sizeof(name), OUTBOX_DIR "/%s.dat", uplink);
+  snprintf(ack_name, sizeof(ack_name), OUTBOX_DIR "/%s.ack", uplink);
+
+  // the last delivered record
+  uint32_t delivered = 0;
+  File ack = LittleFS.open(ack_name, "r");
+  uint32_t v[2];
+  if (ack && (ack.read(reinterpret_cast<uint8_t *>(v), sizeof(v)) == sizeof(v)) && (v[1] == crc32(&v[0], sizeof(v[0]))))
+    delivered = v[0];
+  ack.close();
+
+  // the records after it, wherever they are in the ring
+  uint32_t first = 0, last = delivered;
+  File f = LittleFS.open(name, "r");
+  if (f) {
+    OutboxRecord r;
+    while (f.read(reinterpret_cast<uint8_t *>(&r), sizeof(r)) == sizeof(r)) {
+      if (!valid(r) || (r.seq <= delivered))
+        continue;
+      if (!first || (r.seq < first))
+        first = r.seq;
+      if (r.seq > last)
+        last = r.seq;
+    }
+    f.close();
+  } else {
+    f = LittleFS.open(name, "w");  // r+ needs an existing file
+    f.close();
+  }
+  head = first ? first : last + 1;
+  tail = last + 1;
+  if (tail - head > OUTBOX_SLOTS)
+    head = tail - OUTBOX_SLOTS;
+  stats.high_water = tail - head;
+  ready = true;
+  LOG(INFO, "Outbox %s: %u records waiting", name, tail - head);
+  return true;
+}
+
+uint32_t Outbox::depth() {
+  SpinLockGuard guard(lock);
+  return tail - head;
+}
+
+bool Outbox::store(const OutboxRecord &record) {
+  OutboxRecord r = record;
+  r.seq = tail;
+  r.crc = crc32(&r, RECORD_CRC_LEN);
+  File f = LittleFS.open(name, "r+");
+  bool ok = f && f.seek((r.seq % OUTBOX_SLOTS) * sizeof(r)) &&
+            (f.write(reinterpret_cast<const uint8_t *>(&r), sizeof(r)) == sizeof(r));
+  f.close();
+  SpinLockGuard guard(lock);
+  if (!ok) {
+    stats.dropped++;
+    return false;
+  }
+  stats.stored++;
+  tail++;
+  if (tail - head > OUTBOX_SLOTS) {
+    head = tail - OUTBOX_SLOTS;  // the oldest one was overwritten
+    stats.dropped++;
+  }
+  if (tail - head > stats.high_water)
+    stats.high_water = tail - head;
+  return true;
+}
+
+bool Outbox::deliver(const MeasurementRecord &m, bool online, OutboxSend send, void *context) {
+  OutboxRecord r = outbox_record(m);
+  if (online && (head == tail) && send(r, context))
+    return true;
+  // offline, failed or older records first: keep it for drain()
+  if (ready && !store(r))
+    LOG(ERROR, "Outbox %s: can't store record", name);
+  return false;
+}
+
+bool Outbox::readSlot(uint32_t seq, OutboxRecord &r) {
+  File f = LittleFS.open(name, "r");
+  bool ok = f && f.seek((seq % OUTBOX_SLOTS) * sizeof(r)) &&
+            (f.read(reinterpret_cast<uint8_t *>(&r), sizeof(r)) == sizeof(r));
+  f.close();
+  return ok && valid(r) && (r.seq == seq);
+}
+
+void Outbox::writeAck() {
+  uint32_t v[2] = {head - 1, 0};
+  v[1] = crc32(&v[0], sizeof(v[0]));
+  File f = LittleFS.open(ack_name, "w");
+  if (!f || (f.write(reinterpret_cast<const uint8_t *>(v), sizeof(v)) != sizeof(v)))
+    LOG(ERROR, "Outbox: writing %s failed, records may be sent twice", ack_name);
+  f.close();
+}
+
+void Outbox::countReplayed(uint32_t n) {
+  uint32_t now = millis();
+  SpinLockGuard guard(lock);
+  stats.replayed += n;
+  if (now - minute_start_ms >= 60000) {
+    stats.drain_per_min = (now - minute_start_ms < 120000) ? minute_count : 0;
+    minute_start_ms = now;
+    minute_count = 0;
+  }
+  minute_count += n;
+}
+
+size_t Outbox::drain(OutboxSend send, void *context) {
+  if (!ready || (head == tail) || (millis() - last_drain_ms < OUTBOX_DRAIN_MS))
+    return 0;
+  last_drain_ms = millis();
+  uint32_t now_s = time(nullptr);
+  uint32_t start = head;
+  size_t sent = 0;
+  while ((head != tail) && (sent < OUTBOX_BATCH)) {
+    OutboxRecord r;
+    bool ok = readSlot(head, r);
+    bool expired = ok && max_age_s && (r.status & MEAS_TIME_VALID) && (now_s > CLOCK_VALID_AFTER) &&
+                   (now_s - r.utc > max_age_s);
+    if (ok && !expired && !send(r, context))
+      break;  // still offline, try again with the next batch
+    SpinLockGuard guard(lock);
+    head++;
+    if (!ok)
+      stats.lost++;
+    else if (expired)
+      stats.expired++;
+    else
+      sent++;
+  }
+  if (head != start)
+    writeAck();
+  countReplayed(sent);
+  if (sent)
+    LOG(INFO, "Outbox %s: %u records replayed, %u waiting", name, (unsigned)sent, tail - head);
+  return sent;
+}
+
+void Outbox::readStats(OutboxStats &s) {
+  uint32_t now = millis();
+  SpinLockGuard guard(lock);
+  s = stats;
+  s.depth = tail - head;
+  if (now - minute_start_ms >= 120000)
+    s.drain_per_min = 0;  // nothing replayed for a while
+}
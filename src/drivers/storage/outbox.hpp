@@ -0,0 +1,119 @@
+/**
+ * @file outbox.hpp
+ * @brief Store-and-forward of interval records for an uplink which is offline
+ *
+ * Every uplink (Madavi, sensor.community, MQTT) has its own outbox. A record is sent
+ * directly if the uplink is online and its outbox is empty, otherwise (or if sending fails)
+ * it is stored. drain() replays the stored records oldest first, at most OUTBOX_BATCH of them
+ * every OUTBOX_DRAIN_MS, and stops at the first failure.
+ *
+ * The records live in a ring of OUTBOX_SLOTS fixed size slots in /outbox/<name>.dat, slot
+ * seq % OUTBOX_SLOTS, each with its own CRC; /outbox/<name>.ack has the last delivered
+ * sequence number (written once per batch). After a reset, the slots are scanned: valid
+ * records after the delivered one are the backlog again. Sequence numbers continue across
+ * resets, so a record is never replayed twice unless the ack write itself failed; receivers
+ * which see the seq (MQTT) can drop those duplicates. When the ring is full, the oldest
+ * record is overwritten.
+ *
+ * An outbox is used by one task only (the one of its uplink); readStats() may be called
+ * from any task.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "config/config.hpp"
+#include "drivers/storage/storage.hpp"
+#include "core/measurement.hpp"
+#include "core/spinlock.hpp"
+
+// Stored records per uplink (interval records: every 90 s, 480 = 12 h), 48 bytes each.
+#ifndef OUTBOX_SLOTS
+#define OUTBOX_SLOTS 480
+#endif
+
+// Replay at most OUTBOX_BATCH records every OUTBOX_DRAIN_MS per uplink. [ms]
+#ifndef OUTBOX_BATCH
+#define OUTBOX_BATCH 5
+#endif
+#ifndef OUTBOX_DRAIN_MS
+#define OUTBOX_DRAIN_MS 30000
+#endif
+
+/**
+ * @struct OutboxRecord
+ * @brief What an uplink sends of an interval record (one slot, 48 bytes)
+ */
+struct OutboxRecord {
+  uint32_t seq;        ///< per outbox, continues across resets, 0: empty slot
+  uint32_t utc;        ///< [s], see MEAS_TIME_VALID
+  uint32_t dt_ms;
+  uint32_t counts;
+  uint32_t hv_pulses;
+  uint32_t cpm;
+  float temperature;
+  float humidity;
+  float pressure;
+  uint16_t status;     ///< MEAS_* bits
+  uint16_t tube_nbr;
+  uint32_t reserved;
+  uint32_t crc;        ///< CRC-32 of everything above
+};
+
+typedef struct {
+  uint32_t depth;          // records waiting now
+  uint32_t high_water;     // most records ever waiting
+  uint32_t stored;         // records which could not be sent directly
+  uint32_t replayed;       // stored records sent later
+  uint32_t dropped;        // overwritten because the outbox was full
+  uint32_t expired;        // older than the max. age of the uplink, not sent
+  uint32_t lost;           // missing / corrupt slots found while replaying
+  uint32_t drain_per_min;  // records replayed in the last full minute
+} OutboxStats;
+
+// Send one record, true if the uplink took it.
+typedef bool (*OutboxSend)(const OutboxRecord &r, void *context);
+
+class Outbox {
+public:
+  /**
+   * @brief Open /outbox/<name>.* and find the backlog left from before the reset
+   * @param max_age_s replay only records younger than this (if the clock is set), 0: all
+   */
+  bool begin(const char *name, uint32_t max_age_s);
+
+  /**
+   * @brief Send m directly if online and nothing is waiting, otherwise (or if that fails) store it
+   * @return true if it was sent
+   */
+  bool deliver(const MeasurementRecord &m, bool online, OutboxSend send, void *context);
+
+  /** @brief Replay the next batch if OUTBOX_DRAIN_MS passed since the last one, returns the records sent */
+  size_t drain(OutboxSend send, void *context);
+
+  /** @brief Records waiting (any task) */
+  uint32_t depth();
+
+  void readStats(OutboxStats &stats);
+
+private:
+  bool store(const OutboxRecord &r);
+  bool readSlot(uint32_t seq, OutboxRecord &r);
+  void writeAck();
+  void countReplayed(uint32_t n);
+
+  bool ready = false;
+  char name[24] = {};
+  char ack_name[24] = {};
+  uint32_t max_age_s = 0;
+  uint32_t head = 1;       // oldest waiting seq
+  uint32_t tail = 1;       // next seq to store
+  uint32_t last_drain_ms = 0;
+  uint32_t minute_start_ms = 0;
+  uint32_t minute_count = 0;
+  SpinLock lock;           // stats (and head / tail for depth())
+  OutboxStats stats{};
+};
+
+OutboxRecord outbox_record(const MeasurementRecord &m);
@@ -0,0 +1,15 @@
+#include "storage.hpp"
+
+#include "core/core.hpp"
+
+bool mount_storage(void) {
+  static int mounted = -1;  // not tried yet
+  if (mounted < 0) {
+    mounted = LittleFS.begin(true);
+    if (mounted)
+      LOG(INFO, "LittleFS: %u of %u bytes used", (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+    else
+      LOG(ERROR, "LittleFS: mount failed, no archive / outbox");
+  }
+  return mounted;
+}
@@ -0,0 +1,10 @@
+// The LittleFS partition ("spiffs" in the partition table) shared by the archive and the uplink outboxes.
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// Mount LittleFS once (formats it if that fails, e.g. on first boot: takes a few seconds),
+// false if there is no usable partition. Call during setup.
+bool mount_storage(void);
@@ -0,0 +1,94 @@
+// AlarmEngine (src/app/alarm_engine.hpp) fed with Poisson batches every 250 ms like the tube stage:
+// - the absolute detector does not alarm below the threshold more often than the configured false
+//   alarm interval allows, whatever the factor,
+// - it detects rates above the threshold,
+// - the relative detector detects a step to factor x baseline about as fast as it expects.
+
+#include "host_test.hpp"
+
+#include <random>
+
+#include "app/alarm_engine.hpp"
+
+#define BATCH_MS 250
+
+// Alarms raised within hours at a constant rate cps (baseline as given, 0: absolute detector only).
+static int alarms(AlarmEngine &engine, double cps, float baseline_cps, double hours, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::poisson_distribution<uint32_t> counts(cps * BATCH_MS / 1000.0);
+  int raised = 0;
+  for (uint64_t t = 0; t < hours * 3600000; t += BATCH_MS)
+    raised += (engine.update(counts(rng), BATCH_MS, baseline_cps) == ALARM_RAISED);
+  return raised;
+}
+
+// Seconds until the alarm at a constant rate cps, 0 if none within an hour.
+static double detection_s(AlarmEngine &engine, double cps, float baseline_cps, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::poisson_distribution<uint32_t> counts(cps * BATCH_MS / 1000.0);
+  for (uint32_t t = BATCH_MS; t <= 3600000; t += BATCH_MS) {
+    if (engine.update(counts(rng), BATCH_MS, baseline_cps) == ALARM_RAISED)
+      return t / 1000.0;
+  }
+  return 0.0;
+}
+
+static void test_below_threshold() {
+  // false alarm interval 1 h: at most one alarm per hour on average at up to 90 % of the threshold
+  const double hours = 100;
+  for (float factor : {3.0f, 10.0f}) {
+    for (double fraction : {0.5, 0.7, 0.9}) {
+      AlarmEngine engine;
+      engine.configure(factor, 10.0f, 1.0f);
+      int n = alarms(engine, 10.0 * fraction, 0.0f, hours, (unsigned)(fraction * 100 + factor));
+      if (fraction <= 0.7)
+        CHECK_EQ(n, 0);
+      else
+        CHECK(n <= hours);
+    }
+  }
+  // the firmware's default interval: no alarm at 90 % within days
+  AlarmEngine engine;
+  engine.configure(3.0f, 10.0f, LOCAL_ALARM_FALSE_ALARM_INTERVAL);
+  CHECK_EQ(alarms(engine, 9.0, 0.0f, 72, 1), 0);
+}
+
+static void test_above_threshold() {
+  // default interval, 1.5 / 2 x the threshold: detected within a minute
+  for (double fraction : {1.5, 2.0}) {
+    double sum = 0.0;
+    for (unsigned run = 0; run < 20; run++) {
+      AlarmEngine engine;
+      engine.configure(3.0f, 10.0f, LOCAL_ALARM_FALSE_ALARM_INTERVAL);
+      double s = detection_s(engine, 10.0 * fraction, 0.0f, run);
+      CHECK(s > 0.0);
+      CHECK(engine.byThreshold());
+      sum += s;
+    }
+    CHECK(sum / 20 < 60.0);
+  }
+}
+
+static void test_relative() {
+  // background 1 cps, step to 3 cps: about the expected detection time, not by the threshold detector
+  double sum = 0.0, expected = 0.0;
+  for (unsigned run = 0; run < 20; run++) {
+    AlarmEngine engine;
+    engine.configure(3.0f, 10.0f, LOCAL_ALARM_FALSE_ALARM_INTERVAL);
+    CHECK_EQ(alarms(engine, 1.0, 1.0f, 1, run), 0);
+    expected = engine.expectedDetectionS();
+    double s = detection_s(engine, 3.0, 1.0f, run + 100);
+    CHECK(s > 0.0);
+    CHECK(!engine.byThreshold());
+    sum += s;
+  }
+  CHECK(expected > 0.0);
+  CHECK_NEAR(sum / 20, expected, 0.5 * expected);
+}
+
+int main() {
+  test_below_threshold();
+  test_above_threshold();
+  test_relative();
+  return host_test_result("alarm_engine");
+}
@@ -0,0 +1,174 @@
+// AudioSequencer (src/drivers/io/audio_sequencer.hpp): step timing of advance() and the pre-emption
+// rules (alarm beats melody, melody beats ticks, the same priority replaces, a lower one waits).
+
+#include "host_test.hpp"
+
+#include "drivers/io/audio_sequencer.hpp"
+
+// {frequency_mHz, volume, led, duration_ms}
+static const int MELODY[][4] = {
+  {440000, 1, 1, 100},
+  {-1, 0, 0, 0},  // LED off right away, speaker unchanged
+  {880000, 0, -1, 50},
+  {0, 0, -1, 200},
+};
+static const int MELODY_2[][4] = {
+  {660000, 1, -1, 30},
+};
+static const int ALARM[][4] = {
+  {3000000, 1, 1, 400},
+  {0, 0, 0, 100},
+};
+
+#define LEN(a) (sizeof(a) / sizeof(a[0]))
+
+static void test_step_timing() {
+  AudioSequencer seq;
+  CHECK(!seq.busy());
+  CHECK(seq.request(MELODY, LEN(MELODY), AUDIO_PRIO_MELODY));
+  AudioStep s = seq.advance(1000);
+  CHECK(seq.busy());
+  CHECK_EQ(s.frequency_mHz, 440000);
+  CHECK_EQ(s.volume, 1);
+  CHECK_EQ(s.led, 1);
+  CHECK_EQ(s.delay_ms, 100);
+
+  // woken up early: nothing changes, call again when the note ends
+  s = seq.advance(1040);
+  CHECK_EQ(s.frequency_mHz, -1);
+  CHECK_EQ(s.led, -1);
+  CHECK_EQ(s.delay_ms, 60);
+
+  // a note of 0 ms is merged into the next one
+  s = seq.advance(1100);
+  CHECK_EQ(s.frequency_mHz, 880000);
+  CHECK_EQ(s.volume, 0);
+  CHECK_EQ(s.led, 0);
+  CHECK_EQ(s.delay_ms, 50);
+
+  // late: the next note still lasts its full duration
+  s = seq.advance(1160);
+  CHECK_EQ(s.frequency_mHz, 0);
+  CHECK_EQ(s.led, -1);
+  CHECK_EQ(s.delay_ms, 200);
+
+  // end of sequence: speaker and LED off, nothing scheduled
+  s = seq.advance(1360);
+  CHECK_EQ(s.frequency_mHz, 0);
+  CHECK_EQ(s.led, 0);
+  CHECK_EQ(s.delay_ms, 0);
+  CHECK(!seq.busy());
+  CHECK_EQ(seq.current(), AUDIO_PRIO_TICK);
+  CHECK_EQ(seq.preempted(), 0);
+}
+
+static void test_millis_wrap() {
+  AudioSequencer seq;
+  seq.request(ALARM, LEN(ALARM), AUDIO_PRIO_ALARM);
+  AudioStep s = seq.advance(0xFFFFFF00u);
+  CHECK_EQ(s.delay_ms, 400);
+  s = seq.advance(0xFFFFFF00u + 200);  // wrapped, still early
+  CHECK_EQ(s.frequency_mHz, -1);
+  CHECK_EQ(s.delay_ms, 200);
+  s = seq.advance(0xFFFFFF00u + 400);
+  CHECK_EQ(s.frequency_mHz, 0);
+  CHECK_EQ(s.delay_ms, 100);
+}
+
+static void test_invalid_requests() {
+  AudioSequencer seq;
+  CHECK(!seq.request(MELODY, LEN(MELODY), AUDIO_PRIO_TICK));
+  CHECK(!seq.request(nullptr, 1, AUDIO_PRIO_MELODY));
+  CHECK(!seq.request(MELODY, 0, AUDIO_PRIO_ALARM));
+  AudioStep s = seq.advance(0);
+  CHECK(!seq.busy());
+  CHECK_EQ(s.delay_ms, 0);
+}
+
+static void test_alarm_preempts_melody() {
+  AudioSequencer seq;
+  seq.request(MELODY, LEN(MELODY), AUDIO_PRIO_MELODY);
+  seq.advance(0);
+  CHECK(seq.request(ALARM, LEN(ALARM), AUDIO_PRIO_ALARM));  // starts right away
+  AudioStep s = seq.advance(30);  // the alarm cuts the melody's first note short
+  CHECK_EQ(seq.current(), AUDIO_PRIO_ALARM);
+  CHECK_EQ(s.frequency_mHz, 3000000);
+  CHECK_EQ(s.delay_ms, 400);
+  CHECK_EQ(seq.preempted(), 1);
+  s = seq.advance(430);
+  s = seq.advance(530);
+  CHECK_EQ(s.delay_ms, 0);  // the melody was dropped, not resumed
+  CHECK(!seq.busy());
+}
+
+static void test_melody_preempts_ticks() {
+  AudioSequencer seq;
+  CHECK(!seq.busy());  // ticks may use the speaker
+  CHECK(seq.request(MELODY_2, LEN(MELODY_2), AUDIO_PRIO_MELODY));
+  seq.advance(0);
+  CHECK(seq.busy());   // now they must not
+  CHECK_EQ(seq.preempted(), 0);  // ticks are no sequence
+  seq.advance(30);
+  CHECK(!seq.busy());
+}
+
+static void test_same_priority_replaces() {
+  // while playing: the new melody starts right away
+  AudioSequencer seq;
+  seq.request(MELODY, LEN(MELODY), AUDIO_PRIO_MELODY);
+  seq.advance(0);
+  CHECK(seq.request(MELODY_2, LEN(MELODY_2), AUDIO_PRIO_MELODY));
+  AudioStep s = seq.advance(10);
+  CHECK_EQ(s.frequency_mHz, 660000);
+  CHECK_EQ(s.delay_ms, 30);
+  CHECK_EQ(seq.preempted(), 1);
+
+  // while queued: only the last one plays
+  AudioSequencer queued;
+  queued.request(ALARM, LEN(ALARM), AUDIO_PRIO_ALARM);
+  queued.advance(0);
+  CHECK(!queued.request(MELODY, LEN(MELODY), AUDIO_PRIO_MELODY));
+  CHECK(!queued.request(MELODY_2, LEN(MELODY_2), AUDIO_PRIO_MELODY));
+  queued.advance(400);
+  s = queued.advance(500);
+  CHECK_EQ(s.delay_ms, 1);
+  s = queued.advance(501);
+  CHECK_EQ(s.frequency_mHz, 660000);
+  s = queued.advance(531);
+  CHECK_EQ(s.delay_ms, 0);
+  CHECK(!queued.busy());
+}
+
+static void test_lower_priority_waits() {
+  AudioSequencer seq;
+  seq.request(ALARM, LEN(ALARM), AUDIO_PRIO_ALARM);
+  seq.advance(0);
+  CHECK(!seq.request(MELODY, LEN(MELODY), AUDIO_PRIO_MELODY));  // refused while the alarm plays
+  AudioStep s = seq.advance(5);  // the caller may still wake up: the alarm keeps playing
+  CHECK_EQ(seq.current(), AUDIO_PRIO_ALARM);
+  CHECK_EQ(s.frequency_mHz, -1);
+  CHECK_EQ(s.delay_ms, 395);
+  s = seq.advance(400);
+  CHECK_EQ(s.frequency_mHz, 0);
+  CHECK_EQ(s.delay_ms, 100);
+  // end of the alarm: speaker off, and the waiting melody is due right after
+  s = seq.advance(500);
+  CHECK_EQ(s.frequency_mHz, 0);
+  CHECK_EQ(s.delay_ms, 1);
+  CHECK(!seq.busy());
+  s = seq.advance(501);
+  CHECK_EQ(seq.current(), AUDIO_PRIO_MELODY);
+  CHECK_EQ(s.frequency_mHz, 440000);
+  CHECK_EQ(seq.preempted(), 0);
+}
+
+int main() {
+  test_step_timing();
+  test_millis_wrap();
+  test_invalid_requests();
+  test_alarm_preempts_melody();
+  test_melody_preempts_ticks();
+  test_same_priority_replaces();
+  test_lower_priority_waits();
+  return host_test_result("audio_sequencer");
+}
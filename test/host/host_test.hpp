@@ -0,0 +1,48 @@
+/**
+ * @file host_test.hpp
+ * @brief Minimal check macros for the host tests in test/host (make test)
+ *
+ * Every test is one program: it runs its cases from main() and returns host_test_result().
+ * A failed check prints file:line and the expression and the program continues, so one run
+ * shows all failures.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+inline int host_test_checks = 0;
+inline int host_test_failures = 0;
+
+#define CHECK(cond) do { \
+    host_test_checks++; \
+    if (!(cond)) { \
+      host_test_failures++; \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) do { \
+    host_test_checks++; \
+    long long check_a_ = (long long)(a), check_b_ = (long long)(b); \
+    if (check_a_ != check_b_) { \
+      host_test_failures++; \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, check_a_, check_b_); \
+    } \
+  } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) do { \
+    host_test_checks++; \
+    double check_a_ = (a), check_b_ = (b); \
+    if (!(std::fabs(check_a_ - check_b_) <= (tolerance))) { \
+      host_test_failures++; \
+      fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: %g vs. %g\n", __FILE__, __LINE__, #a, #b, #tolerance, check_a_, check_b_); \
+    } \
+  } while (0)
+
+/** @brief Summary line, exit code for main() */
+inline int host_test_result(const char *name) {
+  printf("%s: %d checks, %d failed\n", name, host_test_checks, host_test_failures);
+  return host_test_failures ? 1 : 0;
+}
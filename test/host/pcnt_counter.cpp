@@ -0,0 +1,126 @@
+// PcntCounter (src/drivers/sensors/pcnt_counter.hpp) against a stub of the PCNT unit: the 16 bit
+// hardware counter wraps at the limit and raises the overflow interrupt, which the test delivers
+// right away, later (after some reads) or in the middle of a read.
+
+#include "host_test.hpp"
+
+#include <random>
+
+#include "drivers/sensors/pcnt_counter.hpp"
+
+#define LIMIT 32767
+
+static PcntCounter *counter;
+static int16_t hw_value;         // the hardware counter
+static int pending_irqs;         // overflow interrupts raised, not served yet
+static bool irq_during_read;     // serve the pending interrupts while the counter is read
+static uint32_t pulses;          // the truth
+
+static int16_t stub_read(void) {
+  int16_t value = hw_value;
+  if (irq_during_read) {
+    for (; pending_irqs; pending_irqs--)
+      counter->onOverflow();
+  }
+  return value;
+}
+
+static void stub_clear(void) {
+  hw_value = 0;
+}
+
+static const PcntHal stub_hal = {stub_read, stub_clear};
+
+static void serve_irqs() {
+  for (; pending_irqs; pending_irqs--)
+    counter->onOverflow();
+}
+
+// n pulses on the input: the counter wraps to 0 at the limit and raises the interrupt
+static void count(uint32_t n) {
+  pulses += n;
+  while (n--) {
+    if (++hw_value == LIMIT) {
+      hw_value = 0;
+      pending_irqs++;
+    }
+  }
+}
+
+static void reset(PcntCounter &c) {
+  counter = &c;
+  pending_irqs = 0;
+  irq_during_read = false;
+  pulses = 0;
+  c.begin();
+}
+
+static void test_overflow_served() {
+  PcntCounter c(stub_hal, LIMIT);
+  reset(c);
+  count(100);
+  CHECK_EQ(c.total(), 100);
+  count(LIMIT);
+  serve_irqs();
+  CHECK_EQ(c.total(), 100 + LIMIT);
+  CHECK_EQ(c.overflows(), 1);
+}
+
+static void test_overflow_pending() {
+  PcntCounter c(stub_hal, LIMIT);
+  reset(c);
+  count(LIMIT - 10);
+  CHECK_EQ(c.total(), LIMIT - 10);
+  count(20);  // wrapped, the interrupt did not run yet
+  CHECK_EQ(c.total(), LIMIT + 10);
+  count(5);
+  CHECK_EQ(c.total(), LIMIT + 15);  // still pending, not counted twice
+  serve_irqs();
+  CHECK_EQ(c.total(), LIMIT + 15);
+  count(LIMIT);
+  serve_irqs();
+  CHECK_EQ(c.total(), 2 * LIMIT + 15);
+}
+
+static void test_overflow_during_read() {
+  PcntCounter c(stub_hal, LIMIT);
+  reset(c);
+  count(LIMIT + 3);
+  irq_during_read = true;  // the first read is retried
+  CHECK_EQ(c.total(), LIMIT + 3);
+}
+
+static void test_random(unsigned seed) {
+  // random bursts between reads, the interrupt is served after 0..2 reads: never backwards, exact
+  PcntCounter c(stub_hal, LIMIT);
+  reset(c);
+  std::mt19937 rng(seed);
+  uint32_t last = 0, wrong = 0, backwards = 0;
+  int reads_until_irq = 0;
+  for (int i = 0; i < 200000; i++) {
+    count(rng() % 2000);
+    if (pending_irqs && (reads_until_irq-- <= 0)) {
+      serve_irqs();
+      reads_until_irq = rng() % 3;
+    }
+    irq_during_read = (rng() % 16) == 0;
+    uint32_t total = c.total();
+    if (total != pulses)
+      wrong++;
+    if ((int32_t)(total - last) < 0)
+      backwards++;
+    last = total;
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(backwards, 0);
+  CHECK(c.overflows() > 5000);
+}
+
+int main() {
+  test_overflow_served();
+  test_overflow_pending();
+  test_overflow_during_read();
+  test_random(1);
+  test_random(2);
+  return host_test_result("pcnt_counter");
+}
@@ -0,0 +1,125 @@
+// PulseRing / PulseIntervals (src/drivers/sensors/pulse_ring.hpp):
+// - an "ISR" thread pushes while a "read_GMC" thread drains: every timestamp arrives once, in order,
+//   and accepted + dropped is exactly the amount of pulses,
+// - intervals from a wrapping 240 MHz cycle counter are exact or dropped, never taken modulo 2^32.
+
+#include "host_test.hpp"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "drivers/sensors/pulse_ring.hpp"
+
+static void test_concurrent(uint32_t pulses, unsigned seed) {
+  PulseRing<64> ring;  // small, so the producer overruns the consumer at times
+  std::atomic<bool> done{false};
+
+  std::thread producer([&]() {
+    std::mt19937 rng(seed);
+    for (uint32_t i = 1; i <= pulses; i++) {
+      ring.push(i);  // the timestamp is the pulse number
+      if ((rng() & 0xff) == 0)
+        std::this_thread::yield();  // bursts
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t popped = 0, last = 0, out_of_order = 0;
+  uint32_t batch[16];
+  for (;;) {
+    bool finished = done.load(std::memory_order_acquire);
+    size_t n;
+    while ((n = ring.pop(batch, 16)) > 0) {
+      for (size_t i = 0; i < n; i++) {
+        if (batch[i] <= last)
+          out_of_order++;
+        last = batch[i];
+      }
+      popped += n;
+    }
+    if (finished)
+      break;
+  }
+  producer.join();
+
+  CHECK_EQ(out_of_order, 0);
+  CHECK_EQ(popped, ring.accepted());
+  CHECK_EQ(ring.accepted() + ring.dropped(), pulses);
+  CHECK(ring.highWater() <= ring.capacity());
+}
+
+// Pulses at the given times [us], drained every drain_us. Returns the reported intervals [us] and
+// checks each against the true one (and the pulse times, unless the drain is late by a wrap period).
+static std::vector<uint32_t> run_intervals(const std::vector<uint64_t> &pulses_us, uint64_t drain_us) {
+  const uint32_t ticks_per_us = 240;
+  PulseIntervals intervals;
+  intervals.begin(ticks_per_us, 0);
+  std::vector<uint32_t> reported;
+  size_t next = 0;
+  uint64_t prev_us = 0;
+  for (uint64_t now_us = drain_us; next < pulses_us.size(); now_us += drain_us) {
+    intervals.startDrain((uint32_t)(now_us * ticks_per_us), (uint32_t)(now_us / 1000));
+    for (; (next < pulses_us.size()) && (pulses_us[next] <= now_us); next++) {
+      uint32_t interval;
+      if (intervals.add((uint32_t)(pulses_us[next] * ticks_per_us), &interval)) {
+        CHECK(next > 0);
+        CHECK_EQ(interval, pulses_us[next] - prev_us);
+        reported.push_back(interval);
+      }
+      prev_us = pulses_us[next];
+      if (drain_us < (uint64_t)intervals.wrapMs() * 1000)
+        CHECK_NEAR(intervals.lastPulseMs(), pulses_us[next] / 1000, 1);  // the age is truncated to ms
+    }
+  }
+  return reported;
+}
+
+static void test_wrap() {
+  // wrap period of the 240 MHz cycle counter: 17.895 s
+  std::vector<uint64_t> pulses = {1000000, 1001000, 6001000, 22001000, 42001000, 58001000, 58001500};
+  std::vector<uint32_t> r = run_intervals(pulses, 250000);
+  // 1 ms, 5 s, 16 s reported; 20 s (would read as 2.1 s) dropped; 16 s, 0.5 ms reported
+  CHECK_EQ(r.size(), 5);
+  if (r.size() == 5) {
+    CHECK_EQ(r[0], 1000);
+    CHECK_EQ(r[1], 5000000);
+    CHECK_EQ(r[2], 16000000);
+    CHECK_EQ(r[3], 16000000);
+    CHECK_EQ(r[4], 500);
+  }
+}
+
+static void test_wrap_poisson() {
+  // 0.1 cps over 3 h: plenty of gaps beyond the wrap period, none may be reported modulo 2^32
+  std::mt19937 rng(42);
+  std::exponential_distribution<double> gap_s(0.1);
+  std::vector<uint64_t> pulses;
+  uint64_t t = 0;
+  while (t < 3ULL * 3600 * 1000000) {
+    t += 100 + (uint64_t)(gap_s(rng) * 1e6);
+    pulses.push_back(t);
+  }
+  std::vector<uint32_t> r = run_intervals(pulses, 1000000);
+  CHECK(r.size() < pulses.size() * 9 / 10);
+  CHECK(r.size() > pulses.size() * 8 / 10);  // ~82 % of the gaps are shorter than 16.9 s
+  // drained late (but within a wrap period): pulse ages up to 12 s
+  CHECK_EQ(run_intervals(pulses, 12000000).size(), r.size());
+}
+
+static void test_late_drain() {
+  // the drain is late by more than a wrap period: the first interval after it is ambiguous
+  std::vector<uint64_t> pulses = {1000000, 2000000, 25000000, 26000000};
+  std::vector<uint32_t> r = run_intervals(pulses, 20000000);
+  CHECK_EQ(r.size(), 2);  // 1 s (drained together), 1 s; 23 s dropped
+}
+
+int main() {
+  test_concurrent(2000000, 1);
+  test_concurrent(2000000, 2);
+  test_wrap();
+  test_wrap_poisson();
+  test_late_drain();
+  return host_test_result("pulse_ring");
+}
@@ -0,0 +1,139 @@
+// RateEstimator (src/app/rate_estimator.hpp) fed with synthetic Poisson traces like the tube stage
+// does (counts of every read, about every 250 ms with jitter):
+// - every window holds exactly the counts of the updates within its span, the span is the window
+//   length (minus less than one bucket) once the window is filled,
+// - the rates scatter around the true rate like their reported 1 sigma uncertainty says,
+// - a rate step has fully reached a window one window length later.
+
+#include "host_test.hpp"
+
+#include <random>
+#include <vector>
+
+#include "app/rate_estimator.hpp"
+
+struct Update {
+  uint64_t elapsed_ms;  // since the start of the trace, does not wrap
+  uint64_t sum;         // counts up to and including this update
+};
+
+// Counts of the updates after elapsed since_ms up to the last one.
+static uint64_t counts_since(const std::vector<Update> &updates, uint64_t since_ms) {
+  size_t lo = 0, hi = updates.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (updates[mid].elapsed_ms <= since_ms)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return updates.back().sum - (lo ? updates[lo - 1].sum : 0);
+}
+
+// Constant rate cps for the given time, starting at start_ms. Checks the window contents after
+// every update and the scatter of the rates in non-overlapping samples of each window.
+static void test_constant(double cps, double hours, uint32_t start_ms, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> interval(200, 300);
+  RateEstimator est;
+  est.reset(start_ms);
+  std::vector<Update> updates;
+  uint32_t now = start_ms;
+  uint64_t elapsed = 0;
+  uint32_t wrong_counts = 0, wrong_span = 0;
+  int samples[RATE_WINDOWS] = {}, within_1[RATE_WINDOWS] = {}, within_3[RATE_WINDOWS] = {};
+  uint64_t next_sample[RATE_WINDOWS];
+  for (int w = 0; w < RATE_WINDOWS; w++)
+    next_sample[w] = RateEstimator::windowMs((RateWindow)w);
+  while (elapsed < hours * 3600000) {
+    uint32_t dt = interval(rng);
+    std::poisson_distribution<uint32_t> counts(cps * dt / 1000.0);
+    uint32_t n = counts(rng);
+    now += dt;
+    elapsed += dt;
+    updates.push_back({elapsed, (updates.empty() ? 0 : updates.back().sum) + n});
+    est.update(now, n);
+
+    for (int w = 0; w < RATE_WINDOWS; w++) {
+      uint32_t window_ms = RateEstimator::windowMs((RateWindow)w);
+      RateEstimate r = est.rate((RateWindow)w);
+      if (r.counts != counts_since(updates, elapsed - r.span_ms))
+        wrong_counts++;
+      uint32_t min_span = (elapsed < window_ms) ? (uint32_t)elapsed : window_ms - window_ms / 10;
+      if ((r.span_ms < min_span) || (r.span_ms > window_ms + 300))
+        wrong_span++;
+      if (elapsed >= next_sample[w]) {
+        next_sample[w] += window_ms;
+        // against the uncertainty of the true rate, the reported one is checked below
+        double sigma = std::sqrt(cps * r.span_ms / 1000.0) / (r.span_ms / 1000.0);
+        double z = std::fabs(r.cps - cps) / sigma;
+        samples[w]++;
+        within_1[w] += (z <= 1.0);
+        within_3[w] += (z <= 3.0);
+        if (r.counts >= 100)
+          CHECK_NEAR(r.cps_err / sigma, 1.0, 0.25);
+      }
+    }
+  }
+  CHECK_EQ(wrong_counts, 0);
+  CHECK_EQ(wrong_span, 0);
+  for (int w = 0; w < RATE_WINDOWS; w++) {
+    // 68 % within 1 sigma, 99.7 % within 3 sigma; generous bounds for the few samples of long windows,
+    // the 1 sigma share only holds with enough counts per window (not for a few discrete ones)
+    if (samples[w] >= 100) {
+      if (cps * RateEstimator::windowMs((RateWindow)w) / 1000.0 >= 20)
+        CHECK_NEAR((double)within_1[w] / samples[w], 0.68, 0.1);
+      CHECK((double)within_3[w] / samples[w] >= 0.98);
+    } else {
+      CHECK(within_3[w] >= samples[w] - 1);
+    }
+  }
+  RateEstimate total = est.total();
+  CHECK_NEAR(total.cps, cps, 4 * std::sqrt(cps * elapsed / 1000.0) / (elapsed / 1000.0));
+  CHECK_EQ(total.span_ms, elapsed);
+}
+
+static void test_step() {
+  // 1 cps for an hour, then 50 cps: a window has the new rate one window length after the step
+  std::mt19937 rng(7);
+  RateEstimator est;
+  est.reset(0);
+  uint32_t now = 0;
+  for (; now < 3600000; now += 250)
+    est.update(now + 250, std::poisson_distribution<uint32_t>(0.25)(rng));
+  uint32_t step = now;
+  for (int w = 0; w < RATE_WINDOWS; w++) {
+    uint32_t window_ms = RateEstimator::windowMs((RateWindow)w);
+    for (; now < step + window_ms; now += 250)
+      est.update(now + 250, std::poisson_distribution<uint32_t>(12.5)(rng));
+    RateEstimate r = est.rate((RateWindow)w);
+    CHECK_NEAR(r.cps, 50.0, 5 * std::sqrt(50.0 / (r.span_ms / 1000.0)));
+  }
+}
+
+static void test_gap() {
+  // no update for longer than the 10 s window: it forgets its old counts
+  RateEstimator est;
+  est.reset(0);
+  for (uint32_t now = 250; now <= 60000; now += 250)
+    est.update(now, 10);
+  est.update(80000, 0);
+  CHECK_EQ(est.rate(RATE_10S).counts, 0);
+  CHECK_EQ(est.rate(RATE_10S).span_ms, 80000 - 60000);
+  // the 60 s window still has the updates within its span, up to 60 s
+  RateEstimate r = est.rate(RATE_60S);
+  CHECK(r.span_ms <= 60000);
+  CHECK_EQ(r.counts, 10 * ((60000 - (80000 - r.span_ms)) / 250));
+  CHECK_EQ(est.total().counts, 240 * 10);
+}
+
+int main() {
+  test_constant(0.1, 6, 0, 1);
+  test_constant(1, 6, 0, 2);
+  test_constant(10, 6, 0, 3);
+  test_constant(1000, 2, 0, 4);
+  test_constant(10, 1, 0xFFFFFFFFu - 600000, 5);  // millis() wraps after 10 min
+  test_step();
+  test_gap();
+  return host_test_result("rate_estimator");
+}
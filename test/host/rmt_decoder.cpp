@@ -0,0 +1,165 @@
+// RMT decoder (src/drivers/sensors/rmt_decoder.hpp) round trip: pulse trains are encoded into RMT
+// frames the way the receiver records them (split at the idle threshold, 15 bit durations, false
+// pulses on the rising edge within the dead time) and must decode to the same timestamps.
+
+#include "host_test.hpp"
+
+#include <random>
+#include <vector>
+
+#include "drivers/sensors/rmt_decoder.hpp"
+
+// same timing as sensors.cpp: 0.5 us ticks
+#define TICKS_PER_US 2
+#define IDLE_TICKS (15000 * TICKS_PER_US)
+#define DEAD_TIME_TICKS (30 * TICKS_PER_US)
+#define PULSE_TICKS (8 * TICKS_PER_US)  // GM pulse width (active low)
+#define ACTIVE_LEVEL 0
+
+struct Frame {
+  uint64_t start;  // time of the first edge
+  std::vector<uint32_t> items;
+};
+
+static uint32_t item(uint32_t d0, int l0, uint32_t d1, int l1) {
+  return (d0 & 0x7FFF) | ((uint32_t)l0 << 15) | ((d1 & 0x7FFF) << 16) | ((uint32_t)l1 << 31);
+}
+
+// Segments (level, duration) to items, a 0 duration ends the frame.
+static std::vector<uint32_t> to_items(const std::vector<std::pair<int, uint32_t>> &segments) {
+  std::vector<uint32_t> items;
+  for (size_t i = 0; i < segments.size(); i += 2) {
+    if (i + 1 < segments.size())
+      items.push_back(item(segments[i].second, segments[i].first, segments[i + 1].second, segments[i + 1].first));
+    else
+      items.push_back(item(segments[i].second, segments[i].first, 0, !segments[i].first));
+  }
+  if (segments.size() % 2 == 0)
+    items.push_back(0);
+  return items;
+}
+
+// Edges of the input for the pulses at edges[] (the times of falling edges, incl. false ones),
+// split into frames wherever the input is idle for IDLE_TICKS.
+static std::vector<Frame> encode(const std::vector<uint64_t> &edges) {
+  std::vector<Frame> frames;
+  std::vector<std::pair<int, uint32_t>> segments;
+  uint64_t start = 0;
+  for (size_t i = 0; i < edges.size(); i++) {
+    if (segments.empty())
+      start = edges[i];
+    uint64_t end = (i + 1 < edges.size()) ? edges[i + 1] : UINT64_MAX;
+    uint32_t active = (end - edges[i] > PULSE_TICKS) ? PULSE_TICKS : (uint32_t)(end - edges[i]) / 2;
+    segments.push_back({ACTIVE_LEVEL, active});
+    if (end - edges[i] - active >= IDLE_TICKS) {
+      frames.push_back({start, to_items(segments)});  // idle: the receiver ends the frame
+      segments.clear();
+    } else {
+      segments.push_back({!ACTIVE_LEVEL, (uint32_t)(end - edges[i] - active)});
+    }
+  }
+  return frames;
+}
+
+static std::vector<uint64_t> decode(const std::vector<Frame> &frames, uint32_t *counts, int64_t start_error = 0) {
+  RmtDecoderState state = {};
+  std::vector<uint64_t> out;
+  uint64_t ts[512];
+  *counts = 0;
+  for (const Frame &f : frames) {
+    uint64_t start = (&f == &frames[0]) ? f.start : f.start + start_error;  // error of the estimate
+    RmtDecodeResult r = rmt_decode_pulses(f.items.data(), f.items.size(), start, ACTIVE_LEVEL,
+                                          DEAD_TIME_TICKS, &state, ts, 512);
+    *counts += r.counts;
+    out.insert(out.end(), ts, ts + r.timestamps);
+  }
+  return out;
+}
+
+// Poisson pulses at cps, each with a false pulse on its rising edge with probability glitch_p.
+static void generate(double cps, double seconds, double glitch_p, unsigned seed,
+                     std::vector<uint64_t> &pulses, std::vector<uint64_t> &edges) {
+  std::mt19937 rng(seed);
+  std::exponential_distribution<double> gap(cps);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  uint64_t t = 1000;
+  for (;;) {
+    t += DEAD_TIME_TICKS + 1 + (uint64_t)(gap(rng) * 1e6 * TICKS_PER_US);
+    if (t > seconds * 1e6 * TICKS_PER_US)
+      break;
+    pulses.push_back(t);
+    edges.push_back(t);
+    if (u(rng) < glitch_p)
+      edges.push_back(t + PULSE_TICKS + 2);  // within the dead time
+  }
+}
+
+static void test_round_trip(double cps, double glitch_p) {
+  std::vector<uint64_t> pulses, edges;
+  generate(cps, 600, glitch_p, (unsigned)cps, pulses, edges);
+  std::vector<Frame> frames = encode(edges);
+  uint32_t counts;
+  std::vector<uint64_t> decoded = decode(frames, &counts);
+  CHECK_EQ(counts, pulses.size());
+  CHECK(decoded == pulses);
+  CHECK(frames.size() > 1);
+}
+
+static void test_frame_ticks() {
+  std::vector<uint64_t> edges = {100, 1100, 5100};
+  std::vector<Frame> frames = encode(edges);
+  CHECK_EQ(frames.size(), 1);
+  // first edge to the end of the last pulse
+  CHECK_EQ(rmt_frame_ticks(frames[0].items.data(), frames[0].items.size()), 5000 + PULSE_TICKS);
+}
+
+static void test_late_frame_start() {
+  // the caller estimates the frame start too early: timestamps still never run backwards
+  std::vector<uint64_t> edges = {1000, 2000, 1000 + 2 * IDLE_TICKS, 3000 + 2 * IDLE_TICKS};
+  std::vector<Frame> frames = encode(edges);
+  CHECK_EQ(frames.size(), 2);
+  uint32_t counts;
+  std::vector<uint64_t> decoded = decode(frames, &counts, -(int64_t)(2 * IDLE_TICKS));
+  CHECK_EQ(counts, 4);
+  bool ordered = true;
+  for (size_t i = 1; i < decoded.size(); i++)
+    ordered = ordered && (decoded[i] > decoded[i - 1]);
+  CHECK(ordered);
+}
+
+static void test_back_to_back_frames() {
+  // the channel memory was full: the next frame starts right away, with a false pulse
+  std::vector<Frame> frames = encode({1000});
+  std::vector<Frame> second = encode({1000 + PULSE_TICKS + 2, 5000});
+  frames.insert(frames.end(), second.begin(), second.end());
+  uint32_t counts;
+  std::vector<uint64_t> decoded = decode(frames, &counts);
+  CHECK_EQ(counts, 2);
+  CHECK(decoded == std::vector<uint64_t>({1000, 5000}));
+}
+
+static void test_timestamp_overflow() {
+  // more pulses than timestamp space: all counted, the first max_timestamps stamped
+  std::vector<uint64_t> edges;
+  for (int i = 0; i < 100; i++)
+    edges.push_back(1000 + i * 1000);
+  std::vector<Frame> frames = encode(edges);
+  RmtDecoderState state = {};
+  uint64_t ts[10];
+  RmtDecodeResult r = rmt_decode_pulses(frames[0].items.data(), frames[0].items.size(), frames[0].start,
+                                        ACTIVE_LEVEL, DEAD_TIME_TICKS, &state, ts, 10);
+  CHECK_EQ(r.counts, 100);
+  CHECK_EQ(r.timestamps, 10);
+  CHECK_EQ(ts[9], edges[9]);
+}
+
+int main() {
+  test_round_trip(0.3, 0.0);
+  test_round_trip(5, 0.5);
+  test_round_trip(200, 0.5);
+  test_frame_ticks();
+  test_late_frame_start();
+  test_back_to_back_frames();
+  test_timestamp_overflow();
+  return host_test_result("rmt_decoder");
+}
@@ -0,0 +1,102 @@
+// Scheduler (src/app/scheduler.hpp) on simulated FreeRTOS timers: periodic stages must wake the
+// dispatcher by themselves, event stages run on trigger(), overruns are counted.
+
+#include "host_test.hpp"
+
+#include "app/scheduler.hpp"
+
+static void count_run(void *context) {
+  (*static_cast<int *>(context))++;
+}
+
+// Dispatch until the simulated time reaches until_ms, false if the dispatcher would have hung.
+static bool dispatch_until(Scheduler &s, uint32_t until_ms) {
+  while (millis() < until_ms) {
+    s.dispatch();
+    if (host_task_blocked)
+      return false;
+  }
+  return true;
+}
+
+static void test_periodic_only() {
+  Scheduler s;
+  int fast = 0, slow = 0;
+  s.begin();
+  int a = s.add("fast", 100, count_run, &fast);
+  int b = s.add("slow", 250, count_run, &slow);
+  s.start();
+  uint32_t start = millis();
+  CHECK(dispatch_until(s, start + 1000));
+  CHECK_EQ(fast, 10);
+  CHECK_EQ(slow, 4);
+  CHECK_EQ(s.stats(a).runs, 10);
+  CHECK_EQ(s.stats(a).misses, 0);
+  CHECK_EQ(s.stats(b).skipped, 0);
+}
+
+static void test_first_delay() {
+  Scheduler s;
+  int runs = 0;
+  s.begin();
+  s.add("delayed", 100, count_run, &runs, 30);
+  s.start();
+  uint32_t start = millis();
+  s.dispatch();
+  CHECK_EQ(runs, 1);
+  CHECK_EQ(millis() - start, 30);
+  s.dispatch();
+  CHECK_EQ(runs, 2);
+  CHECK_EQ(millis() - start, 130);
+}
+
+static void test_trigger() {
+  Scheduler s;
+  int periodic = 0, event = 0;
+  s.begin();
+  s.add("periodic", 1000, count_run, &periodic);
+  int e = s.add("event", 0, count_run, &event);
+  s.start();
+  uint32_t start = millis();
+  s.trigger(e);
+  s.trigger(e);  // coalesces with the pending release
+  s.dispatch();
+  CHECK_EQ(event, 1);
+  CHECK_EQ(periodic, 0);
+  CHECK_EQ(millis(), start);
+  s.dispatch(10);  // nothing released: returns after the timeout
+  CHECK_EQ(event, 1);
+  CHECK_EQ(millis() - start, 10);
+}
+
+static void slow_run(void *context) {
+  count_run(context);
+  host_advance_us(250 * 1000);  // runs for 2.5 periods
+}
+
+static void test_overrun() {
+  Scheduler s;
+  int runs = 0;
+  s.begin();
+  int a = s.add("slow", 100, slow_run, &runs);
+  s.start();
+  uint32_t start = millis();
+  CHECK(dispatch_until(s, start + 1000));
+  StageStats st = s.stats(a);
+  CHECK(runs >= 3);
+  CHECK_EQ(st.runs, runs);
+  CHECK_EQ(st.misses, runs);
+  CHECK(st.skipped > 0);
+  CHECK(st.max_run_ms >= 250);
+}
+
+int main() {
+  test_periodic_only();
+  host_drop_timers();
+  test_first_delay();
+  host_drop_timers();
+  test_trigger();
+  host_drop_timers();
+  test_overrun();
+  return host_test_result("scheduler");
+}
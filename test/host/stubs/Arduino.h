@@ -0,0 +1,15 @@
+// Host stub of the Arduino core, only what the code under test uses.
+// Time is simulated, see freertos/FreeRTOS.h.
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+unsigned long millis(void);
+unsigned long micros(void);
@@ -0,0 +1,6 @@
+// Host test configuration: the header defaults of every module, without the profiler
+// (its probes are global state shared by all tests).
+
+#pragma once
+
+#define PERF_PROFILING 0
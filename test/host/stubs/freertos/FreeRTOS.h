@@ -0,0 +1,58 @@
+// Host stub of the FreeRTOS / ESP-IDF port basics, see freertos_sim.cpp.
+// One tick is one millisecond (CONFIG_FREERTOS_HZ 1000, like the firmware).
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+// Critical sections are real spinlocks, so tests may use threads as "ISR" and "task".
+struct portMUX_TYPE {
+  std::atomic_flag flag = ATOMIC_FLAG_INIT;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+static inline void host_mux_lock(portMUX_TYPE *mux) {
+  while (mux->flag.test_and_set(std::memory_order_acquire))
+    ;
+}
+static inline void host_mux_unlock(portMUX_TYPE *mux) {
+  mux->flag.clear(std::memory_order_release);
+}
+
+#define portENTER_CRITICAL(mux) host_mux_lock(mux)
+#define portEXIT_CRITICAL(mux) host_mux_unlock(mux)
+#define portENTER_CRITICAL_ISR(mux) host_mux_lock(mux)
+#define portEXIT_CRITICAL_ISR(mux) host_mux_unlock(mux)
+#define portENTER_CRITICAL_SAFE(mux) host_mux_lock(mux)
+#define portEXIT_CRITICAL_SAFE(mux) host_mux_unlock(mux)
+#define portYIELD_FROM_ISR() do { } while (0)
+
+// Simulated time [us], only advances in host_advance_us() and in blocking calls.
+uint64_t host_time_us(void);
+
+// Advance the simulated time, firing the software timers which expire on the way.
+void host_advance_us(uint64_t us);
+
+// Forget all software timers (their owners go out of scope between test cases).
+void host_drop_timers(void);
+
+// Longest a blocking call with portMAX_DELAY waits for something to happen. [ms]
+#define HOST_MAX_BLOCK_MS (60 * 60 * 1000)
+
+// Set when a call with portMAX_DELAY waited HOST_MAX_BLOCK_MS in vain: the task would hang forever.
+extern bool host_task_blocked;
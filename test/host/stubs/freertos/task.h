@@ -0,0 +1,16 @@
+// Host stub of the FreeRTOS task notifications, see freertos_sim.cpp.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+struct HostTask;
+typedef HostTask *TaskHandle_t;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken);
+
+// Without a pending notification the simulated time runs on (timers fire) until one arrives or wait ends.
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait);
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,14 @@
+// Host stub of the FreeRTOS software timers, see freertos_sim.cpp.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+struct HostTimer;
+typedef HostTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id, TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t wait);
+void *pvTimerGetTimerID(TimerHandle_t timer);
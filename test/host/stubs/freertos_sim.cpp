@@ -0,0 +1,138 @@
+// Single task simulation of the FreeRTOS calls used by the code under test.
+//
+// There is no scheduler: the test program is the task. Time is simulated and only runs when the
+// test advances it or the task blocks (ulTaskNotifyTake, vTaskDelay), software timers fire in the
+// calling thread whenever their expiry time is passed. Task notifications are atomic, so a thread
+// standing in for an ISR may give them.
+
+#include <Arduino.h>
+#include <freertos/task.h>
+#include <freertos/timers.h>
+
+#include <vector>
+
+struct HostTask {
+  std::atomic<uint32_t> notifications{0};
+};
+
+struct HostTimer {
+  TickType_t period;
+  bool auto_reload;
+  bool active;
+  uint64_t expiry_us;
+  void *id;
+  TimerCallbackFunction_t callback;
+};
+
+static uint64_t now_us;
+static std::vector<HostTimer *> timers;
+static thread_local HostTask current_task;
+bool host_task_blocked = false;
+
+uint64_t host_time_us(void) {
+  return now_us;
+}
+
+unsigned long millis(void) {
+  return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros(void) {
+  return (unsigned long)now_us;
+}
+
+// Earliest active timer expiring at or before until_us, nullptr if none.
+static HostTimer *next_timer(uint64_t until_us) {
+  HostTimer *next = nullptr;
+  for (HostTimer *t : timers) {
+    if (t->active && (t->expiry_us <= until_us) && (!next || (t->expiry_us < next->expiry_us)))
+      next = t;
+  }
+  return next;
+}
+
+static void fire(HostTimer *t) {
+  now_us = t->expiry_us;
+  if (t->auto_reload)
+    t->expiry_us += (uint64_t)t->period * 1000;
+  else
+    t->active = false;
+  t->callback(t);
+}
+
+void host_advance_us(uint64_t us) {
+  uint64_t until_us = now_us + us;
+  HostTimer *t;
+  while ((t = next_timer(until_us)) != nullptr)
+    fire(t);
+  now_us = until_us;
+}
+
+void host_drop_timers(void) {
+  for (HostTimer *t : timers)
+    delete t;
+  timers.clear();
+  host_task_blocked = false;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return &current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  task->notifications.fetch_add(1);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+  task->notifications.fetch_add(1);
+  if (higher_priority_task_woken)
+    *higher_priority_task_woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait) {
+  uint64_t wait_us = (uint64_t)((wait == portMAX_DELAY) ? HOST_MAX_BLOCK_MS : wait) * 1000;
+  uint64_t until_us = now_us + wait_us;
+  HostTimer *t;
+  while (!current_task.notifications.load() && ((t = next_timer(until_us)) != nullptr))
+    fire(t);
+  while ((t = next_timer(now_us)) != nullptr)
+    fire(t);  // the other timers of the same tick fire before the task runs
+  uint32_t value = current_task.notifications.load();
+  if (!value) {
+    now_us = until_us;
+    if (wait == portMAX_DELAY)
+      host_task_blocked = true;
+    return 0;
+  }
+  if (clear_on_exit)
+    current_task.notifications.store(0);
+  else
+    current_task.notifications.fetch_sub(1);
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  host_advance_us((uint64_t)ticks * 1000);
+}
+
+TimerHandle_t xTimerCreate(const char *, TickType_t period, UBaseType_t auto_reload, void *id, TimerCallbackFunction_t callback) {
+  HostTimer *t = new HostTimer{period, auto_reload != 0, false, 0, id, callback};
+  timers.push_back(t);
+  return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t) {
+  timer->active = true;
+  timer->expiry_us = now_us + (uint64_t)timer->period * 1000;
+  return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t) {
+  timer->period = period;
+  return xTimerStart(timer, 0);
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) {
+  return timer->id;
+}
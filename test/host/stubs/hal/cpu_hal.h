@@ -0,0 +1,9 @@
+// Host stub of the cpu cycle counter: 240 MHz on the simulated time base.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+static inline uint32_t cpu_hal_get_cycle_count(void) {
+  return (uint32_t)(host_time_us() * 240);
+}
@@ -0,0 +1,162 @@
+// Simulation of the local alarm (src/app/alarm_engine.hpp) fed like MeasurementPipeline does: Poisson
+// counts in batches of --batch-ms, the baseline is the average rate since boot (RateEstimator::total())
+// once it has 100 counts.
+//
+// - false alarms: background only, with configured mean intervals between false alarms much shorter
+//   than the firmware's LOCAL_ALARM_FALSE_ALARM_INTERVAL (a year can't be simulated often enough),
+//   measured vs. configured interval,
+// - detection: after --warmup h of background the rate steps up by several factors, time from the step
+//   to the alarm (mean / median / 95 %) vs. the expected latency of the relative detector, and the
+//   detection delay the engine reports.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o alarm_sim tools/alarm_sim/alarm_sim.cpp src/app/alarm_engine.cpp src/app/rate_estimator.cpp
+// Run:
+//   ./alarm_sim [--cps CPS] [--factor F] [--threshold-cps CPS] [--interval H] [--runs N] [--batch-ms MS]
+//               [--warmup H] [--seed N]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "app/alarm_engine.hpp"
+#include "app/rate_estimator.hpp"
+
+#define MINCOUNTS 100  // same as measurement_pipeline.cpp
+
+struct Options {
+  double cps = 0.7;            // background, ~0.1 uSv/h with an SBM-20
+  double factor = 3.0;         // LOCAL_ALARM_FACTOR
+  double threshold_cps = 0.0;  // absolute detector off, so the relative one is measured alone
+  double interval_h = LOCAL_ALARM_FALSE_ALARM_INTERVAL;
+  int runs = 50;
+  uint32_t batch_ms = 250;     // TUBE_INTERVAL
+  double warmup_h = 1.0;
+  unsigned seed = 1;
+};
+
+// Counting device: the pipeline's alarm path with its own random stream.
+struct Device {
+  AlarmEngine engine;
+  RateEstimator rates;
+  std::mt19937 rng;
+  uint32_t now_ms = 0;
+
+  Device(const Options &o, float interval_h, unsigned seed) : rng(seed) {
+    engine.configure(o.factor, o.threshold_cps, interval_h);
+    rates.reset(0);
+  }
+
+  AlarmEvent batch(double cps, uint32_t dt_ms) {
+    uint32_t counts = std::poisson_distribution<uint32_t>(cps * dt_ms / 1000.0)(rng);
+    now_ms += dt_ms;
+    rates.update(now_ms, counts);
+    RateEstimate accumulated = rates.total();
+    float baseline_cps = (accumulated.counts >= MINCOUNTS) ? accumulated.cps : 0.0f;
+    return engine.update(counts, dt_ms, baseline_cps);
+  }
+};
+
+static double percentile(std::vector<double> v, double p) {
+  if (v.empty())
+    return 0.0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
+
+static void false_alarms(const Options &o) {
+  printf("false alarms at %.2f cps (%d runs of 20 configured intervals each):\n", o.cps, o.runs);
+  printf("  configured [h]  alarms  measured [h]\n");
+  for (double interval_h : {0.1, 1.0, 10.0}) {
+    uint64_t alarms = 0;
+    double hours = 0.0;
+    for (int run = 0; run < o.runs; run++) {
+      Device d(o, interval_h, o.seed * 1000003u + run);
+      uint64_t batches = (uint64_t)((o.warmup_h + 20 * interval_h) * 3600000 / o.batch_ms);
+      uint64_t warmup = (uint64_t)(o.warmup_h * 3600000 / o.batch_ms);
+      for (uint64_t i = 0; i < batches; i++) {
+        AlarmEvent e = d.batch(o.cps, o.batch_ms);
+        if ((i >= warmup) && (e == ALARM_RAISED))
+          alarms++;
+      }
+      hours += (batches - warmup) * o.batch_ms / 3600000.0;
+    }
+    if (alarms)
+      printf("  %14.1f  %6llu  %12.2f\n", interval_h, (unsigned long long)alarms, hours / alarms);
+    else
+      printf("  %14.1f  %6d  > %10.2f\n", interval_h, 0, hours);
+  }
+}
+
+static void detection(const Options &o) {
+  printf("detection after %.1f h at %.2f cps, false alarm interval %.0f h, alarm factor %.1f (%d runs):\n",
+         o.warmup_h, o.cps, o.interval_h, o.factor, o.runs);
+  printf("  step   expected [s]  mean [s]  median [s]  95%% [s]  reported delay [s]  missed\n");
+  for (double step : {1.5, 2.0, 3.0, 5.0, 10.0}) {
+    std::vector<double> latency, reported;
+    float expected = 0.0f;
+    int missed = 0;
+    for (int run = 0; run < o.runs; run++) {
+      Device d(o, (float)o.interval_h, o.seed * 7919u + run);
+      uint64_t warmup = (uint64_t)(o.warmup_h * 3600000 / o.batch_ms);
+      for (uint64_t i = 0; i < warmup; i++)
+        d.batch(o.cps, o.batch_ms);  // a false alarm here is as likely as in the field, ignore it
+      expected = d.engine.expectedDetectionS();
+      uint32_t step_ms = d.now_ms;
+      bool raised = false;
+      // give up after an hour
+      while (!raised && (d.now_ms - step_ms < 3600000))
+        raised = (d.batch(o.cps * step, o.batch_ms) == ALARM_RAISED);
+      if (!raised) {
+        missed++;
+        continue;
+      }
+      latency.push_back((d.now_ms - step_ms) / 1000.0);
+      reported.push_back(d.engine.detectionDelayMs() / 1000.0);
+    }
+    double mean = 0.0, mean_reported = 0.0;
+    for (size_t i = 0; i < latency.size(); i++) {
+      mean += latency[i] / latency.size();
+      mean_reported += reported[i] / latency.size();
+    }
+    char expected_s[16] = "-";
+    if (step == o.factor)
+      snprintf(expected_s, sizeof(expected_s), "%.1f", expected);  // only valid for the configured step
+    printf("  %4.1fx  %12s  %8.1f  %10.1f  %7.1f  %17.1f  %6d\n", step, expected_s, mean,
+           percentile(latency, 0.5), percentile(latency, 0.95), mean_reported, missed);
+  }
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--cps") && i + 1 < argc)
+      o.cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--factor") && i + 1 < argc)
+      o.factor = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--threshold-cps") && i + 1 < argc)
+      o.threshold_cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--interval") && i + 1 < argc)
+      o.interval_h = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--runs") && i + 1 < argc)
+      o.runs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--batch-ms") && i + 1 < argc)
+      o.batch_ms = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+      o.warmup_h = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      o.seed = (unsigned)atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--cps CPS] [--factor F] [--threshold-cps CPS] [--interval H] [--runs N]\n"
+              "          [--batch-ms MS] [--warmup H] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+  false_alarms(o);
+  printf("\n");
+  detection(o);
+  return 0;
+}
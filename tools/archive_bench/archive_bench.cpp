@@ -0,0 +1,154 @@
+// Benchmark of the archive block codec (src/core/archive_codec.hpp): encodes synthetic interval
+// records (every 90 s, Poisson counts, HV pulses, BME280 like temperature / humidity / pressure with
+// a daily cycle and sensor noise) in blocks like the firmware, decodes them again, checks that every
+// record comes back bit exact and reports bytes per record (total and per column) and records per
+// second for encoding and decoding.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o archive_bench tools/archive_bench/archive_bench.cpp src/core/archive_codec.cpp
+// Run:
+//   ./archive_bench [--days D] [--cps CPS] [--block N] [--interval S] [--no-thp] [--seed N]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "core/archive_codec.hpp"
+
+static const char *column_names[ARCHIVE_COLUMNS] = {
+  "t", "dt_ms", "counts", "hv_pulses", "status", "temperature", "humidity", "pressure"
+};
+
+// bytes of an index entry per block in the firmware (drivers/storage/archive.hpp)
+static const size_t INDEX_ENTRY_BYTES = 16;
+
+static std::vector<ArchiveRecord> synthetic(double days, double cps, double interval_s, bool thp, unsigned seed) {
+  std::mt19937_64 rng(seed);
+  std::normal_distribution<double> jitter_ms(0.0, 300.0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<ArchiveRecord> records;
+  size_t n = (size_t)(days * 86400 / interval_s);
+  records.reserve(n);
+  double t = 1760000000.0;
+  for (size_t i = 0; i < n; i++) {
+    // dt is between the last pulses of two records: interval +- the time to the next pulse
+    double dt = interval_s * 1000 + jitter_ms(rng);
+    std::poisson_distribution<uint32_t> counts(cps * dt / 1000);
+    std::poisson_distribution<uint32_t> hv(1.5);
+    t += interval_s;
+    double day = 2 * M_PI * fmod(t, 86400) / 86400;
+    ArchiveRecord r = {};
+    r.t = (uint32_t)t + (rng() % 2);  // record built in the second after the stage release
+    r.dt_ms = (uint32_t)dt;
+    r.counts = counts(rng);
+    r.hv_pulses = hv(rng);
+    r.status = MEAS_TIME_VALID | MEAS_WIFI_CONNECTED;
+    if (thp) {
+      r.status |= MEAS_THP_VALID;
+      r.temperature = (float)(21.0 + 3.0 * sin(day) + 0.01 * noise(rng));
+      r.humidity = (float)(45.0 - 8.0 * sin(day) + 0.05 * noise(rng));
+      r.pressure = (float)(1013.25 + 2.0 * sin(day / 3) + 0.02 * noise(rng));
+    }
+    records.push_back(r);
+  }
+  return records;
+}
+
+int main(int argc, char **argv) {
+  double days = 30, cps = 0.5, interval_s = 90;
+  size_t block = 96;
+  bool thp = true;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (!strcmp(argv[i], "--days") && more)
+      days = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--cps") && more)
+      cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--block") && more)
+      block = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--interval") && more)
+      interval_s = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--no-thp"))
+      thp = false;
+    else if (!strcmp(argv[i], "--seed") && more)
+      seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--days D] [--cps CPS] [--block N] [--interval S] [--no-thp] [--seed N]\n", argv[0]);
+      return 1;
+    }
+  }
+  if ((block == 0) || (block > 0xffff)) {
+    fprintf(stderr, "--block must be 1..65535\n");
+    return 1;
+  }
+
+  std::vector<ArchiveRecord> records = synthetic(days, cps, interval_s, thp, seed);
+  size_t blocks = (records.size() + block - 1) / block;
+  std::vector<uint8_t> encoded(blocks * ARCHIVE_BLOCK_BOUND(block));
+  std::vector<size_t> offsets, sizes;
+
+  auto start = std::chrono::steady_clock::now();
+  size_t pos = 0;
+  for (size_t i = 0; i < records.size(); i += block) {
+    size_t n = std::min(block, records.size() - i);
+    size_t len = archive_encode(&records[i], n, &encoded[pos], ARCHIVE_BLOCK_BOUND(n));
+    if (!len) {
+      fprintf(stderr, "block %zu does not fit into ARCHIVE_BLOCK_BOUND\n", offsets.size());
+      return 1;
+    }
+    offsets.push_back(pos);
+    sizes.push_back(len);
+    pos += len;
+  }
+  double encode_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  size_t decoded = 0, mismatches = 0;
+  ArchiveDecoder decoder;
+  ArchiveRecord r;
+  for (size_t b = 0; b < offsets.size(); b++) {
+    if (!decoder.begin(&encoded[offsets[b]], sizes[b])) {
+      fprintf(stderr, "block %zu is malformed\n", b);
+      return 1;
+    }
+    while (decoder.next(r)) {
+      if (memcmp(&r, &records[decoded], sizeof(r)))
+        mismatches++;
+      decoded++;
+    }
+  }
+  double decode_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // column sizes from the block layout
+  size_t column_bytes[ARCHIVE_COLUMNS] = {};
+  for (size_t b = 0; b < offsets.size(); b++) {
+    const uint8_t *p = &encoded[offsets[b]] + 2;
+    for (int c = 0; c < ARCHIVE_COLUMNS; c++) {
+      size_t len = p[0] | (p[1] << 8);
+      column_bytes[c] += len + 2;
+      p += len + 2;
+    }
+  }
+
+  size_t n = records.size();
+  size_t total = pos + offsets.size() * INDEX_ENTRY_BYTES;
+  printf("%zu records (%.1f days every %.0f s, %.2f cps%s), %zu blocks of %zu\n",
+         n, days, interval_s, cps, thp ? ", THP" : "", offsets.size(), block);
+  printf("raw %zu bytes (%zu per record), archive %zu bytes incl. index: %.2f bytes per record, %.1fx\n",
+         n * sizeof(ArchiveRecord), sizeof(ArchiveRecord), total, (double)total / n, (double)n * sizeof(ArchiveRecord) / total);
+  for (int c = 0; c < ARCHIVE_COLUMNS; c++)
+    printf("  %-12s %6.2f bits per record\n", column_names[c], column_bytes[c] * 8.0 / n);
+  printf("encode: %.0f records/s, decode: %.0f records/s\n", n / encode_s, n / decode_s);
+  printf("1 MB holds %.0f days\n", 1048576.0 / ((double)total / n) * interval_s / 86400);
+  if ((decoded != n) || mismatches) {
+    printf("FAILED: %zu of %zu records decoded, %zu differ\n", decoded, n, mismatches);
+    return 1;
+  }
+  printf("round trip ok\n");
+  return 0;
+}
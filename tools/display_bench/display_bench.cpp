@@ -0,0 +1,342 @@
+// I2C traffic of the OLED updates: the old DisplayModule (U8X8::clear() and drawString() on every
+// refresh, the whole status line on every status change) against TileCanvas (src/core/tile_canvas.hpp),
+// which only sends the tiles that changed.
+//
+// A mock U8x8 SSD1306 backend counts the bytes and transfers exactly like U8x8's HW I2C path:
+// per drawTile() one command transfer (address, control byte, column / page commands), then the
+// tile data in transfers of max. 24 bytes (address + control byte each); drawString() sends every
+// glyph tile on its own, clear() all rows. The fonts are synthetic, with the tile sizes of the
+// firmware's fonts (1x1, 1x2, 2x2, 3x6). Both mock panels must end up with the same content after
+// every update, the tool checks that.
+//
+// The simulated hour: a live record every DISPLAYREFRESH (10 s) with a fluctuating cpm, every
+// MEASUREMENT_INTERVAL (150 s) madavi and sensor.community each go SENDING -> IDLE (set_status(),
+// then display_status(), like wifi.cpp), sometimes WiFi / BLE change.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o display_bench tools/display_bench/display_bench.cpp src/core/tile_canvas.cpp
+// Run:
+//   ./display_bench [--lora] [--cpm CPM] [--hours H] [--seed N] [--i2c HZ]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "core/tile_canvas.hpp"
+
+// --- synthetic U8x8 fonts: first char, last char, tiles wide, tiles high, glyph tiles ---
+
+static std::vector<uint8_t> make_font(uint8_t first, uint8_t last, uint8_t tw, uint8_t th) {
+  std::vector<uint8_t> f = {first, last, tw, th};
+  for (int c = first; c <= last; c++)
+    for (int t = 0; t < tw * th * 8; t++)
+      f.push_back((c == ' ') ? 0 : (uint8_t)(c * 31 + t * 7 + (t >> 3) * 13));
+  return f;
+}
+
+static std::vector<uint8_t> font_cpc = make_font(32, 255, 1, 1);        // amstrad_cpc_extended_f
+static std::vector<uint8_t> font_victoria = make_font(32, 127, 1, 1);   // victoriamedium8_r
+static std::vector<uint8_t> font_7x14 = make_font(32, 255, 1, 2);       // 7x14_1x2_f
+static std::vector<uint8_t> font_inb33 = make_font(32, 58, 3, 6);       // inb33_3x6_n
+static std::vector<uint8_t> font_wyse = make_font(32, 255, 2, 2);       // px437wyse700b_2x2_f
+
+// --- mock panel ---
+
+#define I2C_CHUNK 24  // U8x8 ssd13xx_fast_i2c: max. data bytes per transfer
+
+struct MockU8x8 {
+  uint8_t cols, rows;  // rows: what U8X8::clear() clears
+  uint8_t ram[8][16][8] = {};
+  const uint8_t *font = nullptr;
+  uint64_t bytes = 0;
+  uint64_t transfers = 0;
+
+  MockU8x8(uint8_t cols, uint8_t rows) : cols(cols), rows(rows) {}
+
+  void data(size_t len) {
+    while (len) {
+      size_t n = (len > I2C_CHUNK) ? I2C_CHUNK : len;
+      bytes += 2 + n;  // address, 0x40, data
+      transfers++;
+      len -= n;
+    }
+  }
+
+  // u8x8 DRAW_TILE: address, 0x00, column high / low, page; then the tiles, repeat times
+  void drawTile(uint8_t x, uint8_t y, uint8_t cnt, const uint8_t *tiles, uint8_t repeat = 1) {
+    bytes += 5;
+    transfers++;
+    for (uint8_t r = 0; r < repeat; r++) {
+      memcpy(ram[y][x + r * cnt], tiles, cnt * 8);
+      data(cnt * 8);
+    }
+  }
+
+  void clear() {
+    static const uint8_t zero[8] = {};
+    for (uint8_t y = 0; y < rows; y++)
+      drawTile(0, y, 1, zero, cols);
+  }
+
+  void setFont(const std::vector<uint8_t> &f) { font = f.data(); }
+
+  void drawString(uint8_t x, uint8_t y, const char *s) {
+    uint8_t first = font[0], last = font[1], tw = font[2], th = font[3];
+    static const uint8_t zero[8] = {};
+    for (; *s; s++, x += tw) {
+      uint8_t c = *s;
+      for (uint8_t ty = 0; ty < th; ty++)
+        for (uint8_t tx = 0; tx < tw; tx++) {
+          const uint8_t *tile = ((c >= first) && (c <= last)) ? font + 4 + ((c - first) * tw * th + ty * tw + tx) * 8 : zero;
+          if ((x + tx < 16) && (y + ty < 8))  // U8x8 sends it anyway, the controller wraps / ignores it
+            drawTile(x + tx, y + ty, 1, tile);
+        }
+    }
+  }
+};
+
+// --- the two display modules (screen layout of src/drivers/display/display.cpp) ---
+
+static char *format_time(unsigned int secs) {
+  static char result[4];
+  unsigned int mins = secs / 60, hours = secs / 3600, days = secs / 86400;
+  if (secs < 60)
+    snprintf(result, 4, "%2ds", secs);
+  else if (mins < 60)
+    snprintf(result, 4, "%2dm", mins);
+  else if (hours < 24)
+    snprintf(result, 4, "%2dh", hours);
+  else
+    snprintf(result, 4, "%2dd", days % 100);
+  return result;
+}
+
+static const char *status_chars[8] = {".W0wA", ".s1S?", ".m2M?", ".t3T?", ".B4b?", ".", ".", ".H7"};
+
+struct Screen {
+  bool lora;
+  int status[8] = {1, 1, 1, 0, 3, 0, 0, 1};
+
+  void statusText(char *out) {
+    const char *format = lora ? "%c%c%c%c%c%c%c%c" : "%c %c %c %c %c %c %c %c";
+    char c[8];
+    for (int i = 0; i < 8; i++)
+      c[i] = status_chars[i][status[i]];
+    snprintf(out, 17, format, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+  }
+};
+
+struct OldDisplay : Screen {
+  MockU8x8 &panel;
+  OldDisplay(MockU8x8 &p, bool lora) : panel(p) { this->lora = lora; }
+
+  void renderStatus() {
+    char out[17];
+    statusText(out);
+    int line = lora ? 5 : 7;
+    panel.setFont(font_victoria);
+    panel.drawString(0, line, lora ? "        " : "                ");  // clearLine()
+    panel.drawString(0, line, out);
+  }
+
+  void showGmc(unsigned t, int nsvph, int cpm) {
+    panel.clear();
+    char out[40];
+    if (!lora) {
+      panel.setFont(font_7x14);
+      sprintf(out, "%3s%7d nSv/h", format_time(t), nsvph);
+      panel.drawString(0, 0, out);
+      panel.setFont(font_inb33);
+      sprintf(out, "%5d", cpm);
+      panel.drawString(0, 2, out);
+    } else {
+      panel.setFont(font_cpc);
+      sprintf(out, " %7d", nsvph);
+      panel.drawString(0, 2, out);
+      panel.setFont(font_wyse);
+      sprintf(out, "%4d", cpm);
+      panel.drawString(0, 3, out);
+    }
+    renderStatus();
+  }
+
+  void setStatus(int i, int v) {
+    if (status[i] != v) {
+      status[i] = v;
+      renderStatus();
+    }
+  }
+};
+
+struct NewDisplay : Screen {
+  MockU8x8 &panel;
+  TileCanvas canvas;
+  NewDisplay(MockU8x8 &p, bool lora) : panel(p) {
+    this->lora = lora;
+    canvas.begin(lora ? 8 : 16, 8);
+  }
+
+  void flush() {
+    canvas.flush([](uint8_t x, uint8_t y, uint8_t count, const uint8_t *tiles, void *c) {
+      static_cast<MockU8x8 *>(c)->drawTile(x, y, count, tiles);
+    }, &panel);
+  }
+
+  void drawStatus() {
+    char out[17];
+    statusText(out);
+    int line = lora ? 5 : 7;
+    canvas.setFont(font_victoria.data());
+    canvas.clearRow(line);
+    canvas.drawString(0, line, out);
+  }
+
+  void renderStatus() {
+    drawStatus();
+    flush();
+  }
+
+  void showGmc(unsigned t, int nsvph, int cpm) {
+    canvas.clear();
+    char out[40];
+    if (!lora) {
+      canvas.setFont(font_7x14.data());
+      sprintf(out, "%3s%7d nSv/h", format_time(t), nsvph);
+      canvas.drawString(0, 0, out);
+      canvas.setFont(font_inb33.data());
+      sprintf(out, "%5d", cpm);
+      canvas.drawString(0, 2, out);
+    } else {
+      canvas.setFont(font_cpc.data());
+      sprintf(out, " %7d", nsvph);
+      canvas.drawString(0, 2, out);
+      canvas.setFont(font_wyse.data());
+      sprintf(out, "%4d", cpm);
+      canvas.drawString(0, 3, out);
+    }
+    renderStatus();
+  }
+
+  void setStatus(int i, int v) {
+    if (status[i] != v) {
+      status[i] = v;
+      renderStatus();
+    }
+  }
+};
+
+// --- run ---
+
+struct Traffic {
+  uint64_t bytes = 0, transfers = 0, updates = 0;
+};
+
+static void add(Traffic &t, MockU8x8 &p, uint64_t b0, uint64_t t0) {
+  t.bytes += p.bytes - b0;
+  t.transfers += p.transfers - t0;
+  t.updates++;
+}
+
+int main(int argc, char **argv) {
+  bool lora = false;
+  double cpm_mean = 20, hours = 1;
+  unsigned seed = 1;
+  double i2c_hz = 400000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--lora"))
+      lora = true;
+    else if (!strcmp(argv[i], "--cpm") && (i + 1 < argc))
+      cpm_mean = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--hours") && (i + 1 < argc))
+      hours = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && (i + 1 < argc))
+      seed = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--i2c") && (i + 1 < argc))
+      i2c_hz = atof(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--lora] [--cpm CPM] [--hours H] [--seed N] [--i2c HZ]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  uint8_t cols = lora ? 8 : 16;
+  MockU8x8 old_panel(cols, lora ? 4 : 8), new_panel(cols, lora ? 4 : 8);
+  OldDisplay old_display(old_panel, lora);
+  NewDisplay new_display(new_panel, lora);
+  std::mt19937 rng(seed);
+  std::poisson_distribution<int> counts(cpm_mean / 6);  // per 10 s
+  std::uniform_int_distribution<int> percent(0, 99);
+
+  Traffic old_gmc, new_gmc, old_status, new_status;
+  uint32_t mismatches = 0;
+  auto compare = [&]() {
+    if (memcmp(old_panel.ram, new_panel.ram, sizeof(old_panel.ram)))
+      mismatches++;
+  };
+  auto status = [&](int index, int value) {
+    // wifi.cpp: set_status(), then display_status()
+    for (int step = 0; step < 2; step++) {
+      uint64_t ob = old_panel.bytes, ot = old_panel.transfers, nb = new_panel.bytes, nt = new_panel.transfers;
+      if (step == 0) {
+        old_display.setStatus(index, value);
+        new_display.setStatus(index, value);
+      } else {
+        old_display.renderStatus();
+        new_display.renderStatus();
+      }
+      add(old_status, old_panel, ob, ot);
+      add(new_status, new_panel, nb, nt);
+      compare();
+    }
+  };
+
+  uint64_t total_counts = 0;
+  unsigned steps = (unsigned)(hours * 360);
+  for (unsigned i = 1; i <= steps; i++) {
+    unsigned t = i * 10;
+    total_counts += counts(rng);
+    int cpm = lround(counts(rng) * 6.0);
+    int nsvph = (int)(total_counts * 60.0 / t / 60.0 * 1000 * 0.0057);  // Si22G-ish factor
+    uint64_t ob = old_panel.bytes, ot = old_panel.transfers, nb = new_panel.bytes, nt = new_panel.transfers;
+    old_display.showGmc(t, nsvph, cpm);
+    new_display.showGmc(t, nsvph, cpm);
+    add(old_gmc, old_panel, ob, ot);
+    add(new_gmc, new_panel, nb, nt);
+    compare();
+    if (t % 150 == 0) {
+      status(2, 3);  // madavi sending
+      status(2, 1);  // idle
+      status(1, 3);  // sensor.community sending
+      status(1, 1);
+    }
+    if (percent(rng) < 2) {
+      status(0, 3);  // WiFi reconnect
+      status(0, 1);
+    }
+    if (percent(rng) < 3)
+      status(4, (new_display.status[4] == 3) ? 1 : 3);  // BLE client (dis)connects
+  }
+
+  double us_per_byte = 9e6 / i2c_hz;  // 8 data bits + ack
+  printf("%s panel (%dx%d tiles), %.1f h at ~%.0f cpm, I2C %.0f kHz\n", lora ? "64x32 LoRa" : "128x64", cols,
+         lora ? 4 : 8, hours, cpm_mean, i2c_hz / 1000);
+  printf("%-24s %8s %12s %12s %12s\n", "per update", "updates", "bytes", "transfers", "bus [ms]");
+  auto row = [&](const char *name, const Traffic &t) {
+    double b = (double)t.bytes / t.updates;
+    printf("%-24s %8llu %12.1f %12.1f %12.2f\n", name, (unsigned long long)t.updates, b,
+           (double)t.transfers / t.updates, b * us_per_byte / 1000);
+  };
+  row("old: showGmc", old_gmc);
+  row("tiles: showGmc", new_gmc);
+  row("old: status", old_status);
+  row("tiles: status", new_status);
+  uint64_t old_total = old_gmc.bytes + old_status.bytes, new_total = new_gmc.bytes + new_status.bytes;
+  printf("total: %llu -> %llu bytes (%.1f %%), bus time %.2f s -> %.2f s per hour\n",
+         (unsigned long long)old_total, (unsigned long long)new_total, 100.0 * new_total / old_total,
+         old_total * us_per_byte / 1e6 / hours, new_total * us_per_byte / 1e6 / hours);
+  printf("panel mismatches: %u\n", mismatches);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,261 @@
+// Simulation of the HV recharge controller (src/drivers/sensors/hv_charger.hpp) against a
+// simple model of the HV capacitor, to compare control laws before flashing them.
+//
+// Capacitor model:
+// - every charge pulse adds charge_v * (1 - V / supply_v) volts (charging slows down near the supply limit)
+// - leakage: exponential decay with time constant tau, which halves every 10 degC (diode leak current)
+// - every GM pulse (Poisson, cps) removes gm_pulse_v volts
+// - the "capacitor full" signal triggers when V reaches full_v
+//
+// --isr compares the interrupt load of the two timer schemes for the same scenario instead: the old
+// 100 us periodic timer, whose ISR counted periods until the next state machine step, and the one-shot
+// alarm reprogrammed to the delay step() returns (recharge_timer_callback() in io.cpp). Reported are
+// ISR calls per second and the host cycles their bodies take per second (TSC on x86, else ns), plus
+// an estimate for the ESP32 with --entry-cycles of interrupt entry / exit / driver overhead per call.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o hv_sim tools/hv_sim/hv_sim.cpp
+// Run:
+//   ./hv_sim [--temp C] [--cps CPS] [--hours H] [--seed N] [--isr] [--entry-cycles N]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycles"
+static inline uint64_t host_cycles() { return __rdtsc(); }
+#else
+#define CYCLE_UNIT "ns"
+static inline uint64_t host_cycles() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+#endif
+
+#include "drivers/sensors/hv_charger.hpp"
+
+struct Model {
+  double full_v = 400.0;      // comparator threshold
+  double min_v = 380.0;       // tube needs at least this
+  double supply_v = 600.0;    // asymptotic voltage of the charge pump
+  double charge_v = 4.0;      // volts per charge pulse (at 0V)
+  double tau_20c_s = 200.0;   // leakage time constant at 20 degC
+  double gm_pulse_v = 0.05;   // volts per GM pulse
+};
+
+// the HAL is plain function pointers, so the simulated hardware is global
+static Model model;
+static double voltage;
+static bool cap_full;
+static long charge_pulses_total, recharges, failures;
+
+static void sim_set_fet(bool on) {
+  if (on) {
+    voltage += model.charge_v * (1.0 - voltage / model.supply_v);
+    if (voltage >= model.full_v)
+      cap_full = true;
+  }
+}
+static bool sim_cap_full(void) { return cap_full; }
+static void sim_clear_cap_full(void) { cap_full = false; }
+static void sim_charged(int pulses, bool ok, uint32_t /*interval_us*/) {
+  charge_pulses_total += pulses;
+  recharges++;
+  if (!ok)
+    failures++;
+}
+
+static const HvChargerHal sim_hal = {sim_set_fet, sim_cap_full, sim_clear_cap_full, sim_charged};
+
+// same timing as the firmware (see sensors.cpp)
+static const HvTiming sim_timing = {1500, 1000, 1000000, 1000, 10000000, 10 * 60 * 1000000, 3333};
+
+// alternative control laws to compare against HvAdaptiveLaw
+
+struct FixedLaw {  // recharge every second, no adaption
+  static uint32_t next(uint32_t /*interval_us*/, int /*charge_pulses*/) { return 1000000; }
+};
+
+struct ProportionalLaw {  // aim for 3 pulses, scale proportionally
+  static uint32_t next(uint32_t interval_us, int charge_pulses) {
+    return (uint32_t)((uint64_t)interval_us * 3 / (charge_pulses ? charge_pulses : 1));
+  }
+};
+
+struct Result {
+  double wakeups_per_h, pulses_per_h, min_v, below_min_pct, converged_s, final_interval_s;
+};
+
+// Capacitor between two steps: leakage and GM pulses for dt_s.
+static void discharge(double dt_s, double tau_s, double cps, std::mt19937 &rng) {
+  std::poisson_distribution<long> gm(cps * dt_s);
+  voltage = voltage * exp(-dt_s / tau_s) - gm(rng) * model.gm_pulse_v;
+  if (voltage < 0)
+    voltage = 0;
+}
+
+template <class Law>
+static Result simulate(double temp_c, double cps, double hours, unsigned seed) {
+  std::mt19937 rng(seed);
+  double tau_s = model.tau_20c_s / pow(2.0, (temp_c - 20.0) / 10.0);
+  voltage = model.full_v;
+  cap_full = false;
+  charge_pulses_total = recharges = failures = 0;
+
+  HvCharger<Law> charger(sim_hal, sim_timing);
+  double t_s = 0, end_s = hours * 3600.0;
+  long wakeups = 0;
+  double min_v = voltage, below_s = 0;
+  std::vector<std::pair<double, double>> intervals;  // (time, log(interval)) after every recharge
+  while (t_s < end_s) {
+    long before = recharges;
+    double dt_s = charger.step() / 1e6;
+    wakeups++;
+    if (recharges != before)
+      intervals.push_back({t_s, log((double)charger.interval())});
+    // let the capacitor discharge until the next step
+    double v0 = voltage;
+    discharge(dt_s, tau_s, cps, rng);
+    if (voltage < min_v)
+      min_v = voltage;
+    if (voltage < model.min_v)
+      below_s += (v0 < model.min_v) ? dt_s : dt_s * (model.min_v - voltage) / (v0 - voltage);
+    t_s += dt_s;
+  }
+  // converged: first time the interval is within a factor of 1.5 of its (geometric) mean over the 2nd half of the run
+  double log_mean = 0;
+  size_t half = intervals.size() / 2;
+  for (size_t i = half; i < intervals.size(); i++)
+    log_mean += intervals[i].second;
+  log_mean /= (intervals.size() - half);
+  double converged_s = t_s;
+  for (auto &iv : intervals) {
+    if (fabs(iv.second - log_mean) < log(1.5)) {
+      converged_s = iv.first;
+      break;
+    }
+  }
+  return {wakeups / hours, charge_pulses_total / hours, min_v, 100.0 * below_s / t_s, converged_s, exp(log_mean) / 1e6};
+}
+
+// ISRs of the two schemes. Like in the firmware they are called through a function pointer and keep
+// their state in globals, so the compiler can't fold the interrupts fired back to back into one.
+#define POLL_PERIOD_US 100
+
+static HvCharger<> *isr_charger;
+static uint32_t isr_delay_us;  // delay of the last step, for the capacitor model
+static uint32_t poll_current, poll_next_state;
+
+// The old scheme: a timer interrupt every 100 us, which only runs the state machine once the
+// periods until its next step have passed (isr_recharge() before the one-shot timer).
+static bool polling_isr(void) {
+  if (++poll_current < poll_next_state)
+    return false;  // nothing to do yet
+  poll_current = 0;
+  isr_delay_us = isr_charger->step();
+  poll_next_state = isr_delay_us / POLL_PERIOD_US;
+  return true;
+}
+
+// The one-shot alarm: every interrupt runs the state machine and programs the next deadline.
+static bool one_shot_isr(void) {
+  isr_delay_us = isr_charger->step();
+  return true;
+}
+
+struct IsrResult {
+  double calls_per_s, cycles_per_s, pulses_per_h;
+};
+
+// Runs the scenario with the given ISR. Only the ISRs are timed: interrupts are fired back to back
+// until one ran the state machine, then the capacitor model catches up until the next step is due.
+static IsrResult isr_load(bool (*isr)(void), double temp_c, double cps, double hours, unsigned seed) {
+  std::mt19937 rng(seed);
+  double tau_s = model.tau_20c_s / pow(2.0, (temp_c - 20.0) / 10.0);
+  voltage = model.full_v;
+  cap_full = false;
+  charge_pulses_total = recharges = failures = 0;
+
+  HvCharger<> charger(sim_hal, sim_timing);
+  isr_charger = &charger;
+  poll_current = poll_next_state = 0;
+  bool (*volatile fire)(void) = isr;
+  // cost of reading the counter, subtracted from every measurement
+  uint64_t overhead = ~0ULL;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t start = host_cycles();
+    uint64_t c = host_cycles() - start;
+    overhead = (c < overhead) ? c : overhead;
+  }
+
+  uint64_t calls = 0, cycles = 0;
+  double t_s = 0, end_s = hours * 3600.0;
+  while (t_s < end_s) {
+    uint64_t n = 1;
+    uint64_t start = host_cycles();
+    while (!fire())
+      n++;
+    uint64_t c = host_cycles() - start;
+    cycles += (c > overhead) ? c - overhead : 0;
+    calls += n;
+    // the next step is due after isr_delay_us with either scheme
+    discharge(isr_delay_us / 1e6, tau_s, cps, rng);
+    t_s += isr_delay_us / 1e6;
+  }
+  return {calls / t_s, cycles / t_s, charge_pulses_total / hours};
+}
+
+static void print(const char *name, const Result &r) {
+  printf("%-14s %12.0f %12.0f %8.1f %9.3f %12.0f %12.3f\n", name,
+         r.wakeups_per_h, r.pulses_per_h, r.min_v, r.below_min_pct, r.converged_s, r.final_interval_s);
+}
+
+static void print_isr(const char *name, const IsrResult &r, uint32_t entry_cycles) {
+  // the host cycles of the bodies stand in for the ESP32 ones, the entry overhead dominates anyway
+  double esp32 = r.calls_per_s * entry_cycles + r.cycles_per_s;
+  printf("%-14s %12.1f %14.0f %16.0f %10.4f %12.0f\n", name, r.calls_per_s, r.cycles_per_s, esp32,
+         100.0 * esp32 / 240e6, r.pulses_per_h);
+}
+
+int main(int argc, char **argv) {
+  double temp_c = 20.0, cps = 1.0, hours = 24.0;
+  unsigned seed = 1;
+  bool isr = false;
+  uint32_t entry_cycles = 300;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--temp") && i + 1 < argc)
+      temp_c = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--cps") && i + 1 < argc)
+      cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--hours") && i + 1 < argc)
+      hours = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--isr"))
+      isr = true;
+    else if (!strcmp(argv[i], "--entry-cycles") && i + 1 < argc)
+      entry_cycles = (uint32_t)atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--temp C] [--cps CPS] [--hours H] [--seed N] [--isr] [--entry-cycles N]\n", argv[0]);
+      return 1;
+    }
+  }
+  printf("temp %.1f degC, %.1f cps, %.1f h\n", temp_c, cps, hours);
+  if (isr) {
+    printf("%-14s %12s %14s %16s %10s %12s\n", "timer", "ISR calls/s", "host " CYCLE_UNIT "/s",
+           "ESP32 cycles/s", "% 240MHz", "pulses/h");
+    print_isr("periodic 100us", isr_load(polling_isr, temp_c, cps, hours, seed), entry_cycles);
+    print_isr("one-shot", isr_load(one_shot_isr, temp_c, cps, hours, seed), entry_cycles);
+    printf("ESP32 cycles/s: calls x %u cycles interrupt entry / exit / driver (estimate, --entry-cycles)\n"
+           "plus the host " CYCLE_UNIT " of the ISR bodies\n", entry_cycles);
+    return 0;
+  }
+  printf("%-14s %12s %12s %8s %9s %12s %12s\n", "law", "wakeups/h", "pulses/h", "min V", "<min [%]", "converged s", "mean intv s");
+  print("adaptive", simulate<HvAdaptiveLaw>(temp_c, cps, hours, seed));
+  print("fixed 1s", simulate<FixedLaw>(temp_c, cps, hours, seed));
+  print("proportional", simulate<ProportionalLaw>(temp_c, cps, hours, seed));
+  return 0;
+}
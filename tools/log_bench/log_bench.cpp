@@ -0,0 +1,300 @@
+// Benchmark of the logging backend (src/core/log_format.hpp): per-call cost in the calling task for
+// - a LOG() call below LOG_MIN_LEVEL (compiled out),
+// - a call filtered by the run time log level,
+// - the ring: pack format pointer + arguments into the lock-free ring (1..N producer threads, one
+//   consumer thread renders the messages like logTask),
+// - the old synchronous path: vsnprintf() twice into a VLA, utc prefix, "Serial.println()",
+// with a message mix like the firmware's (short status lines, floats, a ~350 byte HTTP body).
+// The consumer checks every rendered message against vsnprintf() (single producer run).
+//
+// The UART is not simulated: the old path additionally blocks the caller for up to the wire time of
+// the line (10 bits per byte at --baud), which is printed separately.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -Isrc -o log_bench tools/log_bench/log_bench.cpp src/core/log_format.cpp src/core/timestamp.cpp
+// Run:
+//   ./log_bench [--calls N] [--producers P] [--baud B]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "core/log_format.hpp"
+#include "core/timestamp.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// same values as src/core/core.hpp / core.cpp
+#define DEBUG 0
+#define INFO 1
+#define WARNING 2
+#define LOG_MIN_LEVEL INFO
+#define LOG_PREFIX_FORMAT "GEIGER: %s "
+#define LOG_PREFIX_LEN (7+1+23+1)
+#define OLD_PREFIX_LEN (7+1+19+1)  // before the milliseconds
+#define LOG_LINE_LEN 512
+
+static volatile int log_level = INFO;  // run time level
+static LogRing ring;
+static char sink[LOG_PREFIX_LEN + LOG_LINE_LEN + 2];  // "Serial"
+static volatile size_t sink_bytes;
+
+static void write_sink(const char *line, size_t len) {
+  memcpy(sink, line, std::min(len, sizeof(sink)));
+  sink_bytes = sink_bytes + len;
+}
+
+static uint32_t mono_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch()).count();
+}
+
+// the old clock.cpp: gmtime() and strftime() per call
+static char *format_utc_old(time_t t, char *buffer) {
+  struct tm ti;
+  gmtime_r(&t, &ti);
+  strftime(buffer, 20, "%Y-%m-%dT%H:%M:%S", &ti);
+  return buffer;
+}
+
+// --- the logging paths, noinline like log() in the firmware (another translation unit) ---
+
+__attribute__((noinline, format(printf, 2, 3))) static void log_ring(int level, const char *format, ...) {
+  if (level < log_level)
+    return;
+  va_list args;
+  va_start(args, format);
+  ring.write(mono_ms(), level, format, args);
+  va_end(args);
+}
+
+// CoreServices::logMessageVa() before the ring
+__attribute__((noinline, format(printf, 2, 3))) static void log_sync(int level, const char *format, ...) {
+  if (level < log_level)
+    return;
+  va_list args, args_copy;
+  va_start(args, format);
+  va_copy(args_copy, args);
+  int needed = vsnprintf(NULL, 0, format, args_copy);
+  va_end(args_copy);
+  char buf[needed + 1 + OLD_PREFIX_LEN];
+  char utc[20];
+  sprintf(buf, LOG_PREFIX_FORMAT, format_utc_old(time(nullptr), utc));
+  vsprintf(buf + OLD_PREFIX_LEN, format, args);
+  va_end(args);
+  write_sink(buf, strlen(buf));
+}
+
+#define LOG_RING(level, ...) do { if ((level) >= LOG_MIN_LEVEL) log_ring((level), __VA_ARGS__); } while (0)
+
+// --- message mix ---
+
+static const int KINDS = 4;
+static char bodies[16][400];
+
+static void make_bodies() {
+  for (int i = 0; i < 16; i++)
+    snprintf(bodies[i], sizeof(bodies[i]),
+             "{\"software_version\": \"V1.17.0-dev\", \"sensordatavalues\": ["
+             "{\"value_type\": \"counts_per_minute\", \"value\": \"%d\"}, "
+             "{\"value_type\": \"hv_pulses\", \"value\": \"%d\"}, "
+             "{\"value_type\": \"counts\", \"value\": \"%d\"}, "
+             "{\"value_type\": \"sample_time_ms\", \"value\": \"%d\"}]}",
+             20 + i, 3 + i, 30 + i, 90000 + i);
+}
+
+static const char *FMT_MQTT = "MQTT: published %s (%u bytes), seq %lu";
+static const char *FMT_THP = "Sensor: T=%.1f C, H=%.1f %%, P=%.2f hPa";
+static const char *FMT_HTTP = "http request body: %s";
+static const char *FMT_LORA = "LoRa: Waiting for transmission to complete (timeout: %ld ms)...";
+static const char *TOPIC = "multigeiger/esp32-5622542/measurement";
+
+template <class F>
+static void message(uint32_t i, F &&log) {
+  switch (i % KINDS) {
+  case 0: log(FMT_MQTT, TOPIC, (unsigned)(180 + i % 50), (unsigned long)i); break;
+  case 1: log(FMT_THP, 21.0 + (i % 100) * 0.1, 40.0 + (i % 30), 1013.25 - (i % 20) * 0.5); break;
+  case 2: log(FMT_HTTP, bodies[i % 16]); break;
+  default: log(FMT_LORA, 30000L + i); break;
+  }
+}
+
+#define CALL_RING [](const char *f, auto... a) { log_ring(INFO, f, a...); }
+#define CALL_SYNC [](const char *f, auto... a) { log_sync(INFO, f, a...); }
+#define CALL_REF(buf) [&](const char *f, auto... a) { snprintf(buf, sizeof(buf), f, a...); }
+
+// --- measurements ---
+
+static double now_overhead_ns() {
+  const int n = 100000;
+  double total = 0;
+  for (int i = 0; i < n; i++) {
+    Clock::time_point t0 = Clock::now();
+    Clock::time_point t1 = Clock::now();
+    total += std::chrono::duration<double, std::nano>(t1 - t0).count();
+  }
+  return total / n;
+}
+
+struct Result {
+  std::vector<double> ns;  // per call
+  uint32_t full = 0;       // calls which found the ring full (dropped)
+};
+
+static void report(const char *name, std::vector<double> &ns, double overhead, uint32_t dropped) {
+  std::sort(ns.begin(), ns.end());
+  double sum = 0;
+  for (double v : ns)
+    sum += std::max(0.0, v - overhead);
+  auto pct = [&](double p) { return std::max(0.0, ns[(size_t)(p * (ns.size() - 1))] - overhead); };
+  printf("%-34s %9.0f %9.0f %9.0f %9.0f", name, sum / ns.size(), pct(0.5), pct(0.99), pct(1.0));
+  if (dropped != UINT32_MAX)
+    printf(" %8u", dropped);
+  printf("\n");
+}
+
+static std::atomic<bool> consumer_stop{false};
+static std::atomic<uint32_t> consumed{0};
+static std::atomic<uint32_t> mismatches{0};
+static std::atomic<uint32_t> truncated{0};
+
+// logTask: render, prefix, "Serial.write()"; with check, compare against snprintf (single producer)
+static void consumer(bool check) {
+  char line[LOG_PREFIX_LEN + LOG_LINE_LEN + 2];
+  uint32_t i = 0;
+  for (;;) {
+    LogMessage m;
+    if (!ring.read(m, line + LOG_PREFIX_LEN, LOG_LINE_LEN)) {
+      if (consumer_stop)
+        break;
+      std::this_thread::yield();
+      continue;
+    }
+    if (check) {
+      char expected[LOG_LINE_LEN];
+      message(i++, CALL_REF(expected));
+      if (strcmp(expected, line + LOG_PREFIX_LEN)) {
+        if (!mismatches++)
+          fprintf(stderr, "mismatch:\n  %s\n  %s\n", expected, line + LOG_PREFIX_LEN);
+      }
+    }
+    if (m.truncated)
+      truncated++;
+    uint32_t age_ms = mono_ms() - m.time_ms;  // like logTask: back from now, then to utc
+    char utc[UTC_MS_LEN], prefix[LOG_PREFIX_LEN + 1];
+    snprintf(prefix, sizeof(prefix), LOG_PREFIX_FORMAT, format_utc_ms((uint64_t)time(nullptr) * 1000 - age_ms, utc));
+    memcpy(line, prefix, LOG_PREFIX_LEN);
+    size_t n = LOG_PREFIX_LEN + m.len;
+    line[n++] = '\r';
+    line[n++] = '\n';
+    write_sink(line, n);
+    consumed++;
+  }
+}
+
+static void producer(uint32_t calls, Result &r) {
+  r.ns.reserve(calls);
+  for (uint32_t i = 0; i < calls; i++) {
+    // keep the ring from overflowing (not timed): the firmware logs in bursts, not in a tight loop
+    while (ring.size() > LOG_RING_SLOTS / 2)
+      std::this_thread::yield();
+    uint32_t before;
+    uint32_t queued, dropped, high;
+    ring.readStats(queued, before, high);
+    Clock::time_point t0 = Clock::now();
+    message(i, CALL_RING);
+    Clock::time_point t1 = Clock::now();
+    r.ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    ring.readStats(queued, dropped, high);
+    r.full += dropped - before;
+  }
+}
+
+static void run_ring(int producers, uint32_t calls, double overhead) {
+  consumer_stop = false;
+  consumed = 0;
+  std::thread cons(consumer, producers == 1);
+  std::vector<Result> results(producers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++)
+    threads.emplace_back(producer, calls, std::ref(results[p]));
+  for (std::thread &t : threads)
+    t.join();
+  consumer_stop = true;
+  cons.join();
+  std::vector<double> all;
+  uint32_t full = 0;
+  for (Result &r : results) {
+    all.insert(all.end(), r.ns.begin(), r.ns.end());
+    full += r.full;
+  }
+  char name[48];
+  snprintf(name, sizeof(name), "ring, %d producer%s", producers, (producers > 1) ? "s" : "");
+  report(name, all, overhead, full);
+}
+
+int main(int argc, char **argv) {
+  uint32_t calls = 200000;
+  int max_producers = 4;
+  int baud = 115200;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--calls") && (i + 1 < argc))
+      calls = strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--producers") && (i + 1 < argc))
+      max_producers = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--baud") && (i + 1 < argc))
+      baud = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--calls N] [--producers P] [--baud B]\n", argv[0]);
+      return 2;
+    }
+  }
+  make_bodies();
+  double overhead = now_overhead_ns();
+
+  printf("ring: %d slots of %zu bytes, max. %d bytes of arguments per message\n",
+         LOG_RING_SLOTS, sizeof(LogRecord), LOG_ARGS_MAX);
+  printf("%-34s %9s %9s %9s %9s %8s\n", "per call [ns]", "mean", "p50", "p99", "max", "dropped");
+
+  // compiled out / filtered at run time: too cheap to time per call, time the whole loop
+  {
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < calls; i++)
+      LOG_RING(DEBUG, FMT_LORA, 30000L + i);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / calls;
+    printf("%-34s %9.1f\n", "LOG() below LOG_MIN_LEVEL", ns);
+    log_level = WARNING;
+    t0 = Clock::now();
+    for (uint32_t i = 0; i < calls; i++)
+      message(i, CALL_RING);
+    ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / calls;
+    printf("%-34s %9.1f\n", "filtered by the run time level", ns);
+    log_level = INFO;
+  }
+
+  for (int p = 1; p <= max_producers; p *= 2)
+    run_ring(p, calls / p, overhead);
+
+  std::vector<double> ns;
+  ns.reserve(calls);
+  size_t bytes_before = sink_bytes;
+  for (uint32_t i = 0; i < calls; i++) {
+    Clock::time_point t0 = Clock::now();
+    message(i, CALL_SYNC);
+    Clock::time_point t1 = Clock::now();
+    ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+  }
+  double line_bytes = (double)(sink_bytes - bytes_before) / calls + 2;  // + println's \r\n
+  report("old: vsnprintf x2 + prefix", ns, overhead, UINT32_MAX);
+
+  printf("\nmismatches: %u, truncated: %u\n", mismatches.load(), truncated.load());
+  if (baud > 0)
+    printf("the old path also waited for the UART: %.0f bytes per line on average = up to %.0f us at %d baud\n",
+           line_bytes, line_bytes * 10 * 1e6 / baud, baud);
+  return mismatches ? 1 : 0;
+}
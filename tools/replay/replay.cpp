@@ -0,0 +1,357 @@
+// Replays GM pulse timestamps through the firmware's measurement pipeline
+// (src/app/measurement_pipeline.hpp: counters, rates, local alarm, live / interval records,
+// one minute log, pulse interval histogram) at full speed, with the stage cadence of the
+// controller: tube every 250 ms, live record every 10 s (earlier at high count rates),
+// interval record every 90 s, one minute log and histogram every 60 s.
+//
+// Pulses are taken as they come, the tube's dead time is assumed to be in the trace already.
+//
+// Trace formats:
+//   text     one pulse time [us] since start per line, lines starting with # are skipped
+//   delta32  little endian uint32: time [us] since the previous pulse (the first: since start)
+//
+// Build (from the repository root):
+//   g++ -O2 -std=gnu++17 -Isrc -o replay tools/replay/replay.cpp
+//       src/app/measurement_pipeline.cpp src/app/rate_estimator.cpp src/app/alarm_engine.cpp
+// Run:
+//   ./replay --trace FILE [--format text|delta32] [options]
+//   ./replay --cps CPS --hours H [--step-at H --step-factor F] [--seed N] [--write FILE] [options]
+// Options:
+//   --alarm-factor F --alarm-threshold USVPH   local alarm settings (default 3 / 1.0)
+//   --tube-factor F                            cps -> uSv/h (default 0.0057, Si22G)
+//   --out FILE | --quiet                       records as CSV (default stdout)
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "app/measurement_pipeline.hpp"
+
+static const uint32_t TUBE_MS = 250;
+static const uint32_t AFTERSTART_MS = 5000;
+static const uint32_t DISPLAYREFRESH_MS = 10000;
+static const uint32_t MEASUREMENT_MS = 90000;
+static const uint32_t MINUTE_MS = 60000;
+
+// --- pulse sources ---
+
+class PulseStream {
+public:
+  virtual ~PulseStream() {}
+  // next pulse time [us since start], false at the end
+  virtual bool next(uint64_t &t_us) = 0;
+};
+
+class TextTrace : public PulseStream {
+public:
+  explicit TextTrace(FILE *f) : f(f) {}
+  bool next(uint64_t &t_us) override {
+    // hand made parser, fscanf would be the bottleneck for multi-day traces
+    uint64_t value = 0;
+    bool digits = false, comment = false;
+    for (;;) {
+      if (pos == len) {
+        len = fread(buf, 1, sizeof(buf), f);
+        pos = 0;
+        if (!len) {
+          if (digits) {
+            t_us = value;
+            return true;
+          }
+          return false;
+        }
+      }
+      char c = buf[pos++];
+      if (c == '\n') {
+        comment = false;
+        if (digits) {
+          t_us = value;
+          return true;
+        }
+      } else if (comment) {
+        continue;
+      } else if (c == '#') {
+        comment = true;
+      } else if ((c >= '0') && (c <= '9')) {
+        value = value * 10 + (c - '0');
+        digits = true;
+      }
+    }
+  }
+
+private:
+  FILE *f;
+  char buf[1 << 16];
+  size_t pos = 0, len = 0;
+};
+
+class Delta32Trace : public PulseStream {
+public:
+  explicit Delta32Trace(FILE *f) : f(f) {}
+  bool next(uint64_t &t_us) override {
+    if (pos == len) {
+      len = fread(buf, sizeof(uint32_t), sizeof(buf) / sizeof(uint32_t), f);
+      pos = 0;
+      if (!len)
+        return false;
+    }
+    t += buf[pos++];
+    t_us = t;
+    return true;
+  }
+
+private:
+  FILE *f;
+  uint32_t buf[1 << 14];
+  size_t pos = 0, len = 0;
+  uint64_t t = 0;
+};
+
+// Poisson pulses at cps, times step_factor from step_at_us on, until end_us
+class SyntheticTrace : public PulseStream {
+public:
+  SyntheticTrace(double cps, uint64_t end_us, uint64_t step_at_us, double step_factor, unsigned seed)
+    : cps(cps), end_us(end_us), step_at_us(step_at_us), step_factor(step_factor), rng(seed) {}
+  bool next(uint64_t &t_us) override {
+    double rate = (t >= step_at_us) ? cps * step_factor : cps;
+    std::exponential_distribution<double> interval(rate / 1e6);
+    t += (uint64_t)interval(rng) + 1;
+    if (t > end_us)
+      return false;
+    t_us = t;
+    return true;
+  }
+
+private:
+  double cps;
+  uint64_t end_us, step_at_us;
+  double step_factor;
+  std::mt19937_64 rng;
+  uint64_t t = 0;
+};
+
+// --- simulated device ---
+
+struct Replay {
+  MeasurementPipeline pipeline;
+  PulseStream *pulses;
+  FILE *write = nullptr;       // copy of the pulses as delta32
+  uint64_t now_us = 0;
+  uint64_t pending_us = 0;     // next pulse, already read
+  bool have_pending = false;
+  bool done = false;
+  uint64_t last_pulse_us = 0;
+  uint64_t total_pulses = 0;
+  uint32_t intervals[256];
+  size_t n_intervals = 0;
+};
+
+static uint32_t replay_millis(void *context) {
+  // wraps after 49.7 days like millis()
+  return (uint32_t)(static_cast<Replay *>(context)->now_us / 1000);
+}
+
+static uint64_t replay_utc_ms(void *context) {
+  return 1700000000000ULL + static_cast<Replay *>(context)->now_us / 1000;
+}
+
+static void replay_read_pulses(unsigned long &counts, unsigned long &timestamp, void *context) {
+  // like read_GMC: everything up to now, intervals in batches
+  Replay &r = *static_cast<Replay *>(context);
+  for (;;) {
+    if (!r.have_pending) {
+      if (r.done || !r.pulses->next(r.pending_us)) {
+        r.done = true;
+        break;
+      }
+      r.have_pending = true;
+    }
+    if (r.pending_us > r.now_us)
+      break;
+    r.have_pending = false;
+    if (r.write) {
+      uint32_t delta = (uint32_t)(r.pending_us - r.last_pulse_us);
+      fwrite(&delta, sizeof(delta), 1, r.write);
+    }
+    if (r.total_pulses) {
+      r.intervals[r.n_intervals++] = (uint32_t)(r.pending_us - r.last_pulse_us);
+      if (r.n_intervals == sizeof(r.intervals) / sizeof(r.intervals[0])) {
+        r.pipeline.addIntervals(r.intervals, r.n_intervals);
+        r.n_intervals = 0;
+      }
+    }
+    r.last_pulse_us = r.pending_us;
+    r.total_pulses++;
+    counts++;
+    timestamp = (unsigned long)(r.pending_us / 1000);
+  }
+  if (r.n_intervals) {
+    r.pipeline.addIntervals(r.intervals, r.n_intervals);
+    r.n_intervals = 0;
+  }
+}
+
+static void print_record(const MeasurementRecord &m, void *context) {
+  FILE *out = static_cast<FILE *>(context);
+  fprintf(out, "%s,%u,%u,0x%02x,%u,%u,%.3f,%.3f,%u,%.4f,%u,%u,%.4f,%.4f\n",
+          m.kind == RECORD_LIVE ? "live" : "interval", m.seq, m.uptime_ms, m.status, m.counts, m.dt_ms,
+          m.cps, m.cps_err, m.cpm, m.dose_uSvph, m.total_counts, m.total_ms, m.total_cps, m.total_dose_uSvph);
+}
+
+static void usage(const char *name) {
+  fprintf(stderr, "usage: %s (--trace FILE [--format text|delta32] | --cps CPS --hours H [--step-at H --step-factor F]"
+          " [--seed N] [--write FILE]) [--alarm-factor F] [--alarm-threshold USVPH] [--tube-factor F] [--out FILE | --quiet]\n", name);
+}
+
+int main(int argc, char **argv) {
+  const char *trace = nullptr, *format = "text", *out_name = nullptr, *write_name = nullptr;
+  double cps = 0, hours = 0, step_at_h = -1, step_factor = 1;
+  unsigned seed = 1;
+  int alarm_factor = 3;
+  float alarm_threshold = 1.0f, tube_factor = 0.0057f;
+  bool quiet = false;
+  for (int i = 1; i < argc; i++) {
+    bool more = i + 1 < argc;
+    if (!strcmp(argv[i], "--trace") && more)
+      trace = argv[++i];
+    else if (!strcmp(argv[i], "--format") && more)
+      format = argv[++i];
+    else if (!strcmp(argv[i], "--cps") && more)
+      cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--hours") && more)
+      hours = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--step-at") && more)
+      step_at_h = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--step-factor") && more)
+      step_factor = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && more)
+      seed = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--write") && more)
+      write_name = argv[++i];
+    else if (!strcmp(argv[i], "--alarm-factor") && more)
+      alarm_factor = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--alarm-threshold") && more)
+      alarm_threshold = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--tube-factor") && more)
+      tube_factor = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--out") && more)
+      out_name = argv[++i];
+    else if (!strcmp(argv[i], "--quiet"))
+      quiet = true;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  static Replay r;  // large (histograms), keep it off the stack
+  FILE *in = nullptr;
+  if (trace) {
+    in = fopen(trace, "rb");
+    if (!in) {
+      perror(trace);
+      return 1;
+    }
+    if (!strcmp(format, "delta32"))
+      r.pulses = new Delta32Trace(in);
+    else if (!strcmp(format, "text"))
+      r.pulses = new TextTrace(in);
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  } else if ((cps > 0) && (hours > 0)) {
+    uint64_t step_at_us = (step_at_h >= 0) ? (uint64_t)(step_at_h * 3600e6) : UINT64_MAX;
+    r.pulses = new SyntheticTrace(cps, (uint64_t)(hours * 3600e6), step_at_us, step_factor, seed);
+  } else {
+    usage(argv[0]);
+    return 1;
+  }
+  if (write_name && !(r.write = fopen(write_name, "wb"))) {
+    perror(write_name);
+    return 1;
+  }
+  FILE *out = quiet ? nullptr : (out_name ? fopen(out_name, "w") : stdout);
+  if (!quiet && !out) {
+    perror(out_name);
+    return 1;
+  }
+
+  MeasurementFanout live, interval;
+  if (out) {
+    fprintf(out, "kind,seq,uptime_ms,status,counts,dt_ms,cps,cps_err,cpm,dose_uSvph,total_counts,total_ms,total_cps,total_dose_uSvph\n");
+    live.add(print_record, out);
+    interval.add(print_record, out);
+  }
+
+  MeasurementSources sources{replay_millis, replay_utc_ms, replay_read_pulses, &r};
+  r.pipeline.begin(sources, "Si22G", 2, tube_factor);
+  r.pipeline.setHv(false, 0);
+  r.pipeline.setWifiStatus(0, false);
+
+  uint64_t next_live = AFTERSTART_MS, next_interval = MEASUREMENT_MS, next_minute = MINUTE_MS;
+  uint64_t records = 0, alarms = 0, minute_logs = 0;
+  MeasurementRecord m;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t now_ms = TUBE_MS; !r.done || r.have_pending; now_ms += TUBE_MS) {
+    r.now_us = now_ms * 1000;
+    r.pipeline.configureAlarm(true, alarm_factor, alarm_threshold);
+    TubeResult tube = r.pipeline.tube();
+    if (tube.alarm == ALARM_RAISED) {
+      alarms++;
+      fprintf(stderr, "%.1f s: local alarm raised (%s), detected after %.1f s\n", now_ms / 1000.0,
+              r.pipeline.alarm().byThreshold() ? "threshold" : "relative", r.pipeline.alarm().detectionDelayMs() / 1000.0);
+    } else if (tube.alarm == ALARM_CLEARED) {
+      fprintf(stderr, "%.1f s: local alarm cleared\n", now_ms / 1000.0);
+    }
+    if (tube.display_due || (now_ms >= next_live)) {
+      if (r.pipeline.liveRecord(m)) {
+        live.publish(m);
+        records++;
+      }
+      next_live = now_ms + DISPLAYREFRESH_MS;
+    }
+    if (now_ms >= next_interval) {
+      if (r.pipeline.intervalRecord(m)) {
+        interval.publish(m);
+        records++;
+      }
+      next_interval += MEASUREMENT_MS;
+    }
+    if (now_ms >= next_minute) {
+      uint32_t time_s, cpm, counts;
+      if (r.pipeline.oneMinute(time_s, cpm, counts))
+        minute_logs++;
+      r.pipeline.rotateHistogram();
+      next_minute += MINUTE_MS;
+    }
+  }
+  // end of the trace: report the incomplete interval as well
+  if (r.pipeline.intervalRecord(m)) {
+    interval.publish(m);
+    records++;
+  }
+  r.pipeline.rotateHistogram();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  const IntervalHistogram &intervals = r.pipeline.intervalsTotal();
+  RateEstimate total = r.pipeline.total();
+  fprintf(stderr, "%llu pulses over %.1f h simulated, %.3f cps, %llu records, %llu one minute logs, %llu alarms\n",
+          (unsigned long long)r.total_pulses, r.now_us / 3600e6, total.cps,
+          (unsigned long long)records, (unsigned long long)minute_logs, (unsigned long long)alarms);
+  fprintf(stderr, "pulse intervals [us]: %u, median %u, p99 %u\n", intervals.count(), intervals.percentile(0.5), intervals.percentile(0.99));
+  fprintf(stderr, "throughput: %.0f pulses/s, %.0fx real time (%.2f s wall)\n",
+          wall_s > 0 ? r.total_pulses / wall_s : 0.0, wall_s > 0 ? (r.now_us / 1e6) / wall_s : 0.0, wall_s);
+
+  if (out && (out != stdout))
+    fclose(out);
+  if (r.write)
+    fclose(r.write);
+  if (in)
+    fclose(in);
+  delete r.pulses;
+  return 0;
+}
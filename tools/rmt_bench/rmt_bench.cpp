@@ -0,0 +1,147 @@
+// Benchmark of the RMT frame decoder (src/drivers/sensors/rmt_decoder.hpp): Poisson GM pulses at
+// --cps, some with a false pulse on the rising edge, are recorded into RMT frames like the receiver
+// does (0.5 us ticks, a frame ends after 15 ms idle or when the 256 items of channel memory are full)
+// and decoded again like rmtTask. Reports ns per item / per pulse and the share of one core rmtTask
+// needs for decoding at that count rate. Every decoded timestamp is checked against the pulse train.
+// Above a few hundred cps the frames get full and the next one starts right away here, unlike on the
+// receiver: such rates only measure the decoder, the backend itself is not suited for them.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o rmt_bench tools/rmt_bench/rmt_bench.cpp src/drivers/sensors/rmt_decoder.cpp
+// Run:
+//   ./rmt_bench [--cps CPS] [--seconds S] [--glitch P] [--seed N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "drivers/sensors/rmt_decoder.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// same values as sensors.cpp
+#define TICKS_PER_US 2
+#define IDLE_TICKS (15000 * TICKS_PER_US)
+#define DEAD_TIME_TICKS (30 * TICKS_PER_US)
+#define MAX_ITEMS 256
+#define PULSE_TICKS (8 * TICKS_PER_US)
+#define ACTIVE_LEVEL 0
+
+struct Frame {
+  uint64_t start;
+  std::vector<uint32_t> items;
+};
+
+struct Recorder {
+  std::vector<Frame> frames;
+  std::vector<uint32_t> durations;
+  std::vector<int> levels;
+  uint64_t start = 0;
+
+  void segment(int level, uint32_t duration) {
+    levels.push_back(level);
+    durations.push_back(duration);
+  }
+
+  void end() {
+    Frame f = {start, {}};
+    for (size_t i = 0; i < durations.size(); i += 2) {
+      uint32_t d1 = (i + 1 < durations.size()) ? durations[i + 1] : 0;
+      int l1 = (i + 1 < durations.size()) ? levels[i + 1] : !levels[i];
+      f.items.push_back((durations[i] & 0x7FFF) | ((uint32_t)levels[i] << 15) | ((d1 & 0x7FFF) << 16) | ((uint32_t)l1 << 31));
+    }
+    if (durations.size() % 2 == 0)
+      f.items.push_back(0);
+    frames.push_back(f);
+    durations.clear();
+    levels.clear();
+  }
+};
+
+int main(int argc, char **argv) {
+  double cps = 100, seconds = 3600, glitch = 0.3;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--cps") && i + 1 < argc)
+      cps = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+      seconds = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--glitch") && i + 1 < argc)
+      glitch = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = (unsigned)atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [--cps CPS] [--seconds S] [--glitch P] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // pulse train: falling edges of valid pulses, plus false pulses within the dead time
+  std::mt19937 rng(seed);
+  std::exponential_distribution<double> gap(cps);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::vector<uint64_t> pulses, edges;
+  for (uint64_t t = 1000;;) {
+    t += DEAD_TIME_TICKS + 1 + (uint64_t)(gap(rng) * 1e6 * TICKS_PER_US);
+    if (t > seconds * 1e6 * TICKS_PER_US)
+      break;
+    pulses.push_back(t);
+    edges.push_back(t);
+    if (u(rng) < glitch)
+      edges.push_back(t + PULSE_TICKS + 2);
+  }
+
+  // record: a segment per level, durations > 15 bits are split, a frame ends after IDLE_TICKS or
+  // when the channel memory is full (the next edge starts a new frame then)
+  Recorder rec;
+  for (size_t i = 0; i < edges.size(); i++) {
+    if (rec.durations.empty())
+      rec.start = edges[i];
+    uint64_t next = (i + 1 < edges.size()) ? edges[i + 1] : UINT64_MAX;
+    uint32_t active = (next - edges[i] > PULSE_TICKS) ? PULSE_TICKS : (uint32_t)(next - edges[i]) / 2;
+    rec.segment(ACTIVE_LEVEL, active);
+    uint64_t idle = next - edges[i] - active;
+    if ((idle >= IDLE_TICKS) || (rec.durations.size() + 1 >= 2 * MAX_ITEMS - 1)) {
+      rec.end();
+    } else {
+      for (; idle > 0x7FFF; idle -= 0x7FFF)
+        rec.segment(!ACTIVE_LEVEL, 0x7FFF);
+      rec.segment(!ACTIVE_LEVEL, (uint32_t)idle);
+    }
+  }
+  size_t items = 0;
+  for (const Frame &f : rec.frames)
+    items += f.items.size();
+
+  // decode like rmtTask, repeated for a stable time
+  static uint64_t ts[MAX_ITEMS * 2];
+  std::vector<uint64_t> decoded;
+  int rounds = 0;
+  Clock::time_point t0 = Clock::now();
+  double elapsed;
+  do {
+    RmtDecoderState state = {};
+    decoded.clear();
+    for (const Frame &f : rec.frames) {
+      RmtDecodeResult r = rmt_decode_pulses(f.items.data(), f.items.size(), f.start, ACTIVE_LEVEL,
+                                            DEAD_TIME_TICKS, &state, ts, MAX_ITEMS * 2);
+      decoded.insert(decoded.end(), ts, ts + r.timestamps);
+    }
+    rounds++;
+    elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+  } while (elapsed < 0.5);
+
+  bool ok = (decoded == pulses);
+  double ns_item = elapsed * 1e9 / rounds / items;
+  double ns_pulse = elapsed * 1e9 / rounds / pulses.size();
+  printf("%g cps, %g s: %zu pulses, %zu false pulses, %zu frames, %zu items (%.1f per frame)\n",
+         cps, seconds, pulses.size(), edges.size() - pulses.size(), rec.frames.size(), items,
+         (double)items / rec.frames.size());
+  printf("decode: %.1f ns/item, %.1f ns/pulse, %.2f Mpulses/s on this host\n", ns_item, ns_pulse, 1e3 / ns_pulse);
+  printf("host cpu share at %g cps: %.4f %%\n", cps, ns_pulse * cps / 1e7);
+  printf("round trip: %s\n", ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+// Decoder for the Serial_Binary print mode (src/core/binary_stream.hpp): reads a capture of the USB
+// serial output (e.g. `cat /dev/ttyUSB0 > capture.bin` at SERIAL_BINARY_BAUD), checks every frame
+// (COBS, CRC-32, frame seq) and collects the records in columns, written as CSV with one header line:
+// - <prefix>measurements.csv: one row per live / interval record
+// - <prefix>pulses.csv: one row per pulse interval (index since boot, interval [us], time since the
+//   first pulse of the capture [us]), if the firmware sends them (SERIAL_BINARY_PULSES)
+// - <prefix>log.txt: the log messages
+// Lost frames, CRC errors and gaps in the record / pulse numbering go to stderr.
+//
+// --bench encodes a synthetic capture in memory (like the firmware at 1000 cps with pulses) and
+// reports the decoding speed (checking only, and into the columns), --corrupt flips random bits
+// first to exercise the resync.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -Isrc -o serial_decode tools/serial_decode/serial_decode.cpp src/core/binary_stream.cpp
+// Run:
+//   ./serial_decode capture.bin [--out PREFIX]
+//   ./serial_decode --bench [--mb N] [--corrupt RATE]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/binary_stream.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// --- columns ---
+
+struct MeasurementColumns {
+  std::vector<uint32_t> seq, utc, uptime_ms, counts, dt_ms, hv_pulses, cpm, total_counts, total_ms;
+  std::vector<uint8_t> kind, tube_nbr;
+  std::vector<uint16_t> status;
+  std::vector<float> cps, cps_err, dose_uSvph, temperature, humidity, pressure;
+
+  void add(const BinMeasurement &m) {
+    seq.push_back(m.seq);
+    kind.push_back(m.kind);
+    tube_nbr.push_back(m.tube_nbr);
+    status.push_back(m.status);
+    utc.push_back(m.utc);
+    uptime_ms.push_back(m.uptime_ms);
+    counts.push_back(m.counts);
+    dt_ms.push_back(m.dt_ms);
+    hv_pulses.push_back(m.hv_pulses);
+    cpm.push_back(m.cpm);
+    cps.push_back(m.cps);
+    cps_err.push_back(m.cps_err);
+    dose_uSvph.push_back(m.dose_uSvph);
+    total_counts.push_back(m.total_counts);
+    total_ms.push_back(m.total_ms);
+    temperature.push_back(m.temperature);
+    humidity.push_back(m.humidity);
+    pressure.push_back(m.pressure);
+  }
+
+  size_t size() const { return seq.size(); }
+};
+
+struct PulseColumns {
+  std::vector<uint32_t> index, interval_us;  // t_us (the running sum of interval_us) is added to the CSV
+
+  void reserve(size_t bytes) {
+    // an interval takes 1 - 5 bytes, typically 2 - 3
+    index.reserve(bytes / 2);
+    interval_us.reserve(bytes / 2);
+  }
+};
+
+struct Capture {
+  MeasurementColumns measurements;
+  PulseColumns pulses;
+  std::vector<std::string> log;
+  std::string version;
+  uint64_t info_frames = 0;
+  uint64_t measurement_frames = 0, pulse_intervals = 0, log_frames = 0;
+  uint64_t corrupt_records = 0;  // valid frame, but a payload that does not parse
+  uint64_t unknown_frames = 0;
+  uint64_t measurement_gaps = 0; // missing seq numbers of live / interval records
+  uint64_t pulse_gaps = 0;       // missing pulse intervals (frames lost in the firmware's log ring)
+  uint32_t next_seq[RECORD_KINDS] = {};
+  uint32_t next_pulse = 0;
+  bool have_pulse = false;
+  bool keep = true;              // false: only count (--bench)
+};
+
+static void on_frame(uint8_t type, uint8_t, const uint8_t *payload, size_t len, void *context) {
+  Capture &c = *static_cast<Capture *>(context);
+  switch (type) {
+  case BIN_INFO:
+    c.info_frames++;
+    if ((len >= 3) && (payload[len - 1] == 0))
+      c.version = reinterpret_cast<const char *>(payload + 2);
+    memset(c.next_seq, 0, sizeof(c.next_seq));  // the firmware (re)started, numbering starts over
+    c.have_pulse = false;
+    break;
+  case BIN_MEASUREMENT: {
+    BinMeasurement m;
+    if (!bin_parse_measurement(payload, len, m) || (m.kind >= RECORD_KINDS)) {
+      c.corrupt_records++;
+      break;
+    }
+    uint32_t &next = c.next_seq[m.kind];
+    if (next && (m.seq > next))
+      c.measurement_gaps += m.seq - next;
+    next = m.seq + 1;
+    c.measurement_frames++;
+    if (c.keep)
+      c.measurements.add(m);
+    break;
+  }
+  case BIN_PULSES: {
+    uint32_t intervals[BIN_MAX_PAYLOAD];
+    uint32_t first;
+    int n = bin_parse_pulses(payload, len, first, intervals, BIN_MAX_PAYLOAD);
+    if (n < 0) {
+      c.corrupt_records++;
+      break;
+    }
+    if (c.have_pulse && (first > c.next_pulse))
+      c.pulse_gaps += first - c.next_pulse;
+    c.have_pulse = true;
+    c.next_pulse = first + n;
+    c.pulse_intervals += n;
+    if (c.keep) {
+      for (int i = 0; i < n; i++) {
+        c.pulses.index.push_back(first + i);
+        c.pulses.interval_us.push_back(intervals[i]);
+      }
+    }
+    break;
+  }
+  case BIN_LOG:
+    c.log_frames++;
+    if (c.keep && len)
+      c.log.push_back(std::to_string(payload[0]) + " " + std::string(reinterpret_cast<const char *>(payload + 1), len - 1));
+    break;
+  default:
+    c.unknown_frames++;
+  }
+}
+
+// --- output ---
+
+static bool write_csv(const std::string &prefix, const Capture &c) {
+  std::string name = prefix + "measurements.csv";
+  FILE *f = fopen(name.c_str(), "w");
+  if (!f)
+    return false;
+  fprintf(f, "seq,kind,tube_nbr,status,utc,uptime_ms,counts,dt_ms,hv_pulses,cpm,cps,cps_err,dose_uSvph,"
+          "total_counts,total_ms,temperature,humidity,pressure\n");
+  const MeasurementColumns &m = c.measurements;
+  for (size_t i = 0; i < m.size(); i++)
+    fprintf(f, "%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.9g,%.9g,%.9g,%u,%u,%.9g,%.9g,%.9g\n",
+            m.seq[i], m.kind[i], m.tube_nbr[i], m.status[i], m.utc[i], m.uptime_ms[i], m.counts[i], m.dt_ms[i],
+            m.hv_pulses[i], m.cpm[i], m.cps[i], m.cps_err[i], m.dose_uSvph[i], m.total_counts[i], m.total_ms[i],
+            m.temperature[i], m.humidity[i], m.pressure[i]);
+  fclose(f);
+
+  if (!c.pulses.index.empty()) {
+    name = prefix + "pulses.csv";
+    if (!(f = fopen(name.c_str(), "w")))
+      return false;
+    fprintf(f, "index,interval_us,t_us\n");
+    uint64_t t_us = 0;
+    for (size_t i = 0; i < c.pulses.index.size(); i++) {
+      t_us += c.pulses.interval_us[i];
+      fprintf(f, "%u,%u,%llu\n", c.pulses.index[i], c.pulses.interval_us[i], (unsigned long long)t_us);
+    }
+    fclose(f);
+  }
+
+  name = prefix + "log.txt";
+  if (!(f = fopen(name.c_str(), "w")))
+    return false;
+  for (const std::string &line : c.log)
+    fprintf(f, "%s\n", line.c_str());
+  fclose(f);
+  return true;
+}
+
+static void summary(const BinFrameDecoder &d, const Capture &c, double seconds) {
+  const BinDecoderStats &s = d.stats();
+  fprintf(stderr, "firmware: %s\n", c.version.empty() ? "(no info frame)" : c.version.c_str());
+  fprintf(stderr, "%llu bytes, %llu frames: %llu measurements, %llu pulse intervals, %llu log lines, %llu info\n",
+          (unsigned long long)s.bytes, (unsigned long long)s.frames, (unsigned long long)c.measurement_frames,
+          (unsigned long long)c.pulse_intervals, (unsigned long long)c.log_frames, (unsigned long long)c.info_frames);
+  fprintf(stderr, "crc errors: %llu, oversized: %llu, frames lost (seq): %llu, corrupt records: %llu, unknown: %llu\n",
+          (unsigned long long)s.crc_errors, (unsigned long long)s.oversized, (unsigned long long)s.seq_gaps,
+          (unsigned long long)c.corrupt_records, (unsigned long long)c.unknown_frames);
+  fprintf(stderr, "missing measurement records: %llu, missing pulse intervals: %llu\n",
+          (unsigned long long)c.measurement_gaps, (unsigned long long)c.pulse_gaps);
+  if (seconds > 0)
+    fprintf(stderr, "decoded in %.3f s: %.0f MB/s, %.1f M frames/s\n", seconds, s.bytes / seconds / 1e6, s.frames / seconds / 1e6);
+}
+
+// --- synthetic capture ---
+
+static std::vector<uint8_t> synthetic(size_t bytes) {
+  std::vector<uint8_t> out;
+  out.reserve(bytes + 1024);
+  std::mt19937 rng(1);
+  std::exponential_distribution<double> interval_us(1000.0 / 1e6);  // 1000 cps
+  uint8_t payload[BIN_MAX_PAYLOAD], frame[BIN_FRAME_LEN(BIN_MAX_PAYLOAD)];
+  uint8_t seq = 0;
+  auto emit = [&](uint8_t type, size_t len) {
+    if (type == BIN_INFO)
+      seq = 0;
+    size_t n = bin_frame(type, seq++, payload, len, frame, sizeof(frame));
+    out.insert(out.end(), frame, frame + n);
+  };
+  emit(BIN_INFO, bin_info(BIN_INFO_PULSES, "V1.17.0-dev", payload, sizeof(payload)));
+  MeasurementRecord m{};
+  m.tube_nbr = 1;
+  m.status = MEAS_THP_VALID | MEAS_TIME_VALID;
+  m.utc = 1760000000;
+  uint32_t pulse = 0;
+  for (uint32_t i = 0; out.size() < bytes; i++) {
+    // every 250 ms: the pulses read_GMC drained, in batches of 64
+    uint32_t batch[64];
+    for (int b = 0; b < 4; b++) {
+      for (int k = 0; k < 64; k++)
+        batch[k] = (uint32_t)interval_us(rng);
+      emit(BIN_PULSES, bin_pulses(pulse, batch, 64, payload, sizeof(payload)));
+      pulse += 64;
+    }
+    if (i % 40 == 0) {  // live record every 10 s
+      m.seq = i / 40 + 1;
+      m.kind = RECORD_LIVE;
+      m.utc += 10;
+      m.uptime_ms = i * 250;
+      m.counts = 10000;
+      m.dt_ms = 10000;
+      m.cps = 1000.0f + (rng() % 100) / 10.0f;
+      m.cps_err = 10.0f;
+      m.cpm = 60000;
+      m.dose_uSvph = m.cps * 0.0057f;
+      m.total_counts = pulse;
+      m.total_ms = m.uptime_ms;
+      m.temperature = 21.5f + (rng() % 10) / 10.0f;
+      m.humidity = 45.0f;
+      m.pressure = 1013.25f;
+      emit(BIN_MEASUREMENT, bin_measurement(m, payload));
+      const char *text = "MQTT: published multigeiger/esp32-5622542/live/measurement (212 bytes)";
+      payload[0] = 1;
+      memcpy(payload + 1, text, strlen(text));
+      emit(BIN_LOG, strlen(text) + 1);
+    }
+  }
+  return out;
+}
+
+int main(int argc, char **argv) {
+  const char *input = nullptr;
+  std::string prefix;
+  bool bench = false, write = false;
+  double mb = 256, corrupt = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--out") && (i + 1 < argc)) {
+      prefix = argv[++i];
+      write = true;
+    } else if (!strcmp(argv[i], "--bench")) {
+      bench = true;
+    } else if (!strcmp(argv[i], "--mb") && (i + 1 < argc)) {
+      mb = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--corrupt") && (i + 1 < argc)) {
+      corrupt = atof(argv[++i]);
+    } else if ((argv[i][0] != '-') || !strcmp(argv[i], "-")) {
+      input = argv[i];
+    } else {
+      input = nullptr;
+      bench = false;
+      break;
+    }
+  }
+  if (!input && !bench) {
+    fprintf(stderr, "usage: %s CAPTURE|- [--out PREFIX]\n       %s --bench [--mb N] [--corrupt RATE]\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  Capture capture;
+  BinFrameDecoder decoder(on_frame, &capture);
+
+  if (bench) {
+    std::vector<uint8_t> data = synthetic((size_t)(mb * 1e6));
+    if (corrupt > 0) {
+      std::mt19937_64 rng(2);
+      size_t flips = (size_t)(data.size() * corrupt);
+      for (size_t i = 0; i < flips; i++)
+        data[rng() % data.size()] ^= 1 << (rng() % 8);
+      fprintf(stderr, "flipped %zu bits\n", flips);
+    }
+    // decoding and checking only, then decoding into the columns (memory bound for pulses)
+    capture.keep = false;
+    Clock::time_point t0 = Clock::now();
+    decoder.feed(data.data(), data.size());
+    summary(decoder, capture, std::chrono::duration<double>(Clock::now() - t0).count());
+    Capture columns;
+    BinFrameDecoder column_decoder(on_frame, &columns);
+    columns.pulses.reserve(data.size());
+    t0 = Clock::now();
+    column_decoder.feed(data.data(), data.size());
+    double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+    fprintf(stderr, "into columns: %.3f s, %.0f MB/s\n", seconds, data.size() / seconds / 1e6);
+    return 0;
+  }
+
+  FILE *f = strcmp(input, "-") ? fopen(input, "rb") : stdin;
+  if (!f) {
+    perror(input);
+    return 1;
+  }
+  if ((f != stdin) && !fseek(f, 0, SEEK_END)) {
+    capture.pulses.reserve(ftell(f));
+    rewind(f);
+  }
+  std::vector<uint8_t> buf(1 << 20);
+  Clock::time_point t0 = Clock::now();
+  size_t n;
+  while ((n = fread(buf.data(), 1, buf.size(), f)) > 0)
+    decoder.feed(buf.data(), n);
+  double seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+  if (f != stdin)
+    fclose(f);
+  summary(decoder, capture, seconds);
+  if (write && !write_csv(prefix, capture)) {
+    perror(prefix.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,217 @@
+// Host harness for the transmission queue (src/core/spsc_queue.hpp): a "main loop" with the firmware's
+// 1 s cadence hands a measurement to a transmission thread every MEASUREMENT_INTERVAL, the transmission
+// thread POSTs it to a deliberately slow local HTTP endpoint and then busy-waits like a LoRa TX timeout.
+// With --inline, the main loop does the uploads itself (like the firmware before the transmission task).
+//
+// Time runs --speed times faster than real time, all times printed are simulated.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++17 -pthread -Isrc -o uplink_sim tools/uplink_sim/uplink_sim.cpp
+// Run:
+//   ./uplink_sim [--http-ms MS] [--lora-ms MS] [--minutes M] [--speed X] [--inline]
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "core/spsc_queue.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+static double speed = 20.0;         // simulated ms per real ms
+static int http_ms = 5000;          // response time of the slow endpoint
+static int lora_ms = 30000;         // LORA_TIMEOUT_MS, the uplink waits this long for TX complete
+static const int LOOP_MS = 1000;    // main loop cadence
+static const int MEASUREMENT_S = 90;
+static const int HTTP_PAUSE_MS = 300;  // delay(300) between endpoints in transmit_data()
+
+static void sim_sleep(int ms) {
+  std::this_thread::sleep_for(std::chrono::microseconds((long)(ms * 1000 / speed)));
+}
+
+static double sim_now_ms(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count() * speed;
+}
+
+// --- fake slow HTTP endpoint ---
+
+static int listen_fd = -1;
+static int http_port = 0;
+static std::atomic<bool> server_stop{false};
+static std::atomic<int> requests{0};
+
+static void http_server() {
+  while (!server_stop) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    char buf[2048];
+    std::string req;
+    ssize_t n;
+    // headers + body are small, one request per connection
+    while ((req.find("\r\n\r\n") == std::string::npos) && ((n = read(fd, buf, sizeof(buf))) > 0))
+      req.append(buf, n);
+    sim_sleep(http_ms);
+    const char *resp = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    ssize_t w = write(fd, resp, strlen(resp));
+    (void)w;
+    close(fd);
+    requests++;
+  }
+}
+
+static int http_post(const std::string &body) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(http_port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  std::string req = "POST /v1/push-sensor-data/ HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n"
+                    "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  ssize_t w = write(fd, req.data(), req.size());
+  (void)w;
+  char buf[256] = {};
+  ssize_t n = read(fd, buf, sizeof(buf) - 1);
+  close(fd);
+  int status = -1;
+  if (n > 0)
+    sscanf(buf, "HTTP/1.1 %d", &status);
+  return status;
+}
+
+// --- the firmware side ---
+
+struct Measurement {
+  unsigned seq;
+  unsigned counts;
+  unsigned dt;
+};
+
+static SpscQueue<Measurement, 8> queue;
+static std::atomic<bool> tx_stop{false};
+static std::atomic<unsigned> sent{0};
+
+static void transmit_data(const Measurement &m) {
+  // same sequence of blocking calls as transmit_data() in wifi.cpp: 2 endpoints x (geiger + thp), then LoRa
+  std::string body = "{\"software_version\":\"uplink_sim\",\"sensordatavalues\":[{\"value_type\":\"counts_per_minute\",\"value\":\"" +
+                     std::to_string(m.counts * 60000ULL / m.dt) + "\"}]}";
+  for (int endpoint = 0; endpoint < 2; endpoint++) {
+    http_post(body);
+    http_post(body);
+    sim_sleep(HTTP_PAUSE_MS);
+  }
+  sim_sleep(lora_ms);
+  sent++;
+}
+
+static void transmit_task() {
+  Measurement m;
+  while (!tx_stop || queue.size()) {
+    while (queue.pop(m))
+      transmit_data(m);
+    sim_sleep(10);  // UPLINK_LMIC_POLL_MS
+  }
+}
+
+int main(int argc, char **argv) {
+  int minutes = 10;
+  bool inline_tx = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--http-ms") && i + 1 < argc)
+      http_ms = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--lora-ms") && i + 1 < argc)
+      lora_ms = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--minutes") && i + 1 < argc)
+      minutes = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--speed") && i + 1 < argc)
+      speed = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--inline"))
+      inline_tx = true;
+    else {
+      fprintf(stderr, "usage: %s [--http-ms MS] [--lora-ms MS] [--minutes M] [--speed X] [--inline]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 8) < 0 ||
+      getsockname(listen_fd, (sockaddr *)&addr, &len) < 0) {
+    perror("fake endpoint");
+    return 1;
+  }
+  http_port = ntohs(addr.sin_port);
+  std::thread server(http_server);
+  std::thread tx;
+  if (!inline_tx)
+    tx = std::thread(transmit_task);
+
+  printf("%s, endpoint %d ms, LoRa %d ms, %d min simulated\n",
+         inline_tx ? "inline uploads (old)" : "transmission task", http_ms, lora_ms, minutes);
+
+  Clock::time_point start = Clock::now();
+  std::vector<double> lateness;  // start of each loop vs. its 1 s slot
+  double next = 0;
+  unsigned counts = 0, last_counts = 0, seq = 0, skipped = 0;
+  int loops = minutes * 60 * 1000 / LOOP_MS;
+  for (int i = 1; i <= loops; i++) {
+    double now = sim_now_ms(start);
+    lateness.push_back(now - next);
+    if ((now - next) >= LOOP_MS) {
+      // like the scheduler: missed slots are skipped, not caught up
+      skipped += (unsigned)((now - next) / LOOP_MS);
+      next = now;
+    }
+
+    // "loopOnce": count, then maybe hand over a measurement
+    counts += 1 + (i % 3);
+    if ((i % (MEASUREMENT_S * 1000 / LOOP_MS)) == 0) {
+      Measurement m = {seq++, counts - last_counts, MEASUREMENT_S * 1000};
+      last_counts = counts;
+      if (inline_tx)
+        transmit_data(m);
+      else if (!queue.push(m))
+        printf("measurement %u dropped, queue full\n", m.seq);
+    }
+    next += LOOP_MS;
+    double wait = next - sim_now_ms(start);
+    if (wait > 0)
+      sim_sleep((int)wait);
+  }
+
+  tx_stop = true;
+  if (tx.joinable())
+    tx.join();
+  server_stop = true;
+  shutdown(listen_fd, SHUT_RDWR);
+  http_post("");  // unblock accept()
+  server.join();
+  close(listen_fd);
+
+  std::sort(lateness.begin(), lateness.end());
+  size_t late = std::count_if(lateness.begin(), lateness.end(), [](double l) { return l > 0.1 * LOOP_MS; });
+  printf("main loop lateness [ms]: median %.0f  p99 %.0f  max %.0f, %zu of %zu loops > 100 ms late, %u loops skipped\n",
+         lateness[lateness.size() / 2], lateness[lateness.size() * 99 / 100], lateness.back(), late, lateness.size(), skipped);
+  printf("measurements: %u produced, %u sent, %u dropped, queue high water %u of %u, %d HTTP requests\n",
+         seq, sent.load(), queue.dropped(), queue.highWater(), queue.capacity(), requests.load());
+  return 0;
+}